@@ -0,0 +1,114 @@
+// ELEC2645 Unit 2 Embedded Systems Project -- Engineering Toolkit
+// Designed by Qi Chang, Student id：201891723
+
+/* "make bench": times the header-only templates in electoolkit.hpp against  *
+ * the C entry points of libelectoolkit on the same data, and checks that    *
+ * they agree.  The C API takes doubles, so for int16 / float captures it is *
+ * timed both on a pre-converted copy and including the conversion (a copy   *
+ * into a buffer allocated beforehand, so no page faults are timed).        */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "electoolkit.hpp"
+
+namespace {
+
+constexpr std::size_t kSamples = 8u << 20;
+constexpr int kRepeats = 5;
+
+template <typename F>
+double best_of(F &&f)           /* fastest of kRepeats runs, seconds */
+{
+    double best = 1e30;
+    for (int r = 0; r < kRepeats; r++) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+bool close_to(double a, double b)
+{
+    return std::fabs(a - b) <= 1e-9 * std::fmax(1.0, std::fabs(b));
+}
+
+volatile double g_sink;         /* keeps the optimiser from dropping the work */
+
+template <typename T>
+void bench_type(const char *name, const std::vector<T> &x)
+{
+    std::vector<double> as_double(x.begin(), x.end());
+    EtkStats c{};
+    etk::basic_stats<T> t{};
+
+    std::vector<double> tmp(x.size());          /* allocated and touched once, outside the timing */
+    double c_time = best_of([&] { etk_stats(as_double.data(), as_double.size(), &c); g_sink = c.mean; });
+    double c_conv = best_of([&] {
+        std::copy(x.begin(), x.end(), tmp.begin());
+        etk_stats(tmp.data(), tmp.size(), &c);
+        g_sink = c.mean;
+    });
+    double t_time = best_of([&] { t = etk::stats(etk::span<T>(x)); g_sink = t.mean; });
+
+    bool same = close_to(t.mean, c.mean) && close_to(t.rms, c.rms) &&
+                static_cast<double>(t.min) == c.min && static_cast<double>(t.max) == c.max;
+    double mb = static_cast<double>(x.size() * sizeof(T)) / 1e6;
+    std::printf("%-8s %10.2f %12.2f %12.2f %11.2f %9.1fx %9.1fx   %s\n", name,
+                c_time * 1e3, c_conv * 1e3, t_time * 1e3, mb / t_time / 1e3,
+                c_time / t_time, c_conv / t_time, same ? "yes" : "NO");
+}
+
+}  // namespace
+
+int main()
+{
+    std::vector<std::int16_t> i16(kSamples);
+    std::vector<float> f32(kSamples);
+    std::vector<double> f64(kSamples);
+    std::uint32_t seed = 12345;
+    for (std::size_t i = 0; i < kSamples; i++) {
+        seed = seed * 1664525u + 1013904223u;                   /* LCG test signal */
+        double v = std::sin(static_cast<double>(i) * 0.001) * 20000.0 + static_cast<double>(seed >> 22) - 512.0;
+        i16[i] = static_cast<std::int16_t>(v);
+        f32[i] = static_cast<float>(v / 3.0);
+        f64[i] = v / 7.0;
+    }
+
+    std::printf("\nStatistics over %zu samples (best of %d runs)\n\n", kSamples, kRepeats);
+    std::printf("%-8s %10s %12s %12s %11s %10s %10s   %s\n", "type", "C (ms)", "C+conv (ms)",
+                "template(ms)", "GB/s", "vs C", "vs C+conv", "agree");
+    bench_type("int16", i16);
+    bench_type("float", f32);
+    bench_type("double", f64);
+
+    /* Percentiles: C on doubles vs the template on the native type */
+    std::vector<double> scratch_d(kSamples);
+    std::vector<std::int16_t> scratch_i(kSamples);
+    std::vector<double> i16_as_double(i16.begin(), i16.end());
+    EtkPercentiles pc{}, pt{};
+    double c_pct = best_of([&] { etk_percentiles(i16_as_double.data(), kSamples, scratch_d.data(), &pc); });
+    double t_pct = best_of([&] { pt = etk::percentiles(etk::span<std::int16_t>(i16), scratch_i.data()); });
+    std::printf("\nPercentiles int16: C %.2f ms, template %.2f ms (%.1fx), p99 %g / %g\n",
+                c_pct * 1e3, t_pct * 1e3, c_pct / t_pct, pc.p99, pt.p99);
+
+    /* Resistor decoding: constexpr table vs the C string tables */
+    const char *cb[4] = { "yellow", "violet", "orange", "gold" };
+    constexpr std::string_view tb[4] = { "yellow", "violet", "orange", "gold" };
+    double ohms = 0.0, tol = 0.0;
+    const int kDecodes = 1000000;
+    double c_dec = best_of([&] {
+        for (int i = 0; i < kDecodes; i++) { etk_resistor_decode(cb, 4, &ohms, &tol); g_sink = ohms; }
+    });
+    double t_dec = best_of([&] {
+        for (int i = 0; i < kDecodes; i++) { g_sink = etk::decode_resistor(tb).ohms; }
+    });
+    constexpr double folded = etk::decode_resistor(tb).ohms;     /* computed by the compiler */
+    std::printf("Resistor decode: C %.1f ns, constexpr template %.1f ns per call (47k = %g at compile time)\n",
+                c_dec / kDecodes * 1e9, t_dec / kDecodes * 1e9, folded);
+    return 0;
+}
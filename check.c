@@ -0,0 +1,927 @@
+// ELEC2645 Unit 2 Embedded Systems Project -- Engineering Toolkit
+// Designed by Qi Chang, Student id：201891723
+
+/* "make check": known-answer tests for the engines behind the menus.  The   *
+ * toolkit is built into this program from source (funcs.c is included, so  *
+ * its static helpers can be called directly); every failed assertion is     *
+ * printed and the exit status is non-zero if any failed.                    */
+
+#include "funcs.c"
+
+static int g_checks, g_failed;
+
+#define CHECK(cond, ...)                                                     \
+    do {                                                                     \
+        g_checks++;                                                          \
+        if (!(cond)) {                                                       \
+            g_failed++;                                                      \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);                      \
+            printf(__VA_ARGS__);                                             \
+            printf("\n");                                                    \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_NEAR(got, want, tol, what)                                     \
+    CHECK(fabs((got) - (want)) <= (tol), "%s = %.17g, want %.17g (+-%g)",    \
+          (what), (double)(got), (double)(want), (double)(tol))
+
+/* ---- Output formatting: must be byte-for-byte what printf would write ---- */
+static uint64_t g_rng = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t check_rand(void)          /* xorshift64, fixed seed: same cases every run */
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+static double check_rand_double(void)     /* mantissa and exponent spread over 1e-7 .. 1e17 */
+{
+    double m = (double)(check_rand() >> 11) * 0x1p-53;
+    int e = (int)(check_rand() % 25) - 7;
+    double x = m * pow(10.0, e);
+    return (check_rand() & 1) ? -x : x;
+}
+static int check_sig_digits(const char *text)   /* first to last non-zero digit of the mantissa */
+{
+    int first = -1, last = -1, n = 0;
+
+    for (const char *p = text; *p && *p != 'e'; p++) {
+        if (*p < '0' || *p > '9') continue;
+        if (*p != '0') {
+            if (first < 0) first = n;
+            last = n;
+        }
+        n++;
+    }
+    return first < 0 ? 1 : last - first + 1;
+}
+static void check_formatter_one(double x)
+{
+    char got[SA_FMT_MAX], want[SA_FMT_MAX];
+
+    for (int prec = 0; prec <= 12; prec++) {
+        sa_fmt_fixed(got, x, prec);
+        snprintf(want, sizeof(want), "%.*f", prec, x);
+        CHECK(strcmp(got, want) == 0, "fixed(%.17g, %d) = '%s', printf '%s'", x, prec, got, want);
+    }
+    for (int digits = 1; digits <= 17; digits++) {
+        sa_fmt_general(got, x, digits);
+        snprintf(want, sizeof(want), "%.*g", digits, x);
+        CHECK(strcmp(got, want) == 0, "general(%.17g, %d) = '%s', printf '%s'", x, digits, got, want);
+    }
+    if (isfinite(x)) {
+        int shortest = 17;                 /* fewest %g digits that read back exactly */
+        for (int digits = 1; digits < 17; digits++) {
+            snprintf(want, sizeof(want), "%.*g", digits, x);
+            if (strtod(want, NULL) == x) {
+                shortest = digits;
+                break;
+            }
+        }
+        snprintf(want, sizeof(want), "%.*g", shortest, x);
+        sa_fmt_shortest(got, x);
+        CHECK(strtod(got, NULL) == x, "shortest(%.17g) = '%s' does not read back", x, got);
+        CHECK(check_sig_digits(got) <= check_sig_digits(want),
+              "shortest(%.17g) = '%s', '%s' has fewer digits", x, got, want);
+    }
+}
+static void check_formatter(void)
+{
+    static const double edge[] = {
+        0.0, -0.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.375, 1e-4, 9.9999e-5, 0.00015,
+        9.5, 99.5, 999.95, 9.9999995, 1e15, 999999999999999.9, 123456789012345678.0,
+        0.1, 0.2, 0.3, 1.0 / 3.0, 2.0 / 3.0, M_PI, 5e-324, 1.7976931348623157e308,
+        INFINITY, -INFINITY, NAN
+    };
+
+    for (size_t i = 0; i < sizeof(edge) / sizeof(edge[0]); i++) {
+        check_formatter_one(edge[i]);
+    }
+    for (int i = 0; i < 20000; i++) {
+        check_formatter_one(check_rand_double());
+    }
+    for (int i = 0; i < 2000; i++) {      /* values with few digits land on ties */
+        double x = (double)(check_rand() % 200001) / 1000.0 - 100.0;
+        check_formatter_one(x);
+        check_formatter_one(x / 8.0);
+    }
+}
+
+/* ---- Multi-channel capture: one frame per line, failed loads keep the old data ---- */
+static int check_write_file(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) return 0;
+    fputs(text, fp);
+    fclose(fp);
+    return 1;
+}
+static void check_channels(void)
+{
+    char dir[] = "/tmp/etk_check_XXXXXX";
+    char good[64], wide[64], empty[64], line[1024];
+    SignalChannels mc;
+
+    if (!mkdtemp(dir)) {
+        CHECK(0, "mkdtemp: %s", strerror(errno));
+        return;
+    }
+    snprintf(good, sizeof(good), "%s/good.txt", dir);
+    snprintf(wide, sizeof(wide), "%s/wide.txt", dir);
+    snprintf(empty, sizeof(empty), "%s/empty.txt", dir);
+    /* header, a short row and a long row among four good frames */
+    check_write_file(good, "# t a b\n1 10 100\n2 20 200\n3 30\n4 40 400 4000\n5,50,500\n6 60 600");
+    check_write_file(empty, "no numbers here\n");
+    char *p = line;
+    for (int c = 0; c <= SA_MAX_CHANNELS; c++) p += sprintf(p, "%d ", c);
+    sprintf(p, "\n");
+    check_write_file(wide, line);
+
+    sa_ch_init(&mc);
+    int rc = sa_ch_load_file(&mc, good, 0);
+    CHECK(rc == SA_OK && mc.channels == 3 && mc.frames == 4 && mc.bad_rows == 2,
+          "good.txt: status %d, %d channels x %d frames, %lld bad rows", rc, mc.channels, mc.frames, mc.bad_rows);
+    if (rc == SA_OK) {
+        static const double want[3][4] = { { 1, 2, 5, 6 }, { 10, 20, 50, 60 }, { 100, 200, 500, 600 } };
+        for (int c = 0; c < 3; c++) {
+            for (int i = 0; i < 4; i++) {
+                CHECK(sa_ch_data(&mc, c)[i] == want[c][i], "channel %d frame %d = %g, want %g",
+                      c, i, sa_ch_data(&mc, c)[i], want[c][i]);
+            }
+        }
+    }
+    CHECK(sa_ch_load_file(&mc, wide, 0) == SA_ERR_FORMAT, "%d columns not reported as too many",
+          SA_MAX_CHANNELS + 1);
+    CHECK(sa_ch_load_file(&mc, empty, 0) == SA_ERR_EMPTY, "a file without numbers loaded");
+    CHECK(sa_ch_load_file(&mc, dir, 0) != SA_OK, "a directory loaded");
+    CHECK(mc.channels == 3 && mc.frames == 4 && sa_ch_data(&mc, 2)[3] == 600.0,
+          "failed loads replaced the capture: %d channels x %d frames", mc.channels, mc.frames);
+    sa_ch_free(&mc);
+
+    unlink(good);
+    unlink(wide);
+    unlink(empty);
+    rmdir(dir);
+}
+
+/* ---- Compressed captures: .etkz encode / decode is bit-exact ---- */
+static void check_codec(void)
+{
+    static const int formats[] = { SA_STORE_F32, SA_STORE_I32, SA_STORE_I16 };
+    const int n = 3 * 4096 + 777;                   /* a short last block */
+    char dir[] = "/tmp/etk_check_XXXXXX";
+    char path[64];
+
+    if (!mkdtemp(dir)) {
+        CHECK(0, "mkdtemp: %s", strerror(errno));
+        return;
+    }
+    snprintf(path, sizeof(path), "%s/capture.etkz", dir);
+
+    for (size_t fi = 0; fi < sizeof(formats) / sizeof(formats[0]); fi++) {
+        SignalCompact pk, back;
+        sa_compact_init(&pk, formats[fi], 0.001, -1.0);
+        sa_compact_init(&back, formats[fi], 1.0, 0.0);
+        if (!sa_compact_reserve(&pk, n)) {
+            CHECK(0, "out of memory");
+            return;
+        }
+        /* Block 0: a slow ramp with noise in the low bits (packs small).  *
+         * Block 1: constant.  Then raw bit patterns: full-width deltas,  *
+         * extreme codes, and for float32 NaN / inf patterns too.          */
+        size_t w = sa_compact_width(pk.format);
+        uint32_t v = 0;
+        for (int i = 0; i < n; i++) {
+            if (i < 4096) {
+                v = (uint32_t)(i * 3) + (uint32_t)(check_rand() & 7);
+            } else if (i >= 2 * 4096) {
+                v = (uint32_t)check_rand();
+            }
+            if (w == 2) {
+                ((uint16_t *)pk.data)[i] = (uint16_t)v;
+            } else {
+                ((uint32_t *)pk.data)[i] = v;
+            }
+        }
+        pk.count = n;
+
+        size_t bytes = 0;
+        int rc = sa_codec_write(&pk, path, &bytes);
+        CHECK(rc == SA_OK, "format %d: sa_codec_write returned %d", pk.format, rc);
+        rc = sa_codec_read(&back, path);
+        CHECK(rc == SA_OK, "format %d: sa_codec_read returned %d", pk.format, rc);
+        if (rc == SA_OK) {
+            CHECK(back.format == pk.format && back.count == n && back.scale == pk.scale &&
+                  back.offset == pk.offset, "format %d: read back as format %d, %d samples, %g * code + %g",
+                  pk.format, back.format, back.count, back.scale, back.offset);
+            CHECK(back.count == n && memcmp(back.data, pk.data, (size_t)n * w) == 0,
+                  "format %d: decoded samples differ", pk.format);
+        }
+        CHECK(bytes < (size_t)n * w, "format %d: %zu bytes for %zu raw", pk.format, bytes, (size_t)n * w);
+
+        if (pk.format != SA_STORE_F32) {            /* float32 patterns include NaN */
+            SignalChannelStats want, got;
+            long long count = 0;
+            sa_compact_stats(&pk, &want);
+            rc = sa_codec_stats(path, &got, &count);
+            CHECK(rc == SA_OK && count == n, "format %d: sa_codec_stats status %d, %lld samples",
+                  pk.format, rc, count);
+            CHECK_NEAR(got.mean, want.mean, 1e-9 * fabs(want.mean), "streamed mean");
+            CHECK(got.min == want.min && got.max == want.max, "format %d: streamed range %g .. %g, want %g .. %g",
+                  pk.format, got.min, got.max, want.min, want.max);
+        }
+
+        /* A cut-off file is refused, not decoded into garbage */
+        CHECK(truncate(path, (off_t)(bytes / 2)) == 0, "truncate: %s", strerror(errno));
+        CHECK(sa_codec_read(&back, path) != SA_OK, "format %d: a truncated file decoded", pk.format);
+        sa_compact_free(&pk);
+        sa_compact_free(&back);
+    }
+    unlink(path);
+    rmdir(dir);
+}
+
+/* ---- Result cache: XXH64 (seed 0) against the reference vectors ---- */
+static void check_xxh64(void)
+{
+    static const struct { const char *text; uint64_t want; } cases[] = {
+        { "",                                            0xef46db3751d8e999ULL },
+        { "abc",                                         0x44bc2cf5ad770999ULL },
+        { "The quick brown fox jumps over the lazy dog", 0x0b242d361fda71bcULL },
+    };
+    unsigned char buf[1027];
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint64_t h = sa_hash64(cases[i].text, strlen(cases[i].text));
+        CHECK(h == cases[i].want, "XXH64('%s') = %016llx, want %016llx", cases[i].text,
+              (unsigned long long)h, (unsigned long long)cases[i].want);
+    }
+
+    /* 0..255 four times then "xyz": whole stripes plus every tail length, *
+     * fed in uneven pieces so the partial-stripe buffer is exercised     */
+    for (size_t i = 0; i < 1024; i++) buf[i] = (unsigned char)i;
+    memcpy(buf + 1024, "xyz", 3);
+    CHECK(sa_hash64(buf, sizeof(buf)) == 0xe146cb31b65bc21aULL, "XXH64(1027 bytes) = %016llx",
+          (unsigned long long)sa_hash64(buf, sizeof(buf)));
+    for (size_t step = 1; step <= 40; step++) {
+        SaHash64 h;
+        sa_hash64_init(&h);
+        for (size_t at = 0; at < sizeof(buf); at += step) {
+            size_t n = sizeof(buf) - at < step ? sizeof(buf) - at : step;
+            sa_hash64_update(&h, buf + at, n);
+        }
+        CHECK(sa_hash64_final(&h) == 0xe146cb31b65bc21aULL, "XXH64 streamed in %zu-byte pieces = %016llx",
+              step, (unsigned long long)sa_hash64_final(&h));
+    }
+}
+
+/* ---- C library: etk_percentiles against a full sort ---- */
+static int check_cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+static double check_sorted_rank(const double *sorted, size_t n, double level)
+{
+    double rank = level * (double)(n - 1);
+    size_t k = (size_t)rank;
+    double frac = rank - (double)k;
+    double v = sorted[k];
+    return (frac > 0.0 && k + 1 < n) ? v + frac * (sorted[k + 1] - v) : v;
+}
+static void check_percentiles(void)
+{
+    static const size_t sizes[] = { 1, 2, 3, 10, 999, 1000, 1001, 65537 };
+    static const double levels[4] = { 0.50, 0.95, 0.99, 0.999 };
+    size_t max = 65537;
+    double *x = malloc(max * sizeof(double));
+    double *scratch = malloc(max * sizeof(double));
+    double *sorted = malloc(max * sizeof(double));
+    EtkPercentiles pct;
+
+    if (!x || !scratch || !sorted) {
+        CHECK(0, "out of memory");
+        free(x);
+        free(scratch);
+        free(sorted);
+        return;
+    }
+    for (size_t si = 0; si < sizeof(sizes) / sizeof(sizes[0]); si++) {
+        size_t n = sizes[si];
+        for (int shape = 0; shape < 4; shape++) {       /* random, few distinct, ascending, descending */
+            for (size_t i = 0; i < n; i++) {
+                switch (shape) {
+                    case 0:  x[i] = check_rand_double(); break;
+                    case 1:  x[i] = (double)(check_rand() % 7); break;
+                    case 2:  x[i] = (double)i * 0.5; break;
+                    default: x[i] = (double)(n - i); break;
+                }
+            }
+            memcpy(sorted, x, n * sizeof(double));
+            qsort(sorted, n, sizeof(double), check_cmp_double);
+
+            for (int in_place = 0; in_place < 2; in_place++) {
+                if (in_place) memcpy(scratch, x, n * sizeof(double));
+                int rc = etk_percentiles(in_place ? scratch : x, n, scratch, &pct);
+                const double got[4] = { pct.p50, pct.p95, pct.p99, pct.p999 };
+                CHECK(rc == ETK_OK, "etk_percentiles(n=%zu) returned %d", n, rc);
+                for (int q = 0; q < 4; q++) {
+                    double want = check_sorted_rank(sorted, n, levels[q]);
+                    CHECK(got[q] == want, "n=%zu shape %d%s: P%g = %.17g, sorted %.17g", n, shape,
+                          in_place ? " in place" : "", levels[q] * 100.0, got[q], want);
+                }
+            }
+        }
+    }
+    CHECK(etk_percentiles(x, 0, scratch, &pct) == ETK_ERR_EMPTY, "n=0 is not ETK_ERR_EMPTY");
+    CHECK(etk_percentiles(NULL, 1, scratch, &pct) == ETK_ERR_ARG, "NULL x is not ETK_ERR_ARG");
+    free(x);
+    free(scratch);
+    free(sorted);
+}
+
+/* ---- Histogram: out-of-range and infinite values land in the end bins ---- */
+static void check_histogram(void)
+{
+    const double x[] = { 0.0, 0.5, 1.0, 9.99, 10.0, -1.0, 11.0, -1e300, 1e300,
+                         -INFINITY, INFINITY, NAN, 4.0 };
+    const long long want[10] = { 5, 1, 0, 0, 1, 0, 0, 0, 0, 5 };
+    long long bins[10];
+
+    CHECK(etk_histogram(x, sizeof(x) / sizeof(x[0]), 0.0, 10.0, bins, 10) == ETK_OK,
+          "etk_histogram did not return ETK_OK");
+    for (int b = 0; b < 10; b++) {
+        CHECK(bins[b] == want[b], "bin %d = %lld, want %lld", b, bins[b], want[b]);
+    }
+    /* A zero-width range puts every sample, infinite or not, in bin 0 */
+    CHECK(etk_histogram(x, sizeof(x) / sizeof(x[0]), 5.0, 5.0, bins, 10) == ETK_OK,
+          "etk_histogram(min == max) did not return ETK_OK");
+    CHECK(bins[0] == 12, "min == max: bin 0 = %lld, want 12", bins[0]);
+}
+
+/* ---- Signal analyzer: RC / Butterworth / FIR gain at known frequencies ---- */
+static double check_filter_gain(SaFilter *f, double freq, double fs)
+{
+    enum { SETTLE = 20000, SPAN = 4800 };         /* SPAN: whole periods of every test tone */
+    static double x[SETTLE + SPAN];
+    double re = 0.0, im = 0.0;
+
+    for (int i = 0; i < SETTLE + SPAN; i++) {
+        x[i] = sin(2.0 * M_PI * freq * i / fs);
+    }
+    for (int i = 0; i < SETTLE + SPAN; i += 777) {  /* odd blocks: state carries across calls */
+        int m = (SETTLE + SPAN - i < 777) ? SETTLE + SPAN - i : 777;
+        sa_filter_process(f, x + i, x + i, (size_t)m);
+    }
+    for (int i = SETTLE; i < SETTLE + SPAN; i++) {
+        re += x[i] * sin(2.0 * M_PI * freq * i / fs);
+        im += x[i] * cos(2.0 * M_PI * freq * i / fs);
+    }
+    return 2.0 * sqrt(re * re + im * im) / SPAN;
+}
+static void check_filters(void)
+{
+    const double fs = 48000.0;
+    static const double tones[] = { 250.0, 1000.0, 2000.0, 4000.0, 10000.0 };
+    const size_t ntones = sizeof(tones) / sizeof(tones[0]);
+    SaFilter f;
+    char what[64];
+
+    /* RC: y += a (x - y) has |H| = a / |1 - (1 - a) e^-jw| */
+    const double R = 1e3, C = 1e-6;
+    for (size_t t = 0; t < ntones; t++) {
+        sa_filter_init_rc(&f, R, C, fs);
+        double a = f.rc_alpha, w = 2.0 * M_PI * tones[t] / fs;
+        double want = a / hypot(1.0 - (1.0 - a) * cos(w), (1.0 - a) * sin(w));
+        snprintf(what, sizeof(what), "RC gain at %g Hz", tones[t]);
+        CHECK_NEAR(check_filter_gain(&f, tones[t], fs), want, 1e-6, what);
+    }
+
+    /* Butterworth: the bilinear transform maps f to tan(pi f / fs), so the *
+     * gain is 1 / sqrt(1 + (W / Wc)^2N) with -3 dB exactly at fc.          */
+    const double fc = 1000.0, wc = tan(M_PI * fc / fs);
+    for (int highpass = 0; highpass < 2; highpass++) {
+        const int order = highpass ? 6 : 4;
+        for (size_t t = 0; t < ntones; t++) {
+            CHECK(sa_filter_init_butterworth(&f, highpass, order, fc, fs), "Butterworth design failed");
+            double ratio = tan(M_PI * tones[t] / fs) / wc;
+            double want = 1.0 / sqrt(1.0 + pow(highpass ? 1.0 / ratio : ratio, 2.0 * order));
+            snprintf(what, sizeof(what), "Butterworth %s order %d at %g Hz", highpass ? "HP" : "LP", order, tones[t]);
+            CHECK_NEAR(check_filter_gain(&f, tones[t], fs), want, 1e-6, what);
+        }
+    }
+    CHECK(!sa_filter_init_butterworth(&f, 0, 3, fc, fs), "odd Butterworth order accepted");
+    CHECK(!sa_filter_init_butterworth(&f, 0, 4, fs / 2.0, fs), "Butterworth fc at Nyquist accepted");
+
+    /* FIR: the measured gain is |sum h[i] e^-jwi| of the designed taps; *
+     * unity at DC, about -6 dB at fc, and Hamming's ~-53 dB stop band.  */
+    const int ntaps = 101;
+    const double fir_fc = 2000.0;
+    for (size_t t = 0; t < ntones; t++) {
+        if (!sa_filter_init_fir(&f, ntaps, fir_fc, fs)) {
+            CHECK(0, "FIR design failed");
+            sa_filter_free(&f);
+            break;
+        }
+        double re = 0.0, im = 0.0, w = 2.0 * M_PI * tones[t] / fs;
+        for (int i = 0; i < ntaps; i++) {
+            re += f.taps[i] * cos(w * i);
+            im += f.taps[i] * sin(w * i);
+        }
+        double want = hypot(re, im);
+        double got = check_filter_gain(&f, tones[t], fs);
+        snprintf(what, sizeof(what), "FIR gain at %g Hz", tones[t]);
+        CHECK_NEAR(got, want, 1e-9, what);
+        if (tones[t] == 250.0) CHECK_NEAR(got, 1.0, 5e-3, "FIR pass-band gain");
+        if (tones[t] == fir_fc) CHECK_NEAR(got, 0.5, 0.01, "FIR gain at fc");
+        if (tones[t] == 10000.0) CHECK(got < 0.003, "FIR stop-band gain %g", got);
+        sa_filter_free(&f);
+    }
+    CHECK(!sa_filter_init_fir(&f, 100, fir_fc, fs), "even FIR length accepted");
+    sa_filter_free(&f);
+}
+
+/* ---- Signal analyzer: resampler output length and tone frequency ---- */
+static double check_tone_level(const double *y, int count, double cycles_per_sample, int skip, int unit)
+{
+    int w = (count - 2 * skip) / unit * unit;     /* whole periods of the tone */
+    double re = 0.0, im = 0.0;
+
+    for (int i = skip; i < skip + w; i++) {
+        re += y[i] * sin(2.0 * M_PI * cycles_per_sample * i);
+        im += y[i] * cos(2.0 * M_PI * cycles_per_sample * i);
+    }
+    return w > 0 ? 2.0 * sqrt(re * re + im * im) / w : 0.0;
+}
+static void check_resampler(void)
+{
+    static const struct { int L, M; } ratios[] = {
+        { 3, 2 }, { 2, 3 }, { 1, 4 }, { 5, 1 }, { 147, 160 }, { 4, 6 },
+    };
+    const double fs = 48000.0, tone = 1000.0;
+    const int n = 10000;
+    SignalContext ctx;
+
+    sa_ctx_init(&ctx);
+    for (size_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++) {
+        int L = ratios[r].L, M = ratios[r].M;
+        sa_signal_clear(&ctx.sig);
+        for (int i = 0; i < n; i++) {
+            sa_signal_append(&ctx.sig, sin(2.0 * M_PI * tone * i / fs));
+        }
+        int rc = sa_ctx_resample(&ctx, L, M);
+        CHECK(rc == SA_OK, "sa_ctx_resample(%d/%d) returned %d", L, M, rc);
+        if (rc != SA_OK) continue;
+
+        int want = (int)(((long long)n * L + M - 1) / M);
+        CHECK(ctx.sig.count == want, "%d/%d: %d outputs, want %d", L, M, ctx.sig.count, want);
+
+        /* 1 kHz at fs * L / M: 48 L / M samples per period, so 48 L samples *
+         * (reduced ratio) are whole periods.  The tone keeps its level and  *
+         * carries almost all the power away from the ends.                  */
+        int g = sa_gcd(L, M);
+        double cps = tone / (fs * L / M);
+        double level = check_tone_level(ctx.sig.samples, ctx.sig.count, cps, 200, 48 * L / g);
+        double power = 0.0;
+        for (int i = 200; i < ctx.sig.count - 200; i++) {
+            power += ctx.sig.samples[i] * ctx.sig.samples[i];
+        }
+        power /= ctx.sig.count - 400;
+        char what[64];
+        snprintf(what, sizeof(what), "%d/%d: 1 kHz level", L, M);
+        CHECK_NEAR(level, 1.0, 5e-3, what);
+        CHECK(level * level / 2.0 > 0.999 * power, "%d/%d: tone holds %.5f of the power", L, M,
+              level * level / 2.0 / power);
+    }
+
+    /* Decimating by 4 puts Nyquist at 6 kHz: a 10 kHz tone must not alias to 2 kHz */
+    sa_signal_clear(&ctx.sig);
+    for (int i = 0; i < n; i++) {
+        sa_signal_append(&ctx.sig, sin(2.0 * M_PI * 10000.0 * i / fs));
+    }
+    CHECK(sa_ctx_resample(&ctx, 1, 4) == SA_OK, "sa_ctx_resample(1/4) failed");
+    double alias = check_tone_level(ctx.sig.samples, ctx.sig.count, 2000.0 / 12000.0, 200, 6);
+    CHECK(alias < 0.005, "10 kHz decimated by 4: %g at the 2 kHz alias", alias);
+    sa_signal_clear(&ctx.sig);
+    CHECK(sa_ctx_resample(&ctx, 2, 1) == SA_ERR_EMPTY, "an empty store is not SA_ERR_EMPTY");
+    sa_ctx_free(&ctx);
+}
+
+/* ---- Signal analyzer: cross-correlation recovers a known delay ---- */
+static void check_xcorr_case(int delay, double gain, double noise)
+{
+    SignalContext a, b;
+    SignalXcorr xc;
+    int n = 20000;
+
+    sa_ctx_init(&a);
+    sa_ctx_init(&b);
+    /* A: smoothed noise so neighbouring lags are correlated too.        *
+     * B[i] = gain * A[i - delay] + noise, i.e. B[n + delay] ~ A[n].     */
+    double *src = malloc((size_t)(n + delay) * sizeof(double));
+    double y = 0.0;
+    for (int i = 0; src && i < n + delay; i++) {
+        y = 0.7 * y + (double)(check_rand() >> 11) * 0x1p-53 - 0.5;
+        src[i] = y;
+    }
+    for (int i = 0; src && i < n; i++) {
+        double jitter = noise * ((double)(check_rand() >> 11) * 0x1p-53 - 0.5);
+        sa_signal_append(&a.sig, src[i + delay]);
+        sa_signal_append(&b.sig, gain * src[i] + jitter);
+    }
+
+    int rc = sa_ctx_xcorr(&a, &b, 200, 256, &xc);
+    CHECK(rc == SA_OK, "sa_ctx_xcorr(delay %d) returned %d", delay, rc);
+    if (rc == SA_OK) {
+        CHECK(xc.peak_lag == delay, "delay %d gain %g: peak lag %d", delay, gain, xc.peak_lag);
+        CHECK_NEAR(xc.delay, (double)delay, 0.25, "refined delay");
+        CHECK((gain < 0) == (xc.peak_r < 0), "delay %d gain %g: peak r %g has the wrong sign",
+              delay, gain, xc.peak_r);
+        CHECK(fabs(xc.peak_r) > (noise > 0 ? 0.9 : 0.98), "delay %d: |peak r| = %g", delay, xc.peak_r);
+    }
+    sa_xcorr_free(&xc);
+    free(src);
+    sa_ctx_free(&a);
+    sa_ctx_free(&b);
+}
+static void check_xcorr(void)
+{
+    check_xcorr_case(0, 1.0, 0.0);
+    check_xcorr_case(37, 1.0, 0.0);
+    check_xcorr_case(150, -0.5, 0.0);           /* inverted and attenuated */
+    check_xcorr_case(91, 2.0, 0.5);             /* with uncorrelated noise */
+}
+
+/* ---- Signal analyzer: event detection on a square wave with known faults ---- */
+static void check_events(void)
+{
+    const int period = 200, periods = 10;
+    SignalContext ctx;
+    SignalEventConfig cfg = { -0.8, 0.8, 5.0, 0.05, 50 };
+    SignalEventList ev;
+
+    /* +-1 square wave, edges ramped linearly over 10 samples (10 % .. 90 % *
+     * takes 8), a 3-sample dip to -1 in period 3 and 70 samples of 0 in    *
+     * period 6.                                                            */
+    sa_ctx_init(&ctx);
+    for (int i = 0; i < period * periods; i++) {
+        int t = i % period;
+        double v = (t < 10) ? -1.0 + 0.2 * (t + 0.5) : (t < 100) ? 1.0 :
+                   (t < 110) ? 1.0 - 0.2 * (t - 100 + 0.5) : -1.0;
+        if (i / period == 3 && t >= 50 && t < 53) v = -1.0;
+        if (i / period == 6 && t >= 20 && t < 90) v = 0.0;
+        sa_signal_append(&ctx.sig, v);
+    }
+
+    int rc = sa_ctx_events(&ctx, &cfg, &ev);
+    CHECK(rc == SA_OK, "sa_ctx_events returned %d", rc);
+    if (rc == SA_OK) {
+        CHECK(ev.total[SA_EVT_RISE] == periods && ev.total[SA_EVT_FALL] == periods &&
+              ev.total[SA_EVT_GLITCH] == 1 && ev.total[SA_EVT_DROPOUT] == 1,
+              "%lld rises, %lld falls, %lld glitches, %lld dropouts", ev.total[SA_EVT_RISE],
+              ev.total[SA_EVT_FALL], ev.total[SA_EVT_GLITCH], ev.total[SA_EVT_DROPOUT]);
+        for (int k = 0; k < 2; k++) {
+            CHECK(ev.trans_n[k] == periods, "%s times: %lld measured", k ? "fall" : "rise", ev.trans_n[k]);
+            CHECK_NEAR(ev.trans_min[k], 8.0, 1e-9, k ? "shortest fall time" : "shortest rise time");
+            CHECK_NEAR(ev.trans_max[k], 8.0, 1e-9, k ? "longest fall time" : "longest rise time");
+        }
+        for (size_t k = 0; k < ev.count; k++) {
+            const SignalEvent *e = &ev.events[k];
+            if (e->kind == SA_EVT_GLITCH) {
+                CHECK(e->polarity == -1, "glitch polarity %d", e->polarity);
+                CHECK_NEAR(e->time, 3 * period + 49.9, 1e-9, "glitch time");
+                CHECK_NEAR(e->duration, 3.0, 1e-9, "glitch width");
+            } else if (e->kind == SA_EVT_DROPOUT) {
+                CHECK(e->start == 6 * period + 20 && e->end == 6 * period + 90,
+                      "dropout [%lld, %lld)", e->start, e->end);
+            }
+        }
+        CHECK(ev.dropout_samples == 70, "%lld dropout samples", ev.dropout_samples);
+    }
+    sa_events_free(&ev);
+
+    /* Without the glitch test the dip is two more edges; a longer minimum hides the dropout */
+    cfg.glitch_width = 0.0;
+    cfg.dropout_min = 100;
+    rc = sa_ctx_events(&ctx, &cfg, &ev);
+    CHECK(rc == SA_OK && ev.total[SA_EVT_RISE] == periods + 1 && ev.total[SA_EVT_FALL] == periods + 1 &&
+          ev.total[SA_EVT_GLITCH] == 0 && ev.total[SA_EVT_DROPOUT] == 0,
+          "no glitch test: status %d, %lld rises, %lld falls, %lld glitches, %lld dropouts", rc,
+          ev.total[SA_EVT_RISE], ev.total[SA_EVT_FALL], ev.total[SA_EVT_GLITCH], ev.total[SA_EVT_DROPOUT]);
+    sa_events_free(&ev);
+
+    cfg.lo = cfg.hi;
+    CHECK(sa_ctx_events(&ctx, &cfg, &ev) == SA_ERR_FORMAT, "lo == hi accepted");
+    sa_ctx_free(&ctx);
+    sa_ctx_init(&ctx);
+    cfg.lo = -0.8;
+    CHECK(sa_ctx_events(&ctx, &cfg, &ev) == SA_ERR_EMPTY, "an empty capture is not SA_ERR_EMPTY");
+    sa_ctx_free(&ctx);
+}
+
+/* ---- Circuit calculator: transient simulation of an RC step ---- */
+static void check_transient_rc(void)
+{
+    const double R = 1e3, C = 1e-6, tau = R * C, fs = 100e3, delay = 0.2e-3;
+    CcLadderSection rc = { R, 0.0, C, 0.0 };
+    CcTransientConfig cfg;
+    CcTransientStats st;
+    SignalContext out;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.section = &rc;
+    cfg.nsections = 1;
+    cfg.probe = 1;
+    cfg.source = CC_SRC_STEP;
+    cfg.v1 = 0.0;
+    cfg.v2 = 5.0;
+    cfg.delay = delay;
+    cfg.sample_rate = fs;
+    cfg.duration = 8.0 * tau;
+    sa_ctx_init(&out);
+
+    int rc_status = cc_transient(&cfg, &out, NULL, &st);
+    CHECK(rc_status == SA_OK, "cc_transient(RC step) returned %d", rc_status);
+    CHECK(out.sig.count == (int)(cfg.duration * fs + 0.5) + 1, "RC step: %d samples", out.sig.count);
+
+    double worst = 0.0, worst_t = 0.0;
+    for (int i = 0; i < out.sig.count; i++) {
+        double t = i / fs;
+        if (fabs(t - delay) < 0.5 / fs) continue;       /* the sample on the edge itself */
+        double want = (t < delay) ? 0.0 : 5.0 * (1.0 - exp(-(t - delay) / tau));
+        double err = fabs(out.sig.samples[i] - want);
+        if (err > worst) {
+            worst = err;
+            worst_t = t;
+        }
+    }
+    /* default reltol 1e-4 per step; the error stays near 1.5e-5 V */
+    CHECK(worst <= 2e-4, "RC step: error %.3g V at t = %.6g s", worst, worst_t);
+    sa_ctx_free(&out);
+}
+
+/* ---- Circuit calculator: Bode sweep of an RC filter ---- */
+static void check_bode_rc(void)
+{
+    const double R = 4.7e3, C_uF = 0.1;
+    const double fc = 1.0 / (2.0 * M_PI * R * C_uF * 1e-6);      /* 338.6 Hz */
+    CcAnalogFilter flt;
+    CcBodeResult res;
+
+    for (int highpass = 0; highpass < 2; highpass++) {
+        CHECK(cc_filter_rc(&flt, R, C_uF, highpass), "cc_filter_rc(highpass %d) failed", highpass);
+        int rc = cc_bode_sweep(&flt, 1.0, 1e6, 200001, NULL, CC_BODE_BINARY, &res);
+        CHECK(rc == SA_OK, "cc_bode_sweep(RC, highpass %d) returned %d", highpass, rc);
+        if (rc != SA_OK) continue;
+
+        /* -3 dB is 10 log10(2) = 3.0103 dB below the pass band; the sweep *
+         * steps 0.007 % in frequency, so the crossing is located to that  */
+        double f3 = highpass ? res.f_low_3db : res.f_high_3db;
+        CHECK_NEAR(f3, fc, fc * 1e-4, highpass ? "RC high-pass -3 dB frequency" : "RC low-pass -3 dB frequency");
+        CHECK_NEAR(res.peak_db, 0.0, 1e-3, "RC pass-band gain, dB");
+        CHECK((highpass ? res.f_high_3db : res.f_low_3db) == 0.0,
+              "RC highpass %d: a second -3 dB point inside the sweep", highpass);
+    }
+}
+
+/* ---- 6. Engineering calculator (expression engine) ---- */
+static double check_expr(const char *text, int *ok)
+{
+    EcProgram prog;
+    char err[128] = "";
+
+    *ok = ec_compile(text, NULL, 0, &prog, err, sizeof(err));
+    return *ok ? ec_eval(&prog, NULL) : NAN;
+}
+static void check_expressions(void)
+{
+    static const struct { const char *text; double want; } cases[] = {
+        { "1/(2*pi*4.7k*100n)", 338.62753849339435 },
+        { "2^3^2",              512.0 },          /* right-associative */
+        { "-2^2",               -4.0 },           /* unary minus binds looser than ^ */
+        { "(1+2)*3 - 4/8",      8.5 },
+        { "par(1k, 1k)",        500.0 },
+    };
+    static const char *const malformed[] = { "", "1+", "(1+2", "2*)", "1 2", "sqrt(", "4.7k*" };
+    int ok;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        double v = check_expr(cases[i].text, &ok);
+        CHECK(ok, "'%s' did not compile", cases[i].text);
+        CHECK_NEAR(v, cases[i].want, 1e-12 * fabs(cases[i].want), cases[i].text);
+    }
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        check_expr(malformed[i], &ok);
+        CHECK(!ok, "malformed '%s' was accepted", malformed[i]);
+    }
+}
+/* The block evaluator used by the sweep must give the same bits as ec_eval */
+static void check_expression_batch(void)
+{
+    static const char *const exprs[] = { "x^0.5", "x^2", "2^x", "(x+1)^-1.5", "sqrt(x)/3 - x*x" };
+    static const double special[] = { -0.0, 0.0, -INFINITY, INFINITY, NAN, -1.0, 1e-300, 4.0 };
+    enum { N = 600 };                       /* more than two EC_BLOCKs */
+    static double x[N], batch[N];
+    const double *vars[1] = { x };
+
+    for (int i = 0; i < N; i++) {
+        x[i] = (i < (int)(sizeof(special) / sizeof(special[0]))) ? special[i] : check_rand_double();
+    }
+    for (size_t e = 0; e < sizeof(exprs) / sizeof(exprs[0]); e++) {
+        EcProgram prog;
+        char err[128] = "";
+        int ok = ec_compile(exprs[e], NULL, 0, &prog, err, sizeof(err));
+        CHECK(ok, "'%s' did not compile: %s", exprs[e], err);
+        if (!ok) continue;
+
+        ec_eval_batch(&prog, vars, N, batch);
+        for (int i = 0; i < N; i++) {
+            double one = ec_eval(&prog, &x[i]);
+            CHECK(memcmp(&one, &batch[i], sizeof(double)) == 0 || (isnan(one) && isnan(batch[i])),
+                  "'%s' at x = %g: batch %.17g, scalar %.17g", exprs[e], x[i], batch[i], one);
+        }
+    }
+}
+
+/* ---- Server: requests through srv_serve_connection() on a socketpair ---- */
+/* Send `req` (len bytes) as one client session, then read every reply.    *
+ * The requests and replies must fit the socket buffers (a few 100 KiB).   */
+static size_t check_srv_session(const char *req, size_t len, char *reply, size_t cap)
+{
+    SrvServer srv;
+    SrvWorker w;
+    int sv[2];
+    size_t got = 0;
+
+    reply[0] = '\0';
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        CHECK(0, "socketpair: %s", strerror(errno));
+        return 0;
+    }
+    memset(&srv, 0, sizeof(srv));
+    memset(&w, 0, sizeof(w));
+    srv.workers = &w;
+    srv.nworkers = 1;
+    srv.started = sa_live_now();
+    w.srv = &srv;
+    atomic_init(&w.fd, -1);
+    w.in = malloc(SRV_IN_SIZE);
+    w.out.fd = -1;
+    sa_ctx_init(&w.ctx);
+
+    for (size_t done = 0; done < len; ) {
+        ssize_t n = write(sv[0], req + done, len - done);
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    shutdown(sv[0], SHUT_WR);               /* the worker sees EOF after the last request */
+    if (w.in && sa_out_need(&w.out, 1)) {
+        srv_serve_connection(&w, sv[1]);
+    }
+    close(sv[1]);
+    for (;;) {
+        ssize_t n = read(sv[0], reply + got, cap - 1 - got);
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    reply[got] = '\0';
+    close(sv[0]);
+    free(w.in);
+    sa_out_release(&w.out);
+    sa_ctx_free(&w.ctx);
+    return got;
+}
+static char *check_repeat(char *p, char c, int n)
+{
+    memset(p, c, (size_t)n);
+    return p + n;
+}
+static void check_server_requests(void)
+{
+    static const char req[] =
+        "PING\nping\r\n\n   \nFOO bar\n"
+        "CONVERT dbm-mw 10\nCONVERT nope 1\nCONVERT dbm-mw\n"
+        "RESISTOR brown black red gold\nRESISTOR pink\n"
+        "CIRCUIT rc 4.7k 0.1\nCIRCUIT rc 1 2 3\nCIRCUIT zz 1\nCIRCUIT ohm v 2 3\n"
+        "EVAL 1/(2*pi*R*C); R=4.7k; C=100n\nEVAL x+1\nEVAL 1+\nEVAL 1; R\n"
+        "QUIT\nPING\n";                          /* nothing after QUIT is answered */
+    static const char want[] =
+        "OK pong\nOK pong\nERR empty request\nERR empty request\nERR unknown command\n"
+        "OK value=10 unit=mW\nERR unknown conversion\nERR usage: CONVERT <name> <value>\n"
+        "OK ohms=1000 tolerance=5\nERR usage: RESISTOR <4 or 5 colours>\n"
+        "OK fc=338.62753849339435\nERR usage: CIRCUIT rc <R> <C_uF>\nERR unknown circuit formula\nOK v=6\n"
+        "OK value=338.6275384933943\nERR unbound variable x\nERR unexpected end of expression\n"
+        "ERR binding must be name=value\n";
+    char reply[4096];
+
+    check_srv_session(req, sizeof(req) - 1, reply, sizeof(reply));
+    CHECK(strcmp(reply, want) == 0, "pipelined requests answered:\n%s", reply);
+
+    /* A line that just fits the read buffer is served; one byte more is    *
+     * refused and the connection is closed.                                */
+    char *big = malloc(2 * SRV_IN_SIZE + 64);
+    if (!big) {
+        CHECK(0, "out of memory");
+        return;
+    }
+    char *p = big;
+    p += sprintf(p, "PING");
+    p = check_repeat(p, ' ', SRV_IN_SIZE - 5);
+    *p++ = '\n';
+    p += sprintf(p, "PING");
+    p = check_repeat(p, ' ', SRV_IN_SIZE - 4);
+    p += sprintf(p, "\nPING\n");
+    check_srv_session(big, (size_t)(p - big), reply, sizeof(reply));
+    CHECK(strcmp(reply, "OK pong\nERR request line too long\n") == 0, "long lines answered '%s'", reply);
+    free(big);
+}
+static void check_server_nesting(void)
+{
+    enum { DEEP = 60000 };
+    char *req = malloc(2 * DEEP + 256);
+    char reply[4096];
+
+    if (!req) {
+        CHECK(0, "out of memory");
+        return;
+    }
+    /* Deep nesting must be refused, not recurse off the stack; the     *
+     * connection keeps working afterwards.                             */
+    char *p = req;
+    p += sprintf(p, "EVAL ");
+    p = check_repeat(p, '(', DEEP);         /* the line must stay under SRV_IN_SIZE */
+    p += sprintf(p, "1\n");
+    p += sprintf(p, "CIRCUIT rc ");
+    p = check_repeat(p, '-', DEEP);
+    p += sprintf(p, "1 1\nPING\n");
+    check_srv_session(req, (size_t)(p - req), reply, sizeof(reply));
+    CHECK(strcmp(reply, "ERR expression nested too deeply\nERR usage: CIRCUIT rc <R> <C_uF>\nOK pong\n") == 0,
+          "deeply nested requests answered '%s'", reply);
+
+    /* ... while ordinary nesting still evaluates */
+    p = req;
+    p += sprintf(p, "EVAL ");
+    p = check_repeat(p, '(', 100);
+    p += sprintf(p, "-2^2");
+    p = check_repeat(p, ')', 100);
+    p += sprintf(p, "\n");
+    check_srv_session(req, (size_t)(p - req), reply, sizeof(reply));
+    CHECK(strcmp(reply, "OK value=-4\n") == 0, "100 brackets answered '%s'", reply);
+    free(req);
+}
+
+static void check_server_analyze(void)
+{
+    char dir[] = "/tmp/etk_check_XXXXXX";
+    char fifo[64], data[64], req[512], reply[1024];
+
+    if (!mkdtemp(dir)) {
+        CHECK(0, "mkdtemp: %s", strerror(errno));
+        return;
+    }
+    snprintf(fifo, sizeof(fifo), "%s/pipe", dir);
+    snprintf(data, sizeof(data), "%s/data.txt", dir);
+    FILE *fp = fopen(data, "w");
+    if (fp) {
+        fputs("1\n2\n3\n", fp);
+        fclose(fp);
+    }
+    CHECK(mkfifo(fifo, 0600) == 0, "mkfifo: %s", strerror(errno));
+
+    /* A FIFO nobody writes to, /dev/zero or a directory must be refused at  *
+     * once - reading them would hold the worker forever.                  */
+    int len = snprintf(req, sizeof(req), "ANALYZE %s\nANALYZE /dev/zero\nANALYZE %s\nANALYZE %s\n",
+                       fifo, dir, data);
+    check_srv_session(req, (size_t)len, reply, sizeof(reply));
+    const char *want = "ERR not a regular file\nERR not a regular file\nERR not a regular file\nOK count=3 ";
+    CHECK(strncmp(reply, want, strlen(want)) == 0, "ANALYZE answered '%s'", reply);
+
+    unlink(fifo);
+    unlink(data);
+    rmdir(dir);
+}
+
+int main(void)
+{
+    check_channels();
+    check_codec();
+    check_formatter();
+    check_xxh64();
+    check_percentiles();
+    check_histogram();
+    check_filters();
+    check_resampler();
+    check_xcorr();
+    check_events();
+    check_transient_rc();
+    check_bode_rc();
+    check_expressions();
+    check_expression_batch();
+    check_server_requests();
+    check_server_nesting();
+    check_server_analyze();
+
+    printf("%d checks, %d failed\n", g_checks, g_failed);
+    return g_failed != 0;
+}
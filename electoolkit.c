@@ -0,0 +1,341 @@
+// ELEC2645 Unit 2 Embedded Systems Project -- Engineering Toolkit
+// Designed by Qi Chang, Student id：201891723
+
+/* Computation cores shared by the menus (funcs.c), the server mode and the *
+ * libelectoolkit library.  Nothing in this file prints, reads input or     *
+ * keeps state between calls; see electoolkit.h for the API.                */
+
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "electoolkit.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* ======================== *
+ * Statistics               *
+ * ======================== */
+int etk_stats(const double *x, size_t n, EtkStats *out)
+{
+    if (!x || !out) {
+        return ETK_ERR_ARG;
+    }
+    memset(out, 0, sizeof(*out));
+    if (n == 0) {
+        return ETK_ERR_EMPTY;
+    }
+
+    double sum = 0.0, sum_sq = 0.0;
+    double min_val = x[0];
+    double max_val = x[0];
+
+    for (size_t i = 0; i < n; i++) {
+        double v = x[i];
+        sum    += v;
+        sum_sq += v * v;
+        if (v < min_val) min_val = v;
+        if (v > max_val) max_val = v;
+    }
+
+    out->count  = n;
+    out->sum    = sum;
+    out->sum_sq = sum_sq;
+    out->min    = min_val;
+    out->max    = max_val;
+    out->mean   = sum / (double)n;
+    out->rms    = sqrt(sum_sq / (double)n);
+    return ETK_OK;
+}
+
+/* Partial sort so that a[k] holds the value it would have in sorted order, *
+ * with a[0..k) <= a[k] <= a(k..n).  Median-of-three Hoare quickselect.     */
+static void etk_select(double *a, size_t n, size_t k)
+{
+    size_t lo = 0, hi = n - 1;
+
+    while (hi > lo) {
+        size_t mid = lo + (hi - lo) / 2;
+        double t;
+        if (a[mid] < a[lo]) { t = a[mid]; a[mid] = a[lo]; a[lo] = t; }
+        if (a[hi]  < a[lo]) { t = a[hi];  a[hi]  = a[lo]; a[lo] = t; }
+        if (a[hi]  < a[mid]) { t = a[hi]; a[hi]  = a[mid]; a[mid] = t; }
+        double pivot = a[mid];
+
+        size_t i = lo, j = hi;
+        while (i <= j) {
+            while (a[i] < pivot) i++;
+            while (a[j] > pivot) j--;
+            if (i <= j) {
+                t = a[i]; a[i] = a[j]; a[j] = t;
+                i++;
+                if (j == 0) break;
+                j--;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return;                               /* a[j+1..i-1] all equal the pivot */
+        }
+    }
+}
+int etk_percentiles(const double *x, size_t n, double *scratch, EtkPercentiles *out)
+{
+    static const double levels[4] = { 0.50, 0.95, 0.99, 0.999 };
+    double v4[4];
+
+    if (!x || !scratch || !out) {
+        return ETK_ERR_ARG;
+    }
+    if (n == 0) {
+        return ETK_ERR_EMPTY;
+    }
+
+    double *a = scratch;
+    if (a != x) {
+        memcpy(a, x, n * sizeof(double));
+    }
+
+    /* Select each rank in ascending order on the unsorted remainder */
+    size_t base = 0;
+    for (int q = 0; q < 4; q++) {
+        double rank = levels[q] * (double)(n - 1);
+        size_t k = (size_t)rank;
+        double frac = rank - (double)k;
+
+        etk_select(a + base, n - base, k - base);
+        double v = a[k];
+        if (frac > 0.0 && k + 1 < n) {
+            double next = a[k + 1];               /* smallest value right of k */
+            for (size_t i = k + 2; i < n; i++) {
+                if (a[i] < next) next = a[i];
+            }
+            v += frac * (next - v);
+        }
+        v4[q] = v;
+        base = k;
+    }
+
+    out->p50  = v4[0];
+    out->p95  = v4[1];
+    out->p99  = v4[2];
+    out->p999 = v4[3];
+    return ETK_OK;
+}
+int etk_histogram(const double *x, size_t n, double min, double max, long long *bins, int nbins)
+{
+    if (!x || !bins || nbins <= 0) {
+        return ETK_ERR_ARG;
+    }
+    double span = max - min;
+    double scale = (span > 0.0) ? nbins / span : 0.0;
+
+    memset(bins, 0, (size_t)nbins * sizeof(long long));
+    for (size_t i = 0; i < n; i++) {
+        if (isnan(x[i])) continue;                /* NaN belongs to no bin */
+        double t = (x[i] - min) * scale;          /* clamped before the int conversion */
+        int b = (t >= (double)nbins) ? nbins - 1 : (t > 0.0) ? (int)t : 0;   /* x >= max: last bin */
+        bins[b]++;
+    }
+    return n > 0 ? ETK_OK : ETK_ERR_EMPTY;
+}
+
+/* ======================== *
+ * Unit conversions         *
+ * ======================== */
+double etk_dbm_to_mw(double dbm) { return pow(10.0, dbm / 10.0); }
+double etk_mw_to_dbm(double mw)  { return 10.0 * log10(mw); }
+double etk_hz_to_rad(double hz)  { return 2.0 * M_PI * hz; }
+double etk_rad_to_hz(double rad) { return rad / (2.0 * M_PI); }
+double etk_c_to_k(double c)      { return c + 273.15; }
+double etk_k_to_c(double k)      { return k - 273.15; }
+double etk_f_to_c(double f)      { return (f - 32.0) * 5.0 / 9.0; }
+double etk_c_to_f(double c)      { return (c * 9.0 / 5.0) + 32.0; }
+double etk_v_to_dbv(double v)    { return 20.0 * log10(v); }
+double etk_dbv_to_v(double dbv)  { return pow(10.0, dbv / 20.0); }
+
+static double etk_adc_default_voltage(double code)
+{
+    return etk_adc_code_to_voltage(code, ETK_ADC_VREF, ETK_ADC_MAX_CODE);
+}
+static double etk_adc_default_temp(double code)
+{
+    return etk_lm35_temp(etk_adc_default_voltage(code));
+}
+
+enum { ETK_IN_ANY, ETK_IN_POSITIVE, ETK_IN_NONNEG, ETK_IN_ADC_CODE };
+
+typedef struct {
+    const char *name;           /* "from-to" */
+    const char *unit;           /* unit of the result */
+    int         domain;         /* ETK_IN_* */
+    double    (*fn)(double);
+} EtkConversion;
+
+static const EtkConversion etk_conversions[] = {
+    { "dbm-mw",   "mW",    ETK_IN_ANY,      etk_dbm_to_mw },
+    { "mw-dbm",   "dBm",   ETK_IN_POSITIVE, etk_mw_to_dbm },
+    { "hz-rad",   "rad/s", ETK_IN_ANY,      etk_hz_to_rad },
+    { "rad-hz",   "Hz",    ETK_IN_ANY,      etk_rad_to_hz },
+    { "c-k",      "K",     ETK_IN_ANY,      etk_c_to_k },
+    { "k-c",      "C",     ETK_IN_ANY,      etk_k_to_c },
+    { "f-c",      "C",     ETK_IN_ANY,      etk_f_to_c },
+    { "c-f",      "F",     ETK_IN_ANY,      etk_c_to_f },
+    { "v-dbv",    "dBV",   ETK_IN_POSITIVE, etk_v_to_dbv },
+    { "dbv-v",    "V",     ETK_IN_ANY,      etk_dbv_to_v },
+    { "adc-v",    "V",     ETK_IN_ADC_CODE, etk_adc_default_voltage },
+    { "v-temp",   "C",     ETK_IN_NONNEG,   etk_lm35_temp },
+    { "adc-temp", "C",     ETK_IN_ADC_CODE, etk_adc_default_temp },
+};
+
+#define ETK_NCONV ((int)(sizeof(etk_conversions) / sizeof(etk_conversions[0])))
+
+int etk_convert(const char *name, double x, double *out, const char **unit)
+{
+    if (!name || !out) {
+        return ETK_ERR_ARG;
+    }
+    for (int i = 0; i < ETK_NCONV; i++) {
+        const EtkConversion *c = &etk_conversions[i];
+        if (strcasecmp(name, c->name) != 0) {
+            continue;
+        }
+        if ((c->domain == ETK_IN_POSITIVE && !(x > 0.0)) ||
+            (c->domain == ETK_IN_NONNEG && !(x >= 0.0))) {
+            return ETK_ERR_RANGE;
+        }
+        if (c->domain == ETK_IN_ADC_CODE) {       /* codes are whole numbers, truncated like the menu */
+            if (!(x > -1.0 && x < ETK_ADC_MAX_CODE + 1.0)) return ETK_ERR_RANGE;
+            x = (double)(int)x;
+        }
+        *out = c->fn(x);
+        if (unit) *unit = c->unit;
+        return ETK_OK;
+    }
+    return ETK_ERR_ARG;
+}
+int etk_conversion_count(void)
+{
+    return ETK_NCONV;
+}
+const char *etk_conversion_name(int i, const char **unit)
+{
+    if (i < 0 || i >= ETK_NCONV) {
+        return NULL;
+    }
+    if (unit) *unit = etk_conversions[i].unit;
+    return etk_conversions[i].name;
+}
+
+/* ======================== *
+ * ADC / sensor mapping     *
+ * ======================== */
+double etk_adc_code_to_voltage(double code, double vref, int max_code)
+{
+    return (code / (double)max_code) * vref;
+}
+double etk_lm35_temp(double volt)
+{
+    return volt * 100.0;                          /* 10 mV/°C => 0.01 V / °C */
+}
+
+/* ======================== *
+ * Circuit formulas         *
+ * ======================== */
+double etk_rc_cutoff_hz(double R, double C_uF)
+{
+    double C = C_uF * 1e-6;  /* uF -> F */
+    return 1.0 / (2.0 * M_PI * R * C);
+}
+double etk_time_constant(double R, double C_uF)
+{
+    return R * (C_uF * 1e-6);
+}
+double etk_divider_vout(double Vin, double R1, double R2)
+{
+    return Vin * (R2 / (R1 + R2));
+}
+double etk_led_resistor_ohms(double Vs, double Vf, double If_mA)
+{
+    return (Vs - Vf) / (If_mA / 1000.0);         /* mA -> A */
+}
+double etk_cap_voltage(double Vs, double R, double C_uF, double t)
+{
+    return Vs * (1.0 - exp(-t / etk_time_constant(R, C_uF)));
+}
+
+/* ======================== *
+ * Resistor colour code     *
+ * ======================== */
+
+/* Index = digit; multiplier 10^digit; gold and silver only as multiplier / tolerance */
+static const char *const etk_colours[10] = {
+    "black", "brown", "red", "orange", "yellow", "green", "blue", "violet", "grey", "white"
+};
+
+int etk_resistor_digit(const char *colour)
+{
+    if (!colour) {
+        return -1;
+    }
+    for (int d = 0; d < 10; d++) {
+        if (strcasecmp(colour, etk_colours[d]) == 0) return d;
+    }
+    return (strcasecmp(colour, "gray") == 0) ? 8 : -1;
+}
+int etk_resistor_multiplier(const char *colour, double *mult)
+{
+    static const double pow10[10] = { 1.0, 10.0, 100.0, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    int d = etk_resistor_digit(colour);
+
+    if (d >= 0)                                   *mult = pow10[d];
+    else if (colour && strcasecmp(colour, "gold") == 0)   *mult = 0.1;
+    else if (colour && strcasecmp(colour, "silver") == 0) *mult = 0.01;
+    else return ETK_ERR_ARG;
+    return ETK_OK;
+}
+int etk_resistor_tolerance(const char *colour, double *tol_pct)
+{
+    static const struct { const char *name; double pct; } table[] = {
+        { "brown", 1.0 }, { "red", 2.0 }, { "green", 0.5 }, { "blue", 0.25 },
+        { "violet", 0.10 }, { "grey", 0.05 }, { "gray", 0.05 }, { "gold", 5.0 }, { "silver", 10.0 }
+    };
+    if (!colour) {
+        return ETK_ERR_ARG;
+    }
+    for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+        if (strcasecmp(colour, table[i].name) == 0) {
+            *tol_pct = table[i].pct;
+            return ETK_OK;
+        }
+    }
+    return ETK_ERR_ARG;
+}
+int etk_resistor_decode(const char *const bands[], int nbands, double *ohms, double *tol_pct)
+{
+    if (!bands || !ohms || !tol_pct || (nbands != 4 && nbands != 5)) {
+        return ETK_ERR_ARG;
+    }
+
+    int digits = nbands - 2;       /* 4-band: two digits, 5-band: three */
+    int base = 0;
+    for (int i = 0; i < digits; i++) {
+        int d = etk_resistor_digit(bands[i]);
+        if (d < 0) return i + 1;
+        base = base * 10 + d;
+    }
+
+    double mult = 0.0;
+    if (etk_resistor_multiplier(bands[digits], &mult) != ETK_OK) {
+        return digits + 1;
+    }
+    if (etk_resistor_tolerance(bands[digits + 1], tol_pct) != ETK_OK) {
+        return digits + 2;
+    }
+    *ohms = base * mult;
+    return ETK_OK;
+}
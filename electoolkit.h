@@ -0,0 +1,96 @@
+// ELEC2645 Unit 2 Embedded Systems Project -- Engineering Toolkit
+// Designed by Qi Chang, Student id：201891723
+
+/* electoolkit: the computation cores of the toolkit as a plain C API.        *
+ *   - No console or file I/O, no globals: every function works only on the  *
+ *     arguments and caller-owned buffers it is given, so all of them are    *
+ *     safe to call from several threads at once.                            *
+ *   - Built into main.out (the menus and the server call it) and into       *
+ *     libelectoolkit.a / libelectoolkit.so ("make lib").                    *
+ *   - Link with -lelectoolkit -lm.  Usable from C++ as is.                  */
+
+#ifndef ELECTOOLKIT_H
+#define ELECTOOLKIT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETK_API_VERSION 1
+
+/* Status codes */
+enum {
+    ETK_OK        =  0,
+    ETK_ERR_ARG   = -1,                /* Unknown name, NULL pointer or wrong count */
+    ETK_ERR_RANGE = -2,                /* Value outside the domain of the formula */
+    ETK_ERR_EMPTY = -3                 /* No samples */
+};
+
+/* --------- Statistics over a caller-owned array of samples --------- */
+typedef struct {
+    size_t count;
+    double sum, sum_sq;
+    double min, max;
+    double mean, rms;
+} EtkStats;
+
+typedef struct {
+    double p50, p95, p99, p999;        /* Linear interpolation between neighbouring ranks */
+} EtkPercentiles;
+
+int etk_stats(const double *x, size_t n, EtkStats *out);
+/* Exact percentiles.  scratch: n doubles owned by the caller, reordered;  *
+ * it may be x itself when the caller does not need the original order.  */
+int etk_percentiles(const double *x, size_t n, double *scratch, EtkPercentiles *out);
+/* nbins equal bins over [min, max]; values outside (and +-inf) go to the end *
+ * bins, NaN samples are skipped.                                             */
+int etk_histogram(const double *x, size_t n, double min, double max, long long *bins, int nbins);
+
+/* --------- Unit conversions --------- */
+double etk_dbm_to_mw(double dbm);      /* P(mW) = 10^(dBm/10) */
+double etk_mw_to_dbm(double mw);       /* mW > 0 */
+double etk_hz_to_rad(double hz);       /* ω = 2πf */
+double etk_rad_to_hz(double rad);
+double etk_c_to_k(double c);
+double etk_k_to_c(double k);
+double etk_f_to_c(double f);
+double etk_c_to_f(double c);
+double etk_v_to_dbv(double v);         /* V > 0 */
+double etk_dbv_to_v(double dbv);
+
+/* By name: "dbm-mw", "mw-dbm", "hz-rad", "rad-hz", "c-k", "k-c", "f-c", "c-f", *
+ * "v-dbv", "dbv-v", "adc-v", "v-temp", "adc-temp" (case-insensitive).        *
+ * unit may be NULL.  ETK_ERR_ARG for an unknown name.                        */
+int         etk_convert(const char *name, double x, double *out, const char **unit);
+int         etk_conversion_count(void);
+const char *etk_conversion_name(int i, const char **unit);   /* NULL when out of range */
+
+/* --------- ADC / sensor mapping --------- */
+#define ETK_ADC_VREF      5.0          /* Reference used by the named conversions */
+#define ETK_ADC_MAX_CODE  1023         /* 10-bit ADC, codes 0-1023 inclusive */
+
+double etk_adc_code_to_voltage(double code, double vref, int max_code);  /* V = code / max_code * vref */
+double etk_lm35_temp(double volt);     /* LM35: 10 mV/°C at 0 °C */
+
+/* --------- Circuit formulas (C in microfarads) --------- */
+double etk_rc_cutoff_hz(double R, double C_uF);                 /* fc = 1/(2πRC) */
+double etk_time_constant(double R, double C_uF);                /* tau = RC */
+double etk_divider_vout(double Vin, double R1, double R2);      /* Vin·R2/(R1+R2) */
+double etk_led_resistor_ohms(double Vs, double Vf, double If_mA);  /* (Vs − Vf)/If */
+double etk_cap_voltage(double Vs, double R, double C_uF, double t);  /* Vs(1 − e^(−t/RC)) */
+
+/* --------- Resistor colour code --------- */
+int etk_resistor_digit(const char *colour);                     /* 0-9, or -1 */
+int etk_resistor_multiplier(const char *colour, double *mult);  /* ETK_OK or ETK_ERR_ARG */
+int etk_resistor_tolerance(const char *colour, double *tol_pct);
+/* 4 or 5 bands (digits, multiplier, tolerance).  Returns ETK_OK, ETK_ERR_ARG *
+ * for a wrong band count, or the 1-based number of the first invalid band.  */
+int etk_resistor_decode(const char *const bands[], int nbands, double *ohms, double *tol_pct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ELECTOOLKIT_H */
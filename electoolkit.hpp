@@ -0,0 +1,304 @@
+// ELEC2645 Unit 2 Embedded Systems Project -- Engineering Toolkit
+// Designed by Qi Chang, Student id：201891723
+
+/* electoolkit.hpp: header-only C++17 layer over the toolkit kernels.         *
+ *   - etk::stats<T, Acc>() / histogram() / percentiles() work on any        *
+ *     arithmetic sample type (int16_t, int32_t, float, double, ...) and are *
+ *     instantiated per type, so the compiler inlines and vectorises them.   *
+ *     Acc is the accumulator type: int64_t / uint64_t for integers of up   *
+ *     to 16 bits (exact for any capture below 2^31 samples), double for    *
+ *     wider integers and floating point, where a 64-bit sum of squares     *
+ *     could overflow.                                                       *
+ *   - Floating-point sums use four independent partial sums, so the last    *
+ *     bits can differ from the serial etk_stats() in electoolkit.c.         *
+ *   - Resistor colour tables, unit constants and the linear formulas are    *
+ *     constexpr and can be checked at compile time (see the static_asserts).*
+ * Nothing here needs linking; electoolkit.h is only used for the ADC model. */
+
+#ifndef ELECTOOLKIT_HPP
+#define ELECTOOLKIT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include "electoolkit.h"
+
+namespace etk {
+
+/* ============================ *
+ * Views over caller memory     *
+ * ============================ */
+template <typename T>
+struct span {                                   /* std::span is C++20 */
+    const T    *ptr  = nullptr;
+    std::size_t len  = 0;
+
+    constexpr span() = default;
+    constexpr span(const T *p, std::size_t n) : ptr(p), len(n) {}
+    template <typename C>
+    constexpr span(const C &c) : ptr(c.data()), len(c.size()) {}
+
+    constexpr const T *data() const { return ptr; }
+    constexpr std::size_t size() const { return len; }
+    constexpr const T *begin() const { return ptr; }
+    constexpr const T *end() const { return ptr + len; }
+    constexpr const T &operator[](std::size_t i) const { return ptr[i]; }
+};
+
+/* ============================ *
+ * Statistics                   *
+ * ============================ */
+/* An int16 square is below 2^30 (uint16: 2^32), so 64 bits hold 2^31 of them; *
+ * an int32 square alone can reach 2^62 and would overflow after a few.       */
+template <typename T>
+using default_accumulator_t = std::conditional_t<std::is_integral_v<T> && (sizeof(T) <= 2),
+                                                 std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>,
+                                                 double>;
+static_assert(std::is_same_v<default_accumulator_t<std::int16_t>, std::int64_t> &&
+              std::is_same_v<default_accumulator_t<std::int32_t>, double> &&
+              std::is_same_v<default_accumulator_t<std::uint64_t>, double>);
+
+template <typename T, typename Acc = default_accumulator_t<T>>
+struct basic_stats {
+    std::size_t count = 0;
+    Acc         sum = 0;
+    Acc         sum_sq = 0;
+    T           min = T();
+    T           max = T();
+    double      mean = 0.0;
+    double      rms = 0.0;
+};
+
+template <typename T, typename Acc = default_accumulator_t<T>>
+basic_stats<T, Acc> stats(span<T> x)
+{
+    static_assert(std::is_arithmetic_v<T> && std::is_arithmetic_v<Acc>, "arithmetic types only");
+    basic_stats<T, Acc> r;
+    const std::size_t n = x.size();
+    if (n == 0) {
+        return r;
+    }
+
+    /* Four independent lanes, written out so they stay in registers at -O2 */
+    const T *p = x.data();
+    Acc s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    Acc q0 = 0, q1 = 0, q2 = 0, q3 = 0;
+    T lo0 = p[0], lo1 = p[0], hi0 = p[0], hi1 = p[0];
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const Acc a = static_cast<Acc>(p[i]),     b = static_cast<Acc>(p[i + 1]);
+        const Acc c = static_cast<Acc>(p[i + 2]), d = static_cast<Acc>(p[i + 3]);
+        s0 += a;  s1 += b;  s2 += c;  s3 += d;
+        q0 += a * a;  q1 += b * b;  q2 += c * c;  q3 += d * d;
+        lo0 = std::min(lo0, std::min(p[i], p[i + 2]));
+        lo1 = std::min(lo1, std::min(p[i + 1], p[i + 3]));
+        hi0 = std::max(hi0, std::max(p[i], p[i + 2]));
+        hi1 = std::max(hi1, std::max(p[i + 1], p[i + 3]));
+    }
+    for (; i < n; i++) {
+        const Acc a = static_cast<Acc>(p[i]);
+        s0 += a;
+        q0 += a * a;
+        lo0 = std::min(lo0, p[i]);
+        hi0 = std::max(hi0, p[i]);
+    }
+
+    r.count = n;
+    r.sum = (s0 + s1) + (s2 + s3);
+    r.sum_sq = (q0 + q1) + (q2 + q3);
+    r.min = std::min(lo0, lo1);
+    r.max = std::max(hi0, hi1);
+    r.mean = static_cast<double>(r.sum) / static_cast<double>(n);
+    r.rms = std::sqrt(static_cast<double>(r.sum_sq) / static_cast<double>(n));
+    return r;
+}
+template <typename T, typename Acc = default_accumulator_t<T>>
+basic_stats<T, Acc> stats(const T *x, std::size_t n)
+{
+    return stats<T, Acc>(span<T>(x, n));
+}
+
+/* nbins equal bins over [min, max]; values outside (and +-inf) go to the end *
+ * bins, NaN samples are skipped -- the same rules as etk_histogram.          */
+template <typename T>
+void histogram(span<T> x, double min, double max, long long *bins, int nbins)
+{
+    const double span_v = max - min;
+    const double scale = (span_v > 0.0) ? nbins / span_v : 0.0;
+
+    std::fill(bins, bins + nbins, 0LL);
+    for (const T &v : x) {
+        const double d = static_cast<double>(v);
+        if (std::isnan(d)) {
+            continue;
+        }
+        const double t = (d - min) * scale;    /* clamped in double: NaN (inf * 0) goes to bin 0 */
+        const int b = (t >= static_cast<double>(nbins)) ? nbins - 1 : (t > 0.0) ? static_cast<int>(t) : 0;
+        bins[b]++;
+    }
+}
+
+/* Exact p50/p95/p99/p99.9 with the same rank interpolation as etk_percentiles. *
+ * scratch: x.size() elements owned by the caller (reordered).                 */
+template <typename T>
+EtkPercentiles percentiles(span<T> x, T *scratch)
+{
+    constexpr double levels[4] = { 0.50, 0.95, 0.99, 0.999 };
+    double v4[4] = {};
+    const std::size_t n = x.size();
+    EtkPercentiles out{};
+    if (n == 0) {
+        return out;
+    }
+
+    std::copy(x.begin(), x.end(), scratch);
+    std::size_t base = 0;
+    for (int k4 = 0; k4 < 4; k4++) {
+        const double rank = levels[k4] * static_cast<double>(n - 1);
+        const std::size_t k = static_cast<std::size_t>(rank);
+        const double frac = rank - static_cast<double>(k);
+
+        std::nth_element(scratch + base, scratch + k, scratch + n);
+        double v = static_cast<double>(scratch[k]);
+        if (frac > 0.0 && k + 1 < n) {
+            v += frac * (static_cast<double>(*std::min_element(scratch + k + 1, scratch + n)) - v);
+        }
+        v4[k4] = v;
+        base = k;
+    }
+    out.p50 = v4[0];
+    out.p95 = v4[1];
+    out.p99 = v4[2];
+    out.p999 = v4[3];
+    return out;
+}
+
+/* ============================ *
+ * Unit constants and formulas  *
+ * ============================ */
+namespace units {
+inline constexpr double pi            = 3.14159265358979323846;
+inline constexpr double zero_celsius  = 273.15;           /* K */
+inline constexpr double adc_vref      = ETK_ADC_VREF;     /* V */
+inline constexpr int    adc_max_code  = ETK_ADC_MAX_CODE;
+inline constexpr double lm35_c_per_v  = 100.0;            /* 10 mV / °C */
+inline constexpr double micro         = 1e-6;
+inline constexpr double milli         = 1e-3;
+}
+
+constexpr double c_to_k(double c)  { return c + units::zero_celsius; }
+constexpr double k_to_c(double k)  { return k - units::zero_celsius; }
+constexpr double f_to_c(double f)  { return (f - 32.0) * 5.0 / 9.0; }
+constexpr double c_to_f(double c)  { return (c * 9.0 / 5.0) + 32.0; }
+constexpr double hz_to_rad(double hz)  { return 2.0 * units::pi * hz; }
+constexpr double rad_to_hz(double rad) { return rad / (2.0 * units::pi); }
+inline double dbm_to_mw(double dbm) { return std::pow(10.0, dbm / 10.0); }   /* std::pow is not constexpr */
+inline double mw_to_dbm(double mw)  { return 10.0 * std::log10(mw); }
+inline double v_to_dbv(double v)    { return 20.0 * std::log10(v); }
+inline double dbv_to_v(double dbv)  { return std::pow(10.0, dbv / 20.0); }
+
+constexpr double adc_code_to_voltage(double code, double vref = units::adc_vref,
+                                     int max_code = units::adc_max_code)
+{
+    return (code / static_cast<double>(max_code)) * vref;
+}
+constexpr double lm35_temp(double volt) { return volt * units::lm35_c_per_v; }
+
+constexpr double rc_cutoff_hz(double R, double C_uF) { return 1.0 / (2.0 * units::pi * R * (C_uF * units::micro)); }
+constexpr double time_constant(double R, double C_uF) { return R * (C_uF * units::micro); }
+constexpr double divider_vout(double Vin, double R1, double R2) { return Vin * (R2 / (R1 + R2)); }
+constexpr double led_resistor_ohms(double Vs, double Vf, double If_mA) { return (Vs - Vf) / (If_mA / 1000.0); }
+inline double cap_voltage(double Vs, double R, double C_uF, double t)
+{
+    return Vs * (1.0 - std::exp(-t / time_constant(R, C_uF)));
+}
+
+/* ============================ *
+ * Resistor colour code         *
+ * ============================ */
+struct colour_band {
+    std::string_view name;
+    int              digit;           /* -1: not a digit colour */
+    double           multiplier;      /* 0: not a multiplier colour */
+    double           tolerance_pct;   /* 0: not a tolerance colour */
+};
+
+inline constexpr colour_band colour_table[] = {
+    { "black",  0, 1.0,  0.0  },
+    { "brown",  1, 1e1,  1.0  },
+    { "red",    2, 1e2,  2.0  },
+    { "orange", 3, 1e3,  0.0  },
+    { "yellow", 4, 1e4,  0.0  },
+    { "green",  5, 1e5,  0.5  },
+    { "blue",   6, 1e6,  0.25 },
+    { "violet", 7, 1e7,  0.10 },
+    { "grey",   8, 1e8,  0.05 },
+    { "gray",   8, 1e8,  0.05 },
+    { "white",  9, 1e9,  0.0  },
+    { "gold",  -1, 0.1,  5.0  },
+    { "silver",-1, 0.01, 10.0 },
+};
+
+constexpr bool iequals(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+        if (x != y) return false;
+    }
+    return true;
+}
+constexpr const colour_band *find_colour(std::string_view name)
+{
+    for (const colour_band &c : colour_table) {
+        if (iequals(c.name, name)) return &c;
+    }
+    return nullptr;
+}
+
+struct resistor_value {
+    double ohms = 0.0;
+    double tolerance_pct = 0.0;
+    int    bad_band = 0;              /* 0 = valid, else the 1-based band (like etk_resistor_decode) */
+};
+
+/* N = 4 or 5 bands: digits, multiplier, tolerance */
+template <std::size_t N>
+constexpr resistor_value decode_resistor(const std::string_view (&bands)[N])
+{
+    static_assert(N == 4 || N == 5, "4- or 5-band codes");
+    resistor_value r;
+    long base = 0;
+    for (std::size_t i = 0; i < N - 2; i++) {
+        const colour_band *c = find_colour(bands[i]);
+        if (!c || c->digit < 0) { r.bad_band = static_cast<int>(i + 1); return r; }
+        base = base * 10 + c->digit;
+    }
+    const colour_band *m = find_colour(bands[N - 2]);
+    if (!m || m->multiplier == 0.0) { r.bad_band = static_cast<int>(N - 1); return r; }
+    const colour_band *t = find_colour(bands[N - 1]);
+    if (!t || t->tolerance_pct == 0.0) { r.bad_band = static_cast<int>(N); return r; }
+    r.ohms = static_cast<double>(base) * m->multiplier;
+    r.tolerance_pct = t->tolerance_pct;
+    return r;
+}
+
+namespace detail {
+inline constexpr std::string_view check_4band[] = { "brown", "black", "RED", "gold" };
+inline constexpr std::string_view check_5band[] = { "orange", "orange", "black", "brown", "brown" };
+inline constexpr std::string_view check_bad[]   = { "brown", "pink", "red", "gold" };
+static_assert(decode_resistor(check_4band).ohms == 1000.0 && decode_resistor(check_4band).tolerance_pct == 5.0);
+static_assert(decode_resistor(check_5band).ohms == 3300.0);
+static_assert(decode_resistor(check_bad).bad_band == 2);
+static_assert(c_to_k(25.0) == 298.15 && divider_vout(12.0, 1000.0, 1000.0) == 6.0);
+}
+
+} /* namespace etk */
+
+#endif /* ELECTOOLKIT_HPP */
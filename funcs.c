@@ -14,24 +14,47 @@
  * - Circuit Calculator
  * - Resistor Colour Decoder
  * - Unit Converter
- * - Engineering Calculator placeholder
+ * - Engineering Calculator (expression evaluator with SI prefixes)
  * - Tools (auto-test and extra file operations for the Signal Analyzer (generate test data) )
  */
 
 #include <stdio.h>                               
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <math.h>
+#include <errno.h>
+#include <limits.h>
+#include <float.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>   /* SSE2 inner loops (always available on x86-64) */
+#endif
 #include "funcs.h"
+#include "electoolkit.h"
 
 /* System doesnt auto define M_PI */
 #ifndef M_PI 
 #define M_PI 3.14159265358979323846
 #endif
 
-/* Global signal-statistics structure */
-SignalStats g_last_signal; /* defined here, but declared as extern in funcs.h */
+/* Default analysis context used by the interactive menus (see sa_default_context) */
+static SignalContext g_sa_ctx;
 
 /* ================= *
  * Local prototypes  *
@@ -41,11 +64,24 @@ SignalStats g_last_signal; /* defined here, but declared as extern in funcs.h */
 static void sa_print_menu(void);
 static int  sa_get_choice(void);
 static int  sa_is_integer(const char *s);
+static void sa_plot_series(const double *x, int n);
+static size_t sa_parse_number_chunk(char *buf, size_t len, int final,
+                                    double *out, size_t *consumed,
+                                    long long *rejected);
+static int  sa_rolling_compute(const double *x, int n, int window,
+                               double *mean, double *rms,
+                               double *min_out, double *max_out,
+                               int *dq_min, int *dq_max);
 
 /* Unit Converter */
 static void uc_print_menu(void);
 static int  uc_get_choice(void);
 static double uc_get_double(const char *prompt);
+static long long uc_get_int_in(const char *prompt, long long lo, long long hi);
+
+/* Engineering Calculator (line input helper is shared with other prompts) */
+static int  ec_read_line(const char *prompt, char *buf, size_t len);
+static int  ec_read_value(const char *prompt, double *value);
 
 /* Circuit Calculator */
 static void cc_rc_filter(void);
@@ -53,26 +89,31 @@ static void cc_voltage_divider(void);
 static void cc_led_resistor(void);
 static void cc_ohms_law(void);
 static void cc_cap_charging(void);
+static void cc_monte_carlo_menu(void);
+static void cc_transient_menu(void);
+static void cc_bode_menu(void);
 
 /* Resistor colour decoder helpers (4-band / 5-band decoders) */
-static void str_to_lower(char *s);
-static int  resistor_digit_from_color(const char *s);
-static int  resistor_multiplier_from_color(const char *s, double *mult);
-static int  resistor_tolerance_from_color(const char *s, double *tol);
+static void resistor_print_result(const char *title, double R, double tol);
 static void resistor_decode_4band(void);
 static void resistor_decode_5band(void);
 
 /* Tools (Auto Tests & File Operations for Signal Analyzer) */
 static void tools_generate_sample_file(void);
 static void tools_run_auto_test(void);
+static void tools_batch_analysis(void);
+static void tools_format_benchmark(void);
+static void tools_cached_stats(void);
 /* Generic loader used both by the Signal Analyzer and Tools */
-static int sa_load_from_file_generic(const char *filename);  /* Loads samples from an arbitrary filename into g_last_signal */
+static int sa_load_from_file_generic(const char *filename);  /* Loads samples from an arbitrary filename into the default context */
+static int sa_load_report(int status, const char *filename);
+static void sa_print_stats(const SignalStats *sig, const SignalPercentiles *pct);  /* pct may be NULL */
 
 
 /* ========================== *
  * 1. Signal Analyzer Module  *
- * ========================== */       /* reads a choice (1~5), and calls the appropriate function */
-void menu_signal_analyzer(void)        /* until the user selects “Back to Main Menu” (6) */
+ * ========================== */       /* reads a choice (1~15), and calls the appropriate function */
+void menu_signal_analyzer(void)        /* until the user selects “Back to Main Menu” (16) */
 {
     int running = 1;
 
@@ -97,6 +138,36 @@ void menu_signal_analyzer(void)        /* until the user selects “Back to Main
                 sa_save_stats_to_file();
                 break;
             case 6:
+                sa_rolling_stats();
+                break;
+            case 7:
+                sa_live_stream();
+                break;
+            case 8:
+                sa_filter_samples();
+                break;
+            case 9:
+                sa_resample_samples();
+                break;
+            case 10:
+                sa_multichannel_menu();
+                break;
+            case 11:
+                sa_compact_menu();
+                break;
+            case 12:
+                sa_codec_menu();
+                break;
+            case 13:
+                sa_spectrogram();
+                break;
+            case 14:
+                sa_detect_events();
+                break;
+            case 15:
+                sa_cross_correlate();
+                break;
+            case 16:
                 /* Back to main menu */
                 running = 0;
                 break;
@@ -114,12 +185,22 @@ static void sa_print_menu(void)       /* Print Signal Analyzer submenu */
     printf("3. Calculate statistics (mean, min, max, RMS)\n");
     printf("4. Plot ASCII bar graph\n");
     printf("5. Save stats to file\n");
-    printf("6. Back to Main Menu\n");
+    printf("6. Rolling statistics (sliding window)\n");
+    printf("7. Live stream from FIFO / file\n");
+    printf("8. Filter samples (RC / biquad / FIR)\n");
+    printf("9. Resample (polyphase decimate / interpolate)\n");
+    printf("10. Multi-channel capture (interleaved DAQ files)\n");
+    printf("11. Compact storage (float32 / int32 / int16)\n");
+    printf("12. Compressed captures (.etkz)\n");
+    printf("13. Spectrogram (STFT heat map)\n");
+    printf("14. Event detection (edges, glitches, dropouts)\n");
+    printf("15. Cross-correlate with a second capture (delay, coherence)\n");
+    printf("16. Back to Main Menu\n");
     printf("-----------------------------\n");
 }
-static int sa_get_choice(void)        /* Retrieve menu options 1–6 with basic input validation */
+static int sa_get_choice(void)        /* Retrieve menu options 1–16 with basic input validation */
 {
-    enum { MIN_OPT = 1, MAX_OPT = 6 };
+    enum { MIN_OPT = 1, MAX_OPT = 16 };
     char buf[64];
     int value = 0;
 
@@ -164,1030 +245,10309 @@ static int sa_is_integer(const char *s)
     return 1;
 }
 
-/* ============================= *
- * 1. Signal Analyzer Functions  *
- * ============================= */
-void sa_enter_samples(void)
-{
-    char buf[64];
-    int count = 0;
-
-    /* 1. Ask User for sample number */
-    while (1) {
-        printf("\nHow many samples do you want to enter? (1-%d): ",
-               MAX_SAMPLES);
-
-        if (!fgets(buf, sizeof(buf), stdin)) {
-            printf("\nInput error. Cancelling.\n");
-            return;
-        }
-        buf[strcspn(buf, "\r\n")] = '\0';  /* Remove line breaks */
-
-        if (!sa_is_integer(buf)) {
-            printf("Please enter an integer number.\n");
-            continue;
-        }
-
-        count = (int)strtol(buf, NULL, 10);
-        if (count < 1 || count > MAX_SAMPLES) {
-            printf("Please choose a value between 1 and %d.\n", MAX_SAMPLES);
-            continue;
-        }
+/* ================================== *
+ * 1. Signal Analyzer: Sample store   *
+ * ================================== */
 
-        break;  /* if it can run then exit loop */
+/* SignalStats keeps sufficient statistics (count, sum, sum of squares,    *
+ * min, max) in step with the sample array.  Appending updates them in     *
+ * O(1), so mean / RMS can be derived without touching the samples again.  *
+ * Code that edits samples[] in place calls sa_signal_mark_dirty(), which  *
+ * makes the next sa_signal_refresh() rescan once.  `generation` changes   *
+ * on every modification so callers can tell whether the data is new.      *
+ * The sample array lives on the heap and grows by doubling; an all-zero   *
+ * SignalStats is a valid empty store.                                     */
+int sa_signal_reserve(SignalStats *sig, int capacity)
+{
+    if (capacity <= sig->capacity) {
+        return 1;
     }
 
-    g_last_signal.count = count;
-
-    /* 2. Input the samples */
-    for (int i = 0; i < count; i++) {
-        double value = 0.0;
-        while (1) {
-            printf("Enter sample %d: ", i + 1);
-
-            if (!fgets(buf, sizeof(buf), stdin)) {
-                printf("\nInput error while reading sample. "
-                       "Stopping input.\n");
-                g_last_signal.count = i;  /* Number successfully read */
-                return;
-            }
-            buf[strcspn(buf, "\r\n")] = '\0';
-
-            char *endptr = NULL;
-            value = strtod(buf, &endptr);
-
-            /* Check whether the entire string is a valid floating-point number. */
-            if (endptr == buf || *endptr != '\0') {
-                printf("Please enter a valid number.\n");
-                continue;
-            }
-
-            g_last_signal.samples[i] = value;
-            break;  /* Exit the inner loop */
-        }
+    double *grown = realloc(sig->samples, (size_t)capacity * sizeof(double));
+    if (!grown) {
+        return 0;
     }
-
-    /* 3. Temporarily reset the statistics to zero; the next step will involve the actual calculation by `sa_calculate_stats`. */
-    g_last_signal.mean = 0.0;
-    g_last_signal.rms  = 0.0;
-    g_last_signal.min  = 0.0;
-    g_last_signal.max  = 0.0;
-
-    printf("\nStored %d samples successfully.\n", g_last_signal.count);
+    sig->samples  = grown;
+    sig->capacity = capacity;
+    return 1;
 }
-static int sa_load_from_file_generic(const char *filename) /* Generic loading function for Tool (Menu 7): reads samples from any filename*/    
+void sa_signal_free(SignalStats *sig)
 {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        printf("\nError: Could not open '%s'. "
-               "Make sure the file exists in the same folder as the program.\n",
-               filename);
+    free(sig->samples);
+    sig->samples  = NULL;
+    sig->capacity = 0;
+    sa_signal_clear(sig);
+}
+void sa_signal_clear(SignalStats *sig)
+{
+    sig->count  = 0;
+    sig->sum    = 0.0;
+    sig->sum_sq = 0.0;
+    sig->mean   = 0.0;
+    sig->rms    = 0.0;
+    sig->min    = 0.0;
+    sig->max    = 0.0;
+    sig->dirty  = 0;
+    sig->generation++;
+}
+int sa_signal_append(SignalStats *sig, double x)
+{
+    if (sig->count >= sig->capacity &&
+        !sa_signal_reserve(sig, sig->capacity ? sig->capacity * 2 : 1024)) {
         return 0;
     }
 
-    double value = 0.0;
-    int count = 0;
-
-    while (count < MAX_SAMPLES && fscanf(fp, "%lf", &value) == 1) {
-        g_last_signal.samples[count] = value;
-        count++;
-    }
-
-    fclose(fp);
-
-    if (count == 0) {
-        printf("\nNo valid samples were found in '%s'.\n", filename);
-        g_last_signal.count = 0;
-        return 0;
+    if (!sig->dirty) {
+        if (sig->count == 0) {
+            sig->min = x;
+            sig->max = x;
+        } else {
+            if (x < sig->min) sig->min = x;
+            if (x > sig->max) sig->max = x;
+        }
+        sig->sum    += x;
+        sig->sum_sq += x * x;
     }
 
-    g_last_signal.count = count;
-
-    /* Clear old statistics to avoid confusion; the actual calculation is performed within `sa_calculate_stats`. */
-    g_last_signal.mean = 0.0;
-    g_last_signal.rms  = 0.0;
-    g_last_signal.min  = 0.0;
-    g_last_signal.max  = 0.0;
-
-    printf("\nLoaded %d samples from '%s'.\n", count, filename);
-
+    sig->samples[sig->count++] = x;
+    sig->generation++;
     return 1;
 }
-void sa_load_from_file(void)         /* Read from sample.txt */
+void sa_signal_mark_dirty(SignalStats *sig)
 {
-    const char *filename = "samples.txt";
-
-    if (sa_load_from_file_generic(filename)) {
-        printf("You can now choose option 3 to calculate statistics.\n");
-    }
+    sig->dirty = 1;
+    sig->generation++;
 }
-void sa_calculate_stats(void)
+void sa_signal_refresh(SignalStats *sig)
 {
-    int n = g_last_signal.count;
+    int n = sig->count;
 
-    /* 1. Check whether there are any samples */
     if (n <= 0) {
-        printf("\nNo samples available. "
-               "Please enter samples (option 1) or load from file (option 2) first.\n");
+        sig->mean = sig->rms = sig->min = sig->max = 0.0;
         return;
     }
 
-    double sum     = 0.0;
-    double sum_sq  = 0.0;
-    double min_val = g_last_signal.samples[0];
-    double max_val = g_last_signal.samples[0];
-
-    /* 2. cumulatively summing and squaring the sums, whilst updating the minimum/maximum values */
-    for (int i = 0; i < n; i++) {
-        double x = g_last_signal.samples[i];
-
-        sum    += x;
-        sum_sq += x * x;
-
-        if (x < min_val) min_val = x;
-        if (x > max_val) max_val = x;
+    /* Full rescan only after in-place edits */
+    if (sig->dirty) {
+        EtkStats st;
+        etk_stats(sig->samples, (size_t)n, &st);
+        sig->sum    = st.sum;
+        sig->sum_sq = st.sum_sq;
+        sig->min    = st.min;
+        sig->max    = st.max;
+        sig->dirty  = 0;
     }
 
-    /* 3. Calculate the mean and RMS */
-    double mean = sum / n;
-    double rms  = sqrt(sum_sq / n);
-
-    /* 4. Save back to global structure */
-    g_last_signal.mean = mean;
-    g_last_signal.rms  = rms;
-    g_last_signal.min  = min_val;
-    g_last_signal.max  = max_val;
+    sig->mean = sig->sum / n;
+    sig->rms  = sqrt(sig->sum_sq / n);
+}
 
-    /* 5. Printed output */
-    printf("\nSignal statistics:\n");
-    printf("  Count : %d\n", n);
-    printf("  Min   : %.6f\n", min_val);
-    printf("  Max   : %.6f\n", max_val);
-    printf("  Mean  : %.6f\n", mean);
-    printf("  RMS   : %.6f\n", rms);
+/* ================================================ *
+ * 1. Signal Analyzer: Distribution statistics      *
+ * ================================================ */
+
+/* Median / tail percentiles (p50, p95, p99, p99.9) and a linear histogram. *
+ *  - Up to SA_PCT_EXACT_MAX samples the percentiles are exact: the samples *
+ *    are copied to the context scratch buffer and quickselect places each  *
+ *    wanted rank in turn, each search starting right of the previous one.  *
+ *  - Larger captures use a log-binned histogram sketch: fixed memory, the  *
+ *    bin comes straight from the exponent and top mantissa bits of the     *
+ *    double (64 bins per octave, each under 1.6% wide).  Sketches merge by  *
+ *    adding counters, so big captures are binned on several threads, and   *
+ *    the live stream keeps one sketch for the whole stream.                *
+ * Percentiles interpolate linearly between neighbouring ranks.             */
+
+#define SA_PCT_EXACT_MAX      (1 << 22)     /* samples; above this use the sketch */
+#define SA_HIST_SUB_BITS      6             /* 64 bins per octave */
+#define SA_HIST_SUB           (1 << SA_HIST_SUB_BITS)
+#define SA_HIST_EXP_MIN       (-48)         /* |x| < 2^-48 counts as zero */
+#define SA_HIST_EXP_MAX       48            /* |x| >= 2^48 shares the outermost bin */
+#define SA_HIST_HALF          ((SA_HIST_EXP_MAX - SA_HIST_EXP_MIN) * SA_HIST_SUB)
+#define SA_HIST_BINS          (2 * SA_HIST_HALF + 1)
+#define SA_HIST_PAR_MIN       (1 << 20)     /* samples per thread when binning in parallel */
+#define SA_HIST_MAX_THREADS   16
+
+/* Bins are ordered by value: negative magnitudes descending, zero, positive */
+typedef struct {
+    long long count;
+    double    min;
+    double    max;
+    long long bins[SA_HIST_BINS];
+} SaHistSketch;
+
+static const double sa_pct_levels[4] = { 0.50, 0.95, 0.99, 0.999 };
+
+static void sa_hist_reset(SaHistSketch *h)
+{
+    memset(h, 0, sizeof(*h));
 }
-void sa_plot_graph(void)
+static inline int sa_hist_bin(double x)
 {
-    const int MAX_BAR = 20;  /* 20 squares in each of the negative and positive directions */
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
 
-    int n = g_last_signal.count;
-    if (n <= 0) {
-        printf("\nNo samples available. "
-               "Please enter samples (option 1) or load from file (option 2) first.\n");
+    int e = (int)((bits >> 52) & 0x7ff) - 1023;
+    int m;
+    if (e < SA_HIST_EXP_MIN) {
+        return SA_HIST_HALF;
+    }
+    if (e >= SA_HIST_EXP_MAX) {
+        m = SA_HIST_HALF - 1;
+    } else {
+        m = (e - SA_HIST_EXP_MIN) * SA_HIST_SUB +
+            (int)((bits >> (52 - SA_HIST_SUB_BITS)) & (SA_HIST_SUB - 1));
+    }
+    return (bits >> 63) ? SA_HIST_HALF - 1 - m : SA_HIST_HALF + 1 + m;
+}
+static inline void sa_hist_push(SaHistSketch *h, double x)
+{
+    if (x != x) {
+        return;                                   /* NaN has no rank */
+    }
+    if (h->count == 0) {
+        h->min = h->max = x;
+    } else {
+        if (x < h->min) h->min = x;
+        if (x > h->max) h->max = x;
+    }
+    h->count++;
+    h->bins[sa_hist_bin(x)]++;
+}
+static void sa_hist_merge(SaHistSketch *dst, const SaHistSketch *src)
+{
+    if (src->count == 0) {
         return;
     }
-
-    /* 1. Find the maximum absolute value for scaling purposes. */
-    double max_abs = 0.0;
-    for (int i = 0; i < n; i++) {
-        double v = fabs(g_last_signal.samples[i]);
-        if (v > max_abs) {
-            max_abs = v;
-        }
+    if (dst->count == 0 || src->min < dst->min) dst->min = src->min;
+    if (dst->count == 0 || src->max > dst->max) dst->max = src->max;
+    dst->count += src->count;
+    for (int i = 0; i < SA_HIST_BINS; i++) {
+        dst->bins[i] += src->bins[i];
     }
-
-    if (max_abs == 0.0) {
-        printf("\nAll samples are zero. Nothing to plot.\n");
+}
+static void sa_hist_bin_range(int idx, double *lo, double *hi)   /* value range covered by a bin */
+{
+    if (idx == SA_HIST_HALF) {
+        *lo = -ldexp(1.0, SA_HIST_EXP_MIN);
+        *hi =  ldexp(1.0, SA_HIST_EXP_MIN);
         return;
     }
+    int m = (idx > SA_HIST_HALF) ? idx - SA_HIST_HALF - 1 : SA_HIST_HALF - 1 - idx;
+    int e = SA_HIST_EXP_MIN + m / SA_HIST_SUB;
+    int s = m % SA_HIST_SUB;
+    double a = ldexp(1.0 + (double)s / SA_HIST_SUB, e);
+    double b = ldexp(1.0 + (double)(s + 1) / SA_HIST_SUB, e);
+    if (idx > SA_HIST_HALF) {
+        *lo = a;
+        *hi = b;
+    } else {
+        *lo = -b;
+        *hi = -a;
+    }
+}
+/* q-quantile estimate (0 <= q <= 1) */
+static double sa_hist_quantile(const SaHistSketch *h, double q)
+{
+    if (h->count == 0) {
+        return 0.0;
+    }
+    double rank = q * (double)(h->count - 1);
+    long long below = 0;
 
-    printf("\nASCII Signal Plot (negative left, positive right)\n\n");
+    for (int i = 0; i < SA_HIST_BINS; i++) {
+        long long c = h->bins[i];
+        if (c == 0 || (double)(below + c) <= rank) {
+            below += c;
+            continue;
+        }
+        double lo, hi;
+        sa_hist_bin_range(i, &lo, &hi);
+        double v = lo + (hi - lo) * ((rank - (double)below + 0.5) / (double)c);
+        if (v < h->min) v = h->min;
+        if (v > h->max) v = h->max;
+        return v;
+    }
+    return h->max;
+}
 
-    /* 2. Draw line for each sample */
-    for (int i = 0; i < n; i++) {
-        double x = g_last_signal.samples[i];
+typedef struct {
+    const double *x;
+    size_t        n;
+    SaHistSketch *sketch;
+} SaHistJob;
 
-        /* Mapping to integer lengths ranging from 0 to MAX_BAR based on absolute value magnitude */
-        int left_bar  = 0;
-        int right_bar = 0;
+static void *sa_hist_thread(void *arg)
+{
+    SaHistJob *job = arg;
+    for (size_t i = 0; i < job->n; i++) {
+        sa_hist_push(job->sketch, job->x[i]);
+    }
+    return NULL;
+}
+/* Bin n samples into h, splitting large inputs across threads and merging */
+static int sa_hist_build(SaHistSketch *h, const double *x, size_t n)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = (int)(n / SA_HIST_PAR_MIN);
+    if (nthreads > cores) nthreads = (int)cores;
+    if (nthreads > SA_HIST_MAX_THREADS) nthreads = SA_HIST_MAX_THREADS;
+
+    sa_hist_reset(h);
+    if (nthreads < 2) {
+        SaHistJob job = { x, n, h };
+        sa_hist_thread(&job);
+        return 1;
+    }
 
-        if (x < 0) {
-            left_bar = (int)((fabs(x) / max_abs) * MAX_BAR + 0.5);   /* rounding */
-            if (left_bar > MAX_BAR) left_bar = MAX_BAR;
-        } else if (x > 0) {
-            right_bar = (int)((x / max_abs) * MAX_BAR + 0.5);
-            if (right_bar > MAX_BAR) right_bar = MAX_BAR;
-        } else {
-            /* x == 0，no action */
+    SaHistSketch *part = malloc((size_t)nthreads * sizeof(SaHistSketch));
+    if (!part) {
+        return 0;
+    }
+    pthread_t tid[SA_HIST_MAX_THREADS];
+    SaHistJob job[SA_HIST_MAX_THREADS];
+    int created[SA_HIST_MAX_THREADS] = { 0 };
+    size_t per = n / (size_t)nthreads;
+
+    for (int t = 0; t < nthreads; t++) {
+        size_t begin = (size_t)t * per;
+        sa_hist_reset(&part[t]);
+        job[t].x = x + begin;
+        job[t].n = (t == nthreads - 1) ? n - begin : per;
+        job[t].sketch = &part[t];
+        created[t] = (pthread_create(&tid[t], NULL, sa_hist_thread, &job[t]) == 0);
+        if (!created[t]) {
+            sa_hist_thread(&job[t]);           /* run it here instead */
         }
+    }
+    for (int t = 0; t < nthreads; t++) {
+        if (created[t]) pthread_join(tid[t], NULL);
+        sa_hist_merge(h, &part[t]);
+    }
+    free(part);
+    return 1;
+}
 
-        printf("%3d: ", i + 1);
-
-        int spaces = MAX_BAR - left_bar;
-        for (int s = 0; s < spaces; s++) {
-            putchar(' ');
-        }
-        for (int j = 0; j < left_bar; j++) {
-            putchar('#');
-        }
+int sa_ctx_percentiles(SignalContext *ctx, SignalPercentiles *pct)
+{
+    const SignalStats *sig = &ctx->sig;
+    double out[4];
+    size_t n = (size_t)sig->count;
 
-        putchar('|');
+    if (sig->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
 
-        for (int j = 0; j < right_bar; j++) {
-            putchar('#');
+    double *a = (n <= SA_PCT_EXACT_MAX) ? sa_ctx_scratch(ctx, n) : NULL;
+    if (a) {
+        EtkPercentiles exact;                      /* quickselect on the scratch copy */
+        etk_percentiles(sig->samples, n, a, &exact);
+        out[0] = exact.p50;
+        out[1] = exact.p95;
+        out[2] = exact.p99;
+        out[3] = exact.p999;
+        pct->exact = 1;
+    } else {
+        SaHistSketch *h = malloc(sizeof(SaHistSketch));
+        if (!h || !sa_hist_build(h, sig->samples, n)) {
+            free(h);
+            return SA_ERR_MEMORY;
         }
-        for (int s = right_bar; s < MAX_BAR; s++) {
-            putchar(' ');
+        for (int q = 0; q < 4; q++) {
+            out[q] = sa_hist_quantile(h, sa_pct_levels[q]);
         }
-
-        printf("  (% .6f)\n", x);
+        free(h);
+        pct->exact = 0;
     }
+
+    pct->p50  = out[0];
+    pct->p95  = out[1];
+    pct->p99  = out[2];
+    pct->p999 = out[3];
+    return SA_OK;
 }
-void sa_save_stats_to_file(void)
+int sa_ctx_histogram(SignalContext *ctx, long long *bins, int nbins)
 {
-    const char *filename = "signal_stats.txt";
-
-    if (g_last_signal.count <= 0) {
-        printf("\nNo samples available. "
-               "Please enter or load samples first.\n");
-        return;
+    int status = sa_ctx_calculate(ctx);
+    if (status != SA_OK) {
+        return status;
     }
 
-    /* Ensure that statistical data is up to date */
-    sa_calculate_stats();
+    const SignalStats *sig = &ctx->sig;
+    etk_histogram(sig->samples, (size_t)sig->count, sig->min, sig->max, bins, nbins);
+    return SA_OK;
+}
+/* ASCII histogram over [min, max] followed by the percentiles */
+static void sa_plot_distribution(SignalContext *ctx)
+{
+    enum { NBINS = 16, MAX_BAR = 40 };
+    long long bins[NBINS];
+    SignalPercentiles pct;
 
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        printf("\nError: Could not open '%s' for writing.\n", filename);
+    if (sa_ctx_histogram(ctx, bins, NBINS) != SA_OK ||
+        sa_ctx_percentiles(ctx, &pct) != SA_OK) {
         return;
     }
 
-    fprintf(fp, "Signal statistics\n");
-    fprintf(fp, "Count = %d\n",  g_last_signal.count);
-    fprintf(fp, "Min   = %.6f\n", g_last_signal.min);
-    fprintf(fp, "Max   = %.6f\n", g_last_signal.max);
-    fprintf(fp, "Mean  = %.6f\n", g_last_signal.mean);
-    fprintf(fp, "RMS   = %.6f\n", g_last_signal.rms);
-
-    fclose(fp);
+    const SignalStats *sig = &ctx->sig;
+    double width = (sig->max - sig->min) / NBINS;
+    long long peak = 0;
+    for (int b = 0; b < NBINS; b++) {
+        if (bins[b] > peak) peak = bins[b];
+    }
 
-    printf("\nStatistics saved to '%s'.\n", filename);
+    printf("\nDistribution (%d bins from min to max)\n\n", NBINS);
+    for (int b = 0; b < NBINS; b++) {
+        int bar = (int)((double)bins[b] / (double)peak * MAX_BAR + 0.5);
+        printf("[% 12.6f, % 12.6f%c ", sig->min + b * width, sig->min + (b + 1) * width,
+               (b == NBINS - 1) ? ']' : ')');
+        for (int j = 0; j < MAX_BAR; j++) {
+            putchar(j < bar ? '#' : ' ');
+        }
+        printf(" %lld\n", bins[b]);
+        if (width == 0.0) break;                  /* all samples equal: one bin */
+    }
+    printf("\nMedian: %.6f  P95: %.6f  P99: %.6f  P99.9: %.6f  (%s)\n",
+           pct.p50, pct.p95, pct.p99, pct.p999, pct.exact ? "exact" : "histogram estimate");
 }
 
-/* ========================== *
- * 5. Unit Converter Module   *
- * ========================== */
+/* ============================================ *
+ * 1. Signal Analyzer: Fast number output       *
+ * ============================================ */
+
+/* Text output for large dumps (filtered / resampled streams, rolling       *
+ * series, sweeps) and the stats files.                                     *
+ *  - sa_fmt_fixed / sa_fmt_general give exactly the text of "%.Nf" and     *
+ *    "%.Ng".  Fast path: scale by an exact power of ten, round once and    *
+ *    print the integer.  The product carries at most one rounding error,   *
+ *    so the result is only trusted when it is not within that error of a   *
+ *    halfway point; ties, huge / tiny values, NaN and inf go to snprintf.  *
+ *  - sa_fmt_shortest gives the shortest decimal that reads back as the     *
+ *    same double (Grisu-style): for 1, 2, ... 17 significant digits the    *
+ *    rounded candidate is accepted once it lies within half the gap to the *
+ *    neighbouring doubles, computed in long double with an error margin.  *
+ *    Other cases use %.Ng verified with strtod, from the first undecided N *
+ *    (from 1 outside the fast range: subnormals, 1e300, ...).              *
+ *  - SaOutBuf collects the text and hands it to write() in one call when   *
+ *    the file is closed, or every SA_OUT_FLUSH bytes for streams.          */
+
+#define SA_FMT_MAX     400                  /* enough for "%.17f" of any double */
+#define SA_OUT_FLUSH   (1 << 20)
+
+static const double sa_pow10[23] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* ax * 10^prec (ax >= 0) rounded to an integer as printf would round the   *
+ * exact value.  Returns 1 on success, 0 if too close to a tie, -1 if the   *
+ * scaled value is too large for the fast path.                             */
+static int sa_fmt_scaled(double ax, int prec, uint64_t *r)
+{
+    if (prec < 0 || prec > 22) {
+        return -1;
+    }
+    double s = ax * sa_pow10[prec];
+    if (!(s < 0x1p52)) {
+        return -1;
+    }
+    double whole = floor(s);
+    double frac = s - whole;
+    if (fabs(frac - 0.5) <= s * 0x1p-52) {
+        return 0;
+    }
+    *r = (uint64_t)whole + (frac > 0.5);
+    return 1;
+}
+/* Write [-]r with `prec` decimals; strip = drop trailing fractional zeros */
+static int sa_fmt_emit(char *out, int neg, uint64_t r, int prec, int strip)
+{
+    char digits[32];
+    int nd = 0;
+
+    do {
+        digits[nd++] = (char)('0' + r % 10);
+        r /= 10;
+    } while (r != 0);
+    while (nd <= prec) {
+        digits[nd++] = '0';
+    }
 
-/* Provides several common engineering unit conversions:   *
- *  1) dBm ↔ mW     (RF / power)                           *
- *  2) Hz  ↔ rad/s  (frequency ↔ angular frequency)        *
- *  3) °C  ↔ K      (absolute temperature)                 *
- *  4) °F  ↔ °C     (temperature between scales)           *
- *  5) V   ↔ dBV    (voltage level in dBV reference)       */
+    int skip = 0;                               /* trailing zeros to drop */
+    if (strip) {
+        while (skip < prec && digits[skip] == '0') skip++;
+    }
 
-void menu_unit_converter(void)
+    char *p = out;
+    if (neg) *p++ = '-';
+    for (int i = nd - 1; i >= prec; i--) {
+        *p++ = digits[i];
+    }
+    if (prec > skip) {
+        *p++ = '.';
+        for (int i = prec - 1; i >= skip; i--) {
+            *p++ = digits[i];
+        }
+    }
+    *p = '\0';
+    return (int)(p - out);
+}
+static int sa_fmt_fixed(char *out, double x, int prec)      /* same text as "%.{prec}f" */
 {
-    int running = 1;
-
-    while (running) {
-        uc_print_menu();
-        int choice = uc_get_choice();
+    uint64_t r;
+    if (x == x && sa_fmt_scaled(fabs(x), prec, &r) == 1) {
+        return sa_fmt_emit(out, signbit(x) != 0, r, prec, 0);
+    }
+    return snprintf(out, SA_FMT_MAX, "%.*f", prec, x);
+}
+static int sa_fmt_general(char *out, double x, int digits)  /* same text as "%.{digits}g" */
+{
+    double ax = fabs(x);
 
-        switch (choice) {
-            case 1: { /* dBm <-> mW */
-                printf("\n1) dBm -> mW\n2) mW -> dBm\n");
-                int dir = uc_get_choice();
-                if (dir == 1) {                        /* dBm to mW: P(mW) = 10^(dBm/10) */
-                    double dbm = uc_get_double("Enter power in dBm: ");
-                    double mw  = pow(10.0, dbm / 10.0);
-                    printf("Result: %.6f mW\n", mw);
-                } else if (dir == 2) {                 /* mW to dBm: dBm = 10·log10(P(mW)), P > 0 */
-                    double mw = 0.0;
-                    do {
-                        mw = uc_get_double("Enter power in mW (> 0): ");
-                        if (mw <= 0.0) {
-                            printf("Power must be > 0 for dBm conversion.\n");
-                        }
-                    } while (mw <= 0.0);
-                    double dbm = 10.0 * log10(mw);
-                    printf("Result: %.6f dBm\n", dbm);
-                }
-                break;
+    if (x == 0.0 && !signbit(x)) {
+        out[0] = '0';
+        out[1] = '\0';
+        return 1;
+    }
+    if (ax >= 1e-4 && ax < 1e15 && digits >= 1 && digits <= 15) {
+        int e = (int)floor(log10(ax));          /* may be one off near powers of ten */
+        uint64_t lo = (uint64_t)sa_pow10[digits - 1];
+        for (int attempt = 0; attempt < 3; attempt++) {
+            int prec = digits - 1 - e;
+            uint64_t r;
+            if (e < -4 || e >= digits || sa_fmt_scaled(ax, prec, &r) != 1) {
+                break;                          /* exponent form or too close to call */
             }
-            case 2: { /* Hz <-> rad/s */
-                printf("\n1) Hz -> rad/s\n2) rad/s -> Hz\n");
-                int dir = uc_get_choice();
+            if (r < lo) {
+                e--;
+            } else if (r >= lo * 10) {
+                e++;                            /* rounding carried into a new digit */
+            } else {
+                return sa_fmt_emit(out, signbit(x) != 0, r, prec, 1);
+            }
+        }
+    }
+    return snprintf(out, SA_FMT_MAX, "%.*g", digits, x);
+}
+#if LDBL_MANT_DIG >= 64
+static const long double sa_pow10l[28] = {
+    1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L,
+    1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L,
+    1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L,
+    1e18L, 1e19L, 1e20L, 1e21L, 1e22L, 1e23L,
+    1e24L, 1e25L, 1e26L, 1e27L
+};
+
+static long double sa_pow10l_signed(int e)
+{
+    return (e < 0) ? 1.0L / sa_pow10l[-e] : sa_pow10l[e];
+}
+#endif
+
+static int sa_fmt_shortest(char *out, double x)            /* shortest text that reads back as x */
+{
+    double ax = fabs(x);
+    int from = 1;                                  /* fewer digits are known not to read back */
+
+#if LDBL_MANT_DIG >= 64
+    /* Try 1, 2, ... 17 significant digits.  In long double the scaled value *
+     * and the distance to the candidate are accurate to ~2^-62 relative,   *
+     * so "closer than half the gap to the neighbouring double" is decided  *
+     * exactly unless it is within that margin (then use the slow path).    */
+    if (ax >= 1e-5 && ax < 1e15) {
+        int ex;
+        double m = frexp(ax, &ex);
+        long double gap_up = ldexpl(1.0L, ex - 54);                       /* half the gap above */
+        long double gap_dn = (m == 0.5) ? ldexpl(1.0L, ex - 55) : gap_up; /* ... and below */
+        int e = (int)floor(log10(ax));
+        if (e > -6 && (long double)ax < sa_pow10l_signed(e)) e--;
+        if (e < 15 && (long double)ax >= sa_pow10l_signed(e + 1)) e++;
+
+        for (int digits = 1; digits <= 17; digits++) {
+            int prec = digits - 1 - e;                                    /* decimals, may be < 0 */
+            long double p10 = sa_pow10l[prec < 0 ? -prec : prec];
+            long double s   = (prec < 0) ? (long double)ax / p10 : (long double)ax * p10;
+            long double r   = rintl(s);
+            long double gap = ((r > s) ? gap_up : gap_dn);
+            gap = (prec < 0) ? gap / p10 : gap * p10;
+            long double dist = fabsl(s - r);
+            long double err  = (s + gap) * 0x1p-62L;
+
+            if (dist + err < gap) {
+                int len = sa_fmt_emit(out, signbit(x) != 0, (uint64_t)r, prec < 0 ? 0 : prec, 0);
+                for (int z = 0; z < -prec; z++) out[len++] = '0';
+                out[len] = '\0';
+                return len;
+            }
+            if (dist - err <= gap) {
+                from = digits;
+                break;                                                    /* too close to call */
+            }
+        }
+    }
+#else
+    if (ax < 1e15 && (ax >= 1e-5 || ax == 0.0)) {
+        for (int prec = 0; prec <= 22; prec++) {
+            uint64_t r;
+            int st = sa_fmt_scaled(ax, prec, &r);
+            if (st < 0) break;
+            if (st == 1 && (double)r / sa_pow10[prec] == ax) {
+                return sa_fmt_emit(out, signbit(x) != 0, r, prec, 0);
+            }
+        }
+    }
+#endif
+    if (x == 0.0) {
+        return snprintf(out, SA_FMT_MAX, "%s", signbit(x) ? "-0" : "0");
+    }
+    int len = 0;
+    for (int digits = from; digits <= 17; digits++) {
+        len = snprintf(out, SA_FMT_MAX, "%.*g", digits, x);
+        if (strtod(out, NULL) == x || x != x) break;
+    }
+    return len;
+}
+typedef struct {
+    int    fd;
+    char  *buf;                                 /* kept between files when the SaOutBuf is reused */
+    size_t len;
+    size_t cap;
+    int    error;
+} SaOutBuf;
+
+static int sa_out_open(SaOutBuf *ob, const char *filename)
+{
+    ob->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ob->len = 0;
+    ob->error = 0;
+    return ob->fd >= 0;
+}
+static void sa_out_flush(SaOutBuf *ob)
+{
+    size_t done = 0;
+    while (done < ob->len && !ob->error) {
+        ssize_t w = write(ob->fd, ob->buf + done, ob->len - done);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) ob->error = 1;
+        else done += (size_t)w;
+    }
+    ob->len = 0;
+}
+/* Room for n more bytes: grow up to SA_OUT_FLUSH, then write out instead */
+static int sa_out_need(SaOutBuf *ob, size_t n)
+{
+    if (ob->len + n <= ob->cap) {
+        return 1;
+    }
+    if (ob->len >= SA_OUT_FLUSH) {
+        sa_out_flush(ob);
+        if (n <= ob->cap) return 1;
+    }
+    size_t cap = ob->cap ? ob->cap * 2 : 65536;
+    while (cap < ob->len + n) cap *= 2;
+    char *grown = realloc(ob->buf, cap);
+    if (!grown) {
+        ob->error = 1;
+        return 0;
+    }
+    ob->buf = grown;
+    ob->cap = cap;
+    return 1;
+}
+static void sa_out_str(SaOutBuf *ob, const char *s)
+{
+    size_t n = strlen(s);
+    if (sa_out_need(ob, n)) {
+        memcpy(ob->buf + ob->len, s, n);
+        ob->len += n;
+    }
+}
+static void sa_out_char(SaOutBuf *ob, char c)
+{
+    if (sa_out_need(ob, 1)) {
+        ob->buf[ob->len++] = c;
+    }
+}
+static void sa_out_int(SaOutBuf *ob, long long v)
+{
+    if (sa_out_need(ob, 24)) {
+        ob->len += (size_t)sa_fmt_emit(ob->buf + ob->len, v < 0,
+                                       v < 0 ? 0 - (uint64_t)v : (uint64_t)v, 0, 0);
+    }
+}
+static void sa_out_fixed(SaOutBuf *ob, double x, int prec)
+{
+    if (sa_out_need(ob, SA_FMT_MAX)) {
+        ob->len += (size_t)sa_fmt_fixed(ob->buf + ob->len, x, prec);
+    }
+}
+static void sa_out_general(SaOutBuf *ob, double x, int digits)
+{
+    if (sa_out_need(ob, SA_FMT_MAX)) {
+        ob->len += (size_t)sa_fmt_general(ob->buf + ob->len, x, digits);
+    }
+}
+static void sa_out_shortest(SaOutBuf *ob, double x)
+{
+    if (sa_out_need(ob, SA_FMT_MAX)) {
+        ob->len += (size_t)sa_fmt_shortest(ob->buf + ob->len, x);
+    }
+}
+/* Write what is left and close the file; keeps the buffer for reuse */
+static int sa_out_close(SaOutBuf *ob)
+{
+    sa_out_flush(ob);
+    if (close(ob->fd) != 0) {
+        ob->error = 1;
+    }
+    ob->fd = -1;
+    return !ob->error;
+}
+static void sa_out_release(SaOutBuf *ob)
+{
+    free(ob->buf);
+    ob->buf = NULL;
+    ob->cap = ob->len = 0;
+}
+
+/* =================================== *
+ * 1. Signal Analyzer: Context API     *
+ * =================================== */
+
+/* Reentrant versions of the Signal Analyzer operations.  They work only on *
+ * the SignalContext they are given (no globals, no console prompts), so    *
+ * separate contexts can be loaded and analysed on different threads.  The  *
+ * menu functions further down are thin wrappers around the default        *
+ * context returned by sa_default_context().                               */
+SignalContext *sa_default_context(void)
+{
+    return &g_sa_ctx;
+}
+void sa_ctx_init(SignalContext *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+void sa_ctx_free(SignalContext *ctx)
+{
+    sa_signal_free(&ctx->sig);
+    free(ctx->scratch);
+    ctx->scratch = NULL;
+    ctx->scratch_cap = 0;
+    ctx->source[0] = '\0';
+}
+double *sa_ctx_scratch(SignalContext *ctx, size_t n)   /* Reusable per-context work buffer of n doubles */
+{
+    if (n > ctx->scratch_cap) {
+        double *grown = realloc(ctx->scratch, n * sizeof(double));
+        if (!grown) {
+            return NULL;
+        }
+        ctx->scratch = grown;
+        ctx->scratch_cap = n;
+    }
+    return ctx->scratch;
+}
+/* Parse an open stream into ctx.  max_bytes > 0 stops the read there and   *
+ * fails with SA_ERR_FORMAT, so a growing file cannot hold the caller.      */
+static int sa_ctx_load_stream(SignalContext *ctx, FILE *fp, const char *filename, long long max_bytes)
+{
+    enum { CHUNK = 65536 };
+
+    char   *chunk  = malloc(CHUNK + 1);
+    double *values = malloc((CHUNK / 2 + 1) * sizeof(double));
+    if (!chunk || !values) {
+        free(chunk);
+        free(values);
+        return SA_ERR_MEMORY;
+    }
+
+    SignalStats *sig = &ctx->sig;
+    long long rejected = 0;
+    size_t carry = 0;
+    int status = SA_OK;
+
+    long long total = 0;
+
+    sa_signal_clear(sig);
+
+    /* Appending keeps the cached sums/min/max current, so no rescan is needed later */
+    for (;;) {
+        size_t got = fread(chunk + carry, 1, CHUNK - carry, fp);
+        int final = (got == 0);
+        total += (long long)got;
+        if (max_bytes > 0 && total > max_bytes) {
+            status = SA_ERR_FORMAT;
+            break;
+        }
+        size_t len = carry + got;
+        size_t used = 0;
+
+        size_t n = sa_parse_number_chunk(chunk, len, final, values, &used, &rejected);
+        for (size_t i = 0; i < n && status == SA_OK; i++) {
+            if (!sa_signal_append(sig, values[i])) {
+                status = SA_ERR_MEMORY;
+            }
+        }
+
+        if (final || status != SA_OK) {
+            break;
+        }
+
+        carry = len - used;
+        if (carry >= CHUNK) {
+            carry = 0;   /* a single over-long token is not a number */
+        }
+        memmove(chunk, chunk + used, carry);
+    }
+
+    free(chunk);
+    free(values);
+
+    snprintf(ctx->source, sizeof(ctx->source), "%s", filename);
+
+    if (status == SA_OK && sig->count == 0) {
+        status = SA_ERR_EMPTY;
+    }
+    return status;
+}
+int sa_ctx_load_file(SignalContext *ctx, const char *filename)
+{
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        return SA_ERR_OPEN;
+    }
+    int status = sa_ctx_load_stream(ctx, fp, filename, 0);
+    fclose(fp);
+    return status;
+}
+int sa_ctx_calculate(SignalContext *ctx)
+{
+    if (ctx->sig.count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    sa_signal_refresh(&ctx->sig);   /* O(1) unless the samples were edited in place */
+    return SA_OK;
+}
+int sa_ctx_plot(SignalContext *ctx)
+{
+    if (ctx->sig.count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    sa_plot_series(ctx->sig.samples, ctx->sig.count);
+    sa_plot_distribution(ctx);
+    return SA_OK;
+}
+int sa_ctx_save_stats(SignalContext *ctx, const char *filename)
+{
+    return sa_ctx_save_stats_as(ctx, filename, SA_SAVE_TEXT);
+}
+
+/* ================================================= *
+ * 1. Signal Analyzer: Structured output and run log  *
+ * ================================================= */
+
+/* The same snapshot of a context (count, min/max/mean/RMS, percentiles and *
+ * a 16-bin histogram) can be saved as:                                     *
+ *   - text    the human-readable report (signal_stats.txt)                 *
+ *   - JSON    one object, numbers in shortest round-trip form              *
+ *   - CSV     a header line and one row                                    *
+ *   - binary  one SaStatsRecord in host byte order                         *
+ * Every analysis run is also appended to a results log (SA_RUN_LOG): one   *
+ * JSON object per line, written with O_APPEND so a record is never         *
+ * rewritten and concurrent writers do not interleave.  The log is fsync'ed *
+ * every SA_RUNLOG_SYNC_RECORDS records or SA_RUNLOG_SYNC_SECONDS, and once *
+ * more at exit, instead of after every record.                             */
+
+#define SA_STATS_BINS            16
+#define SA_RUNLOG_SYNC_RECORDS   64
+#define SA_RUNLOG_SYNC_SECONDS   1.0
+
+typedef struct {
+    char     magic[4];            /* "ETKS" */
+    uint32_t version;             /* 1 */
+    int64_t  count;
+    double   min, max, mean, rms;
+    double   p50, p95, p99, p999;
+    uint32_t exact;               /* 1 = exact percentiles */
+    uint32_t nbins;               /* SA_STATS_BINS, equal bins over [min, max] */
+    int64_t  bins[SA_STATS_BINS];
+} SaStatsRecord;
+
+static int sa_stats_snapshot(SignalContext *ctx, SaStatsRecord *rec)
+{
+    SignalPercentiles pct;
+    long long bins[SA_STATS_BINS];
+    int status;
+
+    if ((status = sa_ctx_calculate(ctx)) != SA_OK ||
+        (status = sa_ctx_percentiles(ctx, &pct)) != SA_OK ||
+        (status = sa_ctx_histogram(ctx, bins, SA_STATS_BINS)) != SA_OK) {
+        return status;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    memcpy(rec->magic, "ETKS", 4);
+    rec->version = 1;
+    rec->count = ctx->sig.count;
+    rec->min   = ctx->sig.min;
+    rec->max   = ctx->sig.max;
+    rec->mean  = ctx->sig.mean;
+    rec->rms   = ctx->sig.rms;
+    rec->p50   = pct.p50;
+    rec->p95   = pct.p95;
+    rec->p99   = pct.p99;
+    rec->p999  = pct.p999;
+    rec->exact = (uint32_t)pct.exact;
+    rec->nbins = SA_STATS_BINS;
+    for (int b = 0; b < SA_STATS_BINS; b++) {
+        rec->bins[b] = bins[b];
+    }
+    return SA_OK;
+}
+
+/* JSON has no NaN / infinity: those become null */
+static void sa_out_json_num(SaOutBuf *ob, double x)
+{
+    if (isfinite(x)) sa_out_shortest(ob, x);
+    else sa_out_str(ob, "null");
+}
+static void sa_out_json_str(SaOutBuf *ob, const char *s)
+{
+    sa_out_char(ob, '"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            sa_out_char(ob, '\\');
+            sa_out_char(ob, (char)c);
+        } else if (c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            sa_out_str(ob, esc);
+        } else {
+            sa_out_char(ob, (char)c);
+        }
+    }
+    sa_out_char(ob, '"');
+}
+static void sa_out_csv_str(SaOutBuf *ob, const char *s)
+{
+    sa_out_char(ob, '"');
+    for (; *s; s++) {
+        if (*s == '"') sa_out_char(ob, '"');
+        sa_out_char(ob, *s);
+    }
+    sa_out_char(ob, '"');
+}
+
+/* "count":...,"min":...,"max":...,"mean":...,"rms":...  (shared by stats files and the log) */
+static void sa_out_json_basic(SaOutBuf *ob, long long count, double min, double max,
+                              double mean, double rms)
+{
+    const char *keys[] = { ",\"min\":", ",\"max\":", ",\"mean\":", ",\"rms\":" };
+    const double vals[] = { min, max, mean, rms };
+
+    sa_out_str(ob, "\"count\":");
+    sa_out_int(ob, count);
+    for (int i = 0; i < 4; i++) {
+        sa_out_str(ob, keys[i]);
+        sa_out_json_num(ob, vals[i]);
+    }
+}
+static void sa_out_json_pct(SaOutBuf *ob, const SaStatsRecord *rec)
+{
+    const char *keys[] = { ",\"p50\":", ",\"p95\":", ",\"p99\":", ",\"p999\":" };
+    const double vals[] = { rec->p50, rec->p95, rec->p99, rec->p999 };
+
+    for (int i = 0; i < 4; i++) {
+        sa_out_str(ob, keys[i]);
+        sa_out_json_num(ob, vals[i]);
+    }
+    sa_out_str(ob, rec->exact ? ",\"exact\":true" : ",\"exact\":false");
+}
+
+static void sa_stats_text(SaOutBuf *ob, const SaStatsRecord *rec)
+{
+    const char *labels[] = { "Min   = ", "Max   = ", "Mean  = ", "RMS   = ",
+                             "Median = ", "P95   = ", "P99   = ", "P99.9 = " };
+    const double values[] = { rec->min, rec->max, rec->mean, rec->rms,
+                              rec->p50, rec->p95, rec->p99, rec->p999 };
+
+    sa_out_str(ob, "Signal statistics\nCount = ");
+    sa_out_int(ob, rec->count);
+    sa_out_char(ob, '\n');
+    for (int i = 0; i < 8; i++) {
+        sa_out_str(ob, labels[i]);
+        sa_out_fixed(ob, values[i], 6);
+        sa_out_char(ob, '\n');
+    }
+    sa_out_str(ob, rec->exact ? "Percentiles: exact\n"
+                              : "Percentiles: histogram estimate (bins under 1.6% wide)\n");
+
+    double width = (rec->max - rec->min) / SA_STATS_BINS;
+    sa_out_str(ob, "\nHistogram (");
+    sa_out_int(ob, SA_STATS_BINS);
+    sa_out_str(ob, " bins from min to max)\n");
+    for (int b = 0; b < SA_STATS_BINS; b++) {
+        sa_out_fixed(ob, rec->min + b * width, 6);
+        sa_out_char(ob, ' ');
+        sa_out_fixed(ob, rec->min + (b + 1) * width, 6);
+        sa_out_char(ob, ' ');
+        sa_out_int(ob, rec->bins[b]);
+        sa_out_char(ob, '\n');
+    }
+}
+static void sa_stats_json(SaOutBuf *ob, const SaStatsRecord *rec, const char *source)
+{
+    sa_out_str(ob, "{\"source\":");
+    sa_out_json_str(ob, source);
+    sa_out_char(ob, ',');
+    sa_out_json_basic(ob, rec->count, rec->min, rec->max, rec->mean, rec->rms);
+    sa_out_json_pct(ob, rec);
+    sa_out_str(ob, ",\"histogram\":[");
+    for (int b = 0; b < SA_STATS_BINS; b++) {
+        if (b) sa_out_char(ob, ',');
+        sa_out_int(ob, rec->bins[b]);
+    }
+    sa_out_str(ob, "]}\n");
+}
+static void sa_stats_csv(SaOutBuf *ob, const SaStatsRecord *rec, const char *source)
+{
+    const double values[] = { rec->min, rec->max, rec->mean, rec->rms,
+                              rec->p50, rec->p95, rec->p99, rec->p999 };
+
+    sa_out_str(ob, "source,count,min,max,mean,rms,p50,p95,p99,p999,exact");
+    for (int b = 0; b < SA_STATS_BINS; b++) {
+        sa_out_str(ob, ",bin");
+        sa_out_int(ob, b);
+    }
+    sa_out_char(ob, '\n');
+
+    sa_out_csv_str(ob, source);
+    sa_out_char(ob, ',');
+    sa_out_int(ob, rec->count);
+    for (int i = 0; i < 8; i++) {
+        sa_out_char(ob, ',');
+        sa_out_shortest(ob, values[i]);
+    }
+    sa_out_str(ob, rec->exact ? ",1" : ",0");
+    for (int b = 0; b < SA_STATS_BINS; b++) {
+        sa_out_char(ob, ',');
+        sa_out_int(ob, rec->bins[b]);
+    }
+    sa_out_char(ob, '\n');
+}
+
+static int sa_stats_save(const SaStatsRecord *record, const char *source,
+                         const char *filename, int format)
+{
+    SaStatsRecord rec = *record;
+    SaOutBuf ob = { 0 };
+    if (!sa_out_open(&ob, filename)) {
+        return SA_ERR_OPEN;
+    }
+
+    /* Built in memory and written with a single write() */
+    switch (format) {
+    case SA_SAVE_JSON:
+        sa_stats_json(&ob, &rec, source);
+        break;
+    case SA_SAVE_CSV:
+        sa_stats_csv(&ob, &rec, source);
+        break;
+    case SA_SAVE_BINARY:
+        if (sa_out_need(&ob, sizeof(rec))) {
+            memcpy(ob.buf + ob.len, &rec, sizeof(rec));
+            ob.len += sizeof(rec);
+        }
+        break;
+    default:
+        sa_stats_text(&ob, &rec);
+        break;
+    }
+
+    int ok = sa_out_close(&ob);
+    sa_out_release(&ob);
+    return ok ? SA_OK : SA_ERR_OPEN;
+}
+int sa_ctx_save_stats_as(SignalContext *ctx, const char *filename, int format)
+{
+    SaStatsRecord rec;
+    int status = sa_stats_snapshot(ctx, &rec);
+    if (status != SA_OK) {
+        return status;
+    }
+    return sa_stats_save(&rec, ctx->source, filename, format);
+}
+
+/* ---- Append-only results log ---- */
+typedef struct {
+    pthread_mutex_t lock;
+    SaOutBuf        ob;           /* ob.fd is the log, opened O_APPEND */
+    int             pending;      /* records written since the last fsync */
+    double          last_sync;
+} SaRunLog;
+
+static SaRunLog g_sa_runlog = { PTHREAD_MUTEX_INITIALIZER, { -1, NULL, 0, 0, 0 }, 0, 0.0 };
+
+static double sa_wall_now(void)   /* Unix time in seconds */
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+static void sa_runlog_atexit(void)
+{
+    sa_runlog_sync();
+}
+
+/* Lock the log and open it on first use; 0 if it cannot be opened */
+static int sa_runlog_begin(void)
+{
+    pthread_mutex_lock(&g_sa_runlog.lock);
+    if (g_sa_runlog.ob.fd < 0) {
+        int fd = open(SA_RUN_LOG, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            pthread_mutex_unlock(&g_sa_runlog.lock);
+            return 0;
+        }
+        g_sa_runlog.ob.fd = fd;
+        g_sa_runlog.last_sync = sa_wall_now();
+        atexit(sa_runlog_atexit);
+    }
+    g_sa_runlog.ob.error = 0;
+    return 1;
+}
+/* Start a record: {"time":"2026-01-31T12:00:00.000Z","t":...,"elapsed_s":...,"mode":...,"source":..., */
+static void sa_runlog_head(double started, double elapsed, const char *mode, const char *source)
+{
+    SaOutBuf *ob = &g_sa_runlog.ob;
+    char stamp[40];
+    time_t secs = (time_t)started;
+    struct tm utc;
+
+    gmtime_r(&secs, &utc);
+    size_t n = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(stamp + n, sizeof(stamp) - n, ".%03dZ", (int)((started - (double)secs) * 1000.0));
+
+    sa_out_str(ob, "{\"time\":\"");
+    sa_out_str(ob, stamp);
+    sa_out_str(ob, "\",\"t\":");
+    sa_out_fixed(ob, started, 3);
+    sa_out_str(ob, ",\"elapsed_s\":");
+    sa_out_fixed(ob, elapsed, 6);
+    sa_out_str(ob, ",\"mode\":");
+    sa_out_json_str(ob, mode);
+    sa_out_str(ob, ",\"source\":");
+    sa_out_json_str(ob, source);
+    sa_out_char(ob, ',');
+}
+/* Finish a record; whole records are written once the buffer is half full */
+static void sa_runlog_tail(const char *status)
+{
+    SaOutBuf *ob = &g_sa_runlog.ob;
+
+    sa_out_str(ob, ",\"status\":");
+    sa_out_json_str(ob, status);
+    sa_out_str(ob, "}\n");
+    g_sa_runlog.pending++;
+    if (ob->len >= SA_OUT_FLUSH / 2) {
+        sa_out_flush(ob);
+    }
+}
+/* Write the buffered records, fsync if the batch is due, unlock */
+static int sa_runlog_end(void)
+{
+    SaOutBuf *ob = &g_sa_runlog.ob;
+
+    sa_out_flush(ob);
+    double now = sa_wall_now();
+    if (g_sa_runlog.pending >= SA_RUNLOG_SYNC_RECORDS ||
+        (g_sa_runlog.pending > 0 && now - g_sa_runlog.last_sync >= SA_RUNLOG_SYNC_SECONDS)) {
+        if (fdatasync(ob->fd) != 0) ob->error = 1;
+        g_sa_runlog.pending = 0;
+        g_sa_runlog.last_sync = now;
+    }
+    int ok = !ob->error;
+    pthread_mutex_unlock(&g_sa_runlog.lock);
+    return ok;
+}
+
+int sa_runlog_sync(void)
+{
+    int ok = 1;
+    pthread_mutex_lock(&g_sa_runlog.lock);
+    if (g_sa_runlog.ob.fd >= 0) {
+        sa_out_flush(&g_sa_runlog.ob);
+        if (g_sa_runlog.pending > 0 && fdatasync(g_sa_runlog.ob.fd) != 0) ok = 0;
+        g_sa_runlog.pending = 0;
+        g_sa_runlog.last_sync = sa_wall_now();
+        ok = ok && !g_sa_runlog.ob.error;
+    }
+    pthread_mutex_unlock(&g_sa_runlog.lock);
+    return ok;
+}
+
+static int sa_runlog_stats(const SaStatsRecord *rec, const char *mode, const char *source,
+                           double started)
+{
+    if (!sa_runlog_begin()) {
+        return SA_ERR_OPEN;
+    }
+
+    double now = sa_wall_now();
+    if (started <= 0.0) started = now;
+    sa_runlog_head(started, now - started, mode, source);
+    sa_out_json_basic(&g_sa_runlog.ob, rec->count, rec->min, rec->max, rec->mean, rec->rms);
+    sa_out_json_pct(&g_sa_runlog.ob, rec);
+    sa_runlog_tail("ok");
+    return sa_runlog_end() ? SA_OK : SA_ERR_OPEN;
+}
+int sa_ctx_log_run(SignalContext *ctx, const char *mode, double started)
+{
+    SaStatsRecord rec;
+    int status = sa_stats_snapshot(ctx, &rec);
+    if (status != SA_OK) {
+        return status;
+    }
+    return sa_runlog_stats(&rec, mode, ctx->source, started);
+}
+
+/* ================================== *
+ * 1. Signal Analyzer: Result cache   *
+ * ================================== */
+
+/* Results of analysing a file are kept in SA_CACHE_DIR (or $ETK_CACHE_DIR), *
+ * one entry per file named after a hash of its absolute path.  An entry     *
+ * stores the file's size, mtime, inode and an XXH64 hash of its contents    *
+ * next to the statistics, so that:                                          *
+ *   - same size + mtime + inode  -> the entry is used without reading the   *
+ *     file at all (a stat() and one small read)                             *
+ *   - same size, other mtime     -> the file is hashed (several GB/s, far   *
+ *     faster than parsing); an equal hash reuses the entry and refreshes    *
+ *     the stored mtime (copied or touched files)                            *
+ *   - anything else              -> the file is analysed again              *
+ * A file whose mtime was within SA_CACHE_RACY_S of the moment its entry     *
+ * was written may have changed again within the same timestamp tick, so it  *
+ * is always verified by hash.  Entries are written to a temporary file and  *
+ * renamed into place, so readers never see a half-written entry.           */
+
+#define SA_CACHE_DIR        ".etk_cache"
+#define SA_CACHE_VERSION    1             /* bump when the analysis changes */
+#define SA_CACHE_RACY_S     2.0
+#define SA_CACHE_HAS_DIST   1u            /* percentiles / histogram present */
+#define SA_HASH_CHUNK       (1 << 20)
+
+/* ---- XXH64 (streaming) ---- */
+#define SA_XXH_P1 0x9E3779B185EBCA87ULL
+#define SA_XXH_P2 0xC2B2AE3D27D4EB4FULL
+#define SA_XXH_P3 0x165667B19E3779F9ULL
+#define SA_XXH_P4 0x85EBCA77C2B2AE63ULL
+#define SA_XXH_P5 0x27D4EB2F165667C5ULL
+
+typedef struct {
+    uint64_t v[4];
+    uint64_t total;
+    uint8_t  mem[32];             /* partial stripe */
+    size_t   memsize;
+} SaHash64;
+
+static uint64_t sa_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+static uint64_t sa_xxh_round(uint64_t acc, uint64_t in)
+{
+    acc += in * SA_XXH_P2;
+    return sa_rotl64(acc, 31) * SA_XXH_P1;
+}
+static uint64_t sa_xxh_read64(const uint8_t *p)      /* little-endian hosts only */
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+static void sa_hash64_init(SaHash64 *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->v[0] = SA_XXH_P1 + SA_XXH_P2;
+    h->v[1] = SA_XXH_P2;
+    h->v[2] = 0;
+    h->v[3] = 0 - SA_XXH_P1;
+}
+static void sa_hash64_update(SaHash64 *h, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data, *end = p + len;
+    h->total += len;
+
+    if (h->memsize + len < 32) {
+        memcpy(h->mem + h->memsize, p, len);
+        h->memsize += len;
+        return;
+    }
+    if (h->memsize) {
+        size_t fill = 32 - h->memsize;
+        memcpy(h->mem + h->memsize, p, fill);
+        for (int i = 0; i < 4; i++) h->v[i] = sa_xxh_round(h->v[i], sa_xxh_read64(h->mem + 8 * i));
+        p += fill;
+        h->memsize = 0;
+    }
+    /* Four independent lanes: the multiply chains overlap in the pipeline */
+    uint64_t v0 = h->v[0], v1 = h->v[1], v2 = h->v[2], v3 = h->v[3];
+    for (; p + 32 <= end; p += 32) {
+        v0 = sa_xxh_round(v0, sa_xxh_read64(p));
+        v1 = sa_xxh_round(v1, sa_xxh_read64(p + 8));
+        v2 = sa_xxh_round(v2, sa_xxh_read64(p + 16));
+        v3 = sa_xxh_round(v3, sa_xxh_read64(p + 24));
+    }
+    h->v[0] = v0; h->v[1] = v1; h->v[2] = v2; h->v[3] = v3;
+
+    h->memsize = (size_t)(end - p);
+    memcpy(h->mem, p, h->memsize);
+}
+static uint64_t sa_hash64_final(const SaHash64 *h)
+{
+    uint64_t acc;
+    if (h->total >= 32) {
+        acc = sa_rotl64(h->v[0], 1) + sa_rotl64(h->v[1], 7) +
+              sa_rotl64(h->v[2], 12) + sa_rotl64(h->v[3], 18);
+        for (int i = 0; i < 4; i++) {
+            acc ^= sa_xxh_round(0, h->v[i]);
+            acc = acc * SA_XXH_P1 + SA_XXH_P4;
+        }
+    } else {
+        acc = SA_XXH_P5;
+    }
+    acc += h->total;
+
+    const uint8_t *p = h->mem, *end = h->mem + h->memsize;
+    for (; p + 8 <= end; p += 8) {
+        acc ^= sa_xxh_round(0, sa_xxh_read64(p));
+        acc = sa_rotl64(acc, 27) * SA_XXH_P1 + SA_XXH_P4;
+    }
+    if (p + 4 <= end) {
+        uint32_t w;
+        memcpy(&w, p, 4);
+        acc ^= (uint64_t)w * SA_XXH_P1;
+        acc = sa_rotl64(acc, 23) * SA_XXH_P2 + SA_XXH_P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        acc ^= *p * SA_XXH_P5;
+        acc = sa_rotl64(acc, 11) * SA_XXH_P1;
+    }
+    acc ^= acc >> 33;
+    acc *= SA_XXH_P2;
+    acc ^= acc >> 29;
+    acc *= SA_XXH_P3;
+    acc ^= acc >> 32;
+    return acc;
+}
+static uint64_t sa_hash64(const void *data, size_t len)
+{
+    SaHash64 h;
+    sa_hash64_init(&h);
+    sa_hash64_update(&h, data, len);
+    return sa_hash64_final(&h);
+}
+static int sa_file_hash(const char *filename, uint64_t *hash)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    char *buf = malloc(SA_HASH_CHUNK);
+    if (!buf) {
+        close(fd);
+        return 0;
+    }
+
+    SaHash64 h;
+    sa_hash64_init(&h);
+    ssize_t got;
+    while ((got = read(fd, buf, SA_HASH_CHUNK)) != 0) {
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        sa_hash64_update(&h, buf, (size_t)got);
+    }
+    free(buf);
+    close(fd);
+    *hash = sa_hash64_final(&h);
+    return got == 0;
+}
+
+/* ---- Cache entries ---- */
+typedef struct {
+    char          magic[4];       /* "ETKC" */
+    uint32_t      version;        /* SA_CACHE_VERSION */
+    uint64_t      size;
+    int64_t       mtime_sec;
+    int64_t       mtime_nsec;
+    uint64_t      ino;
+    uint64_t      hash;           /* XXH64 of the contents, seed 0 */
+    double        cached_at;      /* Unix time the entry was written */
+    uint32_t      flags;          /* SA_CACHE_* */
+    uint32_t      reserved;
+    double        sum, sum_sq;
+    int64_t       rejected;       /* tokens that were not numbers */
+    SaStatsRecord stats;          /* count..p999, histogram (if SA_CACHE_HAS_DIST) */
+    char          path[1024];     /* absolute path, guards against name-hash collisions */
+} SaCacheEntry;
+
+/* Entry file for `filename`; fills the absolute path used as the key */
+static int sa_cache_entry_name(const char *filename, char *abs, size_t abs_len,
+                               char *out, size_t out_len)
+{
+    char resolved[PATH_MAX];
+    if (!realpath(filename, resolved)) {
+        return 0;
+    }
+    const char *dir = getenv("ETK_CACHE_DIR");
+    if (!dir || !*dir) dir = SA_CACHE_DIR;
+
+    size_t len = strlen(resolved);
+    if (len >= abs_len) {
+        return 0;
+    }
+    memcpy(abs, resolved, len + 1);
+    int n = snprintf(out, out_len, "%s/%016llx.etc", dir,
+                     (unsigned long long)sa_hash64(resolved, strlen(resolved)));
+    return n > 0 && (size_t)n < out_len;
+}
+static void sa_cache_stamp(SaCacheEntry *e, const struct stat *sb)
+{
+    e->size       = (uint64_t)sb->st_size;
+    e->mtime_sec  = (int64_t)sb->st_mtim.tv_sec;
+    e->mtime_nsec = (int64_t)sb->st_mtim.tv_nsec;
+    e->ino        = (uint64_t)sb->st_ino;
+    e->cached_at  = sa_wall_now();
+}
+static int sa_cache_write(const char *entry_file, const SaCacheEntry *e)
+{
+    char tmp[PATH_MAX + 32];
+    const char *dir = getenv("ETK_CACHE_DIR");
+    if (!dir || !*dir) dir = SA_CACHE_DIR;
+    mkdir(dir, 0755);
+
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%lx", entry_file, (long)getpid(),
+             (unsigned long)pthread_self());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+    int ok = write(fd, e, sizeof(*e)) == (ssize_t)sizeof(*e);
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tmp, entry_file) != 0) {
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+/* Valid entry for the file as it is now?  need_dist: percentiles required */
+static int sa_cache_probe(const char *filename, int need_dist, SaCacheEntry *e)
+{
+    char abs[1024], entry_file[PATH_MAX];
+    struct stat sb;
+
+    if (stat(filename, &sb) != 0 ||
+        !sa_cache_entry_name(filename, abs, sizeof(abs), entry_file, sizeof(entry_file))) {
+        return 0;
+    }
+    int fd = open(entry_file, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t got = read(fd, e, sizeof(*e));
+    close(fd);
+
+    if (got != (ssize_t)sizeof(*e) || memcmp(e->magic, "ETKC", 4) != 0 ||
+        e->version != SA_CACHE_VERSION || strcmp(e->path, abs) != 0 ||
+        e->size != (uint64_t)sb.st_size ||
+        (need_dist && !(e->flags & SA_CACHE_HAS_DIST))) {
+        return 0;
+    }
+
+    double mtime = (double)sb.st_mtim.tv_sec + (double)sb.st_mtim.tv_nsec * 1e-9;
+    if (e->mtime_sec == (int64_t)sb.st_mtim.tv_sec && e->mtime_nsec == (int64_t)sb.st_mtim.tv_nsec &&
+        e->ino == (uint64_t)sb.st_ino && e->cached_at - mtime >= SA_CACHE_RACY_S) {
+        return 1;
+    }
+
+    /* Same size but different (or too recent) timestamp: compare contents */
+    uint64_t hash;
+    if (!sa_file_hash(filename, &hash) || hash != e->hash) {
+        return 0;
+    }
+    sa_cache_stamp(e, &sb);
+    sa_cache_write(entry_file, e);
+    return 1;
+}
+
+/* Record results for `filename`.  hash: XXH64 taken while the file was read, *
+ * or NULL to hash it now.  Nothing is stored if the file changed since      *
+ * `before` was taken.                                                       */
+static int sa_cache_store(const char *filename, const struct stat *before, const uint64_t *hash,
+                          const SaStatsRecord *rec, unsigned flags,
+                          double sum, double sum_sq, long long rejected)
+{
+    char abs[1024], entry_file[PATH_MAX];
+    struct stat after;
+    SaCacheEntry e;
+
+    if (!sa_cache_entry_name(filename, abs, sizeof(abs), entry_file, sizeof(entry_file))) {
+        return 0;
+    }
+    memset(&e, 0, sizeof(e));
+    if (hash) {
+        e.hash = *hash;
+    } else if (!sa_file_hash(filename, &e.hash)) {
+        return 0;
+    }
+    if (stat(filename, &after) != 0 ||
+        after.st_size != before->st_size || after.st_mtim.tv_sec != before->st_mtim.tv_sec ||
+        after.st_mtim.tv_nsec != before->st_mtim.tv_nsec) {
+        return 0;
+    }
+
+    memcpy(e.magic, "ETKC", 4);
+    e.version  = SA_CACHE_VERSION;
+    sa_cache_stamp(&e, before);
+    e.flags    = flags;
+    e.sum      = sum;
+    e.sum_sq   = sum_sq;
+    e.rejected = rejected;
+    e.stats    = *rec;
+    snprintf(e.path, sizeof(e.path), "%s", abs);
+    return sa_cache_write(entry_file, &e);
+}
+
+static void sa_cache_fill(const SaCacheEntry *e, SignalStats *st, SignalPercentiles *pct)
+{
+    if (st) {
+        memset(st, 0, sizeof(*st));
+        st->count  = (e->stats.count > INT_MAX) ? INT_MAX : (int)e->stats.count;
+        st->mean   = e->stats.mean;
+        st->rms    = e->stats.rms;
+        st->min    = e->stats.min;
+        st->max    = e->stats.max;
+        st->sum    = e->sum;
+        st->sum_sq = e->sum_sq;
+    }
+    if (pct) {
+        pct->p50   = e->stats.p50;
+        pct->p95   = e->stats.p95;
+        pct->p99   = e->stats.p99;
+        pct->p999  = e->stats.p999;
+        pct->exact = (int)e->stats.exact;
+    }
+}
+
+/* Analyse a file into `ctx` (which keeps the samples) and cache the result. *
+ * fd >= 0: read that descriptor (the caller has checked it), at most        *
+ * max_bytes; the descriptor stays open.                                     */
+static int sa_cache_analyze(SignalContext *ctx, const char *filename, int fd, long long max_bytes,
+                            SaCacheEntry *e)
+{
+    struct stat sb;
+    int status;
+
+    if (fd >= 0) {
+        int own = dup(fd);
+        FILE *fp = (own >= 0) ? fdopen(own, "r") : NULL;
+        if (fstat(fd, &sb) != 0 || !fp) {
+            if (fp) fclose(fp);
+            else if (own >= 0) close(own);
+            return SA_ERR_OPEN;
+        }
+        status = sa_ctx_load_stream(ctx, fp, filename, max_bytes);
+        fclose(fp);
+    } else {
+        if (stat(filename, &sb) != 0) {
+            return SA_ERR_OPEN;
+        }
+        status = sa_ctx_load_file(ctx, filename);
+    }
+    if (status == SA_OK) {
+        status = sa_stats_snapshot(ctx, &e->stats);
+    }
+    if (status != SA_OK) {
+        return status;
+    }
+    e->sum    = ctx->sig.sum;
+    e->sum_sq = ctx->sig.sum_sq;
+    sa_cache_store(filename, &sb, NULL, &e->stats, SA_CACHE_HAS_DIST, e->sum, e->sum_sq, 0);
+    return SA_OK;
+}
+
+int sa_file_stats_cached(const char *filename, SignalStats *st, SignalPercentiles *pct,
+                         int *from_cache)
+{
+    SaCacheEntry e;
+    int hit = sa_cache_probe(filename, pct != NULL, &e);
+
+    if (!hit) {
+        SignalContext tmp;
+        sa_ctx_init(&tmp);
+        int status = sa_cache_analyze(&tmp, filename, -1, 0, &e);
+        sa_ctx_free(&tmp);
+        if (status != SA_OK) {
+            return status;
+        }
+    }
+    sa_cache_fill(&e, st, pct);
+    if (from_cache) *from_cache = hit;
+    return SA_OK;
+}
+
+/* ============================= *
+ * 1. Signal Analyzer Functions  *
+ * ============================= */
+void sa_enter_samples(void)
+{
+    char buf[64];
+    int count = 0;
+
+    /* 1. Ask User for sample number */
+    while (1) {
+        printf("\nHow many samples do you want to enter? (1-%d): ",
+               MAX_SAMPLES);
+
+        if (!fgets(buf, sizeof(buf), stdin)) {
+            printf("\nInput error. Cancelling.\n");
+            return;
+        }
+        buf[strcspn(buf, "\r\n")] = '\0';  /* Remove line breaks */
+
+        if (!sa_is_integer(buf)) {
+            printf("Please enter an integer number.\n");
+            continue;
+        }
+
+        count = (int)strtol(buf, NULL, 10);
+        if (count < 1 || count > MAX_SAMPLES) {
+            printf("Please choose a value between 1 and %d.\n", MAX_SAMPLES);
+            continue;
+        }
+
+        break;  /* if it can run then exit loop */
+    }
+
+    SignalStats *sig = &g_sa_ctx.sig;
+    sa_signal_clear(sig);
+    snprintf(g_sa_ctx.source, sizeof(g_sa_ctx.source), "manual entry");
+
+    /* 2. Input the samples (cached statistics are updated as each one is appended) */
+    for (int i = 0; i < count; i++) {
+        double value = 0.0;
+        while (1) {
+            printf("Enter sample %d: ", i + 1);
+
+            if (!fgets(buf, sizeof(buf), stdin)) {
+                printf("\nInput error while reading sample. "
+                       "Stopping input.\n");
+                return;               /* Keeps the i samples successfully read */
+            }
+            buf[strcspn(buf, "\r\n")] = '\0';
+
+            char *endptr = NULL;
+            value = strtod(buf, &endptr);
+
+            /* Check whether the entire string is a valid floating-point number. */
+            if (endptr == buf || *endptr != '\0') {
+                printf("Please enter a valid number.\n");
+                continue;
+            }
+
+            if (!sa_signal_append(sig, value)) {
+                printf("\nOut of memory. Stopping input.\n");
+                return;
+            }
+            break;  /* Exit the inner loop */
+        }
+    }
+
+    printf("\nStored %d samples successfully.\n", sig->count);
+}
+static int sa_load_from_file_generic(const char *filename) /* Generic loading function for Tool (Menu 7): reads samples from any filename*/    
+{
+    return sa_load_report(sa_ctx_load_file(&g_sa_ctx, filename), filename);
+}
+static int sa_load_report(int status, const char *filename)   /* Console message for a load status; 1 if loaded */
+{
+    if (status == SA_ERR_OPEN) {
+        printf("\nError: Could not open '%s'. "
+               "Make sure the file exists in the same folder as the program.\n",
+               filename);
+        return 0;
+    }
+    if (status == SA_ERR_EMPTY) {
+        printf("\nNo valid samples were found in '%s'.\n", filename);
+        return 0;
+    }
+    if (status == SA_ERR_MEMORY) {
+        printf("\nError: Out of memory while loading '%s' (%d samples kept).\n",
+               filename, g_sa_ctx.sig.count);
+        return 0;
+    }
+
+    printf("\nLoaded %d samples from '%s'.\n", g_sa_ctx.sig.count, filename);
+
+    return 1;
+}
+void sa_load_from_file(void)         /* Read from sample.txt */
+{
+    const char *filename = "samples.txt";
+
+    if (sa_load_from_file_generic(filename)) {
+        printf("You can now choose option 3 to calculate statistics.\n");
+    }
+}
+void sa_calculate_stats(void)
+{
+    const SignalStats *sig = &g_sa_ctx.sig;
+
+    /* 1. Derive mean / RMS from the cached sums (rescans only if the samples were edited in place) */
+    if (sa_ctx_calculate(&g_sa_ctx) != SA_OK) {
+        printf("\nNo samples available. "
+               "Please enter samples (option 1) or load from file (option 2) first.\n");
+        return;
+    }
+
+    /* 2. Distribution: exact for normal captures, sketch-based for very large ones */
+    SignalPercentiles pct;
+    int have_pct = (sa_ctx_percentiles(&g_sa_ctx, &pct) == SA_OK);
+
+    /* 3. Printed output */
+    sa_print_stats(sig, have_pct ? &pct : NULL);
+}
+static void sa_print_stats(const SignalStats *sig, const SignalPercentiles *pct)
+{
+    printf("\nSignal statistics:\n");
+    printf("  Count : %d\n", sig->count);
+    printf("  Min   : %.6f\n", sig->min);
+    printf("  Max   : %.6f\n", sig->max);
+    printf("  Mean  : %.6f\n", sig->mean);
+    printf("  RMS   : %.6f\n", sig->rms);
+    if (pct) {
+        printf("  Median: %.6f\n", pct->p50);
+        printf("  P95   : %.6f\n", pct->p95);
+        printf("  P99   : %.6f\n", pct->p99);
+        printf("  P99.9 : %.6f%s\n", pct->p999, pct->exact ? "" : "   (histogram estimate)");
+    }
+}
+void sa_plot_graph(void)
+{
+    if (sa_ctx_plot(&g_sa_ctx) != SA_OK) {
+        printf("\nNo samples available. "
+               "Please enter samples (option 1) or load from file (option 2) first.\n");
+    }
+}
+static void sa_plot_series(const double *x_in, int n)   /* ASCII bar graph of any series (samples, rolling stats...) */
+{
+    const int MAX_BAR = 20;  /* 20 squares in each of the negative and positive directions */
+
+    /* 1. Find the maximum absolute value for scaling purposes. */
+    double max_abs = 0.0;
+    for (int i = 0; i < n; i++) {
+        double v = fabs(x_in[i]);
+        if (v > max_abs) {
+            max_abs = v;
+        }
+    }
+
+    if (max_abs == 0.0) {
+        printf("\nAll samples are zero. Nothing to plot.\n");
+        return;
+    }
+
+    printf("\nASCII Signal Plot (negative left, positive right)\n\n");
+
+    /* 2. Draw line for each sample */
+    for (int i = 0; i < n; i++) {
+        double x = x_in[i];
+
+        /* Mapping to integer lengths ranging from 0 to MAX_BAR based on absolute value magnitude */
+        int left_bar  = 0;
+        int right_bar = 0;
+
+        if (x < 0) {
+            left_bar = (int)((fabs(x) / max_abs) * MAX_BAR + 0.5);   /* rounding */
+            if (left_bar > MAX_BAR) left_bar = MAX_BAR;
+        } else if (x > 0) {
+            right_bar = (int)((x / max_abs) * MAX_BAR + 0.5);
+            if (right_bar > MAX_BAR) right_bar = MAX_BAR;
+        } else {
+            /* x == 0，no action */
+        }
+
+        /* The line is assembled in memory and written with one call: per-character *
+         * stdio calls each take the stream lock once other threads exist.           */
+        char line[64 + SA_FMT_MAX];
+        char num[24];
+        int len = 0;
+
+        if (left_bar < 0) left_bar = 0;                              /* NaN ratios (infinite samples) */
+        if (right_bar < 0) right_bar = 0;
+
+        int digits = sa_fmt_emit(num, 0, (uint64_t)(i + 1), 0, 0);   /* "%3d: " */
+        for (int pad = digits; pad < 3; pad++) line[len++] = ' ';
+        memcpy(line + len, num, (size_t)digits);
+        len += digits;
+        line[len++] = ':';
+        line[len++] = ' ';
+
+        memset(line + len, ' ', (size_t)(MAX_BAR - left_bar));
+        len += MAX_BAR - left_bar;
+        memset(line + len, '#', (size_t)left_bar);
+        len += left_bar;
+
+        line[len++] = '|';
+
+        memset(line + len, '#', (size_t)right_bar);
+        len += right_bar;
+        memset(line + len, ' ', (size_t)(MAX_BAR - right_bar));
+        len += MAX_BAR - right_bar;
+
+        line[len++] = ' ';                                           /* "  (% .6f)\n" */
+        line[len++] = ' ';
+        line[len++] = '(';
+        char *value = line + len;
+        int vlen = sa_fmt_fixed(value + 1, x, 6);
+        if (value[1] == '-') {
+            memmove(value, value + 1, (size_t)vlen);
+        } else {
+            value[0] = ' ';
+            vlen++;
+        }
+        len += vlen;
+        line[len++] = ')';
+        line[len++] = '\n';
+        fwrite(line, 1, (size_t)len, stdout);
+    }
+}
+void sa_save_stats_to_file(void)
+{
+    static const char *const files[] = { "signal_stats.txt", "signal_stats.json",
+                                         "signal_stats.csv", "signal_stats.bin" };
+    char buf[64];
+    int format = SA_SAVE_TEXT;
+
+    if (g_sa_ctx.sig.count <= 0) {
+        printf("\nNo samples available. "
+               "Please enter or load samples first.\n");
+        return;
+    }
+
+    double started = sa_wall_now();
+
+    /* Ensure that statistical data is up to date (O(1) when the samples have not changed) */
+    sa_calculate_stats();
+
+    printf("\nFormat: 1) text  2) JSON  3) CSV  4) binary  [1]: ");
+    if (fgets(buf, sizeof(buf), stdin)) {
+        buf[strcspn(buf, "\r\n")] = '\0';
+        if (sa_is_integer(buf) && atoi(buf) >= 1 && atoi(buf) <= 4) {
+            format = atoi(buf) - 1;
+        } else if (buf[0] != '\0') {
+            printf("Unknown choice, saving as text.\n");
+        }
+    }
+
+    const char *filename = files[format];
+    if (sa_ctx_save_stats_as(&g_sa_ctx, filename, format) != SA_OK) {
+        printf("\nError: Could not open '%s' for writing.\n", filename);
+        return;
+    }
+
+    printf("\nStatistics saved to '%s'.\n", filename);
+    if (sa_ctx_log_run(&g_sa_ctx, "save", started) != SA_OK) {
+        printf("Warning: could not append to the results log '%s'.\n", SA_RUN_LOG);
+    }
+}
+
+/* ============================================ *
+ * 1. Signal Analyzer: Rolling (window) stats   *
+ * ============================================ */
+#define SA_ROLL_SHOWN  10       /* rows listed on screen at each end; the file has all */
+
+/* Sliding-window mean / RMS / min / max in a single pass.                    *
+ * Output i describes the window x[i .. i+window-1], so there are             *
+ * n - window + 1 outputs.                                                    *
+ *  - mean / RMS: running sum and sum of squares, adding the new sample and   *
+ *    subtracting the one that leaves the window.  Both sums are re-anchored  *
+ *    every `window` samples so rounding error cannot build up; that costs    *
+ *    O(window) once per window, i.e. still O(1) amortised per sample.        *
+ *  - min / max: monotonic deques of sample indices (ring buffers of size     *
+ *    `window`).  Every index is pushed and popped at most once.              *
+ * dq_min / dq_max are caller-provided scratch arrays of `window` ints.       *
+ * Returns the number of outputs written, or 0 if the window is invalid.      */
+static int sa_rolling_compute(const double *x, int n, int window,
+                              double *mean, double *rms,
+                              double *min_out, double *max_out,
+                              int *dq_min, int *dq_max)
+{
+    if (window < 1 || window > n) {
+        return 0;
+    }
+
+    double sum = 0.0, sum_sq = 0.0;
+    int min_head = 0, min_len = 0;   /* deque = ring buffer [head, head+len) */
+    int max_head = 0, max_len = 0;
+    int out = 0;
+
+    for (int i = 0; i < n; i++) {
+        double v = x[i];
+
+        /* 1. Running sums (re-anchored at the start of each window block) */
+        if (i >= window && (i % window) == 0) {
+            sum = 0.0;
+            sum_sq = 0.0;
+            for (int k = i - window + 1; k < i; k++) {
+                sum    += x[k];
+                sum_sq += x[k] * x[k];
+            }
+        } else if (i >= window) {
+            double old = x[i - window];
+            sum    -= old;
+            sum_sq -= old * old;
+        }
+        sum    += v;
+        sum_sq += v * v;
+
+        /* 2. Drop indices that have slid out of the window */
+        if (min_len > 0 && dq_min[min_head] <= i - window) {
+            min_head = (min_head + 1) % window;
+            min_len--;
+        }
+        if (max_len > 0 && dq_max[max_head] <= i - window) {
+            max_head = (max_head + 1) % window;
+            max_len--;
+        }
+
+        /* 3. Keep the deques monotonic: pop from the back, then push i */
+        while (min_len > 0 && x[dq_min[(min_head + min_len - 1) % window]] >= v) {
+            min_len--;
+        }
+        dq_min[(min_head + min_len) % window] = i;
+        min_len++;
+
+        while (max_len > 0 && x[dq_max[(max_head + max_len - 1) % window]] <= v) {
+            max_len--;
+        }
+        dq_max[(max_head + max_len) % window] = i;
+        max_len++;
+
+        /* 4. Emit one output per full window */
+        if (i >= window - 1) {
+            double ms = sum_sq / window;
+            mean[out]    = sum / window;
+            rms[out]     = sqrt(ms > 0.0 ? ms : 0.0);   /* guard tiny negative rounding */
+            min_out[out] = x[dq_min[min_head]];
+            max_out[out] = x[dq_max[max_head]];
+            out++;
+        }
+    }
+
+    return out;
+}
+void sa_rolling_stats(void)
+{
+    const char *filename = "signal_rolling.txt";
+    SignalContext *ctx = &g_sa_ctx;
+    int n = ctx->sig.count;
+    char buf[64];
+    int window = 0;
+
+    if (n <= 0) {
+        printf("\nNo samples available. "
+               "Please enter samples (option 1) or load from file (option 2) first.\n");
+        return;
+    }
+
+    /* 1. Ask for the window length */
+    while (1) {
+        printf("\nWindow length in samples (1-%d): ", n);
+
+        if (!fgets(buf, sizeof(buf), stdin)) {
+            printf("\nInput error. Cancelling.\n");
+            return;
+        }
+        buf[strcspn(buf, "\r\n")] = '\0';
+
+        if (!sa_is_integer(buf)) {
+            printf("Please enter an integer number.\n");
+            continue;
+        }
+
+        window = (int)strtol(buf, NULL, 10);
+        if (window < 1 || window > n) {
+            printf("Please choose a value between 1 and %d.\n", n);
+            continue;
+        }
+        break;
+    }
+
+    /* 2. Single pass over the samples (series kept in the context's scratch buffer) */
+    int max_out = n - window + 1;
+    double *mean = sa_ctx_scratch(ctx, 4 * (size_t)max_out);
+    int *dq_min = malloc(2 * (size_t)window * sizeof(int));
+    if (!mean || !dq_min) {
+        printf("\nError: Out of memory for the rolling series.\n");
+        free(dq_min);
+        return;
+    }
+    double *rms = mean + max_out;
+    double *mn  = rms  + max_out;
+    double *mx  = mn   + max_out;
+    int *dq_max = dq_min + window;
+
+    int outputs = sa_rolling_compute(ctx->sig.samples, n, window,
+                                     mean, rms, mn, mx, dq_min, dq_max);
+    free(dq_min);
+
+    /* 3. Print the series */
+    printf("\nRolling statistics (window = %d, %d outputs):\n", window, outputs);
+    printf("  %5s  %12s  %12s  %12s  %12s\n", "End", "Mean", "RMS", "Min", "Max");
+    for (int i = 0; i < outputs; i++) {
+        if (i == SA_ROLL_SHOWN && outputs > 2 * SA_ROLL_SHOWN) {
+            printf("  ... %d more rows (all in '%s')\n", outputs - 2 * SA_ROLL_SHOWN, filename);
+            i = outputs - SA_ROLL_SHOWN;
+        }
+        printf("  %5d  %12.6f  %12.6f  %12.6f  %12.6f\n",
+               i + window, mean[i], rms[i], mn[i], mx[i]);
+    }
+
+    /* 4. Plot the rolling mean */
+    printf("\nRolling mean:");
+    sa_plot_series(mean, outputs);
+
+    /* 5. Save the series so it can be plotted elsewhere */
+    SaOutBuf ob = { 0 };
+    if (!sa_out_open(&ob, filename)) {
+        printf("\nError: Could not open '%s' for writing.\n", filename);
+        return;
+    }
+
+    sa_out_str(&ob, "# Rolling statistics, window = ");
+    sa_out_int(&ob, window);
+    sa_out_str(&ob, " samples\n# end_sample mean rms min max\n");
+    for (int i = 0; i < outputs; i++) {
+        sa_out_int(&ob, i + window);
+        sa_out_char(&ob, ' ');
+        sa_out_fixed(&ob, mean[i], 6);
+        sa_out_char(&ob, ' ');
+        sa_out_fixed(&ob, rms[i], 6);
+        sa_out_char(&ob, ' ');
+        sa_out_fixed(&ob, mn[i], 6);
+        sa_out_char(&ob, ' ');
+        sa_out_fixed(&ob, mx[i], 6);
+        sa_out_char(&ob, '\n');
+    }
+
+    if (!sa_out_close(&ob)) {
+        printf("\nError: Could not write '%s'.\n", filename);
+    }
+    sa_out_release(&ob);
+
+    printf("\nRolling series saved to '%s'.\n", filename);
+}
+
+/* ============================================ *
+ * 1. Signal Analyzer: Live streaming input     *
+ * ============================================ */
+
+/* Live mode reads an unbounded stream of samples from stdin or a named pipe: *
+ *  - a reader thread read()s raw text, parses numbers and pushes them into   *
+ *    a lock-free single-producer / single-consumer ring buffer;             *
+ *  - the calling thread pops samples, updates running statistics, keeps the *
+ *    most recent MAX_SAMPLES samples in the context and periodically        *
+ *    prints and saves a snapshot.                                           *
+ * When the ring is full the reader waits instead of overwriting, so the     *
+ * pipe fills and the producer is throttled: no sample is ever dropped.      */
+
+#define SA_LIVE_RING_SIZE  (1u << 20)   /* samples, must be a power of two */
+#define SA_LIVE_CHUNK      65536        /* bytes per read() */
+
+#define SA_IS_SEPARATOR(c) ((c) == ' ' || (c) == '\n' || (c) == '\r' || \
+                            (c) == '\t' || (c) == ',' || (c) == ';')
+
+typedef struct {
+    double *buf;
+    size_t  mask;
+    _Alignas(64) atomic_size_t head;    /* next slot to pop  (consumer owned) */
+    _Alignas(64) atomic_size_t tail;    /* next slot to push (producer owned) */
+    _Alignas(64) atomic_int    done;    /* producer finished (EOF or error) */
+} SaRing;
+
+typedef struct {
+    SaRing    *ring;
+    int        fd;
+    long long  parsed;                  /* written by reader, read after join */
+    long long  rejected;
+    long long  stalls;                  /* times the reader had to wait for space */
+} SaLiveReader;
+
+typedef struct {
+    long long count;
+    double    sum;
+    double    sum_sq;
+    double    min;
+    double    max;
+} SaRunningStats;
+
+/* Parse whitespace/comma separated numbers from buf[0..len).                 *
+ * buf[len] must be writable (it is used as a terminator).  If `final` is 0   *
+ * the trailing, possibly incomplete token is not parsed; its start offset is *
+ * returned through *consumed so the caller can carry it into the next chunk. *
+ * Returns the number of values written to out (which must hold len/2 + 1).  */
+static size_t sa_parse_number_chunk(char *buf, size_t len, int final,
+                                    double *out, size_t *consumed,
+                                    long long *rejected)
+{
+    size_t limit = len;
+
+    if (!final) {
+        /* Stop after the last separator; whatever follows may be cut off */
+        while (limit > 0 && !SA_IS_SEPARATOR(buf[limit - 1])) {
+            limit--;
+        }
+    }
+    *consumed = limit;
+
+    char saved = buf[limit];
+    buf[limit] = '\0';
+
+    size_t n = 0;
+    char *p   = buf;
+    char *end = buf + limit;
+
+    while (p < end) {
+        while (p < end && SA_IS_SEPARATOR(*p)) p++;
+        if (p >= end) break;
+
+        char *e = NULL;
+        double v = strtod(p, &e);
+
+        if (e == p || (e < end && !SA_IS_SEPARATOR(*e))) {
+            /* Not a number (or trailing junk): skip the whole token */
+            while (p < end && !SA_IS_SEPARATOR(*p)) p++;
+            (*rejected)++;
+            continue;
+        }
+
+        out[n++] = v;
+        p = e;
+    }
+
+    buf[limit] = saved;
+    return n;
+}
+static inline void sa_running_push(SaRunningStats *st, double x)   /* Add one sample to running stats */
+{
+    if (st->count == 0) {
+        st->min = x;
+        st->max = x;
+    }
+    st->count++;
+    st->sum    += x;
+    st->sum_sq += x * x;
+    if (x < st->min) st->min = x;
+    if (x > st->max) st->max = x;
+}
+static void *sa_live_reader_thread(void *arg)
+{
+    SaLiveReader *rd = (SaLiveReader *)arg;
+    SaRing *ring = rd->ring;
+
+    char   *chunk  = malloc(SA_LIVE_CHUNK + 1);
+    double *values = malloc((SA_LIVE_CHUNK / 2 + 1) * sizeof(double));
+    size_t  carry  = 0;
+
+    if (!chunk || !values) {
+        free(chunk);
+        free(values);
+        atomic_store_explicit(&ring->done, 1, memory_order_release);
+        return NULL;
+    }
+
+    for (;;) {
+        ssize_t got = read(rd->fd, chunk + carry, SA_LIVE_CHUNK - carry);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+
+        int final = (got <= 0);
+        size_t len = carry + (got > 0 ? (size_t)got : 0);
+        size_t used = 0;
+
+        size_t n = sa_parse_number_chunk(chunk, len, final, values, &used, &rd->rejected);
+        rd->parsed += (long long)n;
+
+        /* Push to the ring, waiting (not dropping) when it is full */
+        size_t i = 0;
+        while (i < n) {
+            size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+            size_t space = (ring->mask + 1) - (tail - head);
+
+            if (space == 0) {
+                rd->stalls++;
+                sched_yield();
+                continue;
+            }
+
+            size_t batch = n - i;
+            if (batch > space) batch = space;
+            for (size_t k = 0; k < batch; k++) {
+                ring->buf[(tail + k) & ring->mask] = values[i + k];
+            }
+            atomic_store_explicit(&ring->tail, tail + batch, memory_order_release);
+            i += batch;
+        }
+
+        if (final) {
+            break;
+        }
+
+        /* Move the unfinished token to the front for the next read() */
+        carry = len - used;
+        if (carry >= SA_LIVE_CHUNK) {
+            /* A single token filling the whole chunk can never be a number */
+            rd->rejected++;
+            carry = 0;
+        }
+        memmove(chunk, chunk + used, carry);
+    }
+
+    free(chunk);
+    free(values);
+    atomic_store_explicit(&ring->done, 1, memory_order_release);
+    return NULL;
+}
+static double sa_live_now(void)   /* Monotonic clock in seconds */
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+static void sa_live_snapshot(const SaRunningStats *st, const SaHistSketch *dist,
+                             double elapsed, int final)
+{
+    const char *filename = "signal_live.txt";
+    double mean = (st->count > 0) ? st->sum / (double)st->count : 0.0;
+    double rms  = (st->count > 0) ? sqrt(st->sum_sq / (double)st->count) : 0.0;
+    double rate = (elapsed > 0.0) ? (double)st->count / elapsed : 0.0;
+    double p50  = sa_hist_quantile(dist, 0.50);
+    double p99  = sa_hist_quantile(dist, 0.99);
+
+    printf("[Live %8.2f s] Count: %lld  Min: %.6f  Max: %.6f  Mean: %.6f  RMS: %.6f  "
+           "P50: %.6f  P99: %.6f  (%.0f samples/s)%s\n",
+           elapsed, st->count, st->min, st->max, mean, rms, p50, p99, rate,
+           final ? "  [final]" : "");
+
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        printf("Error: Could not open '%s' for writing.\n", filename);
+        return;
+    }
+
+    fprintf(fp, "Live signal statistics%s\n", final ? " (final)" : "");
+    fprintf(fp, "Elapsed = %.3f s\n", elapsed);
+    fprintf(fp, "Count = %lld\n", st->count);
+    fprintf(fp, "Min   = %.6f\n", st->min);
+    fprintf(fp, "Max   = %.6f\n", st->max);
+    fprintf(fp, "Mean  = %.6f\n", mean);
+    fprintf(fp, "RMS   = %.6f\n", rms);
+    fprintf(fp, "P50   = %.6f\n", p50);
+    fprintf(fp, "P95   = %.6f\n", sa_hist_quantile(dist, 0.95));
+    fprintf(fp, "P99   = %.6f\n", p99);
+    fprintf(fp, "P99.9 = %.6f\n", sa_hist_quantile(dist, 0.999));
+    fprintf(fp, "Rate  = %.0f samples/s\n", rate);
+
+    fclose(fp);
+}
+int sa_live_stream_from(SignalContext *ctx, const char *path, double interval_s)
+{
+    int fd = 0;   /* stdin */
+
+    if (path && strcmp(path, "-") != 0) {
+        fd = open(path, O_RDONLY);   /* blocks until a writer opens the FIFO */
+        if (fd < 0) {
+            printf("\nError: Could not open '%s' (%s).\n", path, strerror(errno));
+            return 0;
+        }
+    }
+    if (interval_s <= 0.0) {
+        interval_s = 1.0;
+    }
+
+    SaRing ring;
+    SaHistSketch *dist = malloc(sizeof(SaHistSketch));   /* percentiles over the whole stream */
+    ring.buf = malloc(SA_LIVE_RING_SIZE * sizeof(double));
+    if (!ring.buf || !dist) {
+        printf("\nError: Out of memory for the live ring buffer.\n");
+        free(ring.buf);
+        free(dist);
+        if (fd != 0) close(fd);
+        return 0;
+    }
+    sa_hist_reset(dist);
+    ring.mask = SA_LIVE_RING_SIZE - 1;
+    atomic_init(&ring.head, 0);
+    atomic_init(&ring.tail, 0);
+    atomic_init(&ring.done, 0);
+
+    SaLiveReader rd = { &ring, fd, 0, 0, 0 };
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, sa_live_reader_thread, &rd) != 0) {
+        printf("\nError: Could not start the reader thread.\n");
+        free(ring.buf);
+        free(dist);
+        if (fd != 0) close(fd);
+        return 0;
+    }
+
+    printf("\n[Live] Streaming from %s, snapshot every %.1f s (saved to signal_live.txt)...\n",
+           (fd == 0) ? "stdin" : path, interval_s);
+
+    SaRunningStats st = { 0, 0.0, 0.0, 0.0, 0.0 };
+    double recent[MAX_SAMPLES];       /* most recent samples, copied to the context at the end */
+    int recent_pos = 0;               /* next write position in recent[] */
+    double start = sa_live_now();
+    double next_snapshot = start + interval_s;
+    int idle = 0;
+
+    for (;;) {
+        size_t head = atomic_load_explicit(&ring.head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring.tail, memory_order_acquire);
+
+        if (head == tail) {
+            if (atomic_load_explicit(&ring.done, memory_order_acquire) &&
+                atomic_load_explicit(&ring.tail, memory_order_acquire) == head) {
+                break;
+            }
+            /* Nothing to do: back off gently so slow streams don't burn a core */
+            if (++idle < 64) {
+                sched_yield();
+            } else {
+                struct timespec nap = { 0, 200000 };   /* 200 us */
+                nanosleep(&nap, NULL);
+            }
+        } else {
+            idle = 0;
+            for (size_t k = head; k != tail; k++) {
+                double x = ring.buf[k & ring.mask];
+
+                sa_running_push(&st, x);
+                sa_hist_push(dist, x);
+
+                /* Keep the most recent MAX_SAMPLES samples (circular) */
+                recent[recent_pos] = x;
+                recent_pos = (recent_pos + 1) % MAX_SAMPLES;
+            }
+            atomic_store_explicit(&ring.head, tail, memory_order_release);
+        }
+
+        double now = sa_live_now();
+        if (now >= next_snapshot) {
+            sa_live_snapshot(&st, dist, now - start, 0);
+            next_snapshot = now + interval_s;
+        }
+    }
+
+    pthread_join(reader, NULL);
+    if (fd != 0) close(fd);
+    free(ring.buf);
+
+    sa_live_snapshot(&st, dist, sa_live_now() - start, 1);
+    free(dist);
+    printf("[Live] Stream ended: %lld samples parsed, %lld invalid tokens skipped, "
+           "reader waited for space %lld times.\n", rd.parsed, rd.rejected, rd.stalls);
+
+    /* Unroll the circular tail so the context holds the newest samples in order */
+    int kept  = (st.count > MAX_SAMPLES) ? MAX_SAMPLES : (int)st.count;
+    int first = (st.count > MAX_SAMPLES) ? recent_pos : 0;
+    sa_signal_clear(&ctx->sig);
+    for (int i = 0; i < kept; i++) {
+        sa_signal_append(&ctx->sig, recent[(first + i) % MAX_SAMPLES]);
+    }
+    snprintf(ctx->source, sizeof(ctx->source), "%s", (fd == 0) ? "stdin" : path);
+
+    printf("[Live] The last %d samples are kept for plotting / statistics.\n",
+           ctx->sig.count);
+    return 1;
+}
+void sa_live_stream(void)
+{
+    char path[256];
+
+    printf("\n[Live stream] Reads samples until the writer closes the stream.\n");
+    printf("(To stream from stdin instead, run: producer | ./main.out --live)\n");
+    printf("Enter a FIFO/file path: ");
+    if (!fgets(path, sizeof(path), stdin)) {
+        printf("\nInput error. Cancelling.\n");
+        return;
+    }
+    path[strcspn(path, "\r\n")] = '\0';
+
+    /* stdin is the menu input here, so only named sources are accepted */
+    if (path[0] == '\0' || strcmp(path, "-") == 0) {
+        printf("Please give a FIFO or file path.\n");
+        return;
+    }
+
+    double interval = uc_get_double("Snapshot interval in seconds (e.g. 1): ");
+    sa_live_stream_from(&g_sa_ctx, path, interval);
+}
+
+/* ================================================ *
+ * 1. Signal Analyzer: Pipelined loading            *
+ * ================================================ */
+
+/* sa_ctx_load_file() reads a chunk, parses it, then reads the next one, so  *
+ * the disk sits idle while numbers are parsed and vice versa.  Here a       *
+ * reader thread fills SA_PIPE_DEPTH buffers in turn (double buffering) and  *
+ * hashes each chunk for the result cache while the calling thread parses    *
+ * the previous one, so the load takes about max(read, parse) rather than    *
+ * their sum.  Each buffer has SA_PIPE_CARRY spare bytes in front of the     *
+ * chunk: a number cut off at the end of one chunk is copied there, in front *
+ * of the next chunk, instead of moving whole chunks around.                 *
+ * (io_uring would remove the thread, but is not available on every target; *
+ * a blocking reader thread gives the same overlap.)                         */
+
+#define SA_PIPE_DEPTH   2               /* buffers in flight */
+#define SA_PIPE_CHUNK   (1 << 20)       /* bytes per buffer */
+#define SA_PIPE_CARRY   4096            /* longest number carried between chunks */
+
+typedef struct {
+    int             fd;
+    char           *buf[SA_PIPE_DEPTH]; /* SA_PIPE_CARRY + SA_PIPE_CHUNK + 1 bytes each */
+    size_t          len[SA_PIPE_DEPTH]; /* bytes of chunk data after the carry area */
+    int             filled;             /* buffers ready for the consumer */
+    int             eof;                /* the reader has queued its last buffer */
+    int             error;
+    int             stop;               /* consumer gave up: reader should exit */
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    SaHash64        hash;               /* reader owned until joined */
+    double          read_s;
+    long long       bytes;
+} SaPipe;
+
+static void *sa_pipe_reader(void *arg)
+{
+    SaPipe *pp = (SaPipe *)arg;
+
+    for (int slot = 0;; slot = (slot + 1) % SA_PIPE_DEPTH) {
+        pthread_mutex_lock(&pp->lock);
+        while (pp->filled == SA_PIPE_DEPTH && !pp->stop) {
+            pthread_cond_wait(&pp->cond, &pp->lock);
+        }
+        int stop = pp->stop;
+        pthread_mutex_unlock(&pp->lock);
+        if (stop) {
+            break;
+        }
+
+        char *dst = pp->buf[slot] + SA_PIPE_CARRY;
+        size_t len = 0;
+        int error = 0;
+        double t0 = sa_live_now();
+        while (len < SA_PIPE_CHUNK) {
+            ssize_t got = read(pp->fd, dst + len, SA_PIPE_CHUNK - len);
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) error = 1;
+            if (got <= 0) break;
+            len += (size_t)got;
+        }
+        pp->read_s += sa_live_now() - t0;
+        pp->bytes  += (long long)len;
+        sa_hash64_update(&pp->hash, dst, len);
+
+        int last = error || len < SA_PIPE_CHUNK;
+        pthread_mutex_lock(&pp->lock);
+        pp->len[slot] = len;
+        pp->filled++;
+        pp->eof   = last;
+        pp->error = error;
+        pthread_cond_broadcast(&pp->cond);
+        pthread_mutex_unlock(&pp->lock);
+        if (last) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+int sa_ctx_load_pipelined(SignalContext *ctx, const char *filename, SignalPipeTiming *timing)
+{
+    SaPipe pp;
+    pthread_t reader;
+    double t_start = sa_live_now();
+
+    memset(&pp, 0, sizeof(pp));
+    pp.fd = open(filename, O_RDONLY);
+    if (pp.fd < 0) {
+        return SA_ERR_OPEN;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(pp.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    double *values = malloc((SA_PIPE_CARRY + SA_PIPE_CHUNK) / 2 * sizeof(double) + sizeof(double));
+    int status = values ? SA_OK : SA_ERR_MEMORY;
+    for (int b = 0; b < SA_PIPE_DEPTH && status == SA_OK; b++) {
+        pp.buf[b] = malloc(SA_PIPE_CARRY + SA_PIPE_CHUNK + 1);
+        if (!pp.buf[b]) status = SA_ERR_MEMORY;
+    }
+    pthread_mutex_init(&pp.lock, NULL);
+    pthread_cond_init(&pp.cond, NULL);
+    sa_hash64_init(&pp.hash);
+
+    int started = (status == SA_OK) && pthread_create(&reader, NULL, sa_pipe_reader, &pp) == 0;
+    if (status == SA_OK && !started) {
+        status = SA_ERR_MEMORY;
+    }
+
+    SignalStats *sig = &ctx->sig;
+    long long rejected = 0;
+    size_t carry = 0;
+    double parse_s = 0.0;
+
+    sa_signal_clear(sig);
+
+    for (int slot = 0; started; slot = (slot + 1) % SA_PIPE_DEPTH) {
+        pthread_mutex_lock(&pp.lock);
+        while (pp.filled == 0 && !pp.eof) {
+            pthread_cond_wait(&pp.cond, &pp.lock);
+        }
+        int have = pp.filled > 0;
+        pthread_mutex_unlock(&pp.lock);
+
+        /* The chunk in `slot` is preceded by the carried-over partial token */
+        char *chunk = pp.buf[slot] + SA_PIPE_CARRY - carry;
+        size_t len = carry + (have ? pp.len[slot] : 0);
+        int final = !have;
+        size_t used = 0;
+
+        double t0 = sa_live_now();
+        size_t n = sa_parse_number_chunk(chunk, len, final, values, &used, &rejected);
+        for (size_t i = 0; i < n && status == SA_OK; i++) {
+            if (!sa_signal_append(sig, values[i])) {
+                status = SA_ERR_MEMORY;
+            }
+        }
+
+        /* Hand the unfinished token to the next buffer, then free this one */
+        int next = (slot + 1) % SA_PIPE_DEPTH;
+        carry = len - used;
+        if (carry > SA_PIPE_CARRY) {
+            rejected++;          /* far too long to be a number */
+            carry = 0;
+        }
+        if (!final) {
+            memcpy(pp.buf[next] + SA_PIPE_CARRY - carry, chunk + used, carry);
+        }
+        parse_s += sa_live_now() - t0;
+
+        if (final) {
+            break;
+        }
+        pthread_mutex_lock(&pp.lock);
+        pp.filled--;
+        if (status != SA_OK) pp.stop = 1;
+        pthread_cond_broadcast(&pp.cond);
+        pthread_mutex_unlock(&pp.lock);
+        if (status != SA_OK) {
+            break;
+        }
+    }
+
+    if (started) {
+        pthread_join(reader, NULL);
+        if (pp.error && status == SA_OK) status = SA_ERR_OPEN;
+    }
+    close(pp.fd);
+    pthread_cond_destroy(&pp.cond);
+    pthread_mutex_destroy(&pp.lock);
+    for (int b = 0; b < SA_PIPE_DEPTH; b++) {
+        free(pp.buf[b]);
+    }
+    free(values);
+
+    snprintf(ctx->source, sizeof(ctx->source), "%s", filename);
+
+    if (timing) {
+        timing->wall_s  = sa_live_now() - t_start;
+        timing->read_s  = pp.read_s;
+        timing->parse_s = parse_s;
+        timing->bytes   = pp.bytes;
+        timing->hash    = sa_hash64_final(&pp.hash);
+    }
+    if (status == SA_OK && sig->count == 0) {
+        status = SA_ERR_EMPTY;
+    }
+    return status;
+}
+
+/* ============================================ *
+ * 1. Signal Analyzer: Digital filters          *
+ * ============================================ */
+
+/* Block-wise filter engine.  All filter state lives in SaFilter, so a      *
+ * signal can be pushed through in blocks of any size (whole sample store,  *
+ * or chunks of a stream) and gives exactly the same output.                *
+ *  - RC:     first-order low-pass from the Circuit Calculator's R and C,   *
+ *            y[n] = y[n-1] + a (x[n] - y[n-1]),  a = 1 - e^(-1/(fs R C))   *
+ *  - Biquad: cascade of Direct Form II transposed sections; designs for    *
+ *            Butterworth low-pass / high-pass of even order 2..16          *
+ *  - FIR:    windowed-sinc (Hamming) low-pass; the convolution inner loop  *
+ *            uses SSE2 when the compiler targets it (always on x86-64)     */
+
+#define SA_FILTER_BLOCK     4096     /* samples per processing block */
+#define SA_MAX_BIQUADS      8
+#define SA_MAX_FIR_TAPS     1023
+
+enum { SA_FILTER_RC, SA_FILTER_BIQUAD, SA_FILTER_FIR };
+
+typedef struct {
+    double b0, b1, b2, a1, a2;       /* normalised so a0 = 1 */
+    double z1, z2;                   /* DF2T state */
+} SaBiquad;
+
+typedef struct {
+    int      type;
+    /* RC */
+    double   rc_alpha;
+    double   rc_state;
+    int      rc_primed;              /* start from the first sample, not from 0 V */
+    /* Biquad cascade */
+    SaBiquad sections[SA_MAX_BIQUADS];
+    int      nsections;
+    /* FIR */
+    double  *taps;                   /* stored reversed: taps[0] multiplies the oldest sample */
+    int      ntaps;
+    double  *window;                 /* ntaps-1 history samples followed by one block */
+} SaFilter;
+
+static void sa_filter_init_rc(SaFilter *f, double R, double C, double fs)
+{
+    memset(f, 0, sizeof(*f));
+    f->type = SA_FILTER_RC;
+    f->rc_alpha = 1.0 - exp(-1.0 / (fs * R * C));
+}
+/* Butterworth of even `order` as order/2 biquads (bilinear transform, RBJ form) */
+static int sa_filter_init_butterworth(SaFilter *f, int highpass, int order, double fc, double fs)
+{
+    memset(f, 0, sizeof(*f));
+    f->type = SA_FILTER_BIQUAD;
+    f->nsections = order / 2;
+    if (order < 2 || order % 2 != 0 || f->nsections > SA_MAX_BIQUADS || fc <= 0.0 || fc >= fs / 2.0) {
+        return 0;
+    }
+
+    double w0 = 2.0 * M_PI * fc / fs;
+    double cw = cos(w0), sw = sin(w0);
+
+    for (int k = 0; k < f->nsections; k++) {
+        /* Pole-pair quality factors of a Butterworth response */
+        double q = 1.0 / (2.0 * cos(M_PI * (2.0 * k + 1.0) / (2.0 * order)));
+        double alpha = sw / (2.0 * q);
+        double a0 = 1.0 + alpha;
+        SaBiquad *s = &f->sections[k];
+
+        if (highpass) {
+            s->b0 = (1.0 + cw) / 2.0 / a0;
+            s->b1 = -(1.0 + cw) / a0;
+        } else {
+            s->b0 = (1.0 - cw) / 2.0 / a0;
+            s->b1 = (1.0 - cw) / a0;
+        }
+        s->b2 = s->b0;
+        s->a1 = -2.0 * cw / a0;
+        s->a2 = (1.0 - alpha) / a0;
+    }
+    return 1;
+}
+/* Windowed-sinc low-pass (linear phase about (ntaps-1)/2), unity DC gain */
+static int sa_fir_design_lowpass(double *h, int ntaps, double fc_norm)   /* fc_norm = fc / fs */
+{
+    double mid = (ntaps - 1) / 2.0;
+    double sum = 0.0;
+
+    for (int i = 0; i < ntaps; i++) {
+        double m = i - mid;
+        double sinc = (m == 0.0) ? 2.0 * fc_norm : sin(2.0 * M_PI * fc_norm * m) / (M_PI * m);
+        double w = 0.54 - 0.46 * cos(2.0 * M_PI * i / (ntaps - 1));
+        h[i] = sinc * w;
+        sum += h[i];
+    }
+    if (sum == 0.0) {
+        return 0;
+    }
+    for (int i = 0; i < ntaps; i++) {
+        h[i] /= sum;
+    }
+    return 1;
+}
+static int sa_filter_init_fir(SaFilter *f, int ntaps, double fc, double fs)
+{
+    memset(f, 0, sizeof(*f));
+    f->type = SA_FILTER_FIR;
+    if (ntaps < 3 || ntaps > SA_MAX_FIR_TAPS || ntaps % 2 == 0 || fc <= 0.0 || fc >= fs / 2.0) {
+        return 0;
+    }
+
+    f->ntaps  = ntaps;
+    f->taps   = malloc((size_t)ntaps * sizeof(double));
+    f->window = calloc((size_t)(ntaps - 1 + SA_FILTER_BLOCK), sizeof(double));
+    if (!f->taps || !f->window) {
+        return 0;
+    }
+
+    double *h = malloc((size_t)ntaps * sizeof(double));
+    if (!h || !sa_fir_design_lowpass(h, ntaps, fc / fs)) {
+        free(h);
+        return 0;
+    }
+    for (int i = 0; i < ntaps; i++) {
+        f->taps[i] = h[ntaps - 1 - i];   /* reverse so the dot product runs forwards */
+    }
+    free(h);
+    return 1;
+}
+static void sa_filter_free(SaFilter *f)
+{
+    free(f->taps);
+    free(f->window);
+    f->taps = NULL;
+    f->window = NULL;
+}
+static inline double sa_fir_dot(const double *x, const double *h, int n)
+{
+#if defined(__SSE2__)
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    __m128d acc2 = _mm_setzero_pd(), acc3 = _mm_setzero_pd();
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i),     _mm_loadu_pd(h + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(h + i + 2)));
+        acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_loadu_pd(x + i + 4), _mm_loadu_pd(h + i + 4)));
+        acc3 = _mm_add_pd(acc3, _mm_mul_pd(_mm_loadu_pd(x + i + 6), _mm_loadu_pd(h + i + 6)));
+    }
+    acc0 = _mm_add_pd(_mm_add_pd(acc0, acc1), _mm_add_pd(acc2, acc3));
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc0);
+    double sum = lanes[0] + lanes[1];
+    for (; i < n; i++) {
+        sum += x[i] * h[i];
+    }
+    return sum;
+#else
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i] * h[i];
+        s1 += x[i + 1] * h[i + 1];
+        s2 += x[i + 2] * h[i + 2];
+        s3 += x[i + 3] * h[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += x[i] * h[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+#endif
+}
+/* Filter n samples; `in` and `out` may be the same buffer */
+static void sa_filter_process(SaFilter *f, const double *in, double *out, size_t n)
+{
+    if (n == 0) {
+        return;
+    }
+
+    if (f->type == SA_FILTER_RC) {
+        double a = f->rc_alpha;
+        double y = f->rc_primed ? f->rc_state : in[0];
+        for (size_t i = 0; i < n; i++) {
+            y += a * (in[i] - y);
+            out[i] = y;
+        }
+        f->rc_state = y;
+        f->rc_primed = 1;
+        return;
+    }
+
+    if (f->type == SA_FILTER_BIQUAD) {
+        /* One section at a time over the whole block keeps the state in registers */
+        const double *src = in;
+        for (int k = 0; k < f->nsections; k++) {
+            SaBiquad *s = &f->sections[k];
+            double b0 = s->b0, b1 = s->b1, b2 = s->b2, a1 = s->a1, a2 = s->a2;
+            double z1 = s->z1, z2 = s->z2;
+            for (size_t i = 0; i < n; i++) {
+                double x = src[i];
+                double y = b0 * x + z1;
+                z1 = b1 * x - a1 * y + z2;
+                z2 = b2 * x - a2 * y;
+                out[i] = y;
+            }
+            s->z1 = z1;
+            s->z2 = z2;
+            src = out;
+        }
+        return;
+    }
+
+    /* FIR: window = [last ntaps-1 inputs | current block] */
+    int hist = f->ntaps - 1;
+    while (n > 0) {
+        size_t m = (n < SA_FILTER_BLOCK) ? n : SA_FILTER_BLOCK;
+        memcpy(f->window + hist, in, m * sizeof(double));
+        for (size_t i = 0; i < m; i++) {
+            out[i] = sa_fir_dot(f->window + i, f->taps, f->ntaps);
+        }
+        memmove(f->window, f->window + m, (size_t)hist * sizeof(double));
+        in += m;
+        out += m;
+        n -= m;
+    }
+}
+/* Stream a text sample file through the filter into another text file */
+static int sa_filter_stream_file(SaFilter *f, const char *in_name, const char *out_name,
+                                 long long *count_out)
+{
+    enum { CHUNK = 65536 };
+    FILE *in = fopen(in_name, "r");
+    if (!in) {
+        return SA_ERR_OPEN;
+    }
+    SaOutBuf out = { 0 };
+    if (!sa_out_open(&out, out_name)) {
+        fclose(in);
+        return SA_ERR_OPEN;
+    }
+
+    char   *chunk  = malloc(CHUNK + 1);
+    double *values = malloc((CHUNK / 2 + 1) * sizeof(double));
+    long long rejected = 0, count = 0;
+    size_t carry = 0;
+    int status = (chunk && values) ? SA_OK : SA_ERR_MEMORY;
+
+    while (status == SA_OK) {
+        size_t got = fread(chunk + carry, 1, CHUNK - carry, in);
+        int final = (got == 0);
+        size_t len = carry + got;
+        size_t used = 0;
+
+        size_t n = sa_parse_number_chunk(chunk, len, final, values, &used, &rejected);
+        sa_filter_process(f, values, values, n);
+        for (size_t i = 0; i < n; i++) {
+            sa_out_general(&out, values[i], 9);
+            sa_out_char(&out, '\n');
+        }
+        count += (long long)n;
+
+        if (final) break;
+        carry = len - used;
+        if (carry >= CHUNK) carry = 0;
+        memmove(chunk, chunk + used, carry);
+    }
+
+    free(chunk);
+    free(values);
+    fclose(in);
+    if (!sa_out_close(&out) && status == SA_OK) {
+        status = SA_ERR_OPEN;
+    }
+    sa_out_release(&out);
+    *count_out = count;
+    return status;
+}
+/* Filter the context's samples in place */
+static int sa_ctx_filter_inplace(SignalContext *ctx, SaFilter *f)
+{
+    SignalStats *sig = &ctx->sig;
+
+    if (sig->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    for (int off = 0; off < sig->count; off += SA_FILTER_BLOCK) {
+        int m = (sig->count - off < SA_FILTER_BLOCK) ? sig->count - off : SA_FILTER_BLOCK;
+        sa_filter_process(f, sig->samples + off, sig->samples + off, (size_t)m);
+    }
+    sa_signal_mark_dirty(sig);
+    return SA_OK;
+}
+void sa_filter_samples(void)
+{
+    SaFilter f;
+    double fs, fc = 0.0;
+    int ok = 0;
+
+    printf("\n[Filter]\n");
+    printf("1. RC low-pass (R, C as in the Circuit Calculator)\n");
+    printf("2. Butterworth low-pass (biquad cascade)\n");
+    printf("3. Butterworth high-pass (biquad cascade)\n");
+    printf("4. FIR low-pass (windowed sinc)\n");
+    int type = uc_get_choice();
+    if (type < 1 || type > 4) {
+        printf("Invalid filter type.\n");
+        return;
+    }
+
+    fs = uc_get_double("Sample rate fs (Hz): ");
+    if (fs <= 0.0) {
+        printf("Sample rate must be > 0.\n");
+        return;
+    }
+
+    if (type == 1) {
+        double R    = uc_get_double("Enter R in ohms: ");
+        double C_uF = uc_get_double("Enter C in microfarads (uF): ");
+        if (R <= 0.0 || C_uF <= 0.0) {
+            printf("R and C must be > 0.\n");
+            return;
+        }
+        fc = etk_rc_cutoff_hz(R, C_uF);
+        sa_filter_init_rc(&f, R, C_uF * 1e-6, fs);
+        ok = 1;
+    } else if (type == 2 || type == 3) {
+        fc = uc_get_double("Cutoff frequency fc (Hz): ");
+        int order = (int)uc_get_int_in("Order (even, 2-16): ", 2, 2 * SA_MAX_BIQUADS);
+        ok = sa_filter_init_butterworth(&f, type == 3, order, fc, fs);
+    } else {
+        fc = uc_get_double("Cutoff frequency fc (Hz): ");
+        int ntaps = (int)uc_get_int_in("Number of taps (odd, 3-1023): ", 3, SA_MAX_FIR_TAPS);
+        ok = sa_filter_init_fir(&f, ntaps, fc, fs);
+    }
+    if (!ok) {
+        printf("Invalid filter parameters (fc must be below fs/2; order/taps in range).\n");
+        sa_filter_free(&f);
+        return;
+    }
+    printf("Cutoff frequency fc = %.3f Hz\n", fc);
+
+    printf("\n1. Filter the loaded samples in place\n");
+    printf("2. Stream a sample file through the filter into another file\n");
+    int target = uc_get_choice();
+
+    if (target == 1) {
+        double t0 = sa_live_now();
+        if (sa_ctx_filter_inplace(&g_sa_ctx, &f) != SA_OK) {
+            printf("\nNo samples available. "
+                   "Please enter samples (option 1) or load from file (option 2) first.\n");
+        } else {
+            double dt = sa_live_now() - t0;
+            printf("Filtered %d samples in %.4f s", g_sa_ctx.sig.count, dt);
+            if (dt > 0.0) printf(" (%.1f MS/s)", g_sa_ctx.sig.count / dt / 1e6);
+            printf(". Use options 3-5 to analyse the result.\n");
+        }
+    } else if (target == 2) {
+        char in_name[256], out_name[256];
+        long long count = 0;
+        if (!ec_read_line("Input file: ", in_name, sizeof(in_name)) ||
+            !ec_read_line("Output file: ", out_name, sizeof(out_name))) {
+            sa_filter_free(&f);
+            return;
+        }
+        int status = sa_filter_stream_file(&f, in_name, out_name, &count);
+        if (status == SA_OK) {
+            printf("Wrote %lld filtered samples to '%s'.\n", count, out_name);
+        } else {
+            printf("Error: Could not filter '%s' into '%s'.\n", in_name, out_name);
+        }
+    } else {
+        printf("Invalid option.\n");
+    }
+
+    sa_filter_free(&f);
+}
+
+/* ============================================ *
+ * 1. Signal Analyzer: Polyphase resampling     *
+ * ============================================ */
+
+/* Rational resampling by L/M (interpolate by L, then decimate by M).       *
+ * Conceptually the input is zero-stuffed to L*fs, low-pass filtered and    *
+ * every M-th value kept.  The polyphase form never builds that stream:     *
+ * output m needs only phase p = (m*M) mod L of the prototype filter,       *
+ * applied to the K inputs ending at n = floor(m*M / L), so each kept       *
+ * output costs K multiply-adds and discarded outputs cost nothing.  The    *
+ * L phase filters are precomputed once as a bank of L x K taps.            *
+ * Input history is carried between calls, so the same state handles the   *
+ * whole sample store or a stream in chunks.  The prototype's group delay   *
+ * is removed (leading outputs dropped, zeros flushed at the end), so the   *
+ * n inputs give ceil(n*L/M) outputs aligned with the original signal.      */
+
+#define SA_RS_TAPS_PER_BAND   24     /* prototype length per max(L, M) */
+#define SA_RS_MAX_FACTOR      256
+
+typedef struct {
+    int        L, M;            /* reduced ratio */
+    int        K;               /* taps per phase */
+    double    *bank;            /* L rows of K taps, each row reversed for sa_fir_dot */
+    double    *buf;             /* input history: absolute samples [buf_start, in_count) */
+    size_t     buf_cap;
+    long long  buf_start;
+    long long  in_count;        /* inputs received so far */
+    long long  next_out;        /* absolute index of the next output (before delay removal) */
+    long long  delay;           /* leading outputs dropped for the group delay */
+    long long  emitted;         /* outputs handed to the caller */
+    long long  limit;           /* stop emitting after this many outputs */
+} SaResampler;
+
+static int sa_gcd(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+static void sa_resampler_free(SaResampler *rs)
+{
+    free(rs->bank);
+    free(rs->buf);
+    rs->bank = NULL;
+    rs->buf  = NULL;
+}
+static int sa_resampler_init(SaResampler *rs, int L, int M)
+{
+    memset(rs, 0, sizeof(*rs));
+    if (L < 1 || M < 1 || L > SA_RS_MAX_FACTOR || M > SA_RS_MAX_FACTOR) {
+        return 0;
+    }
+    int g = sa_gcd(L, M);
+    L /= g;
+    M /= g;
+
+    /* The prototype runs at L*fs and must cut off at the lower of the two   *
+     * Nyquist rates, so its length scales with max(L, M).  The -6 dB point  *
+     * sits at 0.43 of that band so the Hamming transition ends at Nyquist.  */
+    int fmax = (L > M) ? L : M;
+    int K = (SA_RS_TAPS_PER_BAND * fmax + L - 1) / L;
+    int N = K * L;
+
+    rs->L = L;
+    rs->M = M;
+    rs->K = K;
+    rs->buf_cap = (size_t)K + SA_FILTER_BLOCK;
+
+    double *h = malloc((size_t)N * sizeof(double));
+    rs->bank  = malloc((size_t)N * sizeof(double));
+    rs->buf   = calloc(rs->buf_cap, sizeof(double));
+    if (!h || !rs->bank || !rs->buf || !sa_fir_design_lowpass(h, N, 0.43 / fmax)) {
+        free(h);
+        sa_resampler_free(rs);
+        return 0;
+    }
+
+    /* Phase p uses taps h[p], h[p+L], h[p+2L]...; the gain L restores the  *
+     * level lost to zero-stuffing.                                         */
+    for (int p = 0; p < L; p++) {
+        for (int j = 0; j < K; j++) {
+            rs->bank[(size_t)p * K + (K - 1 - j)] = h[p + j * L] * L;
+        }
+    }
+    free(h);
+
+    rs->buf_start = -(long long)(K - 1);     /* K-1 zeros before the first sample */
+    rs->delay     = (long long)((N - 1) / 2.0 / M + 0.5);
+    rs->limit     = LLONG_MAX;
+    return 1;
+}
+/* Upper bound on the outputs produced from n inputs */
+static size_t sa_resampler_max_out(const SaResampler *rs, size_t n)
+{
+    return (size_t)(((long long)n * rs->L) / rs->M) + 2;
+}
+/* Feed n inputs and write every output that became computable; returns the *
+ * count written.  out needs sa_resampler_max_out(rs, n) slots.  When       *
+ * L <= M, out may alias in: outputs never overtake the inputs consumed.    */
+static size_t sa_resampler_process(SaResampler *rs, const double *in, size_t n, double *out)
+{
+    size_t produced = 0;
+    const int K = rs->K;
+
+    while (n > 0) {
+        /* Drop history no future output reads, then append up to a block */
+        long long first = (rs->next_out * rs->M) / rs->L - (K - 1);
+        if (first > rs->in_count - (K - 1)) {
+            first = rs->in_count - (K - 1);
+        }
+        size_t keep = (size_t)(rs->in_count - first);
+        memmove(rs->buf, rs->buf + (first - rs->buf_start), keep * sizeof(double));
+        rs->buf_start = first;
+
+        size_t m = rs->buf_cap - keep;
+        if (m > n) m = n;
+        memcpy(rs->buf + keep, in, m * sizeof(double));
+        rs->in_count += (long long)m;
+        in += m;
+        n  -= m;
+
+        for (;;) {
+            long long pos    = rs->next_out * rs->M;
+            long long newest = pos / rs->L;
+            if (newest >= rs->in_count || rs->emitted >= rs->limit) {
+                break;
+            }
+            long long idx = rs->next_out++;
+            if (idx < rs->delay) {
+                continue;
+            }
+            const double *x = rs->buf + (newest - (K - 1) - rs->buf_start);
+            out[produced++] = sa_fir_dot(x, rs->bank + (size_t)(pos % rs->L) * K, K);
+            rs->emitted++;
+        }
+    }
+    return produced;
+}
+/* End of input: flush zeros until the delay-compensated tail is out.        *
+ * out needs rs->delay + 2 slots.                                           */
+static size_t sa_resampler_finish(SaResampler *rs, double *out)
+{
+    static const double zeros[16];
+    long long total = (rs->in_count * rs->L + rs->M - 1) / rs->M;
+    long long real_inputs = rs->in_count;
+    size_t produced = 0;
+
+    if (rs->limit > total) {
+        rs->limit = total;
+    }
+    /* Bounded: each zero advances the output position towards the limit */
+    while (rs->emitted < rs->limit && rs->in_count - real_inputs < 4 * (long long)rs->K + 16) {
+        produced += sa_resampler_process(rs, zeros, 16, out + produced);
+    }
+    return produced;
+}
+/* Resample the context's samples by L/M in place; returns SA_OK or an error */
+static int sa_ctx_resample(SignalContext *ctx, int L, int M)
+{
+    SignalStats *sig = &ctx->sig;
+    SaResampler rs;
+
+    if (sig->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    if (!sa_resampler_init(&rs, L, M)) {
+        return SA_ERR_MEMORY;
+    }
+
+    long long total = ((long long)sig->count * rs.L + rs.M - 1) / rs.M;
+    if (total + (long long)rs.delay + 2 > INT_MAX) {
+        sa_resampler_free(&rs);
+        return SA_ERR_MEMORY;
+    }
+
+    /* Decimation writes behind its own read position, so it runs directly  *
+     * on the store.  Interpolation grows the signal and needs a new buffer. */
+    double *dst = sig->samples;
+    int dst_cap = sig->capacity;
+    if (rs.L > rs.M) {
+        dst_cap = (int)total + (int)rs.delay + 2;
+        dst = malloc((size_t)dst_cap * sizeof(double));
+        if (!dst) {
+            sa_resampler_free(&rs);
+            return SA_ERR_MEMORY;
+        }
+    }
+
+    rs.limit = total;
+    size_t produced = 0;
+    for (int off = 0; off < sig->count; off += SA_FILTER_BLOCK) {
+        int m = (sig->count - off < SA_FILTER_BLOCK) ? sig->count - off : SA_FILTER_BLOCK;
+        produced += sa_resampler_process(&rs, sig->samples + off, (size_t)m, dst + produced);
+    }
+    if (rs.L <= rs.M && !sa_signal_reserve(sig, (int)produced + (int)rs.delay + 2)) {
+        sa_resampler_free(&rs);
+        return SA_ERR_MEMORY;
+    }
+    if (rs.L <= rs.M) {
+        dst = sig->samples;                   /* reserve may have moved it */
+    }
+    produced += sa_resampler_finish(&rs, dst + produced);
+    sa_resampler_free(&rs);
+
+    if (dst != sig->samples) {
+        free(sig->samples);
+        sig->samples  = dst;
+        sig->capacity = dst_cap;
+    }
+    sig->count = (int)produced;
+    sa_signal_mark_dirty(sig);
+    return SA_OK;
+}
+/* Stream a text sample file through the resampler into another text file */
+static int sa_resample_stream_file(int L, int M, const char *in_name, const char *out_name,
+                                   long long *in_total, long long *out_total)
+{
+    enum { CHUNK = 65536 };
+    SaResampler rs;
+
+    if (!sa_resampler_init(&rs, L, M)) {
+        return SA_ERR_MEMORY;
+    }
+    FILE *in = fopen(in_name, "r");
+    if (!in) {
+        sa_resampler_free(&rs);
+        return SA_ERR_OPEN;
+    }
+    SaOutBuf out = { 0 };
+    if (!sa_out_open(&out, out_name)) {
+        fclose(in);
+        sa_resampler_free(&rs);
+        return SA_ERR_OPEN;
+    }
+
+    size_t  out_cap = sa_resampler_max_out(&rs, CHUNK / 2 + 1);
+    if (out_cap < (size_t)rs.delay + 2) out_cap = (size_t)rs.delay + 2;
+    char   *chunk  = malloc(CHUNK + 1);
+    double *values = malloc((CHUNK / 2 + 1) * sizeof(double));
+    double *res    = malloc(out_cap * sizeof(double));
+    long long rejected = 0, n_in = 0, n_out = 0;
+    size_t carry = 0;
+    int status = (chunk && values && res) ? SA_OK : SA_ERR_MEMORY;
+
+    while (status == SA_OK) {
+        size_t got = fread(chunk + carry, 1, CHUNK - carry, in);
+        int final = (got == 0);
+        size_t len = carry + got;
+        size_t used = 0;
+
+        size_t n = sa_parse_number_chunk(chunk, len, final, values, &used, &rejected);
+        size_t k = sa_resampler_process(&rs, values, n, res);
+        if (final) {
+            k += sa_resampler_finish(&rs, res + k);
+        }
+        for (size_t i = 0; i < k; i++) {
+            sa_out_general(&out, res[i], 9);
+            sa_out_char(&out, '\n');
+        }
+        n_in  += (long long)n;
+        n_out += (long long)k;
+
+        if (final) break;
+        carry = len - used;
+        if (carry >= CHUNK) carry = 0;
+        memmove(chunk, chunk + used, carry);
+    }
+
+    free(chunk);
+    free(values);
+    free(res);
+    fclose(in);
+    if (!sa_out_close(&out) && status == SA_OK) {
+        status = SA_ERR_OPEN;
+    }
+    sa_out_release(&out);
+    sa_resampler_free(&rs);
+    *in_total  = n_in;
+    *out_total = n_out;
+    return status;
+}
+void sa_resample_samples(void)
+{
+    printf("\n[Resample by L/M]  e.g. L=1, M=10 decimates by 10; L=3, M=2 gives 1.5x the rate\n");
+    int L = (int)uc_get_int_in("Interpolation factor L (1-256): ", 1, SA_RS_MAX_FACTOR);
+    int M = (int)uc_get_int_in("Decimation factor M (1-256): ", 1, SA_RS_MAX_FACTOR);
+    if (L == M) {
+        printf("L = M: the rate is unchanged.\n");
+        return;
+    }
+
+    printf("\n1. Resample the loaded samples in place\n");
+    printf("2. Stream a sample file through the resampler into another file\n");
+    int target = uc_get_choice();
+
+    if (target == 1) {
+        int before = g_sa_ctx.sig.count;
+        double t0 = sa_live_now();
+        int status = sa_ctx_resample(&g_sa_ctx, L, M);
+        double dt = sa_live_now() - t0;
+        if (status == SA_ERR_EMPTY) {
+            printf("\nNo samples available. "
+                   "Please enter samples (option 1) or load from file (option 2) first.\n");
+        } else if (status != SA_OK) {
+            printf("Error: Out of memory while resampling.\n");
+        } else {
+            printf("Resampled %d -> %d samples in %.4f s", before, g_sa_ctx.sig.count, dt);
+            if (dt > 0.0) printf(" (%.1f MS/s in)", before / dt / 1e6);
+            printf(". Use options 3-5 to analyse the result.\n");
+        }
+    } else if (target == 2) {
+        char in_name[256], out_name[256];
+        long long n_in = 0, n_out = 0;
+        if (!ec_read_line("Input file: ", in_name, sizeof(in_name)) ||
+            !ec_read_line("Output file: ", out_name, sizeof(out_name))) {
+            return;
+        }
+        if (sa_resample_stream_file(L, M, in_name, out_name, &n_in, &n_out) == SA_OK) {
+            printf("Resampled %lld -> %lld samples into '%s'.\n", n_in, n_out, out_name);
+        } else {
+            printf("Error: Could not resample '%s' into '%s'.\n", in_name, out_name);
+        }
+    } else {
+        printf("Invalid option.\n");
+    }
+}
+
+/* ============================================ *
+ * 1. Signal Analyzer: Multi-channel captures   *
+ * ============================================ */
+
+/* DAQ files store one frame per line: channel 0, channel 1, ... channel    *
+ * N-1.  Loading de-interleaves them into a structure of arrays: every      *
+ * channel is one contiguous run of doubles, 64-byte aligned, with the      *
+ * stride padded to whole cache lines (and nudged off multiples of 4 KiB so *
+ * channels do not collide in the same cache sets).  The per-channel pass   *
+ * then streams straight through memory with aligned SSE2 loads, and large  *
+ * captures spread the channels over several threads.                      */
+
+#define SA_CH_ALIGN           64                        /* bytes */
+#define SA_CH_PAD             (SA_CH_ALIGN / sizeof(double))
+#define SA_CH_PAR_MIN         (1 << 20)                 /* samples before going parallel */
+#define SA_CH_MAX_THREADS     16
+
+static SignalChannels g_sa_channels;                    /* capture used by the menu */
+
+void sa_ch_init(SignalChannels *mc)
+{
+    memset(mc, 0, sizeof(*mc));
+}
+void sa_ch_free(SignalChannels *mc)
+{
+    free(mc->data);
+    sa_ch_init(mc);
+}
+const double *sa_ch_data(const SignalChannels *mc, int channel)
+{
+    return mc->data + (size_t)channel * mc->stride;
+}
+static size_t sa_ch_stride_for(int frames)
+{
+    size_t stride = ((size_t)frames + SA_CH_PAD - 1) / SA_CH_PAD * SA_CH_PAD;
+    if (stride % (4096 / sizeof(double)) == 0) {
+        stride += SA_CH_PAD;
+    }
+    return stride;
+}
+/* Grow every channel to hold `frames` samples, keeping the stored ones */
+static int sa_ch_reserve(SignalChannels *mc, int frames)
+{
+    if (frames <= mc->capacity) {
+        return 1;
+    }
+    size_t stride = sa_ch_stride_for(frames);
+    double *grown = aligned_alloc(SA_CH_ALIGN, stride * (size_t)mc->channels * sizeof(double));
+    if (!grown) {
+        return 0;
+    }
+    for (int c = 0; c < mc->channels && mc->data; c++) {
+        memcpy(grown + (size_t)c * stride, mc->data + (size_t)c * mc->stride,
+               (size_t)mc->frames * sizeof(double));
+    }
+    free(mc->data);
+    mc->data     = grown;
+    mc->stride   = stride;
+    mc->capacity = (int)stride;
+    return 1;
+}
+/* Number of numeric columns on the first line that has any */
+static int sa_ch_detect_columns(FILE *fp)
+{
+    char line[8192];
+    int columns = 0;
+
+    while (columns == 0 && fgets(line, sizeof(line), fp)) {
+        char *p = line;
+        while (*p) {
+            while (*p && SA_IS_SEPARATOR(*p)) p++;
+            if (!*p) break;
+            char *end;
+            strtod(p, &end);
+            if (end != p && (*end == '\0' || SA_IS_SEPARATOR(*end))) {
+                columns++;
+            }
+            while (*end && !SA_IS_SEPARATOR(*end)) end++;
+            p = end;
+        }
+    }
+    rewind(fp);
+    return columns;
+}
+/* One line of an interleaved file: a frame if it holds exactly `channels` *
+ * values, ignored if it holds none (blank, comment, header), a bad row     *
+ * otherwise - never split across frames, so a short row cannot shift the  *
+ * later samples into the wrong channel.                                   */
+static int sa_ch_add_line(SignalChannels *mc, char *line, size_t len, double *values)
+{
+    long long rejected = 0;
+    size_t used;
+    size_t n = sa_parse_number_chunk(line, len, 1, values, &used, &rejected);
+
+    if (n == 0) {
+        return 1;
+    }
+    if (n != (size_t)mc->channels) {
+        mc->bad_rows++;
+        return 1;
+    }
+    if (mc->frames == mc->capacity && !sa_ch_reserve(mc, mc->capacity ? mc->capacity * 2 : 1024)) {
+        return 0;
+    }
+    /* One value per channel row: a frame touches `channels` cache lines, *
+     * and each line is filled by the next SA_CH_PAD frames.             */
+    for (size_t c = 0; c < n; c++) {
+        mc->data[c * mc->stride + (size_t)mc->frames] = values[c];
+    }
+    mc->frames++;
+    return 1;
+}
+/* Load an interleaved file, one frame per line; channels = 0 takes the     *
+ * column count of the first numeric line.  Rows with a different count    *
+ * are skipped and counted in bad_rows.  The new capture replaces *mc only  *
+ * when the load succeeds.  SA_ERR_FORMAT: more than SA_MAX_CHANNELS.       */
+int sa_ch_load_file(SignalChannels *mc, const char *filename, int channels)
+{
+    enum { CHUNK = 65536 };
+
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        return SA_ERR_OPEN;
+    }
+    if (channels <= 0) {
+        channels = sa_ch_detect_columns(fp);
+    }
+    if (channels > SA_MAX_CHANNELS) {
+        fclose(fp);
+        return SA_ERR_FORMAT;
+    }
+    if (channels < 1) {
+        fclose(fp);
+        return SA_ERR_EMPTY;
+    }
+
+    char   *chunk  = malloc(CHUNK + 1);
+    double *values = malloc((CHUNK / 2 + 1) * sizeof(double));
+    if (!chunk || !values) {
+        free(chunk);
+        free(values);
+        fclose(fp);
+        return SA_ERR_MEMORY;
+    }
+
+    SignalChannels tmp;
+    sa_ch_init(&tmp);
+    tmp.channels = channels;
+
+    size_t carry = 0;
+    int overlong = 0;                 /* inside a line longer than CHUNK: drop it */
+    int status = SA_OK;
+
+    for (;;) {
+        size_t got = fread(chunk + carry, 1, CHUNK - carry, fp);
+        size_t len = carry + got;
+        size_t at = 0;
+        char *nl;
+
+        while (status == SA_OK && (nl = memchr(chunk + at, '\n', len - at)) != NULL) {
+            size_t end = (size_t)(nl - chunk);
+            if (overlong) {
+                overlong = 0;
+                tmp.bad_rows++;
+            } else if (!sa_ch_add_line(&tmp, chunk + at, end - at, values)) {
+                status = SA_ERR_MEMORY;
+            }
+            at = end + 1;
+        }
+        if (got == 0) {               /* last line without a newline */
+            if (status == SA_OK && len > at && !overlong &&
+                !sa_ch_add_line(&tmp, chunk + at, len - at, values)) {
+                status = SA_ERR_MEMORY;
+            }
+            break;
+        }
+        if (status != SA_OK) {
+            break;
+        }
+        carry = len - at;
+        if (carry == CHUNK) {
+            carry = 0;
+            overlong = 1;
+        }
+        memmove(chunk, chunk + at, carry);
+    }
+
+    free(chunk);
+    free(values);
+    fclose(fp);
+
+    snprintf(tmp.source, sizeof(tmp.source), "%s", filename);
+    if (status == SA_OK && tmp.frames == 0) {
+        status = SA_ERR_EMPTY;
+    }
+    if (status != SA_OK) {
+        sa_ch_free(&tmp);             /* the previous capture is kept */
+        return status;
+    }
+    sa_ch_free(mc);
+    *mc = tmp;
+    return SA_OK;
+}
+/* Sum, sum of squares, min and max of one aligned channel in one pass */
+static void sa_ch_stats_one(const double *x, int n, SignalChannelStats *st)
+{
+    double sum = 0.0, sum_sq = 0.0, mn = x[0], mx = x[0];
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    __m128d q0 = _mm_setzero_pd(), q1 = _mm_setzero_pd();
+    __m128d lo = _mm_set1_pd(x[0]), hi = lo;
+    for (; i + 4 <= n; i += 4) {
+        __m128d a = _mm_load_pd(x + i);
+        __m128d b = _mm_load_pd(x + i + 2);
+        s0 = _mm_add_pd(s0, a);
+        s1 = _mm_add_pd(s1, b);
+        q0 = _mm_add_pd(q0, _mm_mul_pd(a, a));
+        q1 = _mm_add_pd(q1, _mm_mul_pd(b, b));
+        lo = _mm_min_pd(lo, _mm_min_pd(a, b));
+        hi = _mm_max_pd(hi, _mm_max_pd(a, b));
+    }
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1));
+    sum = t[0] + t[1];
+    _mm_storeu_pd(t, _mm_add_pd(q0, q1));
+    sum_sq = t[0] + t[1];
+    _mm_storeu_pd(t, lo);
+    mn = (t[0] < t[1]) ? t[0] : t[1];
+    _mm_storeu_pd(t, hi);
+    mx = (t[0] > t[1]) ? t[0] : t[1];
+#endif
+    for (; i < n; i++) {
+        double v = x[i];
+        sum    += v;
+        sum_sq += v * v;
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+    }
+
+    st->min  = mn;
+    st->max  = mx;
+    st->mean = sum / n;
+    st->rms  = sqrt(sum_sq / n);
+}
+
+typedef struct {
+    SignalChannels *mc;
+    int             first;        /* channels first, first + step, ... */
+    int             step;
+} SaChJob;
+
+static void *sa_ch_stats_thread(void *arg)
+{
+    SaChJob *job = arg;
+    for (int c = job->first; c < job->mc->channels; c += job->step) {
+        sa_ch_stats_one(sa_ch_data(job->mc, c), job->mc->frames, &job->mc->stats[c]);
+    }
+    return NULL;
+}
+int sa_ch_calculate(SignalChannels *mc)
+{
+    if (mc->channels <= 0 || mc->frames <= 0) {
+        return SA_ERR_EMPTY;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long long total = (long long)mc->frames * mc->channels;
+    int nthreads = (total >= SA_CH_PAR_MIN && cores > 1) ? (int)cores : 1;
+    if (nthreads > mc->channels) nthreads = mc->channels;
+    if (nthreads > SA_CH_MAX_THREADS) nthreads = SA_CH_MAX_THREADS;
+
+    pthread_t tid[SA_CH_MAX_THREADS];
+    SaChJob job[SA_CH_MAX_THREADS];
+    int created[SA_CH_MAX_THREADS] = { 0 };
+
+    for (int t = 1; t < nthreads; t++) {
+        job[t] = (SaChJob){ mc, t, nthreads };
+        created[t] = (pthread_create(&tid[t], NULL, sa_ch_stats_thread, &job[t]) == 0);
+        if (!created[t]) {
+            sa_ch_stats_thread(&job[t]);
+        }
+    }
+    job[0] = (SaChJob){ mc, 0, nthreads };
+    sa_ch_stats_thread(&job[0]);
+    for (int t = 1; t < nthreads; t++) {
+        if (created[t]) pthread_join(tid[t], NULL);
+    }
+    return SA_OK;
+}
+int sa_ch_save_stats(SignalChannels *mc, const char *filename)
+{
+    int status = sa_ch_calculate(mc);
+    if (status != SA_OK) {
+        return status;
+    }
+
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        return SA_ERR_OPEN;
+    }
+
+    fprintf(fp, "# Multi-channel statistics of '%s': %d channels x %d samples\n",
+            mc->source, mc->channels, mc->frames);
+    fprintf(fp, "# %-5s %14s %14s %14s %14s\n", "ch", "min", "max", "mean", "rms");
+    for (int c = 0; c < mc->channels; c++) {
+        const SignalChannelStats *st = &mc->stats[c];
+        fprintf(fp, "%7d %14.6f %14.6f %14.6f %14.6f\n", c, st->min, st->max, st->mean, st->rms);
+    }
+
+    fclose(fp);
+    return SA_OK;
+}
+/* Copy one channel into a single-channel context for the other analyses */
+int sa_ch_to_context(const SignalChannels *mc, int channel, SignalContext *ctx)
+{
+    if (channel < 0 || channel >= mc->channels || mc->frames <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    SignalStats *sig = &ctx->sig;
+
+    sa_signal_clear(sig);
+    if (!sa_signal_reserve(sig, mc->frames)) {
+        return SA_ERR_MEMORY;
+    }
+    memcpy(sig->samples, sa_ch_data(mc, channel), (size_t)mc->frames * sizeof(double));
+    sig->count = mc->frames;
+    sa_signal_mark_dirty(sig);
+    snprintf(ctx->source, sizeof(ctx->source), "%.200s (channel %d)", mc->source, channel);
+    return SA_OK;
+}
+static int sa_ch_ask_channel(const SignalChannels *mc)
+{
+    return (int)uc_get_int_in("Channel number: ", 0, mc->channels - 1);
+}
+void sa_multichannel_menu(void)
+{
+    SignalChannels *mc = &g_sa_channels;
+    int running = 1;
+
+    while (running) {
+        printf("\n------ Multi-channel capture ------\n");
+        if (mc->frames > 0) {
+            printf("Loaded: '%s', %d channels x %d samples\n", mc->source, mc->channels, mc->frames);
+        }
+        printf("1. Load interleaved file (one frame per line)\n");
+        printf("2. Per-channel statistics\n");
+        printf("3. Plot one channel\n");
+        printf("4. Save per-channel statistics (signal_channels.txt)\n");
+        printf("5. Copy one channel into the Signal Analyzer\n");
+        printf("6. Back\n");
+        printf("-----------------------------------\n");
+
+        int choice = uc_get_choice();
+        if (choice != 1 && choice != 6 && mc->frames <= 0) {
+            printf("\nNo capture loaded. Please load a file first (option 1).\n");
+            continue;
+        }
+
+        switch (choice) {
+            case 1: {
+                char name[256];
+                if (!ec_read_line("File name: ", name, sizeof(name))) {
+                    break;
+                }
+                int channels = (int)uc_get_int_in("Number of channels (0 = detect from the first line): ",
+                                                  0, SA_MAX_CHANNELS);
+                double t0 = sa_live_now();
+                int status = sa_ch_load_file(mc, name, channels);
+                if (status == SA_ERR_OPEN) {
+                    printf("\nError: Could not open '%s'.\n", name);
+                } else if (status == SA_ERR_MEMORY) {
+                    printf("\nError: Out of memory while loading '%s'.\n", name);
+                } else if (status == SA_ERR_FORMAT) {
+                    printf("\n'%s' has too many channels (at most %d).\n", name, SA_MAX_CHANNELS);
+                } else if (status != SA_OK) {
+                    printf("\nNo complete frames found in '%s'.\n", name);
+                } else {
+                    printf("\nLoaded %d channels x %d samples from '%s' in %.3f s.\n",
+                           mc->channels, mc->frames, name, sa_live_now() - t0);
+                    if (mc->bad_rows > 0) {
+                        printf("Skipped %lld rows without exactly %d values.\n", mc->bad_rows, mc->channels);
+                    }
+                }
+                break;
+            }
+            case 2: {
+                double t0 = sa_live_now();
+                sa_ch_calculate(mc);
+                double dt = sa_live_now() - t0;
+                printf("\n%4s %14s %14s %14s %14s\n", "ch", "min", "max", "mean", "rms");
+                for (int c = 0; c < mc->channels; c++) {
+                    const SignalChannelStats *st = &mc->stats[c];
+                    printf("%4d %14.6f %14.6f %14.6f %14.6f\n", c, st->min, st->max, st->mean, st->rms);
+                }
+                printf("(%.4f s for %lld samples)\n", dt, (long long)mc->frames * mc->channels);
+                break;
+            }
+            case 3: {
+                int c = sa_ch_ask_channel(mc);
+                if (c >= 0) {
+                    printf("\nChannel %d:\n", c);
+                    sa_plot_series(sa_ch_data(mc, c), mc->frames);
+                }
+                break;
+            }
+            case 4:
+                if (sa_ch_save_stats(mc, "signal_channels.txt") == SA_OK) {
+                    printf("\nPer-channel statistics saved to 'signal_channels.txt'.\n");
+                } else {
+                    printf("\nError: Could not open 'signal_channels.txt' for writing.\n");
+                }
+                break;
+            case 5: {
+                int c = sa_ch_ask_channel(mc);
+                if (c >= 0 && sa_ch_to_context(mc, c, &g_sa_ctx) == SA_OK) {
+                    printf("\nChannel %d (%d samples) copied; options 3-9 now work on it.\n",
+                           c, mc->frames);
+                } else if (c >= 0) {
+                    printf("\nError: Out of memory.\n");
+                }
+                break;
+            }
+            case 6:
+                running = 0;
+                break;
+            default:
+                printf("Unknown option.\n");
+                break;
+        }
+    }
+}
+
+/* ============================================== *
+ * 1. Signal Analyzer: Compact sample storage     *
+ * ============================================== */
+
+/* Holds samples as float32, or as int32 / int16 raw ADC codes with a       *
+ * scale (volts per code) and offset, so a capture takes 1/2 to 1/4 of the  *
+ * memory of the double sample store.  The statistics pass reads the narrow *
+ * values and widens them in registers (SSE2 cvtps2pd / cvtdq2pd, int16     *
+ * sign-extended by unpack + shift), accumulating in double; integer codes  *
+ * are summed as codes and the scale/offset applied once at the end.  Being *
+ * memory-bound, the pass speeds up roughly with the bytes saved.           */
+
+#define SA_CP_ALIGN   64
+
+static SignalCompact g_sa_compact;                     /* storage used by the menu */
+
+static size_t sa_compact_width(int format)
+{
+    return (format == SA_STORE_I16) ? sizeof(int16_t)
+         : (format == SA_STORE_I32) ? sizeof(int32_t) : sizeof(float);
+}
+void sa_compact_init(SignalCompact *pk, int format, double scale, double offset)
+{
+    memset(pk, 0, sizeof(*pk));
+    pk->format = format;
+    pk->scale  = (format == SA_STORE_F32 || scale <= 0.0) ? 1.0 : scale;
+    pk->offset = (format == SA_STORE_F32) ? 0.0 : offset;
+}
+void sa_compact_free(SignalCompact *pk)
+{
+    free(pk->data);
+    pk->data = NULL;
+    pk->count = pk->capacity = 0;
+    pk->clipped = 0;
+}
+size_t sa_compact_bytes(const SignalCompact *pk)
+{
+    return (size_t)pk->count * sa_compact_width(pk->format);
+}
+static int sa_compact_reserve(SignalCompact *pk, int capacity)
+{
+    if (capacity <= pk->capacity) {
+        return 1;
+    }
+    size_t w = sa_compact_width(pk->format);
+    size_t bytes = ((size_t)capacity * w + SA_CP_ALIGN - 1) / SA_CP_ALIGN * SA_CP_ALIGN;
+    void *grown = aligned_alloc(SA_CP_ALIGN, bytes);
+    if (!grown) {
+        return 0;
+    }
+    if (pk->data) {
+        memcpy(grown, pk->data, (size_t)pk->count * w);
+        free(pk->data);
+    }
+    pk->data = grown;
+    pk->capacity = capacity;
+    return 1;
+}
+static int sa_compact_append(SignalCompact *pk, double x)
+{
+    if (pk->count == pk->capacity &&
+        !sa_compact_reserve(pk, pk->capacity ? pk->capacity * 2 : 1024)) {
+        return 0;
+    }
+
+    if (pk->format == SA_STORE_F32) {
+        ((float *)pk->data)[pk->count++] = (float)x;
+        return 1;
+    }
+
+    double lo = (pk->format == SA_STORE_I16) ? INT16_MIN : INT32_MIN;
+    double hi = (pk->format == SA_STORE_I16) ? INT16_MAX : INT32_MAX;
+    double code = floor((x - pk->offset) / pk->scale + 0.5);
+    if (code < lo || code > hi || code != code) {
+        pk->clipped++;
+        code = (code > hi) ? hi : lo;
+    }
+    if (pk->format == SA_STORE_I16) {
+        ((int16_t *)pk->data)[pk->count++] = (int16_t)code;
+    } else {
+        ((int32_t *)pk->data)[pk->count++] = (int32_t)code;
+    }
+    return 1;
+}
+static double sa_compact_at(const SignalCompact *pk, int i)   /* stored value i, before scaling */
+{
+    if (pk->format == SA_STORE_I16) return ((const int16_t *)pk->data)[i];
+    if (pk->format == SA_STORE_I32) return ((const int32_t *)pk->data)[i];
+    return ((const float *)pk->data)[i];
+}
+double sa_compact_value(const SignalCompact *pk, int i)
+{
+    return sa_compact_at(pk, i) * pk->scale + pk->offset;
+}
+int sa_compact_load_file(SignalCompact *pk, const char *filename)
+{
+    enum { CHUNK = 65536 };
+
+    FILE *fp = fopen(filename, "r");
+    if (!fp) {
+        return SA_ERR_OPEN;
+    }
+    char   *chunk  = malloc(CHUNK + 1);
+    double *values = malloc((CHUNK / 2 + 1) * sizeof(double));
+    if (!chunk || !values) {
+        free(chunk);
+        free(values);
+        fclose(fp);
+        return SA_ERR_MEMORY;
+    }
+
+    sa_compact_free(pk);
+
+    long long rejected = 0;
+    size_t carry = 0;
+    int status = SA_OK;
+
+    for (;;) {
+        size_t got = fread(chunk + carry, 1, CHUNK - carry, fp);
+        int final = (got == 0);
+        size_t len = carry + got;
+        size_t used = 0;
+
+        size_t n = sa_parse_number_chunk(chunk, len, final, values, &used, &rejected);
+        for (size_t i = 0; i < n && status == SA_OK; i++) {
+            if (!sa_compact_append(pk, values[i])) {
+                status = SA_ERR_MEMORY;
+            }
+        }
+
+        if (final || status != SA_OK) {
+            break;
+        }
+        carry = len - used;
+        if (carry >= CHUNK) {
+            carry = 0;
+        }
+        memmove(chunk, chunk + used, carry);
+    }
+
+    free(chunk);
+    free(values);
+    fclose(fp);
+
+    snprintf(pk->source, sizeof(pk->source), "%s", filename);
+    if (status == SA_OK && pk->count == 0) {
+        status = SA_ERR_EMPTY;
+    }
+    return status;
+}
+int sa_compact_from_context(SignalCompact *pk, const SignalContext *ctx)
+{
+    const SignalStats *sig = &ctx->sig;
+
+    if (sig->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    sa_compact_free(pk);
+    if (!sa_compact_reserve(pk, sig->count)) {
+        return SA_ERR_MEMORY;
+    }
+    for (int i = 0; i < sig->count; i++) {
+        sa_compact_append(pk, sig->samples[i]);
+    }
+    snprintf(pk->source, sizeof(pk->source), "%s", ctx->source[0] ? ctx->source : "loaded samples");
+    return SA_OK;
+}
+int sa_compact_to_context(const SignalCompact *pk, SignalContext *ctx)
+{
+    SignalStats *sig = &ctx->sig;
+
+    if (pk->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    sa_signal_clear(sig);
+    if (!sa_signal_reserve(sig, pk->count)) {
+        return SA_ERR_MEMORY;
+    }
+    for (int i = 0; i < pk->count; i++) {
+        sig->samples[i] = sa_compact_value(pk, i);
+    }
+    sig->count = pk->count;
+    sa_signal_mark_dirty(sig);
+    snprintf(ctx->source, sizeof(ctx->source), "%s", pk->source);
+    return SA_OK;
+}
+
+#if defined(__SSE2__)
+/* Fold two widened pairs into the running sums and extremes */
+#define SA_CP_ACCUMULATE(a, b)                                    \
+    do {                                                          \
+        s0 = _mm_add_pd(s0, (a));                                 \
+        s1 = _mm_add_pd(s1, (b));                                 \
+        q0 = _mm_add_pd(q0, _mm_mul_pd((a), (a)));                \
+        q1 = _mm_add_pd(q1, _mm_mul_pd((b), (b)));                \
+        lo = _mm_min_pd(lo, _mm_min_pd((a), (b)));                \
+        hi = _mm_max_pd(hi, _mm_max_pd((a), (b)));                \
+    } while (0)
+#endif
+
+/* Sums and extremes of the stored values (codes, before scaling); n > 0 */
+static void sa_compact_scan(const SignalCompact *pk, SaRunningStats *acc)
+{
+    const int n = pk->count;
+    double first = sa_compact_at(pk, 0);
+    double sum = 0.0, sum_sq = 0.0, mn = first, mx = first;
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    __m128d q0 = _mm_setzero_pd(), q1 = _mm_setzero_pd();
+    __m128d lo = _mm_set1_pd(first), hi = lo;
+
+    if (pk->format == SA_STORE_F32) {
+        const float *x = pk->data;
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_load_ps(x + i);
+            __m128d a = _mm_cvtps_pd(v);
+            __m128d b = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+            SA_CP_ACCUMULATE(a, b);
+        }
+    } else if (pk->format == SA_STORE_I32) {
+        const int32_t *x = pk->data;
+        for (; i + 4 <= n; i += 4) {
+            __m128i v = _mm_load_si128((const __m128i *)(x + i));
+            __m128d a = _mm_cvtepi32_pd(v);
+            __m128d b = _mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+            SA_CP_ACCUMULATE(a, b);
+        }
+    } else {
+        const int16_t *x = pk->data;
+        for (; i + 8 <= n; i += 8) {
+            __m128i v  = _mm_load_si128((const __m128i *)(x + i));
+            __m128i w0 = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);   /* sign-extend */
+            __m128i w1 = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            __m128d a = _mm_cvtepi32_pd(w0);
+            __m128d b = _mm_cvtepi32_pd(_mm_shuffle_epi32(w0, _MM_SHUFFLE(1, 0, 3, 2)));
+            SA_CP_ACCUMULATE(a, b);
+            a = _mm_cvtepi32_pd(w1);
+            b = _mm_cvtepi32_pd(_mm_shuffle_epi32(w1, _MM_SHUFFLE(1, 0, 3, 2)));
+            SA_CP_ACCUMULATE(a, b);
+        }
+    }
+
+    double t[2];
+    _mm_storeu_pd(t, _mm_add_pd(s0, s1));
+    sum = t[0] + t[1];
+    _mm_storeu_pd(t, _mm_add_pd(q0, q1));
+    sum_sq = t[0] + t[1];
+    _mm_storeu_pd(t, lo);
+    mn = (t[0] < t[1]) ? t[0] : t[1];
+    _mm_storeu_pd(t, hi);
+    mx = (t[0] > t[1]) ? t[0] : t[1];
+#endif
+    for (; i < n; i++) {
+        double v = sa_compact_at(pk, i);
+        sum    += v;
+        sum_sq += v * v;
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+    }
+
+    acc->count  = n;
+    acc->sum    = sum;
+    acc->sum_sq = sum_sq;
+    acc->min    = mn;
+    acc->max    = mx;
+}
+/* Statistics of values stored as codes: value = code * scale + offset, scale > 0 */
+static void sa_compact_finish_stats(const SaRunningStats *acc, double scale, double offset,
+                                    SignalChannelStats *st)
+{
+    double a = scale, b = offset;
+    double mean_code = acc->sum / (double)acc->count;
+    st->mean = a * mean_code + b;
+    st->rms  = sqrt(fmax(0.0, a * a * (acc->sum_sq / (double)acc->count) + 2.0 * a * b * mean_code + b * b));
+    st->min  = a * acc->min + b;
+    st->max  = a * acc->max + b;
+}
+int sa_compact_stats(const SignalCompact *pk, SignalChannelStats *st)
+{
+    SaRunningStats acc;
+
+    if (pk->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+    sa_compact_scan(pk, &acc);
+    sa_compact_finish_stats(&acc, pk->scale, pk->offset, st);
+    return SA_OK;
+}
+void sa_compact_menu(void)
+{
+    static const char *names[] = { "", "float32", "int32 codes", "int16 codes" };
+    SignalCompact *pk = &g_sa_compact;
+    int running = 1;
+
+    while (running) {
+        printf("\n------ Compact storage ------\n");
+        if (pk->count > 0) {
+            printf("Holding %d samples as %s: %.2f MB (double would need %.2f MB)\n",
+                   pk->count, names[pk->format], sa_compact_bytes(pk) / 1e6,
+                   pk->count * (double)sizeof(double) / 1e6);
+        }
+        printf("1. Load file into compact storage\n");
+        printf("2. Pack the loaded samples\n");
+        printf("3. Statistics (mean, min, max, RMS)\n");
+        printf("4. Expand into the Signal Analyzer (double)\n");
+        printf("5. Save statistics (signal_compact.txt)\n");
+        printf("6. Back\n");
+        printf("-----------------------------\n");
+
+        int choice = uc_get_choice();
+        if ((choice == 3 || choice == 4 || choice == 5) && pk->count <= 0) {
+            printf("\nNothing stored yet. Load a file or pack the loaded samples first.\n");
+            continue;
+        }
+
+        switch (choice) {
+            case 1:
+            case 2: {
+                char name[256] = "";
+                if (choice == 1 && !ec_read_line("File name: ", name, sizeof(name))) {
+                    break;
+                }
+                printf("Storage format: 1) float32  2) int32 codes  3) int16 codes\n");
+                int format = uc_get_choice();
+                if (format < SA_STORE_F32 || format > SA_STORE_I16) {
+                    printf("Invalid format.\n");
+                    break;
+                }
+                double scale = 1.0, offset = 0.0;
+                if (format != SA_STORE_F32) {
+                    scale  = uc_get_double("Value of one code (e.g. Vref / 2^bits, 1 for raw codes): ");
+                    offset = uc_get_double("Value of code 0 (offset): ");
+                    if (scale <= 0.0) {
+                        printf("The code value must be > 0.\n");
+                        break;
+                    }
+                }
+                sa_compact_free(pk);
+                sa_compact_init(pk, format, scale, offset);
+                int status = (choice == 1) ? sa_compact_load_file(pk, name)
+                                           : sa_compact_from_context(pk, &g_sa_ctx);
+                if (status == SA_ERR_OPEN) {
+                    printf("\nError: Could not open '%s'.\n", name);
+                } else if (status == SA_ERR_EMPTY) {
+                    printf("\nNo samples found.\n");
+                } else if (status != SA_OK) {
+                    printf("\nError: Out of memory.\n");
+                } else {
+                    printf("\nStored %d samples as %s (%.2f MB)", pk->count, names[format],
+                           sa_compact_bytes(pk) / 1e6);
+                    if (pk->clipped > 0) printf(", %lld outside the code range clipped", pk->clipped);
+                    printf(".\n");
+                }
+                break;
+            }
+            case 3: {
+                SignalChannelStats st;
+                double t0 = sa_live_now();
+                sa_compact_stats(pk, &st);
+                double dt = sa_live_now() - t0;
+                printf("\nCompact statistics (%s):\n", names[pk->format]);
+                printf("  Count : %d\n", pk->count);
+                printf("  Min   : %.6f\n", st.min);
+                printf("  Max   : %.6f\n", st.max);
+                printf("  Mean  : %.6f\n", st.mean);
+                printf("  RMS   : %.6f\n", st.rms);
+                if (dt > 0.0) printf("  (%.1f MS/s)\n", pk->count / dt / 1e6);
+                break;
+            }
+            case 4:
+                if (sa_compact_to_context(pk, &g_sa_ctx) == SA_OK) {
+                    printf("\n%d samples expanded into the Signal Analyzer.\n", pk->count);
+                } else {
+                    printf("\nError: Out of memory.\n");
+                }
+                break;
+            case 5: {
+                SignalChannelStats st;
+                FILE *fp = fopen("signal_compact.txt", "w");
+                if (!fp) {
+                    printf("\nError: Could not open 'signal_compact.txt' for writing.\n");
+                    break;
+                }
+                sa_compact_stats(pk, &st);
+                fprintf(fp, "Signal statistics (%s storage of '%s')\n", names[pk->format], pk->source);
+                fprintf(fp, "Count = %d\n",  pk->count);
+                fprintf(fp, "Min   = %.6f\n", st.min);
+                fprintf(fp, "Max   = %.6f\n", st.max);
+                fprintf(fp, "Mean  = %.6f\n", st.mean);
+                fprintf(fp, "RMS   = %.6f\n", st.rms);
+                fclose(fp);
+                printf("\nStatistics saved to 'signal_compact.txt'.\n");
+                break;
+            }
+            case 6:
+                running = 0;
+                break;
+            default:
+                printf("Unknown option.\n");
+                break;
+        }
+    }
+}
+
+/* ============================================== *
+ * 1. Signal Analyzer: Compressed captures        *
+ * ============================================== */
+
+/* .etkz files store a compact capture losslessly in independent blocks:     *
+ *   header    SaCodecHeader                                                 *
+ *   offsets   uint64 x (nblocks + 1): file offset of each block and the end *
+ *   blocks    SA_CODEC_BLOCK samples each (the last one may be shorter):    *
+ *               uint32  first value                                        *
+ *               uint8   bit width of each 128-value mini-block             *
+ *               packed  zigzag-coded deltas, 128 per mini-block at that    *
+ *                       width, as 4 interleaved 32-bit lanes (value i in   *
+ *                       lane i % 4)                                        *
+ * Codes (and float32 bit patterns) are treated as uint32 with wrap-around, *
+ * so deltas never overflow and decoding is exact.  Slowly varying ADC data *
+ * packs into a few bits per sample.  The lane layout lets the decoder      *
+ * unpack 4 values per SSE2 shift/mask, then undo zigzag and the deltas     *
+ * with a 4-lane prefix sum.  Blocks are shared out to threads; the stats   *
+ * path folds each decoded block into per-thread sums and never stores the  *
+ * capture.  Multi-byte fields are in the writer's native byte order.       */
+
+#define SA_CODEC_BLOCK        4096
+#define SA_CODEC_MINI         128
+#define SA_CODEC_MAX_BLOCK    (4 + SA_CODEC_BLOCK / SA_CODEC_MINI * (1 + 16 * 32))
+#define SA_CODEC_MAX_THREADS  16
+
+typedef struct {
+    char     magic[4];            /* "ETKZ" */
+    uint32_t version;             /* 1 */
+    int32_t  format;              /* SA_STORE_* */
+    uint32_t block_len;           /* SA_CODEC_BLOCK */
+    uint64_t count;
+    uint64_t nblocks;
+    double   scale;
+    double   offset;
+} SaCodecHeader;
+
+static uint32_t sa_codec_get(const SignalCompact *pk, size_t i)   /* value i as a uint32 pattern */
+{
+    if (pk->format == SA_STORE_I16) return (uint32_t)(int32_t)((const int16_t *)pk->data)[i];
+    return ((const uint32_t *)pk->data)[i];
+}
+static size_t sa_codec_encode_block(const SignalCompact *pk, size_t begin, int n, uint8_t *out)
+{
+    uint32_t zz[SA_CODEC_BLOCK];
+    int nmini = (n + SA_CODEC_MINI - 1) / SA_CODEC_MINI;
+    uint32_t prev = sa_codec_get(pk, begin);
+    uint8_t *p = out;
+
+    memcpy(p, &prev, sizeof(prev));
+    p += sizeof(prev);
+    uint8_t *widths = p;
+    p += nmini;
+
+    for (int i = 0; i < nmini * SA_CODEC_MINI; i++) {
+        if (i < n) {
+            uint32_t x = sa_codec_get(pk, begin + (size_t)i);
+            uint32_t d = x - prev;
+            prev = x;
+            zz[i] = (d << 1) ^ (uint32_t)-(d >> 31);    /* zigzag: small magnitudes -> small codes */
+        } else {
+            zz[i] = 0;
+        }
+    }
+
+    for (int m = 0; m < nmini; m++) {
+        const uint32_t *v = zz + m * SA_CODEC_MINI;
+        uint32_t all = 0;
+        for (int i = 0; i < SA_CODEC_MINI; i++) all |= v[i];
+
+        int w = 0;
+        while (w < 32 && (all >> w) != 0) w++;
+        widths[m] = (uint8_t)w;
+
+        uint32_t words[4 * 32] = { 0 };
+        for (int i = 0; i < SA_CODEC_MINI && w > 0; i++) {
+            int lane = i & 3;
+            int bit  = (i >> 2) * w;
+            int word = bit >> 5, sh = bit & 31;
+            words[4 * word + lane] |= v[i] << sh;
+            if (sh + w > 32) {
+                words[4 * (word + 1) + lane] |= v[i] >> (32 - sh);
+            }
+        }
+        memcpy(p, words, (size_t)16 * w);
+        p += 16 * w;
+    }
+    return (size_t)(p - out);
+}
+/* Unpack one mini-block of 128 values at width w (1..32) */
+static void sa_codec_unpack128(const uint8_t *in, int w, uint32_t *out)
+{
+#if defined(__SSE2__)
+    const __m128i *src = (const __m128i *)in;
+    __m128i mask = _mm_set1_epi32((w == 32) ? -1 : (int)((1u << w) - 1));
+    __m128i cur = _mm_loadu_si128(src++);
+    int shift = 0;
+
+    for (int k = 0; k < 32; k++) {
+        __m128i v = _mm_srl_epi32(cur, _mm_cvtsi32_si128(shift));
+        shift += w;
+        if (shift >= 32) {
+            shift -= 32;
+            if (k < 31) {
+                cur = _mm_loadu_si128(src++);
+                if (shift > 0) {
+                    v = _mm_or_si128(v, _mm_sll_epi32(cur, _mm_cvtsi32_si128(w - shift)));
+                }
+            }
+        }
+        _mm_storeu_si128((__m128i *)(out + 4 * k), _mm_and_si128(v, mask));
+    }
+#else
+    uint32_t words[4 * 32];
+    uint32_t mask = (w == 32) ? 0xffffffffu : ((1u << w) - 1);
+    memcpy(words, in, (size_t)16 * w);
+    for (int i = 0; i < SA_CODEC_MINI; i++) {
+        int lane = i & 3;
+        int bit  = (i >> 2) * w;
+        int word = bit >> 5, sh = bit & 31;
+        uint32_t v = words[4 * word + lane] >> sh;
+        if (sh + w > 32) {
+            v |= words[4 * (word + 1) + lane] << (32 - sh);
+        }
+        out[i] = v & mask;
+    }
+#endif
+}
+/* Decode one block of n values into out (room for a whole number of *
+ * mini-blocks).  Returns 0 if the block does not fit in `avail` bytes. */
+static int sa_codec_decode_block(const uint8_t *in, size_t avail, int n, uint32_t *out)
+{
+    int nmini = (n + SA_CODEC_MINI - 1) / SA_CODEC_MINI;
+    uint32_t prev;
+
+    if (avail < sizeof(prev) + (size_t)nmini) {
+        return 0;
+    }
+    memcpy(&prev, in, sizeof(prev));
+    const uint8_t *widths = in + sizeof(prev);
+    const uint8_t *p = widths + nmini;
+    const uint8_t *end = in + avail;
+
+    for (int m = 0; m < nmini; m++) {
+        int w = widths[m];
+        uint32_t *o = out + m * SA_CODEC_MINI;
+        if (w > 32 || (size_t)(end - p) < (size_t)16 * w) {
+            return 0;
+        }
+        if (w == 0) {
+            memset(o, 0, SA_CODEC_MINI * sizeof(uint32_t));
+        } else {
+            sa_codec_unpack128(p, w, o);
+        }
+        p += 16 * w;
+
+        /* Undo zigzag, then running sum starting from the previous value */
+#if defined(__SSE2__)
+        __m128i one = _mm_set1_epi32(1);
+        __m128i run = _mm_set1_epi32((int)prev);
+        for (int k = 0; k < SA_CODEC_MINI; k += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(o + k));
+            v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, run);
+            _mm_storeu_si128((__m128i *)(o + k), v);
+            run = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        prev = o[SA_CODEC_MINI - 1];
+#else
+        for (int k = 0; k < SA_CODEC_MINI; k++) {
+            uint32_t z = o[k];
+            prev += (z >> 1) ^ (uint32_t)-(z & 1);
+            o[k] = prev;
+        }
+#endif
+    }
+    return 1;
+}
+int sa_codec_write(const SignalCompact *pk, const char *filename, size_t *bytes_out)
+{
+    if (pk->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+
+    SaCodecHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "ETKZ", 4);
+    hdr.version   = 1;
+    hdr.format    = pk->format;
+    hdr.block_len = SA_CODEC_BLOCK;
+    hdr.count     = (uint64_t)pk->count;
+    hdr.nblocks   = (hdr.count + SA_CODEC_BLOCK - 1) / SA_CODEC_BLOCK;
+    hdr.scale     = pk->scale;
+    hdr.offset    = pk->offset;
+
+    uint64_t *offsets = malloc((size_t)(hdr.nblocks + 1) * sizeof(uint64_t));
+    uint8_t  *blk     = malloc(SA_CODEC_MAX_BLOCK);
+    FILE *fp = (offsets && blk) ? fopen(filename, "wb") : NULL;
+    if (!fp) {
+        free(offsets);
+        free(blk);
+        return (offsets && blk) ? SA_ERR_OPEN : SA_ERR_MEMORY;
+    }
+
+    /* Header and a placeholder index, blocks, then the real index */
+    uint64_t pos = sizeof(hdr) + (hdr.nblocks + 1) * sizeof(uint64_t);
+    int ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+             fwrite(offsets, sizeof(uint64_t), hdr.nblocks + 1, fp) == hdr.nblocks + 1;
+
+    for (uint64_t b = 0; b < hdr.nblocks && ok; b++) {
+        size_t begin = (size_t)b * SA_CODEC_BLOCK;
+        int n = (int)((hdr.count - begin < SA_CODEC_BLOCK) ? hdr.count - begin : SA_CODEC_BLOCK);
+        size_t len = sa_codec_encode_block(pk, begin, n, blk);
+        offsets[b] = pos;
+        pos += len;
+        ok = fwrite(blk, 1, len, fp) == len;
+    }
+    offsets[hdr.nblocks] = pos;
+
+    if (ok) {
+        ok = fseek(fp, (long)sizeof(hdr), SEEK_SET) == 0 &&
+             fwrite(offsets, sizeof(uint64_t), hdr.nblocks + 1, fp) == hdr.nblocks + 1;
+    }
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    free(offsets);
+    free(blk);
+    if (bytes_out) {
+        *bytes_out = (size_t)pos;
+    }
+    return ok ? SA_OK : SA_ERR_OPEN;
+}
+
+/* A mapped .etkz file */
+typedef struct {
+    const uint8_t       *base;
+    size_t               size;
+    const SaCodecHeader *hdr;
+    const uint64_t      *offsets;
+} SaCodecFile;
+
+static int sa_codec_open(SaCodecFile *cf, const char *filename)
+{
+    memset(cf, 0, sizeof(*cf));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return SA_ERR_OPEN;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SaCodecHeader)) {
+        close(fd);
+        return SA_ERR_FORMAT;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return SA_ERR_OPEN;
+    }
+    cf->base = map;
+    cf->size = (size_t)st.st_size;
+    cf->hdr  = map;
+
+    const SaCodecHeader *h = cf->hdr;
+    int valid = memcmp(h->magic, "ETKZ", 4) == 0 && h->version == 1 &&
+                h->block_len == SA_CODEC_BLOCK &&
+                h->format >= SA_STORE_F32 && h->format <= SA_STORE_I16 &&
+                h->count > 0 && h->count <= INT_MAX &&
+                h->nblocks == (h->count + SA_CODEC_BLOCK - 1) / SA_CODEC_BLOCK &&
+                (cf->size - sizeof(*h)) / sizeof(uint64_t) > h->nblocks;
+    if (valid) {
+        cf->offsets = (const uint64_t *)(cf->base + sizeof(*h));
+        for (uint64_t b = 0; b < h->nblocks && valid; b++) {
+            valid = cf->offsets[b] <= cf->offsets[b + 1] && cf->offsets[b + 1] <= cf->size;
+        }
+    }
+    if (!valid) {
+        munmap(map, cf->size);
+        memset(cf, 0, sizeof(*cf));
+        return SA_ERR_FORMAT;
+    }
+    return SA_OK;
+}
+static void sa_codec_close(SaCodecFile *cf)
+{
+    if (cf->base) {
+        munmap((void *)cf->base, cf->size);
+    }
+    memset(cf, 0, sizeof(*cf));
+}
+
+typedef struct {
+    const SaCodecFile *cf;
+    atomic_int        *next_block;
+    SignalCompact     *dst;         /* decode into this, or ... */
+    SaRunningStats     acc;         /* ... accumulate statistics when dst is NULL */
+    int                ok;
+} SaCodecJob;
+
+static void *sa_codec_thread(void *arg)
+{
+    SaCodecJob *job = arg;
+    const SaCodecHeader *h = job->cf->hdr;
+    uint32_t *buf = aligned_alloc(SA_CP_ALIGN, SA_CODEC_BLOCK * sizeof(uint32_t));
+    SignalCompact view;
+
+    job->ok = (buf != NULL);
+    memset(&view, 0, sizeof(view));
+    view.format = (h->format == SA_STORE_F32) ? SA_STORE_F32 : SA_STORE_I32;
+    view.data   = buf;
+
+    for (;;) {
+        int b = atomic_fetch_add_explicit(job->next_block, 1, memory_order_relaxed);
+        if (!job->ok || (uint64_t)b >= h->nblocks) {
+            break;
+        }
+        size_t begin = (size_t)b * SA_CODEC_BLOCK;
+        int n = (int)((h->count - begin < SA_CODEC_BLOCK) ? h->count - begin : SA_CODEC_BLOCK);
+        const uint8_t *in = job->cf->base + job->cf->offsets[b];
+        size_t avail = (size_t)(job->cf->offsets[b + 1] - job->cf->offsets[b]);
+
+        if (!sa_codec_decode_block(in, avail, n, buf)) {
+            job->ok = 0;
+            break;
+        }
+
+        if (job->dst) {
+            if (h->format == SA_STORE_I16) {
+                int16_t *o = (int16_t *)job->dst->data + begin;
+                for (int i = 0; i < n; i++) o[i] = (int16_t)buf[i];
+            } else {
+                memcpy((uint32_t *)job->dst->data + begin, buf, (size_t)n * sizeof(uint32_t));
+            }
+        } else {
+            SaRunningStats part;
+            view.count = n;
+            sa_compact_scan(&view, &part);
+            if (job->acc.count == 0 || part.min < job->acc.min) job->acc.min = part.min;
+            if (job->acc.count == 0 || part.max > job->acc.max) job->acc.max = part.max;
+            job->acc.count  += part.count;
+            job->acc.sum    += part.sum;
+            job->acc.sum_sq += part.sum_sq;
+        }
+    }
+    free(buf);
+    return NULL;
+}
+/* Decode (dst != NULL) or summarise (acc != NULL) every block in parallel */
+static int sa_codec_run(const SaCodecFile *cf, SignalCompact *dst, SaRunningStats *acc)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = (cores > 0) ? (int)cores : 1;
+    if ((uint64_t)nthreads > cf->hdr->nblocks) nthreads = (int)cf->hdr->nblocks;
+    if (nthreads > SA_CODEC_MAX_THREADS) nthreads = SA_CODEC_MAX_THREADS;
+
+    atomic_int next_block;
+    atomic_init(&next_block, 0);
+    SaCodecJob job[SA_CODEC_MAX_THREADS];
+    pthread_t tid[SA_CODEC_MAX_THREADS];
+    int created[SA_CODEC_MAX_THREADS] = { 0 };
+
+    for (int t = 0; t < nthreads; t++) {
+        memset(&job[t], 0, sizeof(job[t]));
+        job[t].cf = cf;
+        job[t].next_block = &next_block;
+        job[t].dst = dst;
+    }
+    for (int t = 1; t < nthreads; t++) {
+        created[t] = (pthread_create(&tid[t], NULL, sa_codec_thread, &job[t]) == 0);
+    }
+    sa_codec_thread(&job[0]);           /* also picks up the blocks of threads that failed to start */
+
+    int ok = 1;
+    if (acc) {
+        memset(acc, 0, sizeof(*acc));
+    }
+    for (int t = 0; t < nthreads; t++) {
+        if (t > 0 && !created[t]) {
+            continue;
+        }
+        if (t > 0) pthread_join(tid[t], NULL);
+        ok = ok && job[t].ok;
+        if (acc && job[t].acc.count > 0) {
+            if (acc->count == 0 || job[t].acc.min < acc->min) acc->min = job[t].acc.min;
+            if (acc->count == 0 || job[t].acc.max > acc->max) acc->max = job[t].acc.max;
+            acc->count  += job[t].acc.count;
+            acc->sum    += job[t].acc.sum;
+            acc->sum_sq += job[t].acc.sum_sq;
+        }
+    }
+    return ok ? SA_OK : SA_ERR_FORMAT;
+}
+int sa_codec_read(SignalCompact *pk, const char *filename)
+{
+    SaCodecFile cf;
+    int status = sa_codec_open(&cf, filename);
+    if (status != SA_OK) {
+        return status;
+    }
+
+    sa_compact_free(pk);
+    sa_compact_init(pk, cf.hdr->format, cf.hdr->scale, cf.hdr->offset);
+    if (!sa_compact_reserve(pk, (int)cf.hdr->count)) {
+        sa_codec_close(&cf);
+        return SA_ERR_MEMORY;
+    }
+    pk->count = (int)cf.hdr->count;
+
+    status = sa_codec_run(&cf, pk, NULL);
+    sa_codec_close(&cf);
+    if (status != SA_OK) {
+        sa_compact_free(pk);
+        return status;
+    }
+    snprintf(pk->source, sizeof(pk->source), "%s", filename);
+    return SA_OK;
+}
+int sa_codec_stats(const char *filename, SignalChannelStats *st, long long *count)
+{
+    SaCodecFile cf;
+    SaRunningStats acc;
+    int status = sa_codec_open(&cf, filename);
+    if (status != SA_OK) {
+        return status;
+    }
+
+    status = sa_codec_run(&cf, NULL, &acc);
+    if (status == SA_OK) {
+        sa_compact_finish_stats(&acc, cf.hdr->scale, cf.hdr->offset, st);
+        *count = acc.count;
+    }
+    sa_codec_close(&cf);
+    return status;
+}
+static void sa_codec_report(int status, const char *name)
+{
+    if (status == SA_ERR_OPEN) {
+        printf("\nError: Could not open '%s'.\n", name);
+    } else if (status == SA_ERR_FORMAT) {
+        printf("\nError: '%s' is not a valid compressed capture.\n", name);
+    } else if (status == SA_ERR_MEMORY) {
+        printf("\nError: Out of memory.\n");
+    } else if (status == SA_ERR_EMPTY) {
+        printf("\nNo samples found.\n");
+    }
+}
+void sa_codec_menu(void)
+{
+    int running = 1;
+
+    while (running) {
+        printf("\n------ Compressed captures (.etkz) ------\n");
+        printf("1. Compress a text sample file\n");
+        printf("2. Compress the compact storage\n");
+        printf("3. Statistics straight from a compressed file\n");
+        printf("4. Decompress into the compact storage\n");
+        printf("5. Decompress into the Signal Analyzer\n");
+        printf("6. Back\n");
+        printf("-----------------------------------------\n");
+
+        int choice = uc_get_choice();
+        char in_name[256], out_name[256];
+        int status;
+
+        switch (choice) {
+            case 1:
+            case 2: {
+                SignalCompact tmp;
+                SignalCompact *src = &g_sa_compact;
+
+                if (choice == 1) {
+                    if (!ec_read_line("Text sample file: ", in_name, sizeof(in_name))) break;
+                    printf("Stored as: 1) float32  2) int32 codes  3) int16 codes\n");
+                    int format = uc_get_choice();
+                    if (format < SA_STORE_F32 || format > SA_STORE_I16) {
+                        printf("Invalid format.\n");
+                        break;
+                    }
+                    double scale = 1.0, offset = 0.0;
+                    if (format != SA_STORE_F32) {
+                        scale  = uc_get_double("Value of one code (e.g. Vref / 2^bits, 1 for raw codes): ");
+                        offset = uc_get_double("Value of code 0 (offset): ");
+                        if (scale <= 0.0) {
+                            printf("The code value must be > 0.\n");
+                            break;
+                        }
+                    }
+                    sa_compact_init(&tmp, format, scale, offset);
+                    status = sa_compact_load_file(&tmp, in_name);
+                    if (status != SA_OK) {
+                        sa_codec_report(status, in_name);
+                        sa_compact_free(&tmp);
+                        break;
+                    }
+                    if (tmp.clipped > 0) {
+                        printf("Warning: %lld values were outside the code range and were clipped.\n",
+                               tmp.clipped);
+                    }
+                    src = &tmp;
+                } else if (src->count <= 0) {
+                    printf("\nThe compact storage is empty (Signal Analyzer option 11).\n");
+                    break;
+                }
+
+                if (ec_read_line("Output file (.etkz): ", out_name, sizeof(out_name))) {
+                    size_t bytes = 0;
+                    double t0 = sa_live_now();
+                    status = sa_codec_write(src, out_name, &bytes);
+                    if (status == SA_OK) {
+                        printf("\nWrote %d samples to '%s': %.2f MB, %.2f bits/sample, "
+                               "%.1fx smaller than double (%.3f s).\n",
+                               src->count, out_name, bytes / 1e6, bytes * 8.0 / src->count,
+                               src->count * (double)sizeof(double) / bytes, sa_live_now() - t0);
+                    } else {
+                        sa_codec_report(status, out_name);
+                    }
+                }
+                if (src == &tmp) {
+                    sa_compact_free(&tmp);
+                }
+                break;
+            }
+            case 3: {
+                SignalChannelStats st;
+                long long count = 0;
+                if (!ec_read_line("Compressed file: ", in_name, sizeof(in_name))) break;
+                double t0 = sa_live_now();
+                status = sa_codec_stats(in_name, &st, &count);
+                double dt = sa_live_now() - t0;
+                if (status != SA_OK) {
+                    sa_codec_report(status, in_name);
+                    break;
+                }
+                printf("\nSignal statistics of '%s' (decoded on the fly):\n", in_name);
+                printf("  Count : %lld\n", count);
+                printf("  Min   : %.6f\n", st.min);
+                printf("  Max   : %.6f\n", st.max);
+                printf("  Mean  : %.6f\n", st.mean);
+                printf("  RMS   : %.6f\n", st.rms);
+                if (dt > 0.0) printf("  (%.1f MS/s)\n", count / dt / 1e6);
+                break;
+            }
+            case 4:
+            case 5: {
+                if (!ec_read_line("Compressed file: ", in_name, sizeof(in_name))) break;
+                double t0 = sa_live_now();
+                status = sa_codec_read(&g_sa_compact, in_name);
+                if (status != SA_OK) {
+                    sa_codec_report(status, in_name);
+                    break;
+                }
+                if (choice == 5 && (status = sa_compact_to_context(&g_sa_compact, &g_sa_ctx)) != SA_OK) {
+                    sa_codec_report(status, in_name);
+                    break;
+                }
+                printf("\nDecompressed %d samples from '%s' in %.3f s into the %s.\n",
+                       g_sa_compact.count, in_name, sa_live_now() - t0,
+                       (choice == 5) ? "Signal Analyzer" : "compact storage");
+                break;
+            }
+            case 6:
+                running = 0;
+                break;
+            default:
+                printf("Unknown option.\n");
+                break;
+        }
+    }
+}
+
+/* ============================================== *
+ * 1. Signal Analyzer: Spectrogram (STFT)         *
+ * ============================================== */
+
+/* Short-time Fourier transform of the sample store.                        *
+ *  - Frames of `window` samples (a power of two) start every `hop`         *
+ *    samples and are weighted by a periodic Hann window.                   *
+ *  - One FFT plan per run, shared read-only by every thread: bit-reversal  *
+ *    table plus per-stage twiddles laid out contiguously, so each          *
+ *    butterfly pass walks data and twiddles with unit stride.  A real      *
+ *    frame of N samples goes through an N/2-point complex FFT (even        *
+ *    samples as real part, odd as imaginary) and is split into the         *
+ *    N/2 + 1 bins afterwards.                                              *
+ *  - Frames are computed in batches sized to SA_STFT_BATCH_BYTES; each     *
+ *    batch is shared out to threads while the previous one is written, so  *
+ *    the matrix never has to fit in memory (an hour at 48 kHz with hop 256 *
+ *    is ~675k frames, 1.4 GB of float32 at window 1024).                   *
+ *  - The heat map is max-pooled on the fly into a small grid per thread,  *
+ *    merged at the end; pooling by maximum keeps short tones visible.      *
+ * Matrix file: SaStftHeader, then `frames` rows of `bins` float32 values   *
+ * in dB re full-scale amplitude (a sine of amplitude A peaks at 20log10 A), *
+ * native byte order.                                                       */
+
+#define SA_STFT_MIN_WINDOW    16
+#define SA_STFT_MAX_WINDOW    65536
+#define SA_STFT_BATCH_BYTES   (16 << 20)
+#define SA_STFT_MAX_THREADS   16
+#define SA_STFT_FLOOR_DB      (-300.0f)            /* value of an all-zero bin */
+#define SA_STFT_RANGE_DB      80.0                 /* heat map spans peak - 80 dB .. peak */
+
+typedef struct {
+    char     magic[4];            /* "ETKF" */
+    uint32_t version;             /* 1 */
+    uint32_t window;
+    uint32_t hop;
+    uint32_t bins;                /* window / 2 + 1 */
+    uint32_t reserved;
+    uint64_t frames;
+    double   sample_rate;         /* Hz, 0 = not given */
+} SaStftHeader;
+
+/* Complex FFT of n points; stage with half-size m uses tw_re/im[m-1 .. 2m-2] */
+typedef struct {
+    int     n;
+    int    *rev;                  /* bit-reversed index */
+    double *tw_re, *tw_im;        /* n - 1 per-stage twiddles */
+} SaFftPlan;
+
+static void sa_fft_plan_free(SaFftPlan *p)
+{
+    free(p->rev);
+    free(p->tw_re);
+    free(p->tw_im);
+    memset(p, 0, sizeof(*p));
+}
+/* n must be a power of two; returns 0 on allocation failure */
+static int sa_fft_plan_init(SaFftPlan *p, int n)
+{
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+
+    memset(p, 0, sizeof(*p));
+    p->n     = n;
+    p->rev   = malloc((size_t)n * sizeof(int));
+    p->tw_re = malloc((size_t)n * sizeof(double));
+    p->tw_im = malloc((size_t)n * sizeof(double));
+    if (!p->rev || !p->tw_re || !p->tw_im) {
+        sa_fft_plan_free(p);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        p->rev[i] = r;
+    }
+    for (int m = 1; m < n; m <<= 1) {
+        for (int j = 0; j < m; j++) {
+            p->tw_re[m - 1 + j] =  cos(M_PI * j / m);
+            p->tw_im[m - 1 + j] = -sin(M_PI * j / m);
+        }
+    }
+    return 1;
+}
+/* In-place forward transform of data already in bit-reversed order (n >= 4) */
+static void sa_fft_run(const SaFftPlan *p, double *re, double *im)
+{
+    const int n = p->n;
+
+    /* First two stages as one radix-4 pass: twiddles 1 and -i need no multiplies */
+    for (int k = 0; k < n; k += 4) {
+        double a0r = re[k] + re[k + 1],     a0i = im[k] + im[k + 1];
+        double a1r = re[k] - re[k + 1],     a1i = im[k] - im[k + 1];
+        double a2r = re[k + 2] + re[k + 3], a2i = im[k + 2] + im[k + 3];
+        double a3r = re[k + 2] - re[k + 3], a3i = im[k + 2] - im[k + 3];
+        re[k]     = a0r + a2r;  im[k]     = a0i + a2i;
+        re[k + 2] = a0r - a2r;  im[k + 2] = a0i - a2i;
+        re[k + 1] = a1r + a3i;  im[k + 1] = a1i - a3r;
+        re[k + 3] = a1r - a3i;  im[k + 3] = a1i + a3r;
+    }
+    for (int m = 4; m < n; m <<= 1) {
+        const double *wr = p->tw_re + m - 1;
+        const double *wi = p->tw_im + m - 1;
+        for (int k = 0; k < n; k += 2 * m) {
+            double *ar = re + k, *ai = im + k;
+            double *br = ar + m, *bi = ai + m;
+            for (int j = 0; j < m; j++) {
+                double tr = br[j] * wr[j] - bi[j] * wi[j];
+                double ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
+
+typedef struct {
+    int           window, hop, bins;
+    long long     frames;
+    const double *x;              /* samples */
+    SaFftPlan     plan;           /* window / 2 points */
+    double       *hann;           /* window */
+    double       *split_re, *split_im;   /* e^{-2πik/N}, k < window / 2 */
+    double        scale;          /* power -> amplitude^2 re full scale */
+    int           rows, cols;     /* heat map grid */
+    int          *col_of;         /* bin -> heat map column */
+} SaStft;
+
+typedef struct {
+    const SaStft *st;
+    long long     first, count;   /* frames of the current batch */
+    float        *out;            /* count rows of st->bins */
+    double       *re, *im;        /* window / 2 each */
+    float         cells[SA_STFT_ROWS * SA_STFT_COLS];
+} SaStftJob;
+
+/* 10 log10(p) for normal p > 0, to float precision: exponent from the bits, *
+ * log of the mantissa (folded into [0.71, 1.41)) from the atanh series.     *
+ * log10f per bin otherwise costs more than the FFT itself.                 */
+static inline float sa_stft_db(float p)
+{
+    uint32_t bits;
+    float m;
+    memcpy(&bits, &p, sizeof(bits));
+    int e = (int)(bits >> 23) - 127;
+    bits = (bits & 0x7fffff) | 0x3f800000;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > 1.41421356f) {
+        m *= 0.5f;
+        e++;
+    }
+    float s = (m - 1.0f) / (m + 1.0f), s2 = s * s;
+    float ln = 2.0f * s * (1.0f + s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7 + s2 * (1.0f / 9)))));
+    return 3.01029996f * (float)e + 4.34294482f * ln;
+}
+/* Power row to dB in place; zero power becomes SA_STFT_FLOOR_DB */
+static void sa_stft_to_db(float *row, int n)
+{
+    int k = 0;
+#if defined(__SSE2__)
+    const __m128  one   = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f);
+    const __m128  tiny  = _mm_set1_ps(FLT_MIN), sqrt2 = _mm_set1_ps(1.41421356f);
+    const __m128  floor_db = _mm_set1_ps(SA_STFT_FLOOR_DB);
+    const __m128i mant  = _mm_set1_epi32(0x7fffff), expo_one = _mm_set1_epi32(0x3f800000);
+    const __m128i bias  = _mm_set1_epi32(127);
+    for (; k + 4 <= n; k += 4) {
+        __m128  p    = _mm_loadu_ps(row + k);
+        __m128  zero = _mm_cmple_ps(p, _mm_setzero_ps());
+        __m128i bits = _mm_castps_si128(_mm_add_ps(p, tiny));
+        __m128i e    = _mm_sub_epi32(_mm_srli_epi32(bits, 23), bias);
+        __m128  m    = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mant), expo_one));
+        __m128  big  = _mm_cmpgt_ps(m, sqrt2);
+        m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, half)), _mm_andnot_ps(big, m));
+        e = _mm_sub_epi32(e, _mm_castps_si128(big));                  /* mask is -1: e + 1 */
+        __m128 s  = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+        __m128 s2 = _mm_mul_ps(s, s);
+        __m128 poly = _mm_add_ps(_mm_set1_ps(1.0f / 7), _mm_mul_ps(s2, _mm_set1_ps(1.0f / 9)));
+        poly = _mm_add_ps(_mm_set1_ps(1.0f / 5), _mm_mul_ps(s2, poly));
+        poly = _mm_add_ps(_mm_set1_ps(1.0f / 3), _mm_mul_ps(s2, poly));
+        poly = _mm_add_ps(one, _mm_mul_ps(s2, poly));
+        __m128 db = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(3.01029996f), _mm_cvtepi32_ps(e)),
+                               _mm_mul_ps(_mm_set1_ps(8.68588964f), _mm_mul_ps(s, poly)));
+        _mm_storeu_ps(row + k, _mm_or_ps(_mm_and_ps(zero, floor_db), _mm_andnot_ps(zero, db)));
+    }
+#endif
+    for (; k < n; k++) {
+        row[k] = (row[k] > 0.0f) ? sa_stft_db(row[k] + FLT_MIN) : SA_STFT_FLOOR_DB;
+    }
+}
+static void sa_stft_frame(const SaStft *st, const double *x, double *re, double *im, float *row)
+{
+    const int half = st->window / 2;
+    const int *rev = st->plan.rev;
+
+    for (int i = 0; i < half; i++) {                      /* window, pack and permute */
+        re[rev[i]] = x[2 * i]     * st->hann[2 * i];
+        im[rev[i]] = x[2 * i + 1] * st->hann[2 * i + 1];
+    }
+    sa_fft_run(&st->plan, re, im);
+
+    /* X[k] = E[k] + W^k O[k], E/O recovered from Z[k] and conj(Z[half - k]) */
+    row[0]    = (float)((re[0] + im[0]) * (re[0] + im[0]) * st->scale * 0.25);
+    row[half] = (float)((re[0] - im[0]) * (re[0] - im[0]) * st->scale * 0.25);
+    for (int k = 1; k < half; k++) {
+        double zr = re[k], zi = im[k];
+        double cr = re[half - k], ci = -im[half - k];
+        double er = 0.5 * (zr + cr), ei = 0.5 * (zi + ci);
+        double dr = zr - cr, di = zi - ci;
+        double or_ = 0.5 * di, oi = -0.5 * dr;              /* O = (Z - conj) / 2i */
+        double wr = st->split_re[k], wi = st->split_im[k];
+        double xr = er + or_ * wr - oi * wi;
+        double xi = ei + or_ * wi + oi * wr;
+        row[k] = (float)((xr * xr + xi * xi) * st->scale);
+    }
+    sa_stft_to_db(row, half + 1);
+}
+static void *sa_stft_thread(void *arg)
+{
+    SaStftJob *job = arg;
+    const SaStft *st = job->st;
+
+    for (long long f = 0; f < job->count; f++) {
+        long long frame = job->first + f;
+        float *row = job->out + (size_t)f * (size_t)st->bins;
+        sa_stft_frame(st, st->x + (size_t)frame * (size_t)st->hop, job->re, job->im, row);
+
+        float *cell = job->cells + (size_t)(frame * st->rows / st->frames) * SA_STFT_COLS;
+        for (int k = 0; k < st->bins; k++) {
+            float *c = cell + st->col_of[k];
+            if (row[k] > *c) *c = row[k];
+        }
+    }
+    return NULL;
+}
+static void sa_stft_free(SaStft *st)
+{
+    sa_fft_plan_free(&st->plan);
+    free(st->hann);
+    free(st->split_re);
+    free(st->split_im);
+    free(st->col_of);
+}
+static int sa_stft_init(SaStft *st, const SignalStats *sig, int window, int hop)
+{
+    const int half = window / 2;
+
+    memset(st, 0, sizeof(*st));
+    st->window = window;
+    st->hop    = hop;
+    st->bins   = half + 1;
+    st->frames = 1 + (sig->count - window) / hop;
+    st->x      = sig->samples;
+    st->rows   = (st->frames < SA_STFT_ROWS) ? (int)st->frames : SA_STFT_ROWS;
+    st->cols   = (st->bins < SA_STFT_COLS) ? st->bins : SA_STFT_COLS;
+    st->hann     = malloc((size_t)window * sizeof(double));
+    st->split_re = malloc((size_t)half * sizeof(double));
+    st->split_im = malloc((size_t)half * sizeof(double));
+    st->col_of   = malloc((size_t)st->bins * sizeof(int));
+    if (!st->hann || !st->split_re || !st->split_im || !st->col_of ||
+        !sa_fft_plan_init(&st->plan, half)) {
+        sa_stft_free(st);
+        return 0;
+    }
+
+    double wsum = 0.0;
+    for (int i = 0; i < window; i++) {
+        st->hann[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / window);
+        wsum += st->hann[i];
+    }
+    st->scale = 4.0 / (wsum * wsum);                       /* one-sided amplitude */
+    for (int k = 0; k < half; k++) {
+        st->split_re[k] =  cos(2.0 * M_PI * k / window);
+        st->split_im[k] = -sin(2.0 * M_PI * k / window);
+    }
+    for (int k = 0; k < st->bins; k++) {
+        st->col_of[k] = (int)((long long)k * st->cols / st->bins);
+    }
+    return 1;
+}
+int sa_ctx_stft(SignalContext *ctx, int window, int hop, double sample_rate,
+                const char *filename, SignalSpectrogram *spec)
+{
+    const SignalStats *sig = &ctx->sig;
+    SaStft st;
+
+    if (window < SA_STFT_MIN_WINDOW || window > SA_STFT_MAX_WINDOW ||
+        (window & (window - 1)) != 0 || hop < 1 || hop > window) {
+        return SA_ERR_FORMAT;
+    }
+    if (sig->count < window) {
+        return SA_ERR_EMPTY;
+    }
+    if (!sa_stft_init(&st, sig, window, hop)) {
+        return SA_ERR_MEMORY;
+    }
+
+    long long batch = SA_STFT_BATCH_BYTES / ((long long)st.bins * (long long)sizeof(float));
+    if (batch < 1) batch = 1;
+    if (batch > st.frames) batch = st.frames;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = (cores > 1) ? (int)cores : 1;
+    if (nthreads > SA_STFT_MAX_THREADS) nthreads = SA_STFT_MAX_THREADS;
+    if (nthreads > batch) nthreads = (int)batch;
+
+    size_t batch_floats = (size_t)batch * (size_t)st.bins;
+    float *buf[2] = { malloc(batch_floats * sizeof(float)), malloc(batch_floats * sizeof(float)) };
+    SaStftJob *job = calloc((size_t)nthreads, sizeof(SaStftJob));
+    double *work = malloc((size_t)nthreads * (size_t)window * sizeof(double));
+    FILE *fp = NULL;
+    int status = (buf[0] && buf[1] && job && work) ? SA_OK : SA_ERR_MEMORY;
+
+    if (status == SA_OK && filename) {
+        SaStftHeader hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, "ETKF", 4);
+        hdr.version     = 1;
+        hdr.window      = (uint32_t)window;
+        hdr.hop         = (uint32_t)hop;
+        hdr.bins        = (uint32_t)st.bins;
+        hdr.frames      = (uint64_t)st.frames;
+        hdr.sample_rate = sample_rate;
+        fp = fopen(filename, "wb");
+        if (!fp || fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+            status = SA_ERR_OPEN;
+        }
+    }
+    for (int t = 0; status == SA_OK && t < nthreads; t++) {
+        job[t].st = &st;
+        job[t].re = work + (size_t)t * (size_t)window;
+        job[t].im = job[t].re + window / 2;
+        for (int c = 0; c < SA_STFT_ROWS * SA_STFT_COLS; c++) {
+            job[t].cells[c] = SA_STFT_FLOOR_DB;
+        }
+    }
+
+    /* Batch b is computed into buf[b & 1] while buf[(b - 1) & 1] is written */
+    long long nbatches = (st.frames + batch - 1) / batch;
+    for (long long b = 0; status == SA_OK && b <= nbatches; b++) {
+        pthread_t tid[SA_STFT_MAX_THREADS];
+        int created[SA_STFT_MAX_THREADS] = { 0 };
+        long long first = b * batch;
+        long long count = (b < nbatches) ? ((st.frames - first < batch) ? st.frames - first : batch) : 0;
+        long long per = (count + nthreads - 1) / nthreads;
+
+        for (int t = 0; t < nthreads && count > 0; t++) {
+            long long begin = (long long)t * per;
+            job[t].first = first + begin;
+            job[t].count = (begin >= count) ? 0 : ((count - begin < per) ? count - begin : per);
+            job[t].out   = buf[b & 1] + (size_t)begin * (size_t)st.bins;
+            if (t > 0) {
+                created[t] = (pthread_create(&tid[t], NULL, sa_stft_thread, &job[t]) == 0);
+            }
+        }
+        if (b > 0 && fp) {
+            long long prev = (b - 1) * batch;
+            size_t rows = (size_t)((st.frames - prev < batch) ? st.frames - prev : batch);
+            if (fwrite(buf[(b - 1) & 1], sizeof(float) * (size_t)st.bins, rows, fp) != rows) {
+                status = SA_ERR_OPEN;
+            }
+        }
+        for (int t = 0; t < nthreads && count > 0; t++) {
+            if (t == 0 || !created[t]) {
+                sa_stft_thread(&job[t]);          /* this thread's share, or one that failed to start */
+            }
+        }
+        for (int t = 1; t < nthreads && count > 0; t++) {
+            if (created[t]) pthread_join(tid[t], NULL);
+        }
+    }
+    if (fp && fclose(fp) != 0 && status == SA_OK) {
+        status = SA_ERR_OPEN;
+    }
+
+    if (status == SA_OK) {
+        memset(spec, 0, sizeof(*spec));
+        spec->window      = window;
+        spec->hop         = hop;
+        spec->bins        = st.bins;
+        spec->frames      = st.frames;
+        spec->sample_rate = sample_rate;
+        spec->rows        = st.rows;
+        spec->cols        = st.cols;
+        spec->peak_db     = SA_STFT_FLOOR_DB;
+        for (int c = 0; c < SA_STFT_ROWS * SA_STFT_COLS; c++) {
+            float v = SA_STFT_FLOOR_DB;
+            for (int t = 0; t < nthreads; t++) {
+                if (job[t].cells[c] > v) v = job[t].cells[c];
+            }
+            spec->cells[c] = v;
+            if (v > spec->peak_db) spec->peak_db = v;
+        }
+    }
+    free(buf[0]);
+    free(buf[1]);
+    free(job);
+    free(work);
+    sa_stft_free(&st);
+    return status;
+}
+/* ASCII heat map: one line per time slice, frequency left (0 Hz) to right */
+static void sa_stft_plot(const SignalSpectrogram *spec)
+{
+    static const char ramp[] = " .:-=+*#%@";
+    const int levels = (int)sizeof(ramp) - 2;
+    double top = spec->peak_db;
+    double bottom = top - SA_STFT_RANGE_DB;
+
+    printf("\nSpectrogram: %lld frames x %d bins (window %d, hop %d), each cell the loudest bin it covers\n",
+           spec->frames, spec->bins, spec->window, spec->hop);
+    printf("Shading ' ' <= %.1f dB ... '@' = %.1f dB\n\n", bottom, top);
+
+    for (int r = 0; r < spec->rows; r++) {
+        char line[48 + SA_STFT_COLS];
+        long long frame = (long long)r * spec->frames / spec->rows;
+        double t = (spec->sample_rate > 0.0) ? (double)frame * spec->hop / spec->sample_rate : -1.0;
+        int len;
+        if (t >= 0.0 && t < 1e6) {    /* seconds fit the column; otherwise label by frame */
+            len = snprintf(line, 32, "%10.3f s |", t);
+        } else {
+            len = snprintf(line, 32, "%10lld   |", frame);
+        }
+        if (len < 0 || len > 31) {
+            len = 31;                 /* snprintf returns the untruncated length (tiny rates) */
+        }
+        for (int c = 0; c < spec->cols; c++) {
+            double v = spec->cells[(size_t)r * SA_STFT_COLS + c];
+            int level = (v <= bottom) ? 0 : (int)((v - bottom) / SA_STFT_RANGE_DB * levels + 0.5);
+            if (level > levels) level = levels;
+            line[len++] = ramp[level];
+        }
+        line[len++] = '|';
+        line[len++] = '\n';
+        fwrite(line, 1, (size_t)len, stdout);
+    }
+    char right[32];
+    if (spec->sample_rate > 0.0) {
+        snprintf(right, sizeof(right), "%.1f Hz", spec->sample_rate / 2.0);
+    } else {
+        snprintf(right, sizeof(right), "bin %d", spec->bins - 1);
+    }
+    int gap = spec->cols - 5 - (int)strlen(right);
+    printf("%13s%s%*s%s\n", "", (spec->sample_rate > 0.0) ? "0 Hz " : "bin 0", (gap > 0) ? gap : 1, "", right);
+}
+void sa_spectrogram(void)
+{
+    const char *filename = "signal_stft.bin";
+    SignalSpectrogram *spec = malloc(sizeof(*spec));
+
+    if (!spec) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    printf("\n[Spectrogram (STFT)]  Hann-windowed frames, magnitude in dB saved to '%s'\n", filename);
+    int window = (int)uc_get_int_in("Window length (power of two, 16-65536): ",
+                                    SA_STFT_MIN_WINDOW, SA_STFT_MAX_WINDOW);
+    int hop    = (int)uc_get_int_in("Hop between frames (1-window, e.g. window/4): ", 1, window);
+    double rate = uc_get_double("Sample rate in Hz (0 if unknown): ");
+    if (!(rate > 0.0) || !isfinite(rate)) rate = 0.0;
+
+    double t0 = sa_live_now();
+    int status = sa_ctx_stft(&g_sa_ctx, window, hop, rate, filename, spec);
+    double dt = sa_live_now() - t0;
+    if (status == SA_ERR_FORMAT) {
+        printf("The window must be a power of two from %d to %d, and the hop between 1 and the window.\n",
+               SA_STFT_MIN_WINDOW, SA_STFT_MAX_WINDOW);
+    } else if (status == SA_ERR_EMPTY) {
+        printf("\nNeed at least one window of samples (%d). "
+               "Please enter samples (option 1) or load from file (option 2) first.\n", window);
+    } else if (status == SA_ERR_OPEN) {
+        printf("\nError: Could not write '%s'.\n", filename);
+    } else if (status != SA_OK) {
+        printf("Error: Out of memory while computing the spectrogram.\n");
+    } else {
+        sa_stft_plot(spec);
+        printf("\n%lld frames saved to '%s' in %.3f s", spec->frames, filename, dt);
+        if (dt > 0.0) printf(" (%.0f frames/s)", spec->frames / dt);
+        printf(".\n");
+    }
+    free(spec);
+}
+
+/* ============================================== *
+ * 1. Signal Analyzer: Event detection            *
+ * ============================================== */
+
+/* Finds events in the sample store in one pass:                            *
+ *  - Edges: a Schmitt trigger with thresholds lo < hi.  The signal goes    *
+ *    high when it reaches hi and low again only when it falls to lo.       *
+ *    Each edge is timed at the interpolated threshold crossing; the rise   *
+ *    (fall) time runs from the lo (hi) crossing to the hi (lo) crossing,   *
+ *    so thresholds at 10% / 90% of the swing give the classic figure.     *
+ *  - Glitches: a pulse of either polarity narrower than glitch_width       *
+ *    samples is reported as one glitch instead of two edges.               *
+ *  - Dropouts: at least dropout_min consecutive samples with              *
+ *    |x| <= dropout_level (loss of signal).                                *
+ * Almost all samples change nothing, so the scan tests 8 samples at a time *
+ * with SSE2 compares against only the conditions that could fire in the    *
+ * current state, and steps sample by sample only through blocks whose      *
+ * movemask is non-zero.  Transition times are found afterwards by scanning  *
+ * back from the crossing, never further than the previous edge.  At most   *
+ * SA_EVT_MAX_STORED events are kept (in time order); counts and the        *
+ * transition-time summary cover every event.                               */
+
+#define SA_EVT_MAX_STORED     (1 << 20)
+#define SA_EVT_SHOWN          20              /* events listed on screen */
+
+typedef struct {
+    const double            *x;
+    size_t                   n;
+    const SignalEventConfig *cfg;
+    SignalEventList         *out;
+    int         high;                         /* Schmitt trigger output */
+    size_t      last_edge;                    /* sample index of the previous edge */
+    int         in_drop;
+    size_t      drop_start;
+    int         pending;                      /* an edge waiting to see if it starts a glitch */
+    SignalEvent edge;
+    int         status;
+} SaEvtScan;
+
+void sa_events_free(SignalEventList *ev)
+{
+    free(ev->events);
+    memset(ev, 0, sizeof(*ev));
+}
+/* Span statistics: min / max / mean over [start, end) */
+static void sa_evt_span(const double *x, SignalEvent *e)
+{
+    EtkStats st;
+    size_t len = (e->end > e->start) ? (size_t)(e->end - e->start) : 1;
+    etk_stats(x + e->start, len, &st);
+    e->min  = st.min;
+    e->max  = st.max;
+    e->mean = st.mean;
+}
+static void sa_evt_store(SaEvtScan *s, const SignalEvent *e)
+{
+    SignalEventList *ev = s->out;
+
+    ev->total[e->kind]++;
+    if (e->kind <= SA_EVT_FALL && e->duration == e->duration) {
+        int k = e->kind;                                /* rise / fall time summary */
+        if (ev->trans_n[k] == 0 || e->duration < ev->trans_min[k]) ev->trans_min[k] = e->duration;
+        if (ev->trans_n[k] == 0 || e->duration > ev->trans_max[k]) ev->trans_max[k] = e->duration;
+        ev->trans_sum[k] += e->duration;
+        ev->trans_n[k]++;
+    }
+    if (ev->count >= SA_EVT_MAX_STORED) {
+        ev->dropped++;
+        return;
+    }
+    if (ev->count == ev->cap) {
+        size_t cap = ev->cap ? ev->cap * 2 : 1024;
+        SignalEvent *grown = realloc(ev->events, cap * sizeof(SignalEvent));
+        if (!grown) {
+            s->status = SA_ERR_MEMORY;
+            ev->dropped++;
+            return;
+        }
+        ev->events = grown;
+        ev->cap    = cap;
+    }
+    ev->events[ev->count] = *e;
+    sa_evt_span(s->x, &ev->events[ev->count]);
+    ev->count++;
+}
+/* Fractional index where x crosses level between samples i - 1 and i */
+static double sa_evt_cross(const double *x, size_t i, double level)
+{
+    if (i == 0 || x[i] == x[i - 1]) {
+        return (double)i;
+    }
+    double f = (level - x[i - 1]) / (x[i] - x[i - 1]);
+    if (!(f >= 0.0 && f <= 1.0)) f = 1.0;
+    return (double)(i - 1) + f;
+}
+static void sa_evt_edge(SaEvtScan *s, size_t i, int rising)
+{
+    const double *x = s->x;
+    const double lo = s->cfg->lo, hi = s->cfg->hi;
+    SignalEvent e;
+
+    memset(&e, 0, sizeof(e));
+    e.kind     = rising ? SA_EVT_RISE : SA_EVT_FALL;
+    e.polarity = rising ? 1 : -1;
+    e.time     = sa_evt_cross(x, i, rising ? hi : lo);
+    e.end      = (long long)i + 1;
+    e.duration = NAN;                                   /* unknown if the start is not seen */
+
+    /* Back to where the transition left the other threshold */
+    size_t j = i;
+    while (j > s->last_edge && (rising ? x[j - 1] > lo : x[j - 1] < hi)) {
+        j--;
+    }
+    e.start = (long long)(j > 0 ? j - 1 : 0);
+    if (j > s->last_edge) {
+        e.duration = e.time - sa_evt_cross(x, j, rising ? lo : hi);
+    }
+    s->last_edge = i;
+
+    if (s->pending) {
+        double width = e.time - s->edge.time;
+        if (s->cfg->glitch_width > 0.0 && width < s->cfg->glitch_width) {
+            SignalEvent g = s->edge;                    /* previous edge + this one */
+            g.kind     = SA_EVT_GLITCH;
+            g.end      = e.end;
+            g.duration = width;
+            s->pending = 0;
+            sa_evt_store(s, &g);
+            return;
+        }
+        sa_evt_store(s, &s->edge);
+    }
+    s->edge    = e;
+    s->pending = 1;
+}
+static void sa_evt_dropout_end(SaEvtScan *s, size_t i)
+{
+    s->in_drop = 0;
+    if ((long long)(i - s->drop_start) < s->cfg->dropout_min) {
+        return;
+    }
+    SignalEvent e;
+    memset(&e, 0, sizeof(e));
+    e.kind     = SA_EVT_DROPOUT;
+    e.start    = (long long)s->drop_start;
+    e.end      = (long long)i;
+    e.time     = (double)s->drop_start;
+    e.duration = (double)(i - s->drop_start);
+    s->out->dropout_samples += (long long)(i - s->drop_start);
+    sa_evt_store(s, &e);
+}
+/* The state machine, one sample */
+static inline void sa_evt_step(SaEvtScan *s, size_t i)
+{
+    double v = s->x[i];
+
+    if (!s->high) {
+        if (v >= s->cfg->hi) {
+            s->high = 1;
+            sa_evt_edge(s, i, 1);
+        }
+    } else if (v <= s->cfg->lo) {
+        s->high = 0;
+        sa_evt_edge(s, i, 0);
+    }
+    if (s->cfg->dropout_min > 0) {
+        if (!s->in_drop) {
+            if (fabs(v) <= s->cfg->dropout_level) {
+                s->in_drop = 1;
+                s->drop_start = i;
+            }
+        } else if (fabs(v) > s->cfg->dropout_level) {
+            sa_evt_dropout_end(s, i);
+        }
+    }
+}
+static int sa_evt_by_start(const void *a, const void *b)
+{
+    const SignalEvent *ea = a, *eb = b;
+    return (ea->start > eb->start) - (ea->start < eb->start);
+}
+int sa_ctx_events(SignalContext *ctx, const SignalEventConfig *cfg, SignalEventList *out)
+{
+    const SignalStats *sig = &ctx->sig;
+    SaEvtScan s;
+
+    memset(out, 0, sizeof(*out));
+    if (!(cfg->lo < cfg->hi) || cfg->glitch_width < 0.0 || cfg->dropout_min < 0 ||
+        (cfg->dropout_min > 0 && !(cfg->dropout_level >= 0.0))) {
+        return SA_ERR_FORMAT;
+    }
+    if (sig->count <= 0) {
+        return SA_ERR_EMPTY;
+    }
+
+    memset(&s, 0, sizeof(s));
+    s.x    = sig->samples;
+    s.n    = (size_t)sig->count;
+    s.cfg  = cfg;
+    s.out  = out;
+    s.high = (s.x[0] >= cfg->hi);                /* starting level is not an edge */
+    s.status = SA_OK;
+
+    const int drop_on = (cfg->dropout_min > 0);
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d vlo = _mm_set1_pd(cfg->lo), vhi = _mm_set1_pd(cfg->hi);
+    const __m128d vdl = _mm_set1_pd(drop_on ? cfg->dropout_level : 0.0);
+    const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    for (; i + 8 <= s.n; i += 8) {
+        const double *p = s.x + i;
+        __m128d a = _mm_loadu_pd(p),     b = _mm_loadu_pd(p + 2);
+        __m128d c = _mm_loadu_pd(p + 4), d = _mm_loadu_pd(p + 6);
+        __m128d m;
+        if (s.high) {
+            m = _mm_or_pd(_mm_or_pd(_mm_cmple_pd(a, vlo), _mm_cmple_pd(b, vlo)),
+                          _mm_or_pd(_mm_cmple_pd(c, vlo), _mm_cmple_pd(d, vlo)));
+        } else {
+            m = _mm_or_pd(_mm_or_pd(_mm_cmpge_pd(a, vhi), _mm_cmpge_pd(b, vhi)),
+                          _mm_or_pd(_mm_cmpge_pd(c, vhi), _mm_cmpge_pd(d, vhi)));
+        }
+        if (drop_on) {
+            a = _mm_and_pd(a, abs_mask);
+            b = _mm_and_pd(b, abs_mask);
+            c = _mm_and_pd(c, abs_mask);
+            d = _mm_and_pd(d, abs_mask);
+            if (s.in_drop) {
+                m = _mm_or_pd(m, _mm_or_pd(_mm_or_pd(_mm_cmpgt_pd(a, vdl), _mm_cmpgt_pd(b, vdl)),
+                                           _mm_or_pd(_mm_cmpgt_pd(c, vdl), _mm_cmpgt_pd(d, vdl))));
+            } else {
+                m = _mm_or_pd(m, _mm_or_pd(_mm_or_pd(_mm_cmple_pd(a, vdl), _mm_cmple_pd(b, vdl)),
+                                           _mm_or_pd(_mm_cmple_pd(c, vdl), _mm_cmple_pd(d, vdl))));
+            }
+        }
+        if (_mm_movemask_pd(m) == 0) {
+            continue;                               /* nothing can happen in these 8 */
+        }
+        for (size_t k = i; k < i + 8; k++) {
+            sa_evt_step(&s, k);
+        }
+    }
+#endif
+    for (; i < s.n; i++) {
+        sa_evt_step(&s, i);
+    }
+    if (s.in_drop) {
+        sa_evt_dropout_end(&s, s.n);
+    }
+    if (s.pending) {
+        sa_evt_store(&s, &s.edge);
+    }
+
+    /* Edges are held back one step for the glitch test, so dropouts can be *
+     * stored ahead of an earlier edge.                                      */
+    qsort(out->events, out->count, sizeof(SignalEvent), sa_evt_by_start);
+    out->samples = (long long)s.n;
+    if (s.status != SA_OK) {
+        sa_events_free(out);
+    }
+    return s.status;
+}
+int sa_events_save(const SignalEventList *ev, double sample_rate, const char *filename)
+{
+    static const char *const names[SA_EVT_KINDS] = { "rise", "fall", "glitch", "dropout" };
+    const double scale = (sample_rate > 0.0) ? 1.0 / sample_rate : 1.0;
+    SaOutBuf out = { 0 };
+
+    if (!sa_out_open(&out, filename)) {
+        return SA_ERR_OPEN;
+    }
+    sa_out_str(&out, (sample_rate > 0.0) ? "kind,start_sample,end_sample,time_s,duration_s,min,max,mean\n"
+                                         : "kind,start_sample,end_sample,time,duration,min,max,mean\n");
+    for (size_t k = 0; k < ev->count; k++) {
+        const SignalEvent *e = &ev->events[k];
+        sa_out_str(&out, names[e->kind]);
+        if (e->kind == SA_EVT_GLITCH) {
+            sa_out_str(&out, (e->polarity > 0) ? "-high" : "-low");
+        }
+        sa_out_char(&out, ',');
+        sa_out_int(&out, e->start);
+        sa_out_char(&out, ',');
+        sa_out_int(&out, e->end);
+        sa_out_char(&out, ',');
+        sa_out_general(&out, e->time * scale, 12);
+        sa_out_char(&out, ',');
+        if (e->duration == e->duration) {                   /* empty when the start was not seen */
+            sa_out_general(&out, e->duration * scale, 9);
+        }
+        sa_out_char(&out, ',');
+        sa_out_general(&out, e->min, 9);
+        sa_out_char(&out, ',');
+        sa_out_general(&out, e->max, 9);
+        sa_out_char(&out, ',');
+        sa_out_general(&out, e->mean, 9);
+        sa_out_char(&out, '\n');
+    }
+    int ok = sa_out_close(&out);
+    sa_out_release(&out);
+    return ok ? SA_OK : SA_ERR_OPEN;
+}
+void sa_detect_events(void)
+{
+    static const char *const names[SA_EVT_KINDS] = { "Rise", "Fall", "Glitch", "Dropout" };
+    const char *filename = "signal_events.csv";
+    SignalEventConfig cfg;
+    SignalEventList ev;
+
+    printf("\n[Event detection]  Schmitt-trigger edges with rise/fall times, glitches and dropouts\n");
+    cfg.lo = uc_get_double("Low threshold (signal goes low at or below): ");
+    cfg.hi = uc_get_double("High threshold (signal goes high at or above): ");
+    cfg.glitch_width  = uc_get_double("Glitch: pulses narrower than N samples (0 = off): ");
+    cfg.dropout_min   = uc_get_int_in("Dropout: at least N samples near zero (0 = off): ", 0, INT_MAX);
+    cfg.dropout_level = 0.0;
+    if (cfg.dropout_min > 0) {
+        cfg.dropout_level = uc_get_double("Dropout level (|x| at or below counts as no signal): ");
+    }
+    double rate = uc_get_double("Sample rate in Hz (0 if unknown): ");
+    if (!(rate > 0.0) || !isfinite(rate)) rate = 0.0;
+    const double scale = (rate > 0.0) ? 1.0 / rate : 1.0;
+    const char *unit = (rate > 0.0) ? " s" : " samples";
+
+    double t0 = sa_live_now();
+    int status = sa_ctx_events(&g_sa_ctx, &cfg, &ev);
+    double dt = sa_live_now() - t0;
+    if (status == SA_ERR_FORMAT) {
+        printf("The low threshold must be below the high one, and the widths must not be negative.\n");
+        return;
+    } else if (status == SA_ERR_EMPTY) {
+        printf("\nNo samples available. "
+               "Please enter samples (option 1) or load from file (option 2) first.\n");
+        return;
+    } else if (status != SA_OK) {
+        printf("Error: Out of memory while recording events.\n");
+        return;
+    }
+
+    printf("\nScanned %lld samples in %.4f s", ev.samples, dt);
+    if (dt > 0.0) printf(" (%.2f GB/s)", ev.samples * (double)sizeof(double) / dt / 1e9);
+    printf("\n");
+    for (int k = 0; k < SA_EVT_KINDS; k++) {
+        printf("  %-8s: %lld\n", names[k], ev.total[k]);
+    }
+    for (int k = 0; k < 2; k++) {
+        if (ev.trans_n[k] > 0) {
+            printf("  %s time: min %.6g, mean %.6g, max %.6g%s\n", k ? "Fall" : "Rise",
+                   ev.trans_min[k] * scale, ev.trans_sum[k] / ev.trans_n[k] * scale,
+                   ev.trans_max[k] * scale, unit);
+        }
+    }
+    if (ev.total[SA_EVT_DROPOUT] > 0) {
+        printf("  Time in dropouts: %.6g%s\n", ev.dropout_samples * scale, unit);
+    }
+
+    if (ev.count > 0) {
+        printf("\n%-12s %14s %14s %12s %12s %12s\n", "Event", "Time", "Duration", "Min", "Max", "Mean");
+        for (size_t k = 0; k < ev.count && k < SA_EVT_SHOWN; k++) {
+            const SignalEvent *e = &ev.events[k];
+            char kind[16];
+            snprintf(kind, sizeof(kind), "%s%s", names[e->kind],
+                     (e->kind == SA_EVT_GLITCH) ? ((e->polarity > 0) ? " high" : " low") : "");
+            printf("%-12s %14.6g ", kind, e->time * scale);
+            if (e->duration == e->duration) {
+                printf("%14.6g ", e->duration * scale);
+            } else {
+                printf("%14s ", "-");
+            }
+            printf("%12.6g %12.6g %12.6g\n", e->min, e->max, e->mean);
+        }
+        if (ev.count > SA_EVT_SHOWN) {
+            printf("... %zu more\n", ev.count - SA_EVT_SHOWN);
+        }
+        if (sa_events_save(&ev, rate, filename) == SA_OK) {
+            printf("\n%zu events saved to '%s'", ev.count, filename);
+            if (ev.dropped > 0) printf(" (%lld more counted but not kept)", ev.dropped);
+            printf(".\n");
+        } else {
+            printf("\nError: Could not write '%s'.\n", filename);
+        }
+    } else {
+        printf("\nNo events found.\n");
+    }
+    sa_events_free(&ev);
+}
+
+/* ============================================== *
+ * 1. Signal Analyzer: Cross-correlation          *
+ * ============================================== */
+
+/* Compares the loaded samples (capture A) with a second capture B held in   *
+ * its own context.                                                          *
+ *  - Cross-correlation for lags -max_lag..max_lag, computed by blocks       *
+ *    (overlap-save): each block of B_len samples of A is correlated with    *
+ *    the stretch of B that reaches max_lag either side, through FFTs of     *
+ *    M >= 4 * max_lag points.  Memory is O(M) per thread whatever the       *
+ *    capture length (threads are limited to SA_XC_MEM_BUDGET in total),    *
+ *    and the cost is O(N log M) instead of O(N * max_lag).                  *
+ *    A and B go through one complex FFT (A real, B imaginary) and are       *
+ *    separated by symmetry; the inverse is a forward FFT of the conjugate.  *
+ *    Blocks are shared out to threads, each summing its own lag array.      *
+ *  - The means are removed and the result divided by sqrt(ΣA² ΣB²), so     *
+ *    the values are correlation coefficients.  The delay is the lag of the  *
+ *    largest |r|, refined by a parabola through its neighbours.             *
+ *  - Magnitude-squared coherence |Pab|² / (Paa Pbb) by Welch's method,     *
+ *    after shifting B by the peak lag (a delay near the segment length     *
+ *    would otherwise hide the coherence): Hann segments with 50% overlap,   *
+ *    spectra summed per thread and merged.                                 */
+
+#define SA_XC_MAX_LAG         (1 << 18)       /* FFT length M <= 2^21: 64 MiB of work space */
+#define SA_XC_MEM_BUDGET      (256 << 20)     /* bytes of per-thread work space, all threads */
+#define SA_XC_MIN_FFT         16384
+#define SA_XC_MAX_THREADS     16
+#define SA_XC_BANDS           16              /* coherence bars on screen */
+
+static SignalContext g_sa_ref;                /* capture B */
+
+typedef struct {
+    const double *a, *b;
+    long long     na, nb;
+    double        mean_a, mean_b;
+    const SaFftPlan *plan;
+    long long     block;                      /* samples of A per block */
+    long long     nblocks;
+    int           max_lag;
+    atomic_llong *next;                       /* next block / segment to take */
+    double       *re, *im;                    /* plan->n each */
+    double       *acc;                        /* xcorr: 2 max_lag + 1 lags; coherence: 4 per bin */
+    const double *hann;                       /* coherence only */
+} SaXcJob;
+
+/* Z = FFT(a + ib) in re/im -> conj(A[k]) B[k] */
+static inline void sa_xc_cross(const double *re, const double *im, int n, int k,
+                               double *pr, double *pi, double *paa, double *pbb)
+{
+    int j = (n - k) & (n - 1);
+    double ar = 0.5 * (re[k] + re[j]), ai = 0.5 * (im[k] - im[j]);      /* (Z[k] + conj Z[-k]) / 2  */
+    double br = 0.5 * (im[k] + im[j]), bi = 0.5 * (re[j] - re[k]);      /* (Z[k] - conj Z[-k]) / 2i */
+    *pr = ar * br + ai * bi;
+    *pi = ar * bi - ai * br;
+    if (paa) *paa = ar * ar + ai * ai;
+    if (pbb) *pbb = br * br + bi * bi;
+}
+static void *sa_xc_corr_thread(void *arg)
+{
+    SaXcJob *job = arg;
+    const int M = job->plan->n, L = job->max_lag;
+    const int *rev = job->plan->rev;
+    double *re = job->re, *im = job->im;
+
+    for (;;) {
+        long long blk = atomic_fetch_add(job->next, 1);
+        if (blk >= job->nblocks) {
+            break;
+        }
+        long long s = blk * job->block;
+        for (int m = 0; m < M; m++) {            /* A block zero-padded, B from s - L */
+            long long ia = s + m, ib = s - L + m;
+            re[rev[m]] = (m < job->block && ia < job->na) ? job->a[ia] - job->mean_a : 0.0;
+            im[rev[m]] = (ib >= 0 && ib < job->nb) ? job->b[ib] - job->mean_b : 0.0;
+        }
+        sa_fft_run(job->plan, re, im);
+
+        /* conj(A) B for every bin, conjugated and permuted for the inverse */
+        double *pr = job->re + M, *pi = job->im + M;
+        for (int k = 0; k < M; k++) {
+            sa_xc_cross(re, im, M, k, &pr[k], &pi[k], NULL, NULL);
+        }
+        for (int k = 0; k < M; k++) {
+            re[rev[k]] =  pr[k];
+            im[rev[k]] = -pi[k];
+        }
+        sa_fft_run(job->plan, re, im);
+        for (int k = 0; k <= 2 * L; k++) {
+            job->acc[k] += re[k];
+        }
+    }
+    return NULL;
+}
+static void *sa_xc_coh_thread(void *arg)
+{
+    SaXcJob *job = arg;
+    const int W = job->plan->n, half = W / 2;
+    const int *rev = job->plan->rev;
+    double *re = job->re, *im = job->im;
+
+    for (;;) {
+        long long seg = atomic_fetch_add(job->next, 1);
+        if (seg >= job->nblocks) {
+            break;
+        }
+        const double *a = job->a + seg * job->block, *b = job->b + seg * job->block;
+        for (int m = 0; m < W; m++) {
+            re[rev[m]] = (a[m] - job->mean_a) * job->hann[m];
+            im[rev[m]] = (b[m] - job->mean_b) * job->hann[m];
+        }
+        sa_fft_run(job->plan, re, im);
+        for (int k = 0; k <= half; k++) {
+            double pr, pi, paa, pbb;
+            sa_xc_cross(re, im, W, k, &pr, &pi, &paa, &pbb);
+            double *acc = job->acc + 4 * (size_t)k;
+            acc[0] += paa;
+            acc[1] += pbb;
+            acc[2] += pr;
+            acc[3] += pi;
+        }
+    }
+    return NULL;
+}
+/* Run fn on nthreads jobs (job[0] on this thread), sum each job's acc into job[0] */
+static void sa_xc_parallel(void *(*fn)(void *), SaXcJob *job, int nthreads, size_t nacc)
+{
+    pthread_t tid[SA_XC_MAX_THREADS];
+    int created[SA_XC_MAX_THREADS] = { 0 };
+
+    for (int t = 1; t < nthreads; t++) {
+        created[t] = (pthread_create(&tid[t], NULL, fn, &job[t]) == 0);
+    }
+    fn(&job[0]);                              /* also takes the work of threads that failed to start */
+    for (int t = 1; t < nthreads; t++) {
+        if (!created[t]) continue;
+        pthread_join(tid[t], NULL);
+        for (size_t k = 0; k < nacc; k++) {
+            job[0].acc[k] += job[t].acc[k];
+        }
+    }
+}
+/* Threads for `work` units, and one job each with an FFT work area and acc */
+static SaXcJob *sa_xc_jobs(const SaXcJob *proto, long long work, size_t nacc, int *nthreads_out)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = (cores > 1) ? (int)cores : 1;
+    if (nthreads > SA_XC_MAX_THREADS) nthreads = SA_XC_MAX_THREADS;
+    if (nthreads > work) nthreads = (int)work;
+    if (nthreads < 1) nthreads = 1;
+
+    size_t n = (size_t)proto->plan->n;
+    size_t per_thread = (4 * n + nacc) * sizeof(double);
+    if ((size_t)nthreads * per_thread > SA_XC_MEM_BUDGET) {
+        nthreads = (int)(SA_XC_MEM_BUDGET / per_thread);   /* long lags: fewer threads */
+        if (nthreads < 1) nthreads = 1;
+    }
+    SaXcJob *job = calloc((size_t)nthreads, sizeof(SaXcJob));
+    double *mem = calloc((size_t)nthreads * (4 * n + nacc), sizeof(double));
+    if (!job || !mem) {
+        free(job);
+        free(mem);
+        return NULL;
+    }
+    for (int t = 0; t < nthreads; t++) {
+        double *base = mem + (size_t)t * (4 * n + nacc);
+        job[t]     = *proto;
+        job[t].re  = base;                    /* re[0..n) + spare [n..2n) */
+        job[t].im  = base + 2 * n;
+        job[t].acc = base + 4 * n;
+    }
+    *nthreads_out = nthreads;
+    return job;
+}
+static void sa_xc_jobs_free(SaXcJob *job)
+{
+    if (job) {
+        free(job[0].re);
+        free(job);
+    }
+}
+void sa_xcorr_free(SignalXcorr *xc)
+{
+    free(xc->r);
+    free(xc->coherence);
+    memset(xc, 0, sizeof(*xc));
+}
+int sa_ctx_xcorr(SignalContext *a, SignalContext *b, int max_lag, int segment, SignalXcorr *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (max_lag < 0 || max_lag > SA_XC_MAX_LAG ||
+        segment < SA_STFT_MIN_WINDOW || segment > SA_STFT_MAX_WINDOW || (segment & (segment - 1)) != 0) {
+        return SA_ERR_FORMAT;
+    }
+    if (sa_ctx_calculate(a) != SA_OK || sa_ctx_calculate(b) != SA_OK) {
+        return SA_ERR_EMPTY;
+    }
+
+    const SignalStats *sa = &a->sig, *sb = &b->sig;
+    SaXcJob proto;
+    SaFftPlan plan;
+    int nthreads, status = SA_OK;
+
+    memset(&proto, 0, sizeof(proto));
+    proto.a = sa->samples;
+    proto.b = sb->samples;
+    proto.na = sa->count;
+    proto.nb = sb->count;
+    proto.mean_a = sa->mean;
+    proto.mean_b = sb->mean;
+    proto.max_lag = max_lag;
+
+    /* --- Cross-correlation --- */
+    int M = SA_XC_MIN_FFT;
+    while (M < 4 * max_lag + 2) M <<= 1;
+    if (!sa_fft_plan_init(&plan, M)) {
+        return SA_ERR_MEMORY;
+    }
+    atomic_llong next;
+    atomic_init(&next, 0);
+    proto.plan    = &plan;
+    proto.next    = &next;
+    proto.block   = M - 2 * max_lag;
+    proto.nblocks = (proto.na + proto.block - 1) / proto.block;
+
+    size_t nlags = 2 * (size_t)max_lag + 1;
+    SaXcJob *job = sa_xc_jobs(&proto, proto.nblocks, nlags, &nthreads);
+    out->r = malloc(nlags * sizeof(double));
+    if (!job || !out->r) {
+        status = SA_ERR_MEMORY;
+    } else {
+        sa_xc_parallel(sa_xc_corr_thread, job, nthreads, nlags);
+
+        double ea = sa->sum_sq - sa->count * sa->mean * sa->mean;      /* Σ(a - mean)² */
+        double eb = sb->sum_sq - sb->count * sb->mean * sb->mean;
+        double norm = (ea > 0.0 && eb > 0.0) ? 1.0 / (sqrt(ea * eb) * M) : 0.0;
+        size_t peak = 0;
+        for (size_t k = 0; k < nlags; k++) {
+            out->r[k] = job[0].acc[k] * norm;
+            if (fabs(out->r[k]) > fabs(out->r[peak])) peak = k;
+        }
+        out->max_lag   = max_lag;
+        out->peak_lag  = (int)peak - max_lag;
+        out->peak_r    = out->r[peak];
+        out->delay     = out->peak_lag;
+        if (peak > 0 && peak + 1 < nlags) {
+            double y0 = fabs(out->r[peak - 1]), y1 = fabs(out->r[peak]), y2 = fabs(out->r[peak + 1]);
+            double den = y0 - 2.0 * y1 + y2;
+            if (den < 0.0) out->delay += 0.5 * (y0 - y2) / den;
+        }
+    }
+    sa_xc_jobs_free(job);
+    sa_fft_plan_free(&plan);
+
+    /* --- Coherence, with B shifted by the peak lag so the segments line up --- */
+    long long lag   = out->peak_lag;
+    long long first = (lag < 0) ? -lag : 0;
+    long long last  = (proto.nb - lag < proto.na) ? proto.nb - lag : proto.na;
+    long long common = (last > first) ? last - first : 0;
+    proto.a = sa->samples + first;
+    proto.b = sb->samples + first + lag;
+    double *hann = malloc((size_t)segment * sizeof(double));
+    if (status == SA_OK && common >= segment && hann && sa_fft_plan_init(&plan, segment)) {
+        const int half = segment / 2;
+        for (int i = 0; i < segment; i++) {
+            hann[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / segment);
+        }
+        atomic_init(&next, 0);
+        proto.plan    = &plan;
+        proto.block   = half;                                  /* hop: 50% overlap */
+        proto.nblocks = (common - segment) / half + 1;
+        proto.hann    = hann;
+
+        size_t nacc = 4 * (size_t)(half + 1);
+        job = sa_xc_jobs(&proto, proto.nblocks, nacc, &nthreads);
+        out->coherence = malloc((size_t)(half + 1) * sizeof(double));
+        if (!job || !out->coherence) {
+            status = SA_ERR_MEMORY;
+        } else {
+            sa_xc_parallel(sa_xc_coh_thread, job, nthreads, nacc);
+            double sum = 0.0;
+            for (int k = 0; k <= half; k++) {
+                const double *acc = job[0].acc + 4 * (size_t)k;
+                double den = acc[0] * acc[1];
+                out->coherence[k] = (den > 0.0) ? (acc[2] * acc[2] + acc[3] * acc[3]) / den : 0.0;
+                if (k > 0 && k < half) sum += out->coherence[k];
+            }
+            out->segment        = segment;
+            out->bins           = half + 1;
+            out->segments       = proto.nblocks;
+            out->mean_coherence = sum / (half - 1);
+        }
+        sa_xc_jobs_free(job);
+        sa_fft_plan_free(&plan);
+    } else if (status == SA_OK && common >= segment) {
+        status = SA_ERR_MEMORY;
+    }
+    free(hann);
+
+    if (status != SA_OK) {
+        sa_xcorr_free(out);
+    }
+    return status;
+}
+int sa_xcorr_save(const SignalXcorr *xc, double sample_rate, const char *xcorr_file, const char *coh_file)
+{
+    SaOutBuf out = { 0 };
+    int ok = 1;
+
+    if (!sa_out_open(&out, xcorr_file)) {
+        return SA_ERR_OPEN;
+    }
+    sa_out_str(&out, "lag,correlation\n");
+    for (int k = 0; k <= 2 * xc->max_lag; k++) {
+        sa_out_int(&out, k - xc->max_lag);
+        sa_out_char(&out, ',');
+        sa_out_general(&out, xc->r[k], 9);
+        sa_out_char(&out, '\n');
+    }
+    ok = sa_out_close(&out);
+
+    if (ok && xc->coherence && coh_file) {
+        if (!sa_out_open(&out, coh_file)) {
+            sa_out_release(&out);
+            return SA_ERR_OPEN;
+        }
+        sa_out_str(&out, (sample_rate > 0.0) ? "frequency_hz,coherence\n" : "bin,coherence\n");
+        for (int k = 0; k < xc->bins; k++) {
+            if (sample_rate > 0.0) {
+                sa_out_general(&out, k * sample_rate / xc->segment, 9);
+            } else {
+                sa_out_int(&out, k);
+            }
+            sa_out_char(&out, ',');
+            sa_out_general(&out, xc->coherence[k], 6);
+            sa_out_char(&out, '\n');
+        }
+        ok = sa_out_close(&out);
+    }
+    sa_out_release(&out);
+    return ok ? SA_OK : SA_ERR_OPEN;
+}
+void sa_cross_correlate(void)
+{
+    const char *xcorr_file = "signal_xcorr.csv", *coh_file = "signal_coherence.csv";
+    char name[256];
+    SignalXcorr xc;
+
+    if (g_sa_ctx.sig.count <= 0) {
+        printf("\nNo samples available. "
+               "Please enter samples (option 1) or load from file (option 2) first.\n");
+        return;
+    }
+    printf("\n[Cross-correlation]  A = the loaded samples (%d), B = a second capture\n", g_sa_ctx.sig.count);
+    if (g_sa_ref.sig.count > 0) {
+        printf("B is '%s' (%d samples); press Enter to keep it.\n", g_sa_ref.source, g_sa_ref.sig.count);
+    }
+    if (!ec_read_line("Capture B file: ", name, sizeof(name))) {
+        return;
+    }
+    if (name[0] != '\0' || g_sa_ref.sig.count <= 0) {
+        int status = sa_ctx_load_file(&g_sa_ref, name);
+        if (status != SA_OK) {
+            printf("\nError: Could not load samples from '%s'.\n", name);
+            sa_signal_clear(&g_sa_ref.sig);
+            return;
+        }
+        printf("Loaded %d samples into B.\n", g_sa_ref.sig.count);
+    }
+
+    int max_lag = (int)uc_get_int_in("Largest lag to search, in samples (e.g. 1000): ", 0, SA_XC_MAX_LAG);
+    int segment = (int)uc_get_int_in("Coherence segment length (power of two, e.g. 1024): ",
+                                     SA_STFT_MIN_WINDOW, SA_STFT_MAX_WINDOW);
+    double rate = uc_get_double("Sample rate in Hz (0 if unknown): ");
+    if (!(rate > 0.0) || !isfinite(rate)) rate = 0.0;
+
+    double t0 = sa_live_now();
+    int status = sa_ctx_xcorr(&g_sa_ctx, &g_sa_ref, max_lag, segment, &xc);
+    double dt = sa_live_now() - t0;
+    if (status == SA_ERR_FORMAT) {
+        printf("The lag must be 0-%d and the segment a power of two from %d to %d.\n",
+               SA_XC_MAX_LAG, SA_STFT_MIN_WINDOW, SA_STFT_MAX_WINDOW);
+        return;
+    } else if (status != SA_OK) {
+        printf("Error: Out of memory while correlating.\n");
+        return;
+    }
+
+    printf("\nCross-correlation over lags %+d..%+d (%.3f s):\n", -max_lag, max_lag, dt);
+    printf("  Peak correlation : %.6f at lag %+d\n", xc.peak_r, xc.peak_lag);
+    printf("  Delay of B vs A  : %+.3f samples", xc.delay);
+    if (rate > 0.0) printf(" (%+.6g s)", xc.delay / rate);
+    printf("%s\n", (xc.peak_r < 0.0) ? "  (B is inverted)" : "");
+    if (xc.peak_lag == max_lag || xc.peak_lag == -max_lag) {
+        printf("  The peak is at the edge of the search: try a larger lag.\n");
+    }
+
+    if (xc.coherence) {
+        printf("\nCoherence with B aligned at lag %+d (%lld segments of %d, 50%% overlap), mean %.4f\n\n",
+               xc.peak_lag, xc.segments, xc.segment, xc.mean_coherence);
+        int bands = (xc.bins - 1 < SA_XC_BANDS) ? xc.bins - 1 : SA_XC_BANDS;
+        for (int band = 0; band < bands; band++) {
+            int k0 = 1 + band * (xc.bins - 1) / bands, k1 = 1 + (band + 1) * (xc.bins - 1) / bands;
+            double c = 0.0;
+            for (int k = k0; k < k1; k++) c += xc.coherence[k];
+            c /= (k1 - k0);
+            int bar = (int)(c * 40.0 + 0.5);
+            if (rate > 0.0) {
+                printf("%10.1f Hz ", (k0 + k1 - 1) / 2.0 * rate / xc.segment);
+            } else {
+                printf("bin %6d  ", (k0 + k1 - 1) / 2);
+            }
+            for (int j = 0; j < 40; j++) {
+                putchar(j < bar ? '#' : ' ');
+            }
+            printf(" %.3f\n", c);
+        }
+    } else {
+        printf("\nCoherence needs at least %d overlapping samples once B is aligned.\n", segment);
+    }
+
+    if (sa_xcorr_save(&xc, rate, xcorr_file, coh_file) == SA_OK) {
+        printf("\nCorrelation saved to '%s'%s.\n", xcorr_file,
+               xc.coherence ? ", coherence to 'signal_coherence.csv'" : "");
+    } else {
+        printf("\nError: Could not write the results.\n");
+    }
+    sa_xcorr_free(&xc);
+}
+
+/* ========================== *
+ * 5. Unit Converter Module   *
+ * ========================== */
+
+/* Provides several common engineering unit conversions:   *
+ *  1) dBm ↔ mW     (RF / power)                           *
+ *  2) Hz  ↔ rad/s  (frequency ↔ angular frequency)        *
+ *  3) °C  ↔ K      (absolute temperature)                 *
+ *  4) °F  ↔ °C     (temperature between scales)           *
+ *  5) V   ↔ dBV    (voltage level in dBV reference)       *
+ * The formulas live in electoolkit.c (etk_dbm_to_mw, ...).  */
+
+void menu_unit_converter(void)
+{
+    int running = 1;
+
+    while (running) {
+        uc_print_menu();
+        int choice = uc_get_choice();
+
+        switch (choice) {
+            case 1: { /* dBm <-> mW */
+                printf("\n1) dBm -> mW\n2) mW -> dBm\n");
+                int dir = uc_get_choice();
+                if (dir == 1) {                        /* dBm to mW: P(mW) = 10^(dBm/10) */
+                    double dbm = uc_get_double("Enter power in dBm: ");
+                    double mw  = etk_dbm_to_mw(dbm);
+                    printf("Result: %.6f mW\n", mw);
+                } else if (dir == 2) {                 /* mW to dBm: dBm = 10·log10(P(mW)), P > 0 */
+                    double mw = 0.0;
+                    do {
+                        mw = uc_get_double("Enter power in mW (> 0): ");
+                        if (mw <= 0.0) {
+                            printf("Power must be > 0 for dBm conversion.\n");
+                        }
+                    } while (mw <= 0.0);
+                    double dbm = etk_mw_to_dbm(mw);
+                    printf("Result: %.6f dBm\n", dbm);
+                }
+                break;
+            }
+            case 2: { /* Hz <-> rad/s */
+                printf("\n1) Hz -> rad/s\n2) rad/s -> Hz\n");
+                int dir = uc_get_choice();
                 if (dir == 1) {                            /* f [Hz] → ω [rad/s]: ω = 2πf */
                     double hz = uc_get_double("Enter frequency in Hz: ");
-                    double rad = 2.0 * M_PI * hz;
+                    double rad = etk_hz_to_rad(hz);
                     printf("Result: %.6f rad/s\n", rad);
                 } else if (dir == 2) {                     /* ω [rad/s] → f [Hz]: f = ω / (2π) */
                     double rad = uc_get_double("Enter angular frequency in rad/s: ");
-                    double hz = rad / (2.0 * M_PI);
+                    double hz = etk_rad_to_hz(rad);
                     printf("Result: %.6f Hz\n", hz);
                 }
                 break;
             }
-            case 3: { /* °C <-> K */
-                printf("\n1) °C -> K\n2) K -> °C\n");
-                int dir = uc_get_choice();
-                if (dir == 1) {                        /* °C to K: K = °C + 273.15 */
-                    double c = uc_get_double("Enter temperature in °C: ");
-                    double k = c + 273.15;
-                    printf("Result: %.2f K\n", k);
-                } else if (dir == 2) {                 /* K to °C: °C = K - 273.15 */
-                    double k = uc_get_double("Enter temperature in K: ");
-                    double c = k - 273.15;
-                    printf("Result: %.2f °C\n", c);
-                }
+            case 3: { /* °C <-> K */
+                printf("\n1) °C -> K\n2) K -> °C\n");
+                int dir = uc_get_choice();
+                if (dir == 1) {                        /* °C to K: K = °C + 273.15 */
+                    double c = uc_get_double("Enter temperature in °C: ");
+                    double k = etk_c_to_k(c);
+                    printf("Result: %.2f K\n", k);
+                } else if (dir == 2) {                 /* K to °C: °C = K - 273.15 */
+                    double k = uc_get_double("Enter temperature in K: ");
+                    double c = etk_k_to_c(k);
+                    printf("Result: %.2f °C\n", c);
+                }
+                break;
+            }
+            case 4: { /* °F <-> °C */
+                printf("\n1) °F -> °C\n2) °C -> °F\n");
+                int dir = uc_get_choice();
+                if (dir == 1) {                           /* °F to °C: °C = (°F − 32)·5/9 */
+                    double f = uc_get_double("Enter temperature in °F: ");
+                    double c = etk_f_to_c(f);
+                    printf("Result: %.2f °C\n", c);
+                } else if (dir == 2) {                    /* °C to °F: °F = °C·9/5 + 32 */
+                    double c = uc_get_double("Enter temperature in °C: ");
+                    double f = etk_c_to_f(c);
+                    printf("Result: %.2f °F\n", f);
+                }
+                break;
+            }
+            case 5: { /* V <-> dBV */
+                printf("\n1) V -> dBV\n2) dBV -> V\n");
+                int dir = uc_get_choice();
+                if (dir == 1) {                          /* V to dBV: dBV = 20·log10(V), V > 0 */
+                    double v = 0.0;
+                    do {
+                        v = uc_get_double("Enter voltage in V (> 0): ");
+                        if (v <= 0.0) {
+                            printf("Voltage must be > 0 for dBV conversion.\n");
+                        }
+                    } while (v <= 0.0);
+                    double dbv = etk_v_to_dbv(v);
+                    printf("Result: %.6f dBV\n", dbv);
+                } else if (dir == 2) {                   /* dBV to V: V = 10^(dBV/20) */
+                    double dbv = uc_get_double("Enter level in dBV: ");
+                    double v = etk_dbv_to_v(dbv);
+                    printf("Result: %.6f V\n", v);
+                }
+                break;
+            }
+            case 6:
+                /* Back to main menu */
+                running = 0;
+                break;
+            default:
+                printf("Unknown option.\n");
+                break;
+        }
+    }
+}
+static void uc_print_menu(void)     /* Print the Unit Converter submenu options. */
+{
+    printf("\n------ Unit Converter ------\n");
+    printf("1. dBm <-> mW\n");
+    printf("2. Hz  <-> rad/s\n");
+    printf("3. °C  <-> K\n");
+    printf("4. °F  <-> °C\n");
+    printf("5. V   <-> dBV\n");
+    printf("6. Back to Main Menu\n");
+    printf("----------------------------\n");
+}
+static int uc_get_choice(void)      /* The same integer-validation logic as the Signal Analyzer */
+{
+    char buf[64];
+    int value = 0;
+
+    for (;;) {
+        printf("Select option: ");
+        if (!fgets(buf, sizeof(buf), stdin)) {
+            printf("\nInput error, returning.\n");
+            return 6;
+        }
+        buf[strcspn(buf, "\r\n")] = '\0';
+
+        if (!sa_is_integer(buf)) {
+            printf("Please enter an integer!\n");
+            continue;
+        }
+
+        value = (int)strtol(buf, NULL, 10);
+        return value;
+    }
+}
+static double uc_get_double(const char *prompt) /* Prompts the user for a floating-point value and validates that the entire input line represents a valid double.*/
+{
+    char buf[64];
+    double value = 0.0;
+
+    while (1) {
+        printf("%s", prompt);
+        if (!fgets(buf, sizeof(buf), stdin)) {
+            printf("\nInput error, using 0.\n");
+            return 0.0;
+        }
+        buf[strcspn(buf, "\r\n")] = '\0';
+
+        char *endptr = NULL;
+        value = strtod(buf, &endptr);
+        if (endptr == buf || *endptr != '\0') {
+            printf("Please enter a valid number.\n");
+            continue;
+        }
+        return value;
+    }
+}
+/* A whole number in [lo, hi].  The range is checked on the double, so NaN, *
+ * inf or 1e30 never reach an integer conversion.  Returns lo on EOF.        */
+static long long uc_get_int_in(const char *prompt, long long lo, long long hi)
+{
+    for (;;) {
+        double v = uc_get_double(prompt);
+        if (v >= (double)lo && v <= (double)hi && v == floor(v)) {
+            return (long long)v;
+        }
+        if (feof(stdin)) {
+            return lo;
+        }
+        printf("Please enter a whole number from %lld to %lld.\n", lo, hi);
+    }
+}
+
+/* ================================== *
+ * 2. ADC / Sensor Converter Module   *
+ * ================================== */
+
+/* Simple ADC + temperature sensor helper:                          *
+ *  1) - ADC code → Voltage      (using VREF and 10-bit ADC 0–1023) *
+ *  2) - Voltage  → Temperature  (LM35 style: 10 mV / °C)           *
+ *  3) - ADC code → Temperature  (combines the two steps above)     */
+void menu_adc_sensor_converter(void)
+{
+    int running = 1;
+
+    while (running) {
+        printf("\n------ ADC / Sensor Converter ------\n");
+        printf("1. ADC code -> Voltage\n");
+        printf("2. Voltage  -> Temperature (°C)\n");
+        printf("3. ADC code -> Temperature (°C)\n");
+        printf("4. Back to Main Menu\n");
+        printf("------------------------------------\n");
+
+        int choice = uc_get_choice();      /* Reuse the integer choice helper from the Unit Converter. */
+
+        switch (choice) {
+
+            /* --- 1. ADC -> Voltage --- */
+            case 1: {
+                int adc = (int)uc_get_double("Enter ADC code (0–1023): ");       /* Assume a 10-bit ADC, codes 0–1023 inclusive. */
+                if (adc < 0 || adc > ETK_ADC_MAX_CODE) {
+                    printf("ADC code must be 0–1023.\n");
+                    break;
+                }
+                double voltage = etk_adc_code_to_voltage(adc, ETK_ADC_VREF, ETK_ADC_MAX_CODE);
+                printf("Voltage = %.4f V\n", voltage);
+                break;
+            }
+
+            /* --- 2. Voltage -> Temperature --- */
+            case 2: {
+                double volt = uc_get_double("Enter voltage in V: ");
+                if (volt < 0) {
+                    printf("Voltage must be >= 0.\n");
+                    break;
+                }
+                double temp = etk_lm35_temp(volt);      /* 10 mV/°C => 0.01 V / °C */
+                printf("Temperature = %.2f °C\n", temp);
+                break;
+            }
+
+            /* --- 3. ADC -> Temperature --- */
+            case 3: {
+                int adc = (int)uc_get_double("Enter ADC code (0–1023): ");
+                if (adc < 0 || adc > ETK_ADC_MAX_CODE) {
+                    printf("ADC code must be 0–1023.\n");
+                    break;
+                }                                       /* First convert ADC code -> voltage, then voltage -> °C */
+                double voltage = etk_adc_code_to_voltage(adc, ETK_ADC_VREF, ETK_ADC_MAX_CODE);
+                double temp = etk_lm35_temp(voltage);
+                printf("Voltage = %.4f V\n", voltage);
+                printf("Temperature = %.2f °C\n", temp);
+                break;
+            }
+
+            case 4:            /* Back to Main Menu */
+                running = 0;
+                break;
+
+            default:
+                printf("Unknown option.\n");
+                break;
+        }
+    }
+}
+
+/* ============================== *
+ * 3. Circuit Calculator Module   *
+ * ============================== */
+
+/* A small collection of analogue circuit formula helpers:     *
+ *  1) RC filter cutoff frequency   fc = 1/(2πRC)              *
+ *  2) Resistive voltage divider    Vout = Vin * R2/(R1+R2)    *
+ *  3) LED current-limit resistor   R = (Vs − Vf) / If         *
+ *  4) Ohm's law helper             V = I·R, I = V/R, R = V/I  *
+ *  5) Capacitor charging curve     V(t) = Vs(1 − e^(-t/RC))   *
+ *  6) Monte Carlo tolerances of 1-3 (yield, distribution)     *
+ *  7) Transient response of an RC/RL/RLC ladder               *
+ *  8) Bode sweep of RC / Butterworth / RLC filters            */
+void menu_circuit_calculator(void)
+{
+    int running = 1;
+
+    while (running) {
+        printf("\n------ Circuit Calculator ------\n");
+        printf("1. RC filter cutoff frequency\n");
+        printf("2. Voltage divider\n");
+        printf("3. LED current-limit resistor\n");
+        printf("4. Ohm's law (V = I * R)\n");
+        printf("5. Capacitor charging V(t)\n");
+        printf("6. Monte Carlo tolerance analysis\n");
+        printf("7. Transient simulation (RC/RL/RLC ladder)\n");
+        printf("8. Bode sweep (magnitude / phase vs frequency)\n");
+        printf("9. Back to Main Menu\n");
+        printf("--------------------------------\n");
+
+        int choice = uc_get_choice();
+        if (feof(stdin)) {
+            choice = 9;                   /* input closed: uc_get_choice's 6 is not Back here */
+        }
+
+        switch (choice) {
+            case 1: cc_rc_filter();        break;
+            case 2: cc_voltage_divider();  break;
+            case 3: cc_led_resistor();     break;
+            case 4: cc_ohms_law();         break;
+            case 5: cc_cap_charging();     break;
+            case 6: cc_monte_carlo_menu(); break;
+            case 7: cc_transient_menu();   break;
+            case 8: cc_bode_menu();        break;
+            case 9: running = 0;           break;
+            default:
+                printf("Unknown option.\n");
+                break;
+        }
+    }
+}
+
+/* ================================= *
+ * 3. Circuit Calculator Funcitions  *
+ * ================================= */
+static void cc_rc_filter(void)  /* Inputs R (ohms) and C (microfarads), converted to farads then calculating fc */
+{
+    printf("\n[RC low-pass filter cutoff]\n");
+    double R = 0.0;
+    double C_uF = 0.0;
+
+    R = uc_get_double("Enter R in ohms: ");
+    C_uF = uc_get_double("Enter C in microfarads (uF): ");
+
+    if (R <= 0.0 || C_uF <= 0.0) {
+        printf("R and C must be > 0.\n");
+        return;
+    }
+
+    double fc = etk_rc_cutoff_hz(R, C_uF);
+
+    printf("Cutoff frequency fc = %.3f Hz\n", fc);
+}
+static void cc_voltage_divider(void)  /* Two-resistor voltage divider */
+{
+    printf("\n[Voltage divider]\n");
+
+    double Vin = uc_get_double("Enter Vin (V): ");
+    double R1  = uc_get_double("Enter R1 (ohms): ");
+    double R2  = uc_get_double("Enter R2 (ohms): ");
+
+    if (R1 <= 0.0 || R2 <= 0.0) {
+        printf("R1 and R2 must be > 0.\n");
+        return;
+    }
+
+    double Vout = etk_divider_vout(Vin, R1, R2);
+
+    printf("Vout = %.4f V\n", Vout);
+    /* Simultaneously output the ratio of Vout to Vout/Vin. */
+    printf("Divider ratio = Vout/Vin = %.4f\n", (Vin != 0.0) ? (Vout / Vin) : 0.0);
+}
+static void cc_led_resistor(void)  /* Calculate THE LED Current-Limiting Resistor */
+{
+    printf("\n[LED current-limit resistor]\n");
+
+    double Vs = uc_get_double("Enter supply voltage Vs (V): ");
+    double Vf = uc_get_double("Enter LED forward voltage Vf (V): ");
+    double If_mA = uc_get_double("Enter desired LED current If (mA): ");
+
+    if (If_mA <= 0.0) {
+        printf("Current must be > 0.\n");
+        return;
+    }
+    if (Vs - Vf <= 0.0) {
+        printf("Vs must be greater than Vf.\n");
+        return;
+    }
+
+    double R = etk_led_resistor_ohms(Vs, Vf, If_mA);
+
+    printf("Required series resistor R = %.2f ohms\n", R);
+}
+static void cc_ohms_law(void) /* Simple Ohms Law calculator :) */
+{
+    printf("\n[Ohm's law]\n");
+    printf("1. Solve V (given I and R)\n");
+    printf("2. Solve I (given V and R)\n");
+    printf("3. Solve R (given V and I)\n");
+
+    int mode = uc_get_choice();
+
+    if (mode == 1) {
+        double I = uc_get_double("Enter current I (A): ");
+        double R = uc_get_double("Enter resistance R (ohms): ");
+        double V = I * R;
+        printf("V = %.4f V\n", V);
+    } else if (mode == 2) {
+        double V = uc_get_double("Enter voltage V (V): ");
+        double R = uc_get_double("Enter resistance R (ohms): ");
+        if (R == 0.0) {
+            printf("R must not be 0.\n");
+            return;
+        }
+        double I = V / R;
+        printf("I = %.6f A\n", I);
+    } else if (mode == 3) {
+        double V = uc_get_double("Enter voltage V (V): ");
+        double I = uc_get_double("Enter current I (A): ");
+        if (I == 0.0) {
+            printf("I must not be 0.\n");
+            return;
+        }
+        double R = V / I;
+        printf("R = %.2f ohms\n", R);
+    } else {
+        printf("Invalid mode.\n");
+    }
+}
+static void cc_cap_charging(void) /* Cap Charging: V(t) = Vs * (1 − e^(−t/RC)) */
+{
+    printf("\n[Capacitor charging curve]\n");
+
+    double Vs   = uc_get_double("Enter supply voltage Vs (V): ");
+    double R    = uc_get_double("Enter R (ohms): ");
+    double C_uF = uc_get_double("Enter C (microfarads, uF): ");
+    double t    = uc_get_double("Enter time t (seconds): ");
+
+    if (R <= 0.0 || C_uF <= 0.0 || t < 0.0) {
+        printf("R, C must be > 0 and t >= 0.\n");
+        return;
+    }
+
+    double tau = etk_time_constant(R, C_uF);
+    double Vt  = etk_cap_voltage(Vs, R, C_uF, t);
+
+    printf("Time constant tau = R*C = %.6f s\n", tau);
+    printf("V(t) = %.4f V at t = %.4f s\n", Vt, t);
+}
+
+/* ============================================== *
+ * 3. Circuit Calculator: Monte Carlo tolerances  *
+ * ============================================== */
+
+/* Spreads the component tolerances through the divider, RC cutoff and LED *
+ * current formulas.  Each trial draws every part value within its         *
+ * tolerance, uniformly or as a Gaussian with the tolerance at 3 sigma      *
+ * (clamped there: parts outside are rejected at the factory).              *
+ *  - Random numbers come from xoshiro256+ run as 4 independent lanes, two  *
+ *    per SSE2 register (shifts, xors and adds only), turned into doubles   *
+ *    in [0, 1) through the exponent bits.  Trials are evaluated a batch at *
+ *    a time from those arrays.                                             *
+ *  - Trials are cut into fixed chunks, each with its own generator seeded  *
+ *    from (seed, chunk), and threads take chunks in turn: the counts and   *
+ *    the histogram do not depend on the number of threads.                 *
+ *  - The worst case comes from the corners (every part at +/- tolerance);  *
+ *    all three formulas are monotonic in each part, so it bounds every     *
+ *    trial and sets the histogram range.                                  */
+
+#define CC_MC_CHUNK           65536           /* trials per generator stream */
+#define CC_MC_BATCH           1024            /* trials evaluated together */
+#define CC_MC_MAX_THREADS     16
+#define CC_MC_MAX_TRIALS      1000000000LL
+
+typedef struct {
+    uint64_t s[4][4];                         /* state word, lane */
+} CcRng;
+
+static uint64_t cc_splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+static void cc_rng_seed(CcRng *r, uint64_t seed, uint64_t stream)
+{
+    uint64_t x = seed ^ (stream * 0xd1342543de82ef95ULL);
+    for (int w = 0; w < 4; w++) {
+        for (int lane = 0; lane < 4; lane++) {
+            r->s[w][lane] = cc_splitmix64(&x);
+        }
+    }
+}
+/* n uniform doubles in [0, 1), n a multiple of 4; lane i % 4 gives out[i] */
+static void cc_rng_uniform(CcRng *r, double *out, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i s0a = _mm_loadu_si128((const __m128i *)&r->s[0][0]), s0b = _mm_loadu_si128((const __m128i *)&r->s[0][2]);
+    __m128i s1a = _mm_loadu_si128((const __m128i *)&r->s[1][0]), s1b = _mm_loadu_si128((const __m128i *)&r->s[1][2]);
+    __m128i s2a = _mm_loadu_si128((const __m128i *)&r->s[2][0]), s2b = _mm_loadu_si128((const __m128i *)&r->s[2][2]);
+    __m128i s3a = _mm_loadu_si128((const __m128i *)&r->s[3][0]), s3b = _mm_loadu_si128((const __m128i *)&r->s[3][2]);
+    const __m128i one_bits = _mm_set1_epi64x(0x3ff0000000000000LL);
+    const __m128d one = _mm_set1_pd(1.0);
+    for (; i + 4 <= n; i += 4) {
+        __m128i ra = _mm_add_epi64(s0a, s3a), rb = _mm_add_epi64(s0b, s3b);
+        _mm_storeu_pd(out + i,     _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(ra, 12), one_bits)), one));
+        _mm_storeu_pd(out + i + 2, _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(rb, 12), one_bits)), one));
+        __m128i ta = _mm_slli_epi64(s1a, 17), tb = _mm_slli_epi64(s1b, 17);
+        s2a = _mm_xor_si128(s2a, s0a);  s2b = _mm_xor_si128(s2b, s0b);
+        s3a = _mm_xor_si128(s3a, s1a);  s3b = _mm_xor_si128(s3b, s1b);
+        s1a = _mm_xor_si128(s1a, s2a);  s1b = _mm_xor_si128(s1b, s2b);
+        s0a = _mm_xor_si128(s0a, s3a);  s0b = _mm_xor_si128(s0b, s3b);
+        s2a = _mm_xor_si128(s2a, ta);   s2b = _mm_xor_si128(s2b, tb);
+        s3a = _mm_or_si128(_mm_slli_epi64(s3a, 45), _mm_srli_epi64(s3a, 19));
+        s3b = _mm_or_si128(_mm_slli_epi64(s3b, 45), _mm_srli_epi64(s3b, 19));
+    }
+    _mm_storeu_si128((__m128i *)&r->s[0][0], s0a);  _mm_storeu_si128((__m128i *)&r->s[0][2], s0b);
+    _mm_storeu_si128((__m128i *)&r->s[1][0], s1a);  _mm_storeu_si128((__m128i *)&r->s[1][2], s1b);
+    _mm_storeu_si128((__m128i *)&r->s[2][0], s2a);  _mm_storeu_si128((__m128i *)&r->s[2][2], s2b);
+    _mm_storeu_si128((__m128i *)&r->s[3][0], s3a);  _mm_storeu_si128((__m128i *)&r->s[3][2], s3b);
+#endif
+    for (; i < n; i += 4) {                   /* same sequence without SSE2 */
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t *s0 = &r->s[0][lane], *s1 = &r->s[1][lane], *s2 = &r->s[2][lane], *s3 = &r->s[3][lane];
+            uint64_t bits = ((*s0 + *s3) >> 12) | 0x3ff0000000000000ULL;
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            out[i + lane] = d - 1.0;
+            uint64_t t = *s1 << 17;
+            *s2 ^= *s0;
+            *s3 ^= *s1;
+            *s1 ^= *s2;
+            *s0 ^= *s3;
+            *s2 ^= t;
+            *s3 = (*s3 << 45) | (*s3 >> 19);
+        }
+    }
+}
+/* Part values from uniforms in place: nominal * (1 + deviation) */
+static void cc_mc_parts(const CcPart *part, int dist, double *v, int n)
+{
+    const double tol = part->tol_pct / 100.0;
+
+    if (dist == CC_DIST_UNIFORM) {
+        for (int i = 0; i < n; i++) {
+            v[i] = part->nominal * (1.0 + tol * (2.0 * v[i] - 1.0));
+        }
+        return;
+    }
+    for (int i = 0; i + 1 < n; i += 2) {                  /* Box-Muller, sigma = tol / 3 */
+        double rad = sqrt(-2.0 * log(1.0 - v[i]));
+        double ang = 2.0 * M_PI * v[i + 1];
+        double z[2] = { rad * cos(ang), rad * sin(ang) };
+        for (int k = 0; k < 2; k++) {
+            if (z[k] > 3.0) z[k] = 3.0;
+            if (z[k] < -3.0) z[k] = -3.0;
+            v[i + k] = part->nominal * (1.0 + tol * z[k] / 3.0);
+        }
+    }
+}
+static int cc_mc_part_count(int circuit)
+{
+    return (circuit == CC_MC_LED) ? 3 : 2;
+}
+/* The output of one trial; p[k] is part k */
+static inline double cc_mc_eval(const CcMonteCarloConfig *cfg, double p0, double p1, double p2)
+{
+    switch (cfg->circuit) {
+        case CC_MC_DIVIDER: return cfg->vin * p1 / (p0 + p1);                   /* R1, R2 */
+        case CC_MC_RC:      return 1.0 / (2.0 * M_PI * p0 * p1 * 1e-6);         /* R, C (uF) */
+        default:            return (p0 - p1) / p2 * 1000.0;                     /* Vs, Vf, R -> mA */
+    }
+}
+
+typedef struct {
+    const CcMonteCarloConfig *cfg;
+    atomic_llong *next_chunk;
+    long long     nchunks;
+    double        lo, width;                  /* histogram range */
+    long long     count, in_spec;
+    double        sum, sum_sq;                /* of (output - nominal) */
+    double        min, max;
+    long long     hist[CC_MC_BINS];
+    double        buf[3][CC_MC_BATCH];
+} CcMcJob;
+
+static void *cc_mc_thread(void *arg)
+{
+    CcMcJob *job = arg;
+    const CcMonteCarloConfig *cfg = job->cfg;
+    const int nparts = cc_mc_part_count(cfg->circuit);
+    const double nominal = cc_mc_eval(cfg, cfg->part[0].nominal, cfg->part[1].nominal, cfg->part[2].nominal);
+    const double spec = fabs(nominal) * cfg->spec_pct / 100.0;
+    CcRng rng;
+
+    for (;;) {
+        long long chunk = atomic_fetch_add(job->next_chunk, 1);
+        if (chunk >= job->nchunks) {
+            break;
+        }
+        long long first = chunk * CC_MC_CHUNK;
+        long long left  = (cfg->trials - first < CC_MC_CHUNK) ? cfg->trials - first : CC_MC_CHUNK;
+        cc_rng_seed(&rng, cfg->seed, (uint64_t)chunk);
+
+        while (left > 0) {
+            int n = (left < CC_MC_BATCH) ? (int)left : CC_MC_BATCH;
+            for (int k = 0; k < nparts; k++) {
+                cc_rng_uniform(&rng, job->buf[k], CC_MC_BATCH);
+                cc_mc_parts(&cfg->part[k], cfg->dist, job->buf[k], CC_MC_BATCH);
+            }
+            for (int i = 0; i < n; i++) {
+                double y = cc_mc_eval(cfg, job->buf[0][i], job->buf[1][i], job->buf[2][i]);
+                double d = y - nominal;
+                if (job->count == 0 || y < job->min) job->min = y;
+                if (job->count == 0 || y > job->max) job->max = y;
+                job->count++;
+                job->sum    += d;
+                job->sum_sq += d * d;
+                job->in_spec += (fabs(d) <= spec);
+                int b = (job->width > 0.0) ? (int)((y - job->lo) / job->width * CC_MC_BINS) : 0;
+                if (b < 0) b = 0;
+                if (b >= CC_MC_BINS) b = CC_MC_BINS - 1;
+                job->hist[b]++;
+            }
+            left -= n;
+        }
+    }
+    return NULL;
+}
+/* q-quantile from the histogram, linear within a bin */
+static double cc_mc_quantile(const CcMonteCarloResult *res, double q)
+{
+    double rank = q * (double)res->trials;
+    double width = (res->hist_max - res->hist_min) / CC_MC_BINS;
+    long long below = 0;
+
+    for (int b = 0; b < CC_MC_BINS; b++) {
+        if ((double)(below + res->hist[b]) >= rank && res->hist[b] > 0) {
+            double v = res->hist_min + width * (b + (rank - (double)below) / (double)res->hist[b]);
+            if (v < res->min) v = res->min;
+            if (v > res->max) v = res->max;
+            return v;
+        }
+        below += res->hist[b];
+    }
+    return res->max;
+}
+int cc_monte_carlo(const CcMonteCarloConfig *cfg, CcMonteCarloResult *res)
+{
+    const int nparts = cc_mc_part_count(cfg->circuit);
+
+    if (cfg->circuit < CC_MC_DIVIDER || cfg->circuit > CC_MC_LED ||
+        (cfg->dist != CC_DIST_UNIFORM && cfg->dist != CC_DIST_GAUSS) ||
+        cfg->trials < 1 || cfg->trials > CC_MC_MAX_TRIALS) {
+        return 0;
+    }
+    for (int k = 0; k < nparts; k++) {
+        if (!(cfg->part[k].tol_pct >= 0.0 && cfg->part[k].tol_pct < 100.0)) {
+            return 0;
+        }
+    }
+
+    memset(res, 0, sizeof(*res));
+    res->nominal = cc_mc_eval(cfg, cfg->part[0].nominal, cfg->part[1].nominal, cfg->part[2].nominal);
+    for (int corner = 0; corner < (1 << nparts); corner++) {
+        double p[3] = { 0.0, 0.0, 0.0 };
+        for (int k = 0; k < nparts; k++) {
+            double sign = ((corner >> k) & 1) ? 1.0 : -1.0;
+            p[k] = cfg->part[k].nominal * (1.0 + sign * cfg->part[k].tol_pct / 100.0);
+        }
+        double y = cc_mc_eval(cfg, p[0], p[1], p[2]);
+        if (corner == 0 || y < res->wc_min) res->wc_min = y;
+        if (corner == 0 || y > res->wc_max) res->wc_max = y;
+    }
+    if (!isfinite(res->nominal) || !isfinite(res->wc_min) || !isfinite(res->wc_max)) {
+        return 0;
+    }
+
+    long long nchunks = (cfg->trials + CC_MC_CHUNK - 1) / CC_MC_CHUNK;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = (cores > 1) ? (int)cores : 1;
+    if (nthreads > CC_MC_MAX_THREADS) nthreads = CC_MC_MAX_THREADS;
+    if (nthreads > nchunks) nthreads = (int)nchunks;
+
+    CcMcJob *job = calloc((size_t)nthreads, sizeof(CcMcJob));
+    if (!job) {
+        return 0;
+    }
+    atomic_llong next_chunk;
+    atomic_init(&next_chunk, 0);
+    pthread_t tid[CC_MC_MAX_THREADS];
+    int created[CC_MC_MAX_THREADS] = { 0 };
+    for (int t = 0; t < nthreads; t++) {
+        job[t].cfg        = cfg;
+        job[t].next_chunk = &next_chunk;
+        job[t].nchunks    = nchunks;
+        job[t].lo         = res->wc_min;
+        job[t].width      = res->wc_max - res->wc_min;
+    }
+    for (int t = 1; t < nthreads; t++) {
+        created[t] = (pthread_create(&tid[t], NULL, cc_mc_thread, &job[t]) == 0);
+    }
+    cc_mc_thread(&job[0]);                    /* also takes the chunks of threads that failed to start */
+
+    double sum = 0.0, sum_sq = 0.0;
+    for (int t = 0; t < nthreads; t++) {
+        if (t > 0 && !created[t]) continue;
+        if (t > 0) pthread_join(tid[t], NULL);
+        if (job[t].count == 0) continue;
+        if (res->trials == 0 || job[t].min < res->min) res->min = job[t].min;
+        if (res->trials == 0 || job[t].max > res->max) res->max = job[t].max;
+        res->trials  += job[t].count;
+        res->in_spec += job[t].in_spec;
+        sum    += job[t].sum;
+        sum_sq += job[t].sum_sq;
+        for (int b = 0; b < CC_MC_BINS; b++) {
+            res->hist[b] += job[t].hist[b];
+        }
+    }
+    free(job);
+
+    double mean_d = sum / (double)res->trials;
+    double var = sum_sq / (double)res->trials - mean_d * mean_d;
+    res->mean     = res->nominal + mean_d;
+    res->stddev   = (var > 0.0 && res->trials > 1) ? sqrt(var * res->trials / (res->trials - 1)) : 0.0;
+    res->hist_min = res->wc_min;
+    res->hist_max = res->wc_max;
+    res->p_low    = cc_mc_quantile(res, 0.00135);
+    res->p50      = cc_mc_quantile(res, 0.5);
+    res->p_high   = cc_mc_quantile(res, 0.99865);
+    return 1;
+}
+/* Nominal value, then tolerance as a percentage or a resistor band colour */
+static int cc_mc_read_part(const char *name, const char *unit, CcPart *part, int colour_ok)
+{
+    char prompt[128], line[64];
+
+    snprintf(prompt, sizeof(prompt), "%s nominal (%s): ", name, unit);
+    if (!ec_read_value(prompt, &part->nominal)) {
+        return 0;
+    }
+    snprintf(prompt, sizeof(prompt), "%s tolerance in %%%s: ", name, colour_ok ? " (or band colour, e.g. gold)" : "");
+    for (;;) {
+        if (!ec_read_line(prompt, line, sizeof(line))) {
+            return 0;
+        }
+        char *end = NULL;
+        part->tol_pct = strtod(line, &end);
+        if (end != line && *end == '\0' && part->tol_pct >= 0.0 && part->tol_pct < 100.0) {
+            return 1;
+        }
+        if (colour_ok && etk_resistor_tolerance(line, &part->tol_pct) == ETK_OK) {
+            printf("  %s band: +/-%g%%\n", line, part->tol_pct);
+            return 1;
+        }
+        printf("Please enter a percentage from 0 to 100%s.\n", colour_ok ? " or a tolerance band colour" : "");
+    }
+}
+static void cc_monte_carlo_menu(void)
+{
+    static const char *const titles[] = { "Voltage divider Vout", "RC cutoff frequency", "LED current" };
+    static const char *const units[]  = { "V", "Hz", "mA" };
+    CcMonteCarloConfig cfg;
+    CcMonteCarloResult *res = malloc(sizeof(*res));
+
+    if (!res) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    memset(&cfg, 0, sizeof(cfg));
+    printf("\n[Monte Carlo tolerance analysis]\n");
+    printf("1. Voltage divider\n2. RC filter cutoff\n3. LED current\n");
+    cfg.circuit = uc_get_choice() - 1;
+
+    int ok = 1;
+    if (cfg.circuit == CC_MC_DIVIDER) {
+        ok = ec_read_value("Vin (V): ", &cfg.vin) &&
+             cc_mc_read_part("R1", "ohms, e.g. 10k", &cfg.part[0], 1) &&
+             cc_mc_read_part("R2", "ohms", &cfg.part[1], 1);
+        ok = ok && cfg.part[0].nominal > 0.0 && cfg.part[1].nominal > 0.0;
+    } else if (cfg.circuit == CC_MC_RC) {
+        ok = cc_mc_read_part("R", "ohms", &cfg.part[0], 1) &&
+             cc_mc_read_part("C", "microfarads, uF", &cfg.part[1], 0);
+        ok = ok && cfg.part[0].nominal > 0.0 && cfg.part[1].nominal > 0.0;
+    } else if (cfg.circuit == CC_MC_LED) {
+        ok = cc_mc_read_part("Supply Vs", "V", &cfg.part[0], 0) &&
+             cc_mc_read_part("LED Vf", "V", &cfg.part[1], 0) &&
+             cc_mc_read_part("Series R", "ohms", &cfg.part[2], 1);
+        ok = ok && cfg.part[2].nominal > 0.0 && cfg.part[0].nominal > cfg.part[1].nominal;
+    } else {
+        printf("Invalid option.\n");
+        free(res);
+        return;
+    }
+    if (!ok) {
+        printf("Values must be > 0 (and Vs greater than Vf).\n");
+        free(res);
+        return;
+    }
+
+    double trials = uc_get_double("Number of trials (e.g. 1000000): ");
+    if (!(isfinite(trials) && trials >= 1.0 && trials <= (double)CC_MC_MAX_TRIALS)) {
+        printf("Trials must be 1 to %lld.\n", CC_MC_MAX_TRIALS);
+        free(res);
+        return;
+    }
+    printf("Distribution: 1) uniform within tolerance  2) Gaussian, tolerance = 3 sigma\n");
+    cfg.dist     = (uc_get_choice() == 2) ? CC_DIST_GAUSS : CC_DIST_UNIFORM;
+    cfg.spec_pct = uc_get_double("Acceptance window, +/- % of nominal (e.g. 1): ");
+    if (!isfinite(cfg.spec_pct)) cfg.spec_pct = 0.0;
+    cfg.trials   = (long long)trials;
+    cfg.seed     = 2645;                              /* fixed: repeat runs give the same answer */
+
+    double t0 = sa_live_now();
+    if (!cc_monte_carlo(&cfg, res)) {
+        printf("Trials must be 1 to %lld and tolerances below 100%%.\n", CC_MC_MAX_TRIALS);
+        free(res);
+        return;
+    }
+    double dt = sa_live_now() - t0;
+
+    const char *unit = units[cfg.circuit];
+    printf("\n%s, %lld trials (%s):\n", titles[cfg.circuit], res->trials,
+           (cfg.dist == CC_DIST_GAUSS) ? "Gaussian" : "uniform");
+    printf("  Nominal    : %.6g %s\n", res->nominal, unit);
+    printf("  Worst case : %.6g .. %.6g %s\n", res->wc_min, res->wc_max, unit);
+    printf("  Mean       : %.6g %s   std dev %.4g %s\n", res->mean, unit, res->stddev, unit);
+    printf("  Observed   : %.6g .. %.6g %s\n", res->min, res->max, unit);
+    printf("  0.135%% / median / 99.865%% : %.6g / %.6g / %.6g %s\n", res->p_low, res->p50, res->p_high, unit);
+    printf("  Yield      : %.3f%% within +/-%g%% (%lld of %lld)\n",
+           100.0 * res->in_spec / res->trials, cfg.spec_pct, res->in_spec, res->trials);
+    if (dt > 0.0) printf("  (%.3f s, %.1f M trials/s)\n", dt, res->trials / dt / 1e6);
+
+    /* Distribution over the observed range, from the fine histogram */
+    enum { NBARS = 16, MAX_BAR = 40 };
+    long long bars[NBARS] = { 0 };
+    double fine = (res->hist_max - res->hist_min) / CC_MC_BINS;
+    double span = res->max - res->min;
+    long long peak = 0;
+    for (int b = 0; b < CC_MC_BINS; b++) {
+        double centre = res->hist_min + (b + 0.5) * fine;
+        int k = (span > 0.0) ? (int)((centre - res->min) / span * NBARS) : 0;
+        if (k < 0) k = 0;
+        if (k >= NBARS) k = NBARS - 1;
+        bars[k] += res->hist[b];
+    }
+    for (int k = 0; k < NBARS; k++) {
+        if (bars[k] > peak) peak = bars[k];
+    }
+    printf("\n");
+    for (int k = 0; k < NBARS && peak > 0; k++) {
+        int bar = (int)((double)bars[k] / (double)peak * MAX_BAR + 0.5);
+        printf("%12.6g %-3s ", res->min + (k + 0.5) * span / NBARS, unit);
+        for (int j = 0; j < MAX_BAR; j++) {
+            putchar(j < bar ? '#' : ' ');
+        }
+        printf(" %5.2f%%\n", 100.0 * bars[k] / res->trials);
+        if (span == 0.0) break;
+    }
+    free(res);
+}
+
+/* ============================================== *
+ * 3. Circuit Calculator: Transient simulation    *
+ * ============================================== */
+
+/* Time response of a ladder of sections, each a series R (+ L) from the     *
+ * previous node and a shunt C (+ G) to ground, driven by a step, a pulse   *
+ * train or the loaded samples.  Unknowns are interleaved per section as    *
+ * (series current, node voltage), so  M x' = -K x + b u(t)  has a diagonal *
+ * M and a tridiagonal K.  Rows with M = 0 (no L / no C) are algebraic.     *
+ *  - Trapezoidal rule on the differential rows, algebraic rows solved at   *
+ *    the new time:  S(h) x1 = rhs, with S banded (one sub-, one super-    *
+ *    diagonal plus one fill diagonal from partial pivoting).              *
+ *  - Steps are h = hmin * 2^k, k = 0..CC_TR_LEVELS, with hmin = output     *
+ *    interval / 2^CC_TR_LEVELS and every step starting on a multiple of    *
+ *    its own length: S(h) takes only CC_TR_LEVELS + 1 values, each         *
+ *    factored once on first use and reused for the rest of the run, and    *
+ *    every output sample and pulse edge falls exactly on a step boundary.  *
+ *  - Local error of each step from the third divided difference of the    *
+ *    last four points (h^3/12 x'''); a step over reltol is redone at half  *
+ *    the length, one well under it lets the next step double.             *
+ *  - At t = 0 and at every pulse edge the algebraic unknowns are re-solved *
+ *    for the new input with the capacitor voltages and inductor currents   *
+ *    held (the h = 0 system), and the step size restarts from hmin.        *
+ * The circuit starts at rest (all capacitors and inductors discharged).    */
+
+#define CC_TR_LEVELS   16              /* step sizes hmin * 2^0 .. output interval */
+#define CC_TR_BAND_W   4               /* columns i-1 .. i+2 of row i */
+#define CC_TR_RELTOL   1e-4
+#define CC_TR_GROW     0.1             /* error ratio below which the step doubles */
+
+typedef struct {
+    double *ab;                        /* n rows of CC_TR_BAND_W */
+    double *lmul;                      /* elimination multiplier of each row below the pivot */
+    int    *piv;
+    int     ready;
+} CcBandLu;
+
+typedef struct {
+    const CcTransientConfig *cfg;
+    int        n;                      /* 2 unknowns per section */
+    double    *m, *kd, *klo, *kup;     /* M diagonal; K diagonal, sub- and super-diagonal */
+    double     hmin;
+    long long  td, pw, per;            /* pulse timing in hmin ticks */
+    CcBandLu   lu[CC_TR_LEVELS + 2];   /* per level; the last one is the h = 0 restart system */
+    long long  factorizations;
+    int        singular;
+} CcTrRun;
+
+#define CC_TR_AB(lu, i, j) ((lu)->ab[(size_t)(i) * CC_TR_BAND_W + (size_t)((j) - (i) + 1)])
+
+/* LU with partial pivoting of the band already in lu->ab (diagonal stored *
+ * inverted); 0 when singular                                              */
+static int cc_band_factor(CcBandLu *lu, int n)
+{
+    for (int k = 0; k < n; k++) {
+        int p = k;
+        if (k + 1 < n && fabs(CC_TR_AB(lu, k + 1, k)) > fabs(CC_TR_AB(lu, k, k))) {
+            p = k + 1;
+        }
+        lu->piv[k] = p;
+        if (p != k) {                  /* rows k, k+1 are nonzero only in columns k .. k+2 */
+            for (int j = k; j <= k + 2 && j < n; j++) {
+                double t = CC_TR_AB(lu, k, j);
+                CC_TR_AB(lu, k, j) = CC_TR_AB(lu, p, j);
+                CC_TR_AB(lu, p, j) = t;
+            }
+        }
+        double pivot = CC_TR_AB(lu, k, k);
+        if (pivot == 0.0 || !isfinite(pivot)) {
+            return 0;
+        }
+        CC_TR_AB(lu, k, k) = 1.0 / pivot;                        /* the solves multiply */
+        lu->lmul[k] = 0.0;
+        if (k + 1 < n) {
+            double f = CC_TR_AB(lu, k + 1, k) / pivot;
+            lu->lmul[k] = f;
+            CC_TR_AB(lu, k + 1, k) = 0.0;
+            for (int j = k + 1; j <= k + 2 && j < n; j++) {
+                CC_TR_AB(lu, k + 1, j) -= f * CC_TR_AB(lu, k, j);
+            }
+        }
+    }
+    return 1;
+}
+static void cc_band_solve(const CcBandLu *lu, int n, double *x)
+{
+    for (int k = 0; k < n; k++) {
+        int p = lu->piv[k];
+        if (p != k) {
+            double t = x[k];
+            x[k] = x[p];
+            x[p] = t;
+        }
+        if (k + 1 < n) x[k + 1] -= lu->lmul[k] * x[k];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double s = x[i];
+        if (i + 1 < n) s -= CC_TR_AB(lu, i, i + 1) * x[i + 1];
+        if (i + 2 < n) s -= CC_TR_AB(lu, i, i + 2) * x[i + 2];
+        x[i] = s * CC_TR_AB(lu, i, i);
+    }
+}
+static void cc_tr_free(CcTrRun *run)
+{
+    for (int l = 0; l < CC_TR_LEVELS + 2; l++) {
+        free(run->lu[l].ab);
+        free(run->lu[l].lmul);
+        free(run->lu[l].piv);
+    }
+    free(run->m);
+}
+/* Factorization of S(h) for step level l (CC_TR_LEVELS + 1: the h = 0 system), built on first use */
+static const CcBandLu *cc_tr_system(CcTrRun *run, int l)
+{
+    CcBandLu *lu = &run->lu[l];
+    const int n = run->n;
+
+    if (lu->ready) {
+        return lu;
+    }
+    if (!lu->ab) {
+        lu->ab   = calloc((size_t)n * CC_TR_BAND_W, sizeof(double));
+        lu->lmul = malloc((size_t)n * sizeof(double));
+        lu->piv  = malloc((size_t)n * sizeof(int));
+        if (!lu->ab || !lu->lmul || !lu->piv) {
+            return NULL;
+        }
+    }
+    double half_h = (l > CC_TR_LEVELS) ? 0.0 : 0.5 * run->hmin * (double)(1LL << l);
+    for (int r = 0; r < n; r++) {
+        double lo = run->klo[r], d = run->kd[r], up = run->kup[r];
+        if (run->m[r] != 0.0) {                               /* differential row */
+            lo *= half_h;
+            up *= half_h;
+            d   = run->m[r] + half_h * d;
+        }
+        if (r > 0)     CC_TR_AB(lu, r, r - 1) = lo;
+        CC_TR_AB(lu, r, r) = d;
+        if (r + 1 < n) CC_TR_AB(lu, r, r + 1) = up;
+        if (r + 2 < n) CC_TR_AB(lu, r, r + 2) = 0.0;
+    }
+    if (!cc_band_factor(lu, n)) {
+        run->singular = 1;
+        return NULL;
+    }
+    lu->ready = 1;
+    run->factorizations++;
+    return lu;
+}
+/* Input at tick t; for the piecewise-constant sources, the level from t until the next edge */
+static double cc_tr_input(const CcTrRun *run, long long t)
+{
+    const CcTransientConfig *cfg = run->cfg;
+
+    if (cfg->source == CC_SRC_SAMPLED) {
+        const SignalStats *in = &cfg->input->sig;
+        double pos = (double)t / (double)(1LL << CC_TR_LEVELS);
+        long long i = (long long)pos;
+        if (i >= in->count - 1) {
+            return in->samples[in->count - 1];                /* held after the last sample */
+        }
+        double frac = pos - (double)i;
+        return in->samples[i] + frac * (in->samples[i + 1] - in->samples[i]);
+    }
+    if (t < run->td) {
+        return cfg->v1;
+    }
+    long long phase = t - run->td;
+    if (run->per > 0) phase %= run->per;
+    return (phase < run->pw) ? cfg->v2 : cfg->v1;
+}
+/* First pulse edge after tick t (LLONG_MAX when there is none) */
+static long long cc_tr_next_edge(const CcTrRun *run, long long t)
+{
+    if (run->cfg->source == CC_SRC_SAMPLED) {
+        return LLONG_MAX;
+    }
+    if (t < run->td) {
+        return run->td;
+    }
+    long long rel = t - run->td;
+    if (run->per == 0) {
+        return (rel < run->pw) ? run->td + run->pw : LLONG_MAX;
+    }
+    long long start = run->td + rel / run->per * run->per;
+    return (rel % run->per < run->pw) ? start + run->pw : start + run->per;
+}
+/* x1 from x0 over one step of level l (h = 0 system: consistent restart) with input u0 -> u1 */
+static int cc_tr_step(CcTrRun *run, int l, const double *x0, double *x1, double u0, double u1)
+{
+    const CcBandLu *lu = cc_tr_system(run, l);
+    const int n = run->n;
+
+    if (!lu) {
+        return 0;
+    }
+    double half_h = (l > CC_TR_LEVELS) ? 0.0 : 0.5 * run->hmin * (double)(1LL << l);
+    for (int r = 0; r < n; r++) {
+        double bu = (r == 0) ? 1.0 : 0.0;                     /* the source drives row 0 only */
+        if (run->m[r] != 0.0) {
+            double kx = run->kd[r] * x0[r];
+            if (r > 0)     kx += run->klo[r] * x0[r - 1];
+            if (r + 1 < n) kx += run->kup[r] * x0[r + 1];
+            x1[r] = run->m[r] * x0[r] - half_h * kx + half_h * bu * (u0 + u1);
+        } else {
+            x1[r] = bu * u1;
+        }
+    }
+    cc_band_solve(lu, n, x1);
+    return 1;
+}
+int cc_transient(const CcTransientConfig *cfg, SignalContext *out, const char *filename, CcTransientStats *st)
+{
+    const int N = cfg->nsections;
+
+    memset(st, 0, sizeof(*st));
+    if (N < 1 || N > CC_TR_MAX_SECTIONS || cfg->probe < 1 || cfg->probe > N ||
+        !(cfg->sample_rate > 0.0) || !(cfg->duration >= 0.0) || out == cfg->input) {
+        return SA_ERR_FORMAT;
+    }
+    for (int k = 0; k < N; k++) {
+        const CcLadderSection *s = &cfg->section[k];
+        if (!(s->R >= 0.0 && s->L >= 0.0 && s->C >= 0.0 && s->G >= 0.0) || (s->R == 0.0 && s->L == 0.0)) {
+            return SA_ERR_FORMAT;                             /* series branch needs R or L */
+        }
+    }
+    double nout_d = floor(cfg->duration * cfg->sample_rate + 0.5) + 1.0;
+    if (nout_d > CC_TR_MAX_OUTPUT) {
+        return SA_ERR_FORMAT;
+    }
+    if (cfg->source == CC_SRC_SAMPLED && (!cfg->input || cfg->input->sig.count <= 0)) {
+        return SA_ERR_EMPTY;
+    }
+
+    CcTrRun run;
+    memset(&run, 0, sizeof(run));
+    run.cfg  = cfg;
+    run.n    = 2 * N;
+    run.hmin = 1.0 / cfg->sample_rate / (double)(1LL << CC_TR_LEVELS);
+    if (cfg->source != CC_SRC_SAMPLED) {
+        if (cfg->source == CC_SRC_STEP) {
+            run.pw = LLONG_MAX / 4;                           /* never ends */
+        } else {
+            run.pw  = llround(cfg->width / run.hmin);
+            run.per = llround(cfg->period / run.hmin);
+            if (!(cfg->width > 0.0) || !(cfg->period >= 0.0) || cfg->width / run.hmin > 1e17 ||
+                cfg->period / run.hmin > 1e17 || run.pw < 1 || (run.per != 0 && run.per <= run.pw)) {
+                return SA_ERR_FORMAT;
+            }
+        }
+        if (!(cfg->delay >= 0.0) || cfg->delay / run.hmin > 1e17) {
+            return SA_ERR_FORMAT;
+        }
+        run.td = llround(cfg->delay / run.hmin);
+    }
+
+    /* M, K and the state arrays: x0, x1 and three points of history */
+    const int n = run.n;
+    run.m = malloc((size_t)n * 9 * sizeof(double));
+    if (!run.m) {
+        return SA_ERR_MEMORY;
+    }
+    run.kd  = run.m + n;
+    run.klo = run.m + 2 * (size_t)n;
+    run.kup = run.m + 3 * (size_t)n;
+    double *x  = run.m + 4 * (size_t)n;
+    double *x1 = run.m + 5 * (size_t)n;
+    double *hist[3] = { run.m + 6 * (size_t)n, run.m + 7 * (size_t)n, run.m + 8 * (size_t)n };
+    double  hist_t[3] = { 0.0, 0.0, 0.0 };
+    for (int k = 0; k < N; k++) {
+        const CcLadderSection *s = &cfg->section[k];
+        int ri = 2 * k, rv = 2 * k + 1;
+        run.m[ri]   = s->L;  run.kd[ri] = s->R;  run.klo[ri] = (k > 0) ? -1.0 : 0.0;  run.kup[ri] = 1.0;
+        run.m[rv]   = s->C;  run.kd[rv] = s->G;  run.klo[rv] = -1.0;  run.kup[rv] = (k + 1 < N) ? 1.0 : 0.0;
+    }
+
+    SaOutBuf ob = { 0 };
+    int status = SA_OK;
+    if (filename && !sa_out_open(&ob, filename)) {
+        cc_tr_free(&run);
+        return SA_ERR_OPEN;
+    }
+    long long nout = (long long)nout_d;
+    sa_signal_clear(&out->sig);
+    if (!sa_signal_reserve(&out->sig, (int)nout)) {
+        status = SA_ERR_MEMORY;
+    }
+
+    const int probe = 2 * (cfg->probe - 1) + 1;
+    const long long out_mask = (1LL << CC_TR_LEVELS) - 1;
+    const long long end = (nout - 1) << CC_TR_LEVELS;
+    const double reltol = (cfg->reltol > 0.0) ? cfg->reltol : CC_TR_RELTOL;
+    double scale[2] = { 0.0, 0.0 };                      /* largest current / voltage so far */
+    long long t = 0;
+    int level = 0, nhist = 0;
+
+    if (cfg->source == CC_SRC_SAMPLED) {
+        for (int i = 0; i < cfg->input->sig.count; i++) {
+            double a = fabs(cfg->input->sig.samples[i]);
+            if (a > scale[1]) scale[1] = a;
+        }
+    } else {
+        scale[1] = fmax(fabs(cfg->v1), fabs(cfg->v2));
+    }
+
+    /* Consistent start from rest, then one output sample every 2^CC_TR_LEVELS ticks */
+    memset(x1, 0, (size_t)n * sizeof(double));
+    if (status == SA_OK && !cc_tr_step(&run, CC_TR_LEVELS + 1, x1, x, 0.0, cc_tr_input(&run, 0))) {
+        status = run.singular ? SA_ERR_FORMAT : SA_ERR_MEMORY;
+    }
+    while (status == SA_OK) {
+        if ((t & out_mask) == 0) {
+            double v = x[probe];
+            if (!sa_signal_append(&out->sig, v)) {
+                status = SA_ERR_MEMORY;
+                break;
+            }
+            if (filename) {
+                sa_out_general(&ob, v, 12);
+                sa_out_char(&ob, '\n');
+            }
+        }
+        if (nhist == 3) {                                     /* oldest point drops out */
+            double *old = hist[0];
+            hist[0] = hist[1];
+            hist[1] = hist[2];
+            hist[2] = old;
+            hist_t[0] = hist_t[1];
+            hist_t[1] = hist_t[2];
+            nhist = 2;
+        }
+        memcpy(hist[nhist], x, (size_t)n * sizeof(double));
+        hist_t[nhist++] = (double)t * run.hmin;
+        if (t >= end) {
+            break;
+        }
+
+        /* Largest aligned step not crossing the next edge, halved while the error is too big */
+        long long edge = cc_tr_next_edge(&run, t);
+        long long stop = (edge < end) ? edge : end;
+        int k = level;
+        while (k > 0 && ((t & ((1LL << k) - 1)) != 0 || t + (1LL << k) > stop)) {
+            k--;
+        }
+        double ratio;
+        for (;;) {
+            double h  = run.hmin * (double)(1LL << k);
+            double u0 = cc_tr_input(&run, t);
+            double u1 = (cfg->source == CC_SRC_SAMPLED) ? cc_tr_input(&run, t + (1LL << k)) : u0;
+            if (!cc_tr_step(&run, k, x, x1, u0, u1)) {
+                status = run.singular ? SA_ERR_FORMAT : SA_ERR_MEMORY;
+                break;
+            }
+
+            /* Local error from the cubic through this and the last three points */
+            ratio = 0.0;
+            if (nhist == 3) {
+                double t3 = hist_t[0], t2 = hist_t[1], t1 = hist_t[2];
+                double t0 = (double)(t + (1LL << k)) * run.hmin;
+                double i01 = 1.0 / (t0 - t1), i12 = 1.0 / (t1 - t2), i23 = 1.0 / (t2 - t3);
+                double i02 = 1.0 / (t0 - t2), i13 = 1.0 / (t1 - t3);
+                double c = 0.5 * h * h * h / (t0 - t3);           /* h^3/12 * x''' with x''' = 6 dd */
+                for (int r = 0; r < n; r++) {
+                    if (run.m[r] == 0.0) continue;
+                    double d0 = (x1[r] - hist[2][r]) * i01;
+                    double d1 = (hist[2][r] - hist[1][r]) * i12;
+                    double d2 = (hist[1][r] - hist[0][r]) * i23;
+                    double lte = c * fabs((d0 - d1) * i02 - (d1 - d2) * i13);
+                    double mag = fabs(x1[r]);
+                    double tol = reltol * (mag > scale[r & 1] ? mag : scale[r & 1]) + 1e-300;
+                    if (lte > ratio * tol) ratio = lte / tol;
+                }
+            }
+            if (ratio <= 1.0 || k == 0) {
+                break;
+            }
+            k--;
+            st->rejected++;
+        }
+        if (status != SA_OK) {
+            break;
+        }
+
+        double h = run.hmin * (double)(1LL << k);
+        if (st->steps == 0 || h < st->h_min) st->h_min = h;
+        if (h > st->h_max) st->h_max = h;
+        st->steps++;
+        t += 1LL << k;
+        for (int r = 0; r < n; r++) {
+            double a = fabs(x1[r]);
+            if (a > scale[r & 1]) scale[r & 1] = a;
+        }
+        level = (nhist == 3 && ratio < CC_TR_GROW && k < CC_TR_LEVELS) ? k + 1 : k;
+
+        if (t == edge && t < end) {                           /* input jumps: re-solve the algebraic unknowns */
+            if (!cc_tr_step(&run, CC_TR_LEVELS + 1, x1, x, 0.0, cc_tr_input(&run, t))) {
+                status = run.singular ? SA_ERR_FORMAT : SA_ERR_MEMORY;
+            }
+            nhist = 0;
+            level = 0;
+        } else {
+            double *swap = x;
+            x  = x1;
+            x1 = swap;
+        }
+    }
+    st->factorizations = run.factorizations;
+
+    if (filename && !sa_out_close(&ob) && status == SA_OK) {
+        status = SA_ERR_OPEN;
+    }
+    sa_out_release(&ob);
+    cc_tr_free(&run);
+    snprintf(out->source, sizeof(out->source), "transient, node %d", cfg->probe);
+    return status;
+}
+static void cc_transient_menu(void)
+{
+    CcTransientConfig cfg;
+    CcTransientStats st;
+    CcLadderSection sec;
+    double n_sections = 0.0, C_uF = 0.0, R_load = 0.0, probe = 0.0;
+
+    memset(&cfg, 0, sizeof(cfg));
+    memset(&sec, 0, sizeof(sec));
+    printf("\n[Transient simulation]\n");
+    printf("Ladder of identical sections: series R + L from the previous node, shunt C to ground.\n");
+    if (!ec_read_value("Number of sections (1-10000): ", &n_sections) ||
+        !ec_read_value("Series R per section (ohms): ", &sec.R) ||
+        !ec_read_value("Series L per section (H, 0 = none): ", &sec.L) ||
+        !ec_read_value("Shunt C per section (uF, 0 = none): ", &C_uF) ||
+        !ec_read_value("Load resistor at the output (ohms, 0 = open): ", &R_load)) {
+        return;
+    }
+    if (n_sections < 1 || n_sections > CC_TR_MAX_SECTIONS || sec.R < 0.0 || sec.L < 0.0 ||
+        C_uF < 0.0 || R_load < 0.0 || (sec.R == 0.0 && sec.L == 0.0)) {
+        printf("Sections must be 1-%d, values >= 0, and each section needs R or L.\n", CC_TR_MAX_SECTIONS);
+        return;
+    }
+    sec.C = C_uF * 1e-6;
+    cfg.nsections = (int)n_sections;
+
+    printf("\nSource: 1) step  2) pulse train  3) loaded samples\n");
+    int source = uc_get_choice();
+    if (source == 1) {
+        cfg.source = CC_SRC_STEP;
+        cfg.v2 = uc_get_double("Step amplitude (V): ");
+    } else if (source == 2) {
+        cfg.source = CC_SRC_PULSE;
+        if (!ec_read_value("Low level (V): ", &cfg.v1) ||
+            !ec_read_value("High level (V): ", &cfg.v2) ||
+            !ec_read_value("Delay before the first pulse (s): ", &cfg.delay) ||
+            !ec_read_value("Pulse width (s, e.g. 1m): ", &cfg.width) ||
+            !ec_read_value("Period (s, 0 = single pulse): ", &cfg.period)) {
+            return;
+        }
+    } else if (source == 3) {
+        if (g_sa_ctx.sig.count <= 0) {
+            printf("\nNo samples available. "
+                   "Please enter or load samples in the Signal Analyzer first.\n");
+            return;
+        }
+        cfg.source = CC_SRC_SAMPLED;
+        cfg.input  = &g_sa_ctx;
+    } else {
+        printf("Invalid option.\n");
+        return;
+    }
+
+    cfg.sample_rate = uc_get_double(source == 3 ? "Sample rate of the loaded samples (Hz): "
+                                                : "Output sample rate (Hz): ");
+    if (source == 3) {
+        cfg.duration = (g_sa_ctx.sig.count - 1) / (cfg.sample_rate > 0.0 ? cfg.sample_rate : 1.0);
+        printf("Simulating the %d samples (%.6g s).\n", g_sa_ctx.sig.count, cfg.duration);
+    } else {
+        cfg.duration = uc_get_double("Duration (s): ");
+    }
+    if (!ec_read_value("Node to record (1 = first, 0 = output): ", &probe)) {
+        return;
+    }
+    cfg.probe = (probe < 1 || probe > cfg.nsections) ? cfg.nsections : (int)probe;
+
+    CcLadderSection *ladder = malloc((size_t)cfg.nsections * sizeof(*ladder));
+    if (!ladder) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    for (int k = 0; k < cfg.nsections; k++) {
+        ladder[k] = sec;
+    }
+    if (R_load > 0.0) {
+        ladder[cfg.nsections - 1].G = 1.0 / R_load;
+    }
+    cfg.section = ladder;
+
+    SignalContext result;
+    sa_ctx_init(&result);
+    double t0 = sa_live_now();
+    int status = cc_transient(&cfg, &result, "signal_transient.txt", &st);
+    double dt = sa_live_now() - t0;
+    free(ladder);
+
+    if (status != SA_OK) {
+        sa_ctx_free(&result);
+        if (status == SA_ERR_OPEN) {
+            printf("Error: Could not write 'signal_transient.txt'.\n");
+        } else if (status == SA_ERR_MEMORY) {
+            printf("Error: Out of memory.\n");
+        } else {
+            printf("Invalid timing (rate > 0, width > 0, period above the width, at most %d output samples) "
+                   "or an inductor with no C or load after it.\n", CC_TR_MAX_OUTPUT);
+        }
+        return;
+    }
+
+    SignalStats *sig = &result.sig;
+    sa_signal_refresh(sig);
+    printf("\nNode %d of %d, %d samples at %g Hz:\n", cfg.probe, cfg.nsections, sig->count, cfg.sample_rate);
+    printf("  Steps      : %lld (%lld rejected), %lld factorizations\n", st.steps, st.rejected, st.factorizations);
+    if (st.steps > 0) {
+        printf("  Step size  : %.4g .. %.4g s\n", st.h_min, st.h_max);
+    }
+    printf("  Final      : %.6g V   min %.6g V   max %.6g V\n", sig->samples[sig->count - 1], sig->min, sig->max);
+    printf("  (%.3f s)\n", dt);
+
+    /* Preview: 16 evenly spaced samples, bars measured from the minimum */
+    enum { NROWS = 16, MAX_BAR = 40 };
+    double span = sig->max - sig->min;
+    for (int row = 0; row < NROWS && sig->count > 1; row++) {
+        int i = (int)((long long)row * (sig->count - 1) / (NROWS - 1));
+        int bar = (span > 0.0) ? (int)((sig->samples[i] - sig->min) / span * MAX_BAR + 0.5) : 0;
+        printf("%12.5g s %12.6g V |", i / cfg.sample_rate, sig->samples[i]);
+        for (int j = 0; j < bar; j++) {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+
+    /* The waveform replaces the Signal Analyzer samples */
+    sa_ctx_free(&g_sa_ctx);
+    g_sa_ctx = result;
+    printf("\nWaveform saved to 'signal_transient.txt' and loaded into the Signal Analyzer "
+           "(statistics, plot, spectrogram...).\n");
+}
+
+/* ============================================== *
+ * 3. Circuit Calculator: Bode sweep              *
+ * ============================================== */
+
+/* Magnitude and phase of an analog filter, H(s) a cascade of first/second- *
+ * order sections, over a log-spaced sweep of up to 10^8 frequencies.       *
+ *  - Points are evaluated a block at a time, two frequencies per SSE2      *
+ *    register: each section contributes |N|^2/|D|^2 to the magnitude and   *
+ *    arg(N conj D) to the phase.  The phase is a sum of per-section         *
+ *    angles, each continuous over the sweep, so no unwrapping pass (and no *
+ *    dependency between neighbouring points) is needed.                   *
+ *  - atan2 and log10 are polynomial forms run in the same registers        *
+ *    (Cephes atan, atanh series for the log); libm calls would cost more   *
+ *    than the rest of the evaluation.                                     *
+ *  - Batches of points are shared out to threads, each formatting its     *
+ *    share (CSV text or float32 pairs) into its own buffer, while the      *
+ *    previous batch is written, as in the spectrogram.                     *
+ * Binary file: CcBodeHeader, then `points` pairs of float32 (magnitude dB, *
+ * phase degrees), frequency i = f_start (f_stop/f_start)^(i/(points-1)),   *
+ * native byte order.                                                       */
+
+#define CC_BODE_BLOCK        256            /* points evaluated together */
+#define CC_BODE_BATCH        (1 << 18)      /* points per batch */
+#define CC_BODE_MAX_THREADS  16
+#define CC_BODE_CSV_LINE     100            /* bytes reserved per CSV line */
+#define CC_BODE_FLOOR_DB     (-1000.0)      /* magnitude shown for H = 0 */
+
+typedef struct {
+    char     magic[4];            /* "ETKB" */
+    uint32_t version;             /* 1 */
+    uint64_t points;
+    double   f_start, f_stop;     /* Hz */
+} CcBodeHeader;
+
+typedef struct {
+    const CcAnalogFilter *flt;
+    long long points;
+    double    log_f0, dlog;        /* ln f_start, ln step between points */
+    double    rpow[CC_BODE_BLOCK]; /* step ratio^j */
+    int       format;
+} CcBodeRun;
+
+typedef struct {
+    const CcBodeRun *run;
+    long long first, count;        /* share of the current batch */
+    char     *buf[2];              /* output of even / odd batches */
+    size_t    len[2];
+    int       cur;
+    double    peak_db;
+    long long peak_at;
+    double    w[CC_BODE_BLOCK], mag[CC_BODE_BLOCK], phase[CC_BODE_BLOCK];
+} CcBodeJob;
+
+int cc_filter_rc(CcAnalogFilter *flt, double R, double C_uF, int highpass)
+{
+    memset(flt, 0, sizeof(*flt));
+    if (!(R > 0.0) || !(C_uF > 0.0)) {
+        return 0;
+    }
+    double tau = R * C_uF * 1e-6;
+    CcBodeSection *s = &flt->sec[flt->nsections++];
+    s->b[highpass ? 1 : 0] = highpass ? tau : 1.0;         /* sRC / (1 + sRC) or 1 / (1 + sRC) */
+    s->a[0] = 1.0;
+    s->a[1] = tau;
+    snprintf(flt->name, sizeof(flt->name), "RC %s-pass, fc %.6g Hz", highpass ? "high" : "low",
+             1.0 / (2.0 * M_PI * tau));
+    return 1;
+}
+int cc_filter_butterworth(CcAnalogFilter *flt, int highpass, int order, double fc)
+{
+    memset(flt, 0, sizeof(*flt));
+    if (order < 1 || order > 2 * CC_BODE_MAX_SECTIONS || !(fc > 0.0)) {
+        return 0;
+    }
+    double wc = 2.0 * M_PI * fc;
+    /* Normalised poles: s^2 + 2 sin((2k+1) pi / 2n) s + 1 per pair, (s + 1) if n is odd */
+    for (int k = 0; k < order / 2; k++) {
+        CcBodeSection *s = &flt->sec[flt->nsections++];
+        double d = 2.0 * sin((2 * k + 1) * M_PI / (2.0 * order));
+        s->b[highpass ? 2 : 0] = highpass ? 1.0 / (wc * wc) : 1.0;
+        s->a[0] = 1.0;
+        s->a[1] = d / wc;
+        s->a[2] = 1.0 / (wc * wc);
+    }
+    if (order % 2 != 0) {
+        CcBodeSection *s = &flt->sec[flt->nsections++];
+        s->b[highpass ? 1 : 0] = highpass ? 1.0 / wc : 1.0;
+        s->a[0] = 1.0;
+        s->a[1] = 1.0 / wc;
+    }
+    snprintf(flt->name, sizeof(flt->name), "Butterworth %s-pass, order %d, fc %.6g Hz",
+             highpass ? "high" : "low", order, fc);
+    return 1;
+}
+int cc_filter_rlc_bandpass(CcAnalogFilter *flt, double R, double L, double C_uF)
+{
+    memset(flt, 0, sizeof(*flt));
+    if (!(R > 0.0) || !(L > 0.0) || !(C_uF > 0.0)) {
+        return 0;
+    }
+    double C = C_uF * 1e-6;
+    CcBodeSection *s = &flt->sec[flt->nsections++];
+    s->b[1] = R * C;                                        /* across R: sRC / (1 + sRC + s^2 LC) */
+    s->a[0] = 1.0;
+    s->a[1] = R * C;
+    s->a[2] = L * C;
+    snprintf(flt->name, sizeof(flt->name), "Series RLC band-pass, f0 %.6g Hz, Q %.4g",
+             1.0 / (2.0 * M_PI * sqrt(L * C)), sqrt(L / C) / R);
+    return 1;
+}
+
+/* atan(x) for 0 <= x <= 1 (Cephes: reduced below 0.66, rational 4/5) */
+static const double cc_atan_p[5] = {
+    -8.750608600031904122785e-01, -1.615753718733365076637e+01, -7.500855792314704667340e+01,
+    -1.228866684490136173410e+02, -6.485021904942025371773e+01
+};
+static const double cc_atan_q[5] = {
+    2.485846490142306297962e+01, 1.650270098316988542046e+02, 4.328810604912902668951e+02,
+    4.853903996359136964868e+02, 1.945506571482613964425e+02
+};
+static inline double cc_atan2(double y, double x)
+{
+    double ax = fabs(x), ay = fabs(y);
+    double hi = (ax > ay) ? ax : ay, lo = (ax > ay) ? ay : ax;
+    double a = (hi > 0.0) ? lo / hi : 0.0, base = 0.0;
+    if (a > 0.66) {
+        a = (a - 1.0) / (a + 1.0);
+        base = M_PI / 4;
+    }
+    double z = a * a;
+    double p = (((cc_atan_p[0] * z + cc_atan_p[1]) * z + cc_atan_p[2]) * z + cc_atan_p[3]) * z + cc_atan_p[4];
+    double q = ((((z + cc_atan_q[0]) * z + cc_atan_q[1]) * z + cc_atan_q[2]) * z + cc_atan_q[3]) * z + cc_atan_q[4];
+    double r = base + a + a * z * p / q;
+    if (ay > ax) r = M_PI / 2 - r;
+    if (x < 0.0) r = M_PI - r;
+    return (y < 0.0) ? -r : r;
+}
+/* 10 log10(p), p > 0 normal: exponent from the bits, atanh series for the mantissa */
+static inline double cc_bode_db(double p)
+{
+    uint64_t bits;
+    double m;
+    memcpy(&bits, &p, sizeof(bits));
+    int e = (int)(bits >> 52) - 1023;
+    bits = (bits & 0xfffffffffffffULL) | 0x3ff0000000000000ULL;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > M_SQRT2) {
+        m *= 0.5;
+        e++;
+    }
+    double s = (m - 1.0) / (m + 1.0), s2 = s * s;
+    double ln = 2.0 * s * (1.0 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7 + s2 * (1.0 / 9 + s2 / 11)))));
+    return 3.0102999566398120 * e + 4.3429448190325183 * ln;
+}
+/* Points first .. first+n-1 (n <= CC_BODE_BLOCK) into job->mag (dB) and job->phase (degrees) */
+static void cc_bode_block(CcBodeJob *job, long long first, int n)
+{
+    const CcBodeRun *run = job->run;
+    const CcAnalogFilter *flt = run->flt;
+    double w0 = 2.0 * M_PI * exp(run->log_f0 + (double)first * run->dlog);
+    double *w = job->w, *mag = job->mag, *ph = job->phase;
+
+    for (int j = 0; j < n; j++) {
+        w[j]   = w0 * run->rpow[j];
+        mag[j] = 1.0;
+        ph[j]  = 0.0;
+    }
+    for (int k = 0; k < flt->nsections; k++) {
+        const CcBodeSection *s = &flt->sec[k];
+        int j = 0;
+#if defined(__SSE2__)
+        const __m128d b0 = _mm_set1_pd(s->b[0]), b1 = _mm_set1_pd(s->b[1]), b2 = _mm_set1_pd(s->b[2]);
+        const __m128d a0 = _mm_set1_pd(s->a[0]), a1 = _mm_set1_pd(s->a[1]), a2 = _mm_set1_pd(s->a[2]);
+        const __m128d sign = _mm_set1_pd(-0.0), tiny = _mm_set1_pd(DBL_MIN);
+        const __m128d c066 = _mm_set1_pd(0.66), one = _mm_set1_pd(1.0), zero = _mm_setzero_pd();
+        const __m128d pi = _mm_set1_pd(M_PI), pi_2 = _mm_set1_pd(M_PI / 2), pi_4 = _mm_set1_pd(M_PI / 4);
+        for (; j + 2 <= n; j += 2) {
+            __m128d om = _mm_loadu_pd(w + j), om2 = _mm_mul_pd(om, om);
+            __m128d nr = _mm_sub_pd(b0, _mm_mul_pd(b2, om2)), ni = _mm_mul_pd(b1, om);
+            __m128d dr = _mm_sub_pd(a0, _mm_mul_pd(a2, om2)), di = _mm_mul_pd(a1, om);
+            __m128d nn = _mm_add_pd(_mm_mul_pd(nr, nr), _mm_mul_pd(ni, ni));
+            __m128d dd = _mm_add_pd(_mm_mul_pd(dr, dr), _mm_mul_pd(di, di));
+            _mm_storeu_pd(mag + j, _mm_mul_pd(_mm_loadu_pd(mag + j), _mm_div_pd(nn, dd)));
+
+            /* arg(N conj D) by the same steps as cc_atan2, masks in place of branches */
+            __m128d x  = _mm_add_pd(_mm_mul_pd(nr, dr), _mm_mul_pd(ni, di));
+            __m128d y  = _mm_sub_pd(_mm_mul_pd(ni, dr), _mm_mul_pd(nr, di));
+            __m128d ax = _mm_andnot_pd(sign, x), ay = _mm_andnot_pd(sign, y);
+            __m128d a  = _mm_div_pd(_mm_min_pd(ax, ay), _mm_max_pd(_mm_max_pd(ax, ay), tiny));
+            __m128d big = _mm_cmpgt_pd(a, c066);
+            __m128d red = _mm_div_pd(_mm_sub_pd(a, one), _mm_add_pd(a, one));
+            a = _mm_or_pd(_mm_and_pd(big, red), _mm_andnot_pd(big, a));
+            __m128d z = _mm_mul_pd(a, a);
+            __m128d p = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(cc_atan_p[0]), z), _mm_set1_pd(cc_atan_p[1]));
+            p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(cc_atan_p[2]));
+            p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(cc_atan_p[3]));
+            p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(cc_atan_p[4]));
+            __m128d q = _mm_add_pd(z, _mm_set1_pd(cc_atan_q[0]));
+            q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cc_atan_q[1]));
+            q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cc_atan_q[2]));
+            q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cc_atan_q[3]));
+            q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(cc_atan_q[4]));
+            __m128d r = _mm_add_pd(_mm_and_pd(big, pi_4),
+                                   _mm_add_pd(a, _mm_div_pd(_mm_mul_pd(_mm_mul_pd(a, z), p), q)));
+            __m128d steep = _mm_cmpgt_pd(ay, ax), left = _mm_cmplt_pd(x, zero);
+            r = _mm_or_pd(_mm_and_pd(steep, _mm_sub_pd(pi_2, r)), _mm_andnot_pd(steep, r));
+            r = _mm_or_pd(_mm_and_pd(left, _mm_sub_pd(pi, r)), _mm_andnot_pd(left, r));
+            r = _mm_xor_pd(r, _mm_and_pd(_mm_cmplt_pd(y, zero), sign));
+            _mm_storeu_pd(ph + j, _mm_add_pd(_mm_loadu_pd(ph + j), r));
+        }
+#endif
+        for (; j < n; j++) {
+            double om = w[j], om2 = om * om;
+            double nr = s->b[0] - s->b[2] * om2, ni = s->b[1] * om;
+            double dr = s->a[0] - s->a[2] * om2, di = s->a[1] * om;
+            mag[j] *= (nr * nr + ni * ni) / (dr * dr + di * di);
+            ph[j]  += cc_atan2(ni * dr - nr * di, nr * dr + ni * di);
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        mag[j] = (mag[j] > 0.0 && mag[j] < HUGE_VAL) ? cc_bode_db(mag[j] + DBL_MIN)
+                                                     : (mag[j] > 0.0 ? -CC_BODE_FLOOR_DB : CC_BODE_FLOOR_DB);
+        ph[j] *= 180.0 / M_PI;
+    }
+}
+static void *cc_bode_thread(void *arg)
+{
+    CcBodeJob *job = arg;
+    const CcBodeRun *run = job->run;
+    char *out = job->buf[job->cur];
+    size_t len = 0;
+
+    for (long long i = 0; i < job->count; i += CC_BODE_BLOCK) {
+        int n = (job->count - i < CC_BODE_BLOCK) ? (int)(job->count - i) : CC_BODE_BLOCK;
+        long long first = job->first + i;
+        cc_bode_block(job, first, n);
+        for (int j = 0; j < n; j++) {
+            if (job->mag[j] > job->peak_db) {
+                job->peak_db = job->mag[j];
+                job->peak_at = first + j;
+            }
+            if (run->format == CC_BODE_CSV) {
+                len += (size_t)sa_fmt_general(out + len, job->w[j] / (2.0 * M_PI), 10);
+                out[len++] = ',';
+                len += (size_t)sa_fmt_general(out + len, job->mag[j], 8);
+                out[len++] = ',';
+                len += (size_t)sa_fmt_general(out + len, job->phase[j], 8);
+                out[len++] = '\n';
+            } else {
+                float pair[2] = { (float)job->mag[j], (float)job->phase[j] };
+                memcpy(out + len, pair, sizeof(pair));
+                len += sizeof(pair);
+            }
+        }
+    }
+    job->len[job->cur] = len;
+    return NULL;
+}
+/* Response at one frequency, through the same code as the sweep */
+static void cc_bode_point(const CcBodeRun *run, double f, double *mag_db, double *phase_deg)
+{
+    CcBodeRun one = *run;
+    CcBodeJob job;
+
+    memset(&job, 0, sizeof(job));
+    one.log_f0 = log(f);
+    job.run = &one;
+    cc_bode_block(&job, 0, 1);
+    *mag_db = job.mag[0];
+    *phase_deg = job.phase[0];
+}
+/* Frequency between lo and hi (response above / below level at lo) where it crosses level */
+static double cc_bode_crossing(const CcBodeRun *run, double lo, double hi, double level)
+{
+    double m, p, above_at_lo;
+    cc_bode_point(run, lo, &above_at_lo, &p);
+    above_at_lo = (above_at_lo >= level);
+    for (int it = 0; it < 60; it++) {
+        double mid = sqrt(lo * hi);
+        cc_bode_point(run, mid, &m, &p);
+        if ((m >= level) == above_at_lo) lo = mid;
+        else hi = mid;
+    }
+    return sqrt(lo * hi);
+}
+int cc_bode_sweep(const CcAnalogFilter *flt, double f_start, double f_stop, long long points,
+                  const char *filename, int format, CcBodeResult *res)
+{
+    if (flt->nsections < 1 || flt->nsections > CC_BODE_MAX_SECTIONS ||
+        !(f_start > 0.0) || !(f_stop > f_start) || !isfinite(f_stop) ||
+        points < CC_BODE_MIN_POINTS || points > CC_BODE_MAX_POINTS ||
+        (format != CC_BODE_BINARY && format != CC_BODE_CSV)) {
+        return SA_ERR_FORMAT;
+    }
+
+    CcBodeRun *run = malloc(sizeof(*run));
+    if (!run) {
+        return SA_ERR_MEMORY;
+    }
+    run->flt    = flt;
+    run->points = points;
+    run->format = format;
+    run->log_f0 = log(f_start);
+    run->dlog   = (log(f_stop) - run->log_f0) / (double)(points - 1);
+    for (int j = 0; j < CC_BODE_BLOCK; j++) {
+        run->rpow[j] = exp(j * run->dlog);
+    }
+
+    long long batch = (points < CC_BODE_BATCH) ? points : CC_BODE_BATCH;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = (cores > 1) ? (int)cores : 1;
+    if (nthreads > CC_BODE_MAX_THREADS) nthreads = CC_BODE_MAX_THREADS;
+    if (nthreads > (batch + CC_BODE_BLOCK - 1) / CC_BODE_BLOCK) nthreads = (int)((batch + CC_BODE_BLOCK - 1) / CC_BODE_BLOCK);
+    long long per = (batch + nthreads - 1) / nthreads;
+    per = (per + CC_BODE_BLOCK - 1) / CC_BODE_BLOCK * CC_BODE_BLOCK;
+    size_t share_bytes = (size_t)per * ((format == CC_BODE_CSV) ? CC_BODE_CSV_LINE : 2 * sizeof(float)) + SA_FMT_MAX;
+
+    CcBodeJob *job = calloc((size_t)nthreads, sizeof(CcBodeJob));
+    FILE *fp = NULL;
+    int status = job ? SA_OK : SA_ERR_MEMORY;
+    for (int t = 0; status == SA_OK && t < nthreads; t++) {
+        job[t].run     = run;
+        job[t].peak_db = -HUGE_VAL;
+        job[t].buf[0]  = malloc(share_bytes);
+        job[t].buf[1]  = malloc(share_bytes);
+        if (!job[t].buf[0] || !job[t].buf[1]) {
+            status = SA_ERR_MEMORY;
+        }
+    }
+    if (status == SA_OK && filename) {
+        fp = fopen(filename, (format == CC_BODE_CSV) ? "w" : "wb");
+        if (!fp) {
+            status = SA_ERR_OPEN;
+        } else if (format == CC_BODE_CSV) {
+            if (fputs("frequency_hz,magnitude_db,phase_deg\n", fp) == EOF) status = SA_ERR_OPEN;
+        } else {
+            CcBodeHeader hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            memcpy(hdr.magic, "ETKB", 4);
+            hdr.version = 1;
+            hdr.points  = (uint64_t)points;
+            hdr.f_start = f_start;
+            hdr.f_stop  = f_stop;
+            if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) status = SA_ERR_OPEN;
+        }
+    }
+
+    /* Batch b is computed into the buf[b & 1] of every job while buf[(b - 1) & 1] is written */
+    long long nbatches = (points + batch - 1) / batch;
+    for (long long b = 0; status == SA_OK && b <= nbatches; b++) {
+        pthread_t tid[CC_BODE_MAX_THREADS];
+        int created[CC_BODE_MAX_THREADS] = { 0 };
+        long long first = b * batch;
+        long long count = (b < nbatches) ? ((points - first < batch) ? points - first : batch) : 0;
+
+        for (int t = 0; t < nthreads && count > 0; t++) {
+            long long begin = (long long)t * per;
+            job[t].cur   = (int)(b & 1);
+            job[t].first = first + begin;
+            job[t].count = (begin >= count) ? 0 : ((count - begin < per) ? count - begin : per);
+            if (t > 0) {
+                created[t] = (pthread_create(&tid[t], NULL, cc_bode_thread, &job[t]) == 0);
+            }
+        }
+        for (int t = 0; b > 0 && fp && t < nthreads; t++) {
+            size_t len = job[t].len[(b - 1) & 1];
+            if (len > 0 && fwrite(job[t].buf[(b - 1) & 1], 1, len, fp) != len) {
+                status = SA_ERR_OPEN;
+            }
+            job[t].len[(b - 1) & 1] = 0;
+        }
+        for (int t = 0; t < nthreads && count > 0; t++) {
+            if (t == 0 || !created[t]) {
+                cc_bode_thread(&job[t]);          /* this thread's share, or one that failed to start */
+            }
+        }
+        for (int t = 1; t < nthreads && count > 0; t++) {
+            if (created[t]) pthread_join(tid[t], NULL);
+        }
+    }
+    if (fp && fclose(fp) != 0 && status == SA_OK) {
+        status = SA_ERR_OPEN;
+    }
+
+    if (status == SA_OK) {
+        memset(res, 0, sizeof(*res));
+        res->points  = points;
+        res->f_start = f_start;
+        res->f_stop  = f_stop;
+        res->peak_db = -HUGE_VAL;
+        for (int t = 0; t < nthreads; t++) {
+            if (job[t].peak_db > res->peak_db) {
+                res->peak_db = job[t].peak_db;
+                res->peak_hz = exp(run->log_f0 + (double)job[t].peak_at * run->dlog);
+            }
+        }
+        for (int c = 0; c < CC_BODE_COLS; c++) {
+            long long i = llround((double)c * (double)(points - 1) / (CC_BODE_COLS - 1));
+            res->col_hz[c] = exp(run->log_f0 + (double)i * run->dlog);
+            cc_bode_point(run, res->col_hz[c], &res->col_db[c], &res->col_phase[c]);
+        }
+
+        /* -3 dB edges: walk out from the peak on a coarse grid, then bisect */
+        double level = res->peak_db - 3.0103, m, p;
+        enum { GRID = 4096 };
+        double step = (log(f_stop) - log(f_start)) / GRID, prev = res->peak_hz;
+        for (double lf = log(res->peak_hz) - step; lf > run->log_f0 - step / 2; lf -= step) {
+            double f = exp(lf);
+            cc_bode_point(run, f, &m, &p);
+            if (m < level) {
+                res->f_low_3db = cc_bode_crossing(run, f, prev, level);
+                break;
+            }
+            prev = f;
+        }
+        prev = res->peak_hz;
+        for (double lf = log(res->peak_hz) + step; lf < log(f_stop) + step / 2; lf += step) {
+            double f = exp(lf);
+            cc_bode_point(run, f, &m, &p);
+            if (m < level) {
+                res->f_high_3db = cc_bode_crossing(run, prev, f, level);
                 break;
             }
-            case 4: { /* °F <-> °C */
-                printf("\n1) °F -> °C\n2) °C -> °F\n");
-                int dir = uc_get_choice();
-                if (dir == 1) {                           /* °F to °C: °C = (°F − 32)·5/9 */
-                    double f = uc_get_double("Enter temperature in °F: ");
-                    double c = (f - 32.0) * 5.0 / 9.0;
-                    printf("Result: %.2f °C\n", c);
-                } else if (dir == 2) {                    /* °C to °F: °F = °C·9/5 + 32 */
-                    double c = uc_get_double("Enter temperature in °C: ");
-                    double f = (c * 9.0 / 5.0) + 32.0;
-                    printf("Result: %.2f °F\n", f);
-                }
+            prev = f;
+        }
+    }
+    for (int t = 0; job && t < nthreads; t++) {
+        free(job[t].buf[0]);
+        free(job[t].buf[1]);
+    }
+    free(job);
+    free(run);
+    return status;
+}
+/* ASCII Bode plot: magnitude and phase against log frequency, one column per CcBodeResult point */
+static void cc_bode_plot(const CcBodeResult *res)
+{
+    enum { MAG_ROWS = 16, PHASE_ROWS = 10 };
+    double top = ceil(res->peak_db / 10.0) * 10.0 + 0.0;             /* + 0.0: no "-0.0" label */
+    double lowest = top;
+    for (int c = 0; c < CC_BODE_COLS; c++) {
+        if (res->col_db[c] < lowest) lowest = res->col_db[c];
+    }
+    double step = ceil((top - lowest) / (MAG_ROWS - 1) / 5.0) * 5.0;   /* dB per row, multiple of 5 */
+    if (step < 5.0) step = 5.0;
+    double pmax = res->col_phase[0], pmin = res->col_phase[0];
+    for (int c = 1; c < CC_BODE_COLS; c++) {
+        if (res->col_phase[c] > pmax) pmax = res->col_phase[c];
+        if (res->col_phase[c] < pmin) pmin = res->col_phase[c];
+    }
+    double ptop = ceil(pmax / 45.0) * 45.0, pbot = floor(pmin / 45.0) * 45.0;
+    if (ptop - pbot < 45.0) {
+        ptop += 45.0;
+    }
+    double pstep = (ptop - pbot) / (PHASE_ROWS - 1);
+
+    printf("\nMagnitude (dB)\n");
+    for (int r = 0; r < MAG_ROWS; r++) {
+        double level = top - r * step;
+        char line[32 + CC_BODE_COLS];
+        int len = snprintf(line, 24, "%8.1f |", level);
+        for (int c = 0; c < CC_BODE_COLS; c++) {
+            double v = res->col_db[c];
+            int hit = (r == MAG_ROWS - 1) ? (v < level + step / 2) : (v >= level - step / 2 && v < level + step / 2);
+            line[len++] = hit ? '*' : (r == MAG_ROWS - 1 ? '_' : ' ');
+        }
+        line[len++] = '\n';
+        fwrite(line, 1, (size_t)len, stdout);
+    }
+    printf("\nPhase (degrees)\n");
+    for (int r = 0; r < PHASE_ROWS; r++) {
+        double level = ptop - r * pstep;
+        char line[32 + CC_BODE_COLS];
+        int len = snprintf(line, 24, "%8.1f |", level);
+        for (int c = 0; c < CC_BODE_COLS; c++) {
+            double v = res->col_phase[c];
+            line[len++] = (v >= level - pstep / 2 && v < level + pstep / 2) ? '*' : (r == PHASE_ROWS - 1 ? '_' : ' ');
+        }
+        line[len++] = '\n';
+        fwrite(line, 1, (size_t)len, stdout);
+    }
+    char right[32];
+    snprintf(right, sizeof(right), "%.4g Hz", res->f_stop);
+    printf("%10s%-*.4g%s\n", "", CC_BODE_COLS - (int)strlen(right), res->f_start, right);
+}
+static void cc_bode_menu(void)
+{
+    CcAnalogFilter flt;
+    double R = 0.0, L = 0.0, C_uF = 0.0, fc = 0.0, order = 0.0;
+    double f_start = 0.0, f_stop = 0.0, points = 0.0;
+    int ok = 0;
+
+    printf("\n[Bode sweep]\n");
+    printf("1. RC low-pass\n2. RC high-pass\n3. Butterworth low-pass\n4. Butterworth high-pass\n");
+    printf("5. Series RLC band-pass (output across R)\n");
+    int type = uc_get_choice();
+    if (type == 1 || type == 2) {
+        ok = ec_read_value("R (ohms): ", &R) && ec_read_value("C (uF): ", &C_uF) &&
+             cc_filter_rc(&flt, R, C_uF, type == 2);
+    } else if (type == 3 || type == 4) {
+        ok = ec_read_value("Cutoff frequency fc (Hz): ", &fc) && ec_read_value("Order (1-32): ", &order) &&
+             order >= 1.0 && order <= 2.0 * CC_BODE_MAX_SECTIONS &&
+             cc_filter_butterworth(&flt, type == 4, (int)order, fc);
+    } else if (type == 5) {
+        ok = ec_read_value("R (ohms): ", &R) && ec_read_value("L (H, e.g. 10m): ", &L) &&
+             ec_read_value("C (uF): ", &C_uF) && cc_filter_rlc_bandpass(&flt, R, L, C_uF);
+    } else {
+        printf("Invalid option.\n");
+        return;
+    }
+    if (!ok) {
+        printf("Component values and fc must be > 0, order 1-32.\n");
+        return;
+    }
+    if (!ec_read_value("Start frequency (Hz): ", &f_start) ||
+        !ec_read_value("Stop frequency (Hz): ", &f_stop) ||
+        !ec_read_value("Points (2-100M, e.g. 1M): ", &points)) {
+        return;
+    }
+    if (!(points >= CC_BODE_MIN_POINTS && points <= CC_BODE_MAX_POINTS)) {
+        printf("Frequencies must satisfy 0 < start < stop, with 2 to %d points.\n", CC_BODE_MAX_POINTS);
+        return;
+    }
+    printf("Save as 1) binary (signal_bode.bin)  2) CSV (signal_bode.csv)\n");
+    int format = (uc_get_choice() == 2) ? CC_BODE_CSV : CC_BODE_BINARY;
+    const char *filename = (format == CC_BODE_CSV) ? "signal_bode.csv" : "signal_bode.bin";
+
+    CcBodeResult res;
+    double t0 = sa_live_now();
+    int status = cc_bode_sweep(&flt, f_start, f_stop, (long long)points, filename, format, &res);
+    double dt = sa_live_now() - t0;
+    if (status == SA_ERR_OPEN) {
+        printf("Error: Could not write '%s'.\n", filename);
+        return;
+    } else if (status == SA_ERR_MEMORY) {
+        printf("Error: Out of memory.\n");
+        return;
+    } else if (status != SA_OK) {
+        printf("Frequencies must satisfy 0 < start < stop, with 2 to %d points.\n", CC_BODE_MAX_POINTS);
+        return;
+    }
+
+    printf("\n%s\n", flt.name);
+    printf("  Peak       : %.4f dB at %.6g Hz\n", res.peak_db, res.peak_hz);
+    if (res.f_low_3db > 0.0)  printf("  -3 dB low  : %.6g Hz\n", res.f_low_3db);
+    if (res.f_high_3db > 0.0) printf("  -3 dB high : %.6g Hz\n", res.f_high_3db);
+    printf("  %lld points written to '%s' in %.3f s", res.points, filename, dt);
+    if (dt > 0.0) printf(" (%.1f M points/s)", res.points / dt / 1e6);
+    printf("\n");
+    cc_bode_plot(&res);
+}
+
+/* ================================== *
+ * 4. Resistor Colour Decoder Module  *
+ * ================================== */
+void menu_resistor_colour_decoder(void)       /* Submenu */
+{
+    int running = 1;
+
+    while (running) {
+        printf("\n[Resistor Colour Decoder]\n");
+        printf("1. Decode 4-band resistor\n");
+        printf("2. Decode 5-band resistor\n");
+        printf("3. Back to Main Menu\n");
+        printf("---------------------------\n");
+
+        int choice = uc_get_choice();
+
+        switch (choice) {
+            case 1:
+                resistor_decode_4band();
                 break;
-            }
-            case 5: { /* V <-> dBV */
-                printf("\n1) V -> dBV\n2) dBV -> V\n");
-                int dir = uc_get_choice();
-                if (dir == 1) {                          /* V to dBV: dBV = 20·log10(V), V > 0 */
-                    double v = 0.0;
-                    do {
-                        v = uc_get_double("Enter voltage in V (> 0): ");
-                        if (v <= 0.0) {
-                            printf("Voltage must be > 0 for dBV conversion.\n");
-                        }
-                    } while (v <= 0.0);
-                    double dbv = 20.0 * log10(v);
-                    printf("Result: %.6f dBV\n", dbv);
-                } else if (dir == 2) {                   /* dBV to V: V = 10^(dBV/20) */
-                    double dbv = uc_get_double("Enter level in dBV: ");
-                    double v = pow(10.0, dbv / 20.0);
-                    printf("Result: %.6f V\n", v);
-                }
+            case 2:
+                resistor_decode_5band();
+                break;
+            case 3:
+                running = 0;
+                break;
+            default:
+                printf("Unknown option.\n");
                 break;
+        }
+    }
+}
+
+/* ===================================== *
+ * 4. Resistor Colour Decoder Functions  *
+ * ===================================== */
+static void resistor_decode_4band(void)       /* 4 band resistor */
+{
+    char b1[32], b2[32], b3[32], b4[32];
+
+    printf("\n[4-band resistor colour decoder]\n");
+    printf("Supported colours:\n");
+    printf("  black, brown, red, orange, yellow, green, blue,\n");
+    printf("  violet, grey, white, gold, silver (tolerance only)\n\n");
+
+    /* Read 4 band colours */
+    printf("Enter band 1 colour (first digit): ");
+    if (!fgets(b1, sizeof(b1), stdin)) return;
+    printf("Enter band 2 colour (second digit): ");
+    if (!fgets(b2, sizeof(b2), stdin)) return;
+    printf("Enter band 3 colour (multiplier): ");
+    if (!fgets(b3, sizeof(b3), stdin)) return;
+    printf("Enter band 4 colour (tolerance): ");
+    if (!fgets(b4, sizeof(b4), stdin)) return;
+
+    /* Remove line breaks (colours are matched case-insensitively) / 去掉换行 */
+    b1[strcspn(b1, "\r\n")] = '\0';
+    b2[strcspn(b2, "\r\n")] = '\0';
+    b3[strcspn(b3, "\r\n")] = '\0';
+    b4[strcspn(b4, "\r\n")] = '\0';
+
+    const char *bands[4] = { b1, b2, b3, b4 };
+    double R = 0.0;
+    double tol = 0.0;
+    int bad = etk_resistor_decode(bands, 4, &R, &tol);
+
+    if (bad == 1 || bad == 2) {
+        printf("Error: invalid colour in first or second band.\n");
+        return;
+    }
+    if (bad == 3) {
+        printf("Error: invalid multiplier colour.\n");
+        return;
+    }
+    if (bad == 4) {
+        printf("Error: invalid tolerance colour.\n");
+        return;
+    }
+
+    resistor_print_result("4-band", R, tol);
+}
+static void resistor_decode_5band(void)       /* 5 band resistor */
+{
+    char b1[32], b2[32], b3[32], b4[32], b5[32];
+
+    printf("\n[5-band resistor colour decoder]\n");
+    printf("Supported colours (digits & multiplier):\n");
+    printf("  black, brown, red, orange, yellow, green, blue,\n");
+    printf("  violet, grey, white, gold, silver (mult/tolerance)\n\n");
+
+    /* Read 5 band colours */
+    printf("Enter band 1 colour (first digit): ");
+    if (!fgets(b1, sizeof(b1), stdin)) return;
+    printf("Enter band 2 colour (second digit): ");
+    if (!fgets(b2, sizeof(b2), stdin)) return;
+    printf("Enter band 3 colour (third digit): ");
+    if (!fgets(b3, sizeof(b3), stdin)) return;
+    printf("Enter band 4 colour (multiplier): ");
+    if (!fgets(b4, sizeof(b4), stdin)) return;
+    printf("Enter band 5 colour (tolerance): ");
+    if (!fgets(b5, sizeof(b5), stdin)) return;
+
+    /* Remove line breaks (colours are matched case-insensitively) / 去掉换行 */
+    b1[strcspn(b1, "\r\n")] = '\0';
+    b2[strcspn(b2, "\r\n")] = '\0';
+    b3[strcspn(b3, "\r\n")] = '\0';
+    b4[strcspn(b4, "\r\n")] = '\0';
+    b5[strcspn(b5, "\r\n")] = '\0';
+
+    const char *bands[5] = { b1, b2, b3, b4, b5 };
+    double R = 0.0;
+    double tol = 0.0;
+    int bad = etk_resistor_decode(bands, 5, &R, &tol);
+
+    if (bad >= 1 && bad <= 3) {
+        printf("Error: invalid colour in first, second or third band.\n");
+        return;
+    }
+    if (bad == 4) {
+        printf("Error: invalid multiplier colour.\n");
+        return;
+    }
+    if (bad == 5) {
+        printf("Error: invalid tolerance colour.\n");
+        return;
+    }
+
+    resistor_print_result("5-band", R, tol);
+}
+static void resistor_print_result(const char *title, double R, double tol)
+{
+    double display_value = R;
+    const char *unit = "Ω";
+
+    if (R >= 1e6) {
+        display_value = R / 1e6;
+        unit = "MΩ";
+    } else if (R >= 1e3) {
+        display_value = R / 1e3;
+        unit = "kΩ";
+    }
+
+    printf("\nResult (%s):\n", title);
+    printf("  Nominal resistance: %.3f %s\n", display_value, unit);
+    printf("  Tolerance: ±%.2f %%\n", tol);
+}
+/* ================================= *
+ * 6. Engineering Calculator Module  *
+ * ================================= */
+
+/* Evaluates engineering expressions such as  1/(2*pi*4.7k*100n)            *
+ *  - numbers may carry an SI prefix and/or unit: 4.7k, 100nF, 2.2kohm, 5V  *
+ *  - operators  + - * / ^  and parentheses, constants pi and e             *
+ *  - functions  sqrt exp ln log sin cos tan asin acos atan abs,            *
+ *               par(a,b) (parallel resistors), min(a,b), max(a,b)          *
+ *  - any other name (R, C, Vin, ...) is a variable                         *
+ * An expression is parsed once into a small AST, constant sub-trees are    *
+ * folded, and the result is compiled to stack bytecode.  The batch         *
+ * evaluator runs each instruction over a block of EC_BLOCK values at a     *
+ * time, so the interpreter overhead is paid once per block instead of once *
+ * per value and the inner loops compile to straight vector-friendly code.  */
+
+#define EC_MAX_NODES    128
+#define EC_MAX_CODE     128
+#define EC_MAX_CONST     64
+#define EC_MAX_VARS       8
+#define EC_MAX_DEPTH     32
+#define EC_NAME_LEN      16
+#define EC_BLOCK        256
+#define EC_MAX_NESTING  256     /* brackets / signs / ^ deep: the parser recurses per level */
+
+enum { EC_N_NUM, EC_N_VAR, EC_N_NEG, EC_N_BIN, EC_N_FUNC1, EC_N_FUNC2 };
+enum { EC_PUSH_K, EC_PUSH_V, EC_NEG, EC_ADD, EC_SUB, EC_MUL, EC_DIV, EC_POW, EC_F1, EC_F2 };
+enum { EC_MODE_SS, EC_MODE_SK, EC_MODE_KS };   /* operands: stack/stack, stack/const, const/stack */
+enum { EC_F_SQRT, EC_F_EXP, EC_F_LN, EC_F_LOG, EC_F_SIN, EC_F_COS, EC_F_TAN,
+       EC_F_ASIN, EC_F_ACOS, EC_F_ATAN, EC_F_ABS };
+enum { EC_F_PAR, EC_F_MIN, EC_F_MAX };
+
+typedef struct {
+    int    type;
+    int    op;          /* EC_ADD.. for EC_N_BIN, function id for EC_N_FUNC* */
+    int    a, b;        /* child node indices */
+    double value;       /* EC_N_NUM */
+    int    var;         /* EC_N_VAR */
+} EcNode;
+
+typedef struct {
+    unsigned char op;
+    unsigned char mode;
+    unsigned char arg;  /* const / variable / function index */
+} EcInstr;
+
+typedef struct {
+    EcInstr code[EC_MAX_CODE];
+    double  consts[EC_MAX_CONST];
+    char    var_names[EC_MAX_VARS][EC_NAME_LEN];
+    int     ncode, nconst, nvars;
+    int     max_depth;
+    int     folded;     /* number of AST nodes removed by constant folding */
+} EcProgram;
+
+typedef struct {        /* a variable fixed to a value at compile time */
+    const char *name;
+    double      value;
+} EcBinding;
+
+typedef struct {
+    const char      *p;         /* cursor in the source text */
+    EcNode           nodes[EC_MAX_NODES];
+    int              nnodes;
+    EcProgram       *prog;
+    const EcBinding *bind;
+    int              nbind;
+    char            *err;
+    size_t           errlen;
+    int              failed;
+    int              depth;     /* current nesting, bounded by EC_MAX_NESTING */
+} EcParser;
+
+static const char *const ec_func1_names[] = {
+    "sqrt", "exp", "ln", "log", "sin", "cos", "tan", "asin", "acos", "atan", "abs"
+};
+static const char *const ec_func2_names[] = { "par", "min", "max" };
+
+static int ec_fail(EcParser *ps, const char *msg)
+{
+    if (!ps->failed) {
+        snprintf(ps->err, ps->errlen, "%s", msg);
+        ps->failed = 1;
+    }
+    return -1;
+}
+static int ec_new_node(EcParser *ps, int type)
+{
+    if (ps->nnodes >= EC_MAX_NODES) {
+        return ec_fail(ps, "expression too long");
+    }
+    EcNode *n = &ps->nodes[ps->nnodes];
+    memset(n, 0, sizeof(*n));
+    n->type = type;
+    return ps->nnodes++;
+}
+static void ec_skip_spaces(EcParser *ps)
+{
+    while (*ps->p == ' ' || *ps->p == '\t') ps->p++;
+}
+/* SI prefix / unit suffix directly after a number, e.g. "k", "nF", "kohm" */
+static int ec_suffix_scale(const char *s, size_t len, double *scale)
+{
+    static const char *const units[] = { "ohm", "Ohm", "\xCE\xA9", "F", "H", "Hz", "V", "A", "s", "W" };
+    static const struct { const char *sym; double mult; } prefixes[] = {
+        { "f", 1e-15 }, { "p", 1e-12 }, { "n", 1e-9 }, { "u", 1e-6 }, { "\xC2\xB5", 1e-6 },
+        { "\xCE\xBC", 1e-6 }, { "m", 1e-3 }, { "k", 1e3 }, { "K", 1e3 }, { "M", 1e6 },
+        { "G", 1e9 }, { "T", 1e12 }
+    };
+
+    *scale = 1.0;
+    if (len == 0) return 1;
+
+    for (size_t u = 0; u < sizeof(units) / sizeof(units[0]); u++) {
+        if (strlen(units[u]) == len && strncmp(s, units[u], len) == 0) return 1;
+    }
+    for (size_t k = 0; k < sizeof(prefixes) / sizeof(prefixes[0]); k++) {
+        size_t pl = strlen(prefixes[k].sym);
+        if (pl > len || strncmp(s, prefixes[k].sym, pl) != 0) continue;
+
+        const char *rest = s + pl;
+        size_t rest_len = len - pl;
+        int unit_ok = (rest_len == 0);
+        for (size_t u = 0; u < sizeof(units) / sizeof(units[0]) && !unit_ok; u++) {
+            unit_ok = (strlen(units[u]) == rest_len && strncmp(rest, units[u], rest_len) == 0);
+        }
+        if (unit_ok) {
+            *scale = prefixes[k].mult;
+            return 1;
+        }
+    }
+    return 0;
+}
+static int ec_is_name_char(unsigned char c)
+{
+    return isalnum(c) || c == '_' || c >= 0x80;   /* >= 0x80: UTF-8 (µ, Ω) */
+}
+static int ec_parse_expr(EcParser *ps);
+static int ec_parse_unary(EcParser *ps);
+
+static int ec_parse_primary(EcParser *ps)
+{
+    ec_skip_spaces(ps);
+    const char *p = ps->p;
+
+    /* Number with optional SI prefix / unit */
+    if (isdigit((unsigned char)*p) || (*p == '.' && isdigit((unsigned char)p[1]))) {
+        char *end = NULL;
+        double v = strtod(p, &end);
+        const char *suffix = end;
+        while (ec_is_name_char((unsigned char)*end)) end++;
+
+        double scale = 1.0;
+        if (!ec_suffix_scale(suffix, (size_t)(end - suffix), &scale)) {
+            return ec_fail(ps, "unknown SI prefix or unit after a number");
+        }
+        ps->p = end;
+
+        int n = ec_new_node(ps, EC_N_NUM);
+        if (n >= 0) ps->nodes[n].value = v * scale;
+        return n;
+    }
+
+    /* Parenthesised sub-expression */
+    if (*p == '(') {
+        ps->p++;
+        int n = ec_parse_expr(ps);
+        ec_skip_spaces(ps);
+        if (*ps->p != ')') return ec_fail(ps, "missing ')'");
+        ps->p++;
+        return n;
+    }
+
+    /* Name: constant, function or variable */
+    if (isalpha((unsigned char)*p) || *p == '_') {
+        char name[EC_NAME_LEN];
+        size_t len = 0;
+        while (ec_is_name_char((unsigned char)*p)) {
+            if (len + 1 >= sizeof(name)) return ec_fail(ps, "name too long");
+            name[len++] = *p++;
+        }
+        name[len] = '\0';
+        ps->p = p;
+        ec_skip_spaces(ps);
+
+        if (*ps->p == '(') {
+            for (int f = 0; f < (int)(sizeof(ec_func1_names) / sizeof(ec_func1_names[0])); f++) {
+                if (strcmp(name, ec_func1_names[f]) != 0) continue;
+                ps->p++;
+                int arg = ec_parse_expr(ps);
+                ec_skip_spaces(ps);
+                if (*ps->p != ')') return ec_fail(ps, "missing ')' after function argument");
+                ps->p++;
+                int n = ec_new_node(ps, EC_N_FUNC1);
+                if (n >= 0) { ps->nodes[n].op = f; ps->nodes[n].a = arg; }
+                return n;
+            }
+            for (int f = 0; f < (int)(sizeof(ec_func2_names) / sizeof(ec_func2_names[0])); f++) {
+                if (strcmp(name, ec_func2_names[f]) != 0) continue;
+                ps->p++;
+                int a = ec_parse_expr(ps);
+                ec_skip_spaces(ps);
+                if (*ps->p != ',') return ec_fail(ps, "this function needs two arguments");
+                ps->p++;
+                int b = ec_parse_expr(ps);
+                ec_skip_spaces(ps);
+                if (*ps->p != ')') return ec_fail(ps, "missing ')' after function arguments");
+                ps->p++;
+                int n = ec_new_node(ps, EC_N_FUNC2);
+                if (n >= 0) { ps->nodes[n].op = f; ps->nodes[n].a = a; ps->nodes[n].b = b; }
+                return n;
+            }
+            return ec_fail(ps, "unknown function");
+        }
+
+        if (strcmp(name, "pi") == 0 || strcmp(name, "e") == 0) {
+            int n = ec_new_node(ps, EC_N_NUM);
+            if (n >= 0) ps->nodes[n].value = (name[0] == 'p') ? M_PI : exp(1.0);
+            return n;
+        }
+
+        /* Variables fixed by the caller become constants (and can then be folded) */
+        for (int b = 0; b < ps->nbind; b++) {
+            if (strcmp(name, ps->bind[b].name) == 0) {
+                int n = ec_new_node(ps, EC_N_NUM);
+                if (n >= 0) ps->nodes[n].value = ps->bind[b].value;
+                return n;
+            }
+        }
+
+        EcProgram *prog = ps->prog;
+        int var = -1;
+        for (int v = 0; v < prog->nvars; v++) {
+            if (strcmp(prog->var_names[v], name) == 0) var = v;
+        }
+        if (var < 0) {
+            if (prog->nvars >= EC_MAX_VARS) return ec_fail(ps, "too many variables");
+            var = prog->nvars++;
+            snprintf(prog->var_names[var], EC_NAME_LEN, "%s", name);
+        }
+        int n = ec_new_node(ps, EC_N_VAR);
+        if (n >= 0) ps->nodes[n].var = var;
+        return n;
+    }
+
+    return ec_fail(ps, (*p == '\0') ? "unexpected end of expression" : "unexpected character");
+}
+static int ec_parse_power(EcParser *ps)   /* right associative: 2^3^2 = 2^9 */
+{
+    int base = ec_parse_primary(ps);
+    ec_skip_spaces(ps);
+    if (base < 0 || *ps->p != '^') return base;
+    ps->p++;
+
+    int expo = ec_parse_unary(ps);
+    int n = ec_new_node(ps, EC_N_BIN);
+    if (n >= 0) { ps->nodes[n].op = EC_POW; ps->nodes[n].a = base; ps->nodes[n].b = expo; }
+    return n;
+}
+static int ec_parse_unary(EcParser *ps)   /* every recursion ('(', sign, ^, call) passes here */
+{
+    int n;
+
+    if (++ps->depth > EC_MAX_NESTING) {
+        n = ec_fail(ps, "expression nested too deeply");
+    } else {
+        ec_skip_spaces(ps);
+        if (*ps->p == '+') {
+            ps->p++;
+            n = ec_parse_unary(ps);
+        } else if (*ps->p == '-') {
+            ps->p++;
+            int a = ec_parse_unary(ps);
+            n = ec_new_node(ps, EC_N_NEG);
+            if (n >= 0) ps->nodes[n].a = a;
+        } else {
+            n = ec_parse_power(ps);
+        }
+    }
+    ps->depth--;
+    return n;
+}
+static int ec_parse_term(EcParser *ps)
+{
+    int left = ec_parse_unary(ps);
+    for (;;) {
+        ec_skip_spaces(ps);
+        char c = *ps->p;
+        if (left < 0 || (c != '*' && c != '/')) return left;
+        ps->p++;
+        int right = ec_parse_unary(ps);
+        int n = ec_new_node(ps, EC_N_BIN);
+        if (n < 0) return n;
+        ps->nodes[n].op = (c == '*') ? EC_MUL : EC_DIV;
+        ps->nodes[n].a = left;
+        ps->nodes[n].b = right;
+        left = n;
+    }
+}
+static int ec_parse_expr(EcParser *ps)
+{
+    int left = ec_parse_term(ps);
+    for (;;) {
+        ec_skip_spaces(ps);
+        char c = *ps->p;
+        if (left < 0 || (c != '+' && c != '-')) return left;
+        ps->p++;
+        int right = ec_parse_term(ps);
+        int n = ec_new_node(ps, EC_N_BIN);
+        if (n < 0) return n;
+        ps->nodes[n].op = (c == '+') ? EC_ADD : EC_SUB;
+        ps->nodes[n].a = left;
+        ps->nodes[n].b = right;
+        left = n;
+    }
+}
+static double ec_apply_func1(int f, double x)
+{
+    switch (f) {
+        case EC_F_SQRT: return sqrt(x);
+        case EC_F_EXP:  return exp(x);
+        case EC_F_LN:   return log(x);
+        case EC_F_LOG:  return log10(x);
+        case EC_F_SIN:  return sin(x);
+        case EC_F_COS:  return cos(x);
+        case EC_F_TAN:  return tan(x);
+        case EC_F_ASIN: return asin(x);
+        case EC_F_ACOS: return acos(x);
+        case EC_F_ATAN: return atan(x);
+        default:        return fabs(x);
+    }
+}
+static double ec_apply_func2(int f, double a, double b)
+{
+    switch (f) {
+        case EC_F_PAR: return (a * b) / (a + b);
+        case EC_F_MIN: return (a < b) ? a : b;
+        default:       return (a > b) ? a : b;
+    }
+}
+static double ec_apply_binary(int op, double a, double b)
+{
+    switch (op) {
+        case EC_ADD: return a + b;
+        case EC_SUB: return a - b;
+        case EC_MUL: return a * b;
+        case EC_DIV: return a / b;
+        default:     return pow(a, b);
+    }
+}
+/* Constant folding: collapse every sub-tree whose leaves are all numbers */
+static void ec_fold(EcParser *ps, int idx)
+{
+    EcNode *n = &ps->nodes[idx];
+
+    switch (n->type) {
+        case EC_N_NEG:
+        case EC_N_FUNC1:
+            ec_fold(ps, n->a);
+            if (ps->nodes[n->a].type == EC_N_NUM) {
+                double a = ps->nodes[n->a].value;
+                n->value = (n->type == EC_N_NEG) ? -a : ec_apply_func1(n->op, a);
+                n->type = EC_N_NUM;
+                ps->prog->folded++;
             }
-            case 6:
-                /* Back to main menu */
-                running = 0;
+            break;
+        case EC_N_BIN:
+        case EC_N_FUNC2:
+            ec_fold(ps, n->a);
+            ec_fold(ps, n->b);
+            if (ps->nodes[n->a].type == EC_N_NUM && ps->nodes[n->b].type == EC_N_NUM) {
+                double a = ps->nodes[n->a].value, b = ps->nodes[n->b].value;
+                n->value = (n->type == EC_N_BIN) ? ec_apply_binary(n->op, a, b)
+                                                 : ec_apply_func2(n->op, a, b);
+                n->type = EC_N_NUM;
+                ps->prog->folded += 2;
+            }
+            break;
+        default:
+            break;
+    }
+}
+static int ec_add_const(EcParser *ps, double v)
+{
+    EcProgram *prog = ps->prog;
+    for (int k = 0; k < prog->nconst; k++) {
+        if (prog->consts[k] == v) return k;
+    }
+    if (prog->nconst >= EC_MAX_CONST) return ec_fail(ps, "too many constants");
+    prog->consts[prog->nconst] = v;
+    return prog->nconst++;
+}
+static void ec_emit(EcParser *ps, int op, int mode, int arg, int depth_change, int *depth)
+{
+    EcProgram *prog = ps->prog;
+    if (ps->failed) return;
+    if (prog->ncode >= EC_MAX_CODE) {
+        ec_fail(ps, "expression too long");
+        return;
+    }
+    prog->code[prog->ncode].op   = (unsigned char)op;
+    prog->code[prog->ncode].mode = (unsigned char)mode;
+    prog->code[prog->ncode].arg  = (unsigned char)arg;
+    prog->ncode++;
+
+    *depth += depth_change;
+    if (*depth > prog->max_depth) prog->max_depth = *depth;
+    if (*depth > EC_MAX_DEPTH) ec_fail(ps, "expression nested too deeply");
+}
+/* Post-order code generation.  A binary operation with one constant operand *
+ * takes the constant from the pool directly instead of pushing it.          */
+static void ec_codegen(EcParser *ps, int idx, int *depth)
+{
+    const EcNode *n = &ps->nodes[idx];
+
+    switch (n->type) {
+        case EC_N_NUM:
+            ec_emit(ps, EC_PUSH_K, EC_MODE_SS, ec_add_const(ps, n->value), +1, depth);
+            break;
+        case EC_N_VAR:
+            ec_emit(ps, EC_PUSH_V, EC_MODE_SS, n->var, +1, depth);
+            break;
+        case EC_N_NEG:
+            ec_codegen(ps, n->a, depth);
+            ec_emit(ps, EC_NEG, EC_MODE_SS, 0, 0, depth);
+            break;
+        case EC_N_FUNC1:
+            ec_codegen(ps, n->a, depth);
+            ec_emit(ps, EC_F1, EC_MODE_SS, n->op, 0, depth);
+            break;
+        case EC_N_FUNC2:
+            ec_codegen(ps, n->a, depth);
+            ec_codegen(ps, n->b, depth);
+            ec_emit(ps, EC_F2, EC_MODE_SS, n->op, -1, depth);
+            break;
+        default: {   /* EC_N_BIN */
+            const EcNode *a = &ps->nodes[n->a];
+            const EcNode *b = &ps->nodes[n->b];
+            if (b->type == EC_N_NUM) {
+                ec_codegen(ps, n->a, depth);
+                ec_emit(ps, n->op, EC_MODE_SK, ec_add_const(ps, b->value), 0, depth);
+            } else if (a->type == EC_N_NUM) {
+                ec_codegen(ps, n->b, depth);
+                ec_emit(ps, n->op, EC_MODE_KS, ec_add_const(ps, a->value), 0, depth);
+            } else {
+                ec_codegen(ps, n->a, depth);
+                ec_codegen(ps, n->b, depth);
+                ec_emit(ps, n->op, EC_MODE_SS, 0, -1, depth);
+            }
+            break;
+        }
+    }
+}
+/* Parse, fold and compile `text`.  Variables named in `bind` are replaced  *
+ * by their values.  Returns 1 on success, 0 with a message in err.         */
+static int ec_compile(const char *text, const EcBinding *bind, int nbind,
+                      EcProgram *prog, char *err, size_t errlen)
+{
+    EcParser parser;
+    EcParser *ps = &parser;
+
+    memset(prog, 0, sizeof(*prog));
+    memset(ps, 0, sizeof(*ps));
+    ps->p = text;
+    ps->prog = prog;
+    ps->bind = bind;
+    ps->nbind = nbind;
+    ps->err = err;
+    ps->errlen = errlen;
+
+    int root = ec_parse_expr(ps);
+    ec_skip_spaces(ps);
+    if (!ps->failed && *ps->p != '\0') {
+        ec_fail(ps, "unexpected text after the expression");
+    }
+    if (ps->failed || root < 0) {
+        return 0;
+    }
+
+    ec_fold(ps, root);
+
+    int depth = 0;
+    ec_codegen(ps, root, &depth);
+    return !ps->failed;
+}
+static double ec_eval(const EcProgram *prog, const double *vars)   /* One evaluation */
+{
+    double st[EC_MAX_DEPTH];
+    int sp = 0;
+
+    for (int i = 0; i < prog->ncode; i++) {
+        const EcInstr *in = &prog->code[i];
+        switch (in->op) {
+            case EC_PUSH_K: st[sp++] = prog->consts[in->arg]; break;
+            case EC_PUSH_V: st[sp++] = vars[in->arg];         break;
+            case EC_NEG:    st[sp - 1] = -st[sp - 1];          break;
+            case EC_F1:     st[sp - 1] = ec_apply_func1(in->arg, st[sp - 1]); break;
+            case EC_F2:
+                sp--;
+                st[sp - 1] = ec_apply_func2(in->arg, st[sp - 1], st[sp]);
                 break;
             default:
-                printf("Unknown option.\n");
+                if (in->mode == EC_MODE_SK) {
+                    st[sp - 1] = ec_apply_binary(in->op, st[sp - 1], prog->consts[in->arg]);
+                } else if (in->mode == EC_MODE_KS) {
+                    st[sp - 1] = ec_apply_binary(in->op, prog->consts[in->arg], st[sp - 1]);
+                } else {
+                    sp--;
+                    st[sp - 1] = ec_apply_binary(in->op, st[sp - 1], st[sp]);
+                }
                 break;
         }
     }
+    return (sp > 0) ? st[0] : 0.0;
 }
-static void uc_print_menu(void)     /* Print the Unit Converter submenu options. */
+
+/* Element-wise kernels for the block evaluator */
+#define EC_LOOP(expr) for (int i = 0; i < n; i++) { d[i] = (expr); }
+
+static void ec_block_binary(int op, double *d, const double *a, const double *b, int n)
 {
-    printf("\n------ Unit Converter ------\n");
-    printf("1. dBm <-> mW\n");
-    printf("2. Hz  <-> rad/s\n");
-    printf("3. °C  <-> K\n");
-    printf("4. °F  <-> °C\n");
-    printf("5. V   <-> dBV\n");
-    printf("6. Back to Main Menu\n");
-    printf("----------------------------\n");
+    switch (op) {
+        case EC_ADD: EC_LOOP(a[i] + b[i]); break;
+        case EC_SUB: EC_LOOP(a[i] - b[i]); break;
+        case EC_MUL: EC_LOOP(a[i] * b[i]); break;
+        case EC_DIV: EC_LOOP(a[i] / b[i]); break;
+        default:     EC_LOOP(pow(a[i], b[i])); break;
+    }
 }
-static int uc_get_choice(void)      /* The same integer-validation logic as the Signal Analyzer */
+static void ec_block_binary_k(int op, double *d, const double *a, double k, int k_first, int n)
 {
-    char buf[64];
-    int value = 0;
-
-    for (;;) {
-        printf("Select option: ");
-        if (!fgets(buf, sizeof(buf), stdin)) {
-            printf("\nInput error, returning.\n");
-            return 6;
+    if (!k_first) {
+        switch (op) {
+            case EC_ADD: EC_LOOP(a[i] + k); break;
+            case EC_SUB: EC_LOOP(a[i] - k); break;
+            case EC_MUL: EC_LOOP(a[i] * k); break;
+            case EC_DIV: EC_LOOP(a[i] / k); break;
+            default:
+                if (k == 2.0) { EC_LOOP(a[i] * a[i]); }     /* exact, like pow(); ^0.5 is not sqrt() at -0 and -inf */
+                else          { EC_LOOP(pow(a[i], k)); }
+                break;
         }
-        buf[strcspn(buf, "\r\n")] = '\0';
+    } else {
+        switch (op) {
+            case EC_ADD: EC_LOOP(k + a[i]); break;
+            case EC_SUB: EC_LOOP(k - a[i]); break;
+            case EC_MUL: EC_LOOP(k * a[i]); break;
+            case EC_DIV: EC_LOOP(k / a[i]); break;
+            default:     EC_LOOP(pow(k, a[i])); break;
+        }
+    }
+}
 
-        if (!sa_is_integer(buf)) {
-            printf("Please enter an integer!\n");
-            continue;
+/* Evaluate prog for n bindings: vars[v][i] is the value of variable v in row i */
+static void ec_eval_batch(const EcProgram *prog, const double *const *vars, size_t count, double *out)
+{
+    double tmp[EC_MAX_DEPTH][EC_BLOCK];          /* one work block per stack level */
+    const double *st[EC_MAX_DEPTH];
+
+    for (size_t off = 0; off < count; off += EC_BLOCK) {
+        int n = (count - off < EC_BLOCK) ? (int)(count - off) : EC_BLOCK;
+        int sp = 0;
+
+        for (int pc = 0; pc < prog->ncode; pc++) {
+            const EcInstr *in = &prog->code[pc];
+            double *d;
+
+            switch (in->op) {
+                case EC_PUSH_V:
+                    st[sp++] = vars[in->arg] + off;   /* zero-copy: read the caller's array */
+                    break;
+                case EC_PUSH_K: {
+                    double k = prog->consts[in->arg];
+                    d = tmp[sp];
+                    EC_LOOP(k);
+                    st[sp++] = d;
+                    break;
+                }
+                case EC_NEG: {
+                    const double *a = st[sp - 1];
+                    d = tmp[sp - 1];
+                    EC_LOOP(-a[i]);
+                    st[sp - 1] = d;
+                    break;
+                }
+                case EC_F1: {
+                    const double *a = st[sp - 1];
+                    d = tmp[sp - 1];
+                    if (in->arg == EC_F_SQRT)     { EC_LOOP(sqrt(a[i])); }
+                    else if (in->arg == EC_F_ABS) { EC_LOOP(fabs(a[i])); }
+                    else                          { EC_LOOP(ec_apply_func1(in->arg, a[i])); }
+                    st[sp - 1] = d;
+                    break;
+                }
+                case EC_F2: {
+                    const double *b = st[--sp];
+                    const double *a = st[sp - 1];
+                    d = tmp[sp - 1];
+                    EC_LOOP(ec_apply_func2(in->arg, a[i], b[i]));
+                    st[sp - 1] = d;
+                    break;
+                }
+                default: {
+                    if (in->mode == EC_MODE_SS) {
+                        const double *b = st[--sp];
+                        d = tmp[sp - 1];
+                        ec_block_binary(in->op, d, st[sp - 1], b, n);
+                    } else {
+                        d = tmp[sp - 1];
+                        ec_block_binary_k(in->op, d, st[sp - 1], prog->consts[in->arg],
+                                          in->mode == EC_MODE_KS, n);
+                    }
+                    st[sp - 1] = d;
+                    break;
+                }
+            }
         }
 
-        value = (int)strtol(buf, NULL, 10);
-        return value;
+        memcpy(out + off, st[0], (size_t)n * sizeof(double));
     }
 }
-static double uc_get_double(const char *prompt) /* Prompts the user for a floating-point value and validates that the entire input line represents a valid double.*/
+#undef EC_LOOP
+
+static void ec_format_eng(double v, char *buf, size_t len)   /* 0.000338 -> "338.000 u" */
 {
-    char buf[64];
-    double value = 0.0;
+    static const char *const prefixes[] = { "f", "p", "n", "u", "m", "", "k", "M", "G", "T" };
+    if (v == 0.0 || !isfinite(v)) {
+        snprintf(buf, len, "%g", v);
+        return;
+    }
+    int e3 = (int)floor(log10(fabs(v)) / 3.0);
+    if (e3 < -5) e3 = -5;
+    if (e3 > 4) e3 = 4;
+    snprintf(buf, len, "%.4f %s", v / pow(10.0, 3.0 * e3), prefixes[e3 + 5]);
+}
+static int ec_read_line(const char *prompt, char *buf, size_t len)
+{
+    printf("%s", prompt);
+    if (!fgets(buf, (int)len, stdin)) {
+        printf("\nInput error.\n");
+        return 0;
+    }
+    buf[strcspn(buf, "\r\n")] = '\0';
+    return 1;
+}
+/* Read a numeric value; SI prefixes and constant expressions are accepted */
+static int ec_read_value(const char *prompt, double *value)
+{
+    char line[128], err[96];
+    EcProgram prog;
 
-    while (1) {
-        printf("%s", prompt);
-        if (!fgets(buf, sizeof(buf), stdin)) {
-            printf("\nInput error, using 0.\n");
-            return 0.0;
+    for (;;) {
+        if (!ec_read_line(prompt, line, sizeof(line))) return 0;
+        if (!ec_compile(line, NULL, 0, &prog, err, sizeof(err))) {
+            printf("Invalid value: %s.\n", err);
+            continue;
         }
-        buf[strcspn(buf, "\r\n")] = '\0';
-
-        char *endptr = NULL;
-        value = strtod(buf, &endptr);
-        if (endptr == buf || *endptr != '\0') {
-            printf("Please enter a valid number.\n");
+        if (prog.nvars > 0) {
+            printf("Please enter a number (no variables).\n");
             continue;
         }
-        return value;
+        *value = ec_eval(&prog, NULL);
+        return 1;
     }
 }
+static void ec_evaluate_once(void)
+{
+    char line[256], err[96], eng[48];
+    EcProgram prog;
+    double vars[EC_MAX_VARS];
 
-/* ================================== *
- * 2. ADC / Sensor Converter Module   *
- * ================================== */
+    if (!ec_read_line("\nExpression: ", line, sizeof(line))) return;
+    if (!ec_compile(line, NULL, 0, &prog, err, sizeof(err))) {
+        printf("Error: %s.\n", err);
+        return;
+    }
 
-/* Simple ADC + temperature sensor helper:                          *
- *  1) - ADC code → Voltage      (using VREF and 10-bit ADC 0–1023) *
- *  2) - Voltage  → Temperature  (LM35 style: 10 mV / °C)           *
- *  3) - ADC code → Temperature  (combines the two steps above)     */
-void menu_adc_sensor_converter(void)
+    for (int v = 0; v < prog.nvars; v++) {
+        char prompt[64];
+        snprintf(prompt, sizeof(prompt), "  %s = ", prog.var_names[v]);
+        if (!ec_read_value(prompt, &vars[v])) return;
+    }
+
+    double result = ec_eval(&prog, vars);
+    ec_format_eng(result, eng, sizeof(eng));
+    printf("Result = %.10g  (%s)\n", result, eng);
+    printf("[%d bytecode instructions, %d constants, %d nodes folded]\n",
+           prog.ncode, prog.nconst, prog.folded);
+}
+static void ec_sweep(void)
 {
-    const double VREF = 5.0;    /* ADC reference voltage, e.g. 3.3 V or 5.0 V */
+    const char *filename = "calc_sweep.txt";
+    const size_t MAX_POINTS = 10000000;
+    char line[256], name[EC_NAME_LEN], err[96];
+    EcProgram probe, prog;
+
+    if (!ec_read_line("\nExpression: ", line, sizeof(line))) return;
+    if (!ec_compile(line, NULL, 0, &probe, err, sizeof(err))) {
+        printf("Error: %s.\n", err);
+        return;
+    }
+    if (probe.nvars == 0) {
+        printf("The expression has no variables to sweep.\n");
+        return;
+    }
+
+    /* 1. Which variable to sweep; the others are fixed and folded in */
+    int sweep_var = 0;
+    if (probe.nvars > 1) {
+        printf("Variables:");
+        for (int v = 0; v < probe.nvars; v++) printf(" %s", probe.var_names[v]);
+        printf("\n");
+        if (!ec_read_line("Variable to sweep: ", name, sizeof(name))) return;
+        sweep_var = -1;
+        for (int v = 0; v < probe.nvars; v++) {
+            if (strcmp(name, probe.var_names[v]) == 0) sweep_var = v;
+        }
+        if (sweep_var < 0) {
+            printf("No variable named '%s'.\n", name);
+            return;
+        }
+    }
+
+    EcBinding bind[EC_MAX_VARS];
+    int nbind = 0;
+    for (int v = 0; v < probe.nvars; v++) {
+        if (v == sweep_var) continue;
+        char prompt[64];
+        snprintf(prompt, sizeof(prompt), "  %s (fixed) = ", probe.var_names[v]);
+        if (!ec_read_value(prompt, &bind[nbind].value)) return;
+        bind[nbind].name = probe.var_names[v];
+        nbind++;
+    }
+    if (!ec_compile(line, bind, nbind, &prog, err, sizeof(err))) {
+        printf("Error: %s.\n", err);
+        return;
+    }
+
+    /* 2. Sweep range */
+    double start = 0.0, stop = 0.0, points_d = 0.0;
+    char prompt[64];
+    snprintf(prompt, sizeof(prompt), "  %s start = ", probe.var_names[sweep_var]);
+    if (!ec_read_value(prompt, &start)) return;
+    snprintf(prompt, sizeof(prompt), "  %s stop  = ", probe.var_names[sweep_var]);
+    if (!ec_read_value(prompt, &stop)) return;
+    if (!ec_read_value("  Number of points (2 - 10M): ", &points_d)) return;
+    if (points_d < 2.0 || points_d > (double)MAX_POINTS) {
+        printf("Number of points must be between 2 and %zu.\n", MAX_POINTS);
+        return;
+    }
+    size_t points = (size_t)points_d;
+
+    int log_scale = 0;
+    if (start > 0.0 && stop > 0.0) {
+        char yn[16];
+        if (!ec_read_line("  Logarithmic spacing? (y/n): ", yn, sizeof(yn))) return;
+        log_scale = (yn[0] == 'y' || yn[0] == 'Y');
+    }
+
+    double *x = malloc(points * sizeof(double));
+    double *y = malloc(points * sizeof(double));
+    if (!x || !y) {
+        printf("Error: Out of memory for %zu points.\n", points);
+        free(x);
+        free(y);
+        return;
+    }
+    for (size_t i = 0; i < points; i++) {
+        double t = (double)i / (double)(points - 1);
+        x[i] = log_scale ? start * pow(stop / start, t) : start + (stop - start) * t;
+    }
+
+    /* 3. Batch evaluation (timed); after binding only the swept variable is left */
+    const double *vars[1] = { x };
+
+    double t0 = sa_live_now();
+    ec_eval_batch(&prog, vars, points, y);
+    double elapsed = sa_live_now() - t0;
+
+    double ymin = y[0], ymax = y[0];
+    for (size_t i = 1; i < points; i++) {
+        if (y[i] < ymin) ymin = y[i];
+        if (y[i] > ymax) ymax = y[i];
+    }
+
+    printf("\nEvaluated %zu points in %.4f s (%.1f M evaluations/s, %d instructions).\n",
+           points, elapsed, elapsed > 0.0 ? (double)points / elapsed / 1e6 : 0.0, prog.ncode);
+    printf("  f(%s = %.6g) = %.6g\n", probe.var_names[sweep_var], x[0], y[0]);
+    printf("  f(%s = %.6g) = %.6g\n", probe.var_names[sweep_var], x[points - 1], y[points - 1]);
+    printf("  Range of results: %.6g .. %.6g\n", ymin, ymax);
+
+    SaOutBuf ob = { 0 };
+    if (!sa_out_open(&ob, filename)) {
+        printf("\nError: Could not open '%s' for writing.\n", filename);
+    } else {
+        sa_out_str(&ob, "# ");
+        sa_out_str(&ob, line);
+        sa_out_str(&ob, "\n# ");
+        sa_out_str(&ob, probe.var_names[sweep_var]);
+        sa_out_str(&ob, " result\n");
+        for (size_t i = 0; i < points; i++) {
+            sa_out_general(&ob, x[i], 10);
+            sa_out_char(&ob, ' ');
+            sa_out_general(&ob, y[i], 10);
+            sa_out_char(&ob, '\n');
+        }
+        if (sa_out_close(&ob)) {
+            printf("Sweep saved to '%s'.\n", filename);
+        } else {
+            printf("\nError: Could not write '%s'.\n", filename);
+        }
+    }
+    sa_out_release(&ob);
 
+    free(x);
+    free(y);
+}
+void menu_engineering_calculator(void)
+{
     int running = 1;
 
     while (running) {
-        printf("\n------ ADC / Sensor Converter ------\n");
-        printf("1. ADC code -> Voltage\n");
-        printf("2. Voltage  -> Temperature (°C)\n");
-        printf("3. ADC code -> Temperature (°C)\n");
-        printf("4. Back to Main Menu\n");
-        printf("------------------------------------\n");
+        printf("\n[Engineering Calculator]\n");
+        printf("Expressions like 1/(2*pi*R*C) or 1/(2*pi*4.7k*100n); SI prefixes f p n u m k M G T,\n");
+        printf("units ohm F H Hz V A s W, functions sqrt exp ln log sin cos tan abs par(a,b).\n");
+        printf("1. Evaluate expression\n");
+        printf("2. Sweep a variable (batch evaluation, saved to calc_sweep.txt)\n");
+        printf("3. Back to Main Menu\n");
+        printf("---------------------------\n");
 
-        int choice = uc_get_choice();      /* Reuse the integer choice helper from the Unit Converter. */
+        int choice = uc_get_choice();
+        if (feof(stdin)) {
+            choice = 3;                   /* input closed: uc_get_choice's 6 is not Back here */
+        }
 
         switch (choice) {
-
-            /* --- 1. ADC -> Voltage --- */
-            case 1: {
-                int adc = (int)uc_get_double("Enter ADC code (0–1023): ");       /* Assume a 10-bit ADC, codes 0–1023 inclusive. */
-                if (adc < 0 || adc > 1023) {
-                    printf("ADC code must be 0–1023.\n");
-                    break;
-                }
-                double voltage = (adc / 1023.0) * VREF;      /* V = (code / 1023) * VREF */
-                printf("Voltage = %.4f V\n", voltage);
-                break;
-            }
-
-            /* --- 2. Voltage -> Temperature --- */
-            case 2: {
-                double volt = uc_get_double("Enter voltage in V: ");
-                if (volt < 0) {
-                    printf("Voltage must be >= 0.\n");
-                    break;
-                }                                /* LM35 model: 10mV/°C at 0 °C */
-                double temp = volt * 100.0;      /* 10 mV/°C => 0.01 V / °C */
-                printf("Temperature = %.2f °C\n", temp);
+            case 1:
+                ec_evaluate_once();
                 break;
-            }
-
-            /* --- 3. ADC -> Temperature --- */
-            case 3: {
-                int adc = (int)uc_get_double("Enter ADC code (0–1023): ");
-                if (adc < 0 || adc > 1023) {
-                    printf("ADC code must be 0–1023.\n");
-                    break;
-                }                                       /* First convert ADC code -> voltage, then voltage -> °C */
-                double voltage = (adc / 1023.0) * VREF;
-                double temp = voltage * 100.0;  /* 10mV/°C */
-                printf("Voltage = %.4f V\n", voltage);
-                printf("Temperature = %.2f °C\n", temp);
+            case 2:
+                ec_sweep();
                 break;
-            }
-
-            case 4:            /* Back to Main Menu */
+            case 3:
                 running = 0;
                 break;
-
             default:
                 printf("Unknown option.\n");
                 break;
         }
     }
 }
+/* ======================================================================= *
+ *   This feature was delayed......again, and then it finally shipped.     *
+ *   (Still faster than GTA 6.)                                            *
+ *                                                                         *
+ *              ▄██████▄      ╔═╗┬ ┬┌─┐┬┌─                                 *
+ *             ███    ███     ║═╬└┬┘├─┤├┴┐  (Coming Soon™)                 *   
+ *             ███    ███     ╚═╝ ┴ ┴ ┴┴ ┴                                 *
+ *             ███    ███                                                  * 
+ *             ▀██████▀                                                    *
+ *                                                                         *
+ *   Please enjoy other fully implemented modules while waiting :)         *
+ *                                                                         *
+ *     /\_/\     Oh my god meow! you found me!                             *
+ *    ( o.o )    It's the companion we shipped pre-DLC.                    *
+ *     > ^ <     And littele kitten believes in your math skills.          * 
+ *                                                                         *
+ *   If all else fails, you can always team up with our other legendary    *
+ *   companion the Casio FX-991EX, to tackle the challenges!               *
+ *                                                                         *
+ * ======================================================================= */
 
-/* ============================== *
- * 3. Circuit Calculator Module   *
- * ============================== */
 
-/* A small collection of analogue circuit formula helpers:     *
- *  1) RC filter cutoff frequency   fc = 1/(2πRC)              *
- *  2) Resistive voltage divider    Vout = Vin * R2/(R1+R2)    *
- *  3) LED current-limit resistor   R = (Vs − Vf) / If         *
- *  4) Ohm's law helper             V = I·R, I = V/R, R = V/I  *
- *  5) Capacitor charging curve     V(t) = Vs(1 − e^(-t/RC))   */
-void menu_circuit_calculator(void)
+/* ============================================================ *
+ * 7. Tools (Auto Tests & File Operations for Signal Analyzer)  *
+ * ============================================================ */
+
+#define TOOLS_PIPELINE_MIN  (4 << 20)   /* auto-test files this large use the pipelined mode */
+
+void menu_tools(void)
 {
     int running = 1;
 
     while (running) {
-        printf("\n------ Circuit Calculator ------\n");
-        printf("1. RC filter cutoff frequency\n");
-        printf("2. Voltage divider\n");
-        printf("3. LED current-limit resistor\n");
-        printf("4. Ohm's law (V = I * R)\n");
-        printf("5. Capacitor charging V(t)\n");
+        printf("\n------ Tools (Auto Tests & Files for Signal Analyzer) ------\n");
+        printf("1. Generate sample file for Signal Analyzer\n");
+        printf("2. Auto-test Signal Analyzer (load + stats + graph)\n");
+        printf("3. Batch analysis of many capture files\n");
+        printf("4. Output formatter benchmark (fprintf vs buffered)\n");
+        printf("5. File statistics (result cache)\n");
         printf("6. Back to Main Menu\n");
-        printf("--------------------------------\n");
+        printf("----------------------------------------\n");
 
         int choice = uc_get_choice();
 
         switch (choice) {
-            case 1: cc_rc_filter();       break;
-            case 2: cc_voltage_divider(); break;
-            case 3: cc_led_resistor();    break;
-            case 4: cc_ohms_law();        break;
-            case 5: cc_cap_charging();    break;
-            case 6: running = 0;          break;
+            case 1:
+                tools_generate_sample_file();
+                break;
+            case 2:
+                tools_run_auto_test();
+                break;
+            case 3:
+                tools_batch_analysis();
+                break;
+            case 4:
+                tools_format_benchmark();
+                break;
+            case 5:
+                tools_cached_stats();
+                break;
+            case 6:
+                running = 0;
+                break;
             default:
                 printf("Unknown option.\n");
                 break;
         }
     }
 }
-
-/* ================================= *
- * 3. Circuit Calculator Funcitions  *
- * ================================= */
-static void cc_rc_filter(void)  /* Inputs R (ohms) and C (microfarads), converted to farads then calculating fc */
+static int tools_files_equal(const char *a, const char *b)
 {
-    printf("\n[RC low-pass filter cutoff]\n");
-    double R = 0.0;
-    double C_uF = 0.0;
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    int same = (fa && fb);
+    while (same) {
+        int ca = fgetc(fa), cb = fgetc(fb);
+        if (ca != cb) same = 0;
+        if (ca == EOF) break;
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+static void tools_format_benchmark(void)   /* fprintf against the buffered formatter */
+{
+    const char *file_a = "format_bench_a.txt", *file_b = "format_bench_b.txt";
+    int n = (int)uc_get_int_in("Number of values to write (e.g. 1000000): ", 1, 100000000);
+    double *x = malloc((size_t)n * sizeof(double));
+    if (!x) {
+        printf("Error: Out of memory.\n");
+        return;
+    }
+    for (int i = 0; i < n; i++) {                 /* ADC-like values with noise */
+        x[i] = 1.65 + 1.5 * sin(i * 0.001) + (double)((i * 7919) % 1000) * 1e-6;
+    }
 
-    R = uc_get_double("Enter R in ohms: ");
-    C_uF = uc_get_double("Enter C in microfarads (uF): ");
+    printf("\n%-22s %12s %12s %10s %s\n", "format", "fprintf (s)", "buffered (s)", "speed-up", "same text");
+    for (int mode = 0; mode < 3; mode++) {
+        static const char *names[] = { "%.6f", "%.9g", "shortest round-trip" };
+        SaOutBuf ob = { 0 };
+        FILE *fp = fopen(file_a, "w");
+        if (!fp || !sa_out_open(&ob, file_b)) {
+            printf("Error: Could not create the benchmark files.\n");
+            if (fp) fclose(fp);
+            break;
+        }
 
-    if (R <= 0.0 || C_uF <= 0.0) {
-        printf("R and C must be > 0.\n");
+        double t0 = sa_live_now();
+        for (int i = 0; i < n; i++) {
+            if (mode == 0)      fprintf(fp, "%.6f\n", x[i]);
+            else if (mode == 1) fprintf(fp, "%.9g\n", x[i]);
+            else                fprintf(fp, "%.17g\n", x[i]);
+        }
+        fclose(fp);
+        double t1 = sa_live_now();
+        for (int i = 0; i < n; i++) {
+            if (mode == 0)      sa_out_fixed(&ob, x[i], 6);
+            else if (mode == 1) sa_out_general(&ob, x[i], 9);
+            else                sa_out_shortest(&ob, x[i]);
+            sa_out_char(&ob, '\n');
+        }
+        sa_out_close(&ob);
+        sa_out_release(&ob);
+        double t2 = sa_live_now();
+
+        /* Shortest output differs from %.17g in text but must read back the same */
+        int same = (mode < 2) ? tools_files_equal(file_a, file_b) : 1;
+        if (mode == 2) {
+            FILE *fb = fopen(file_b, "r");
+            double v;
+            for (int i = 0; same && i < n; i++) {
+                same = fb && fscanf(fb, "%lf", &v) == 1 && v == x[i];
+            }
+            if (fb) fclose(fb);
+        }
+        printf("%-22s %12.3f %12.3f %9.1fx %s\n", names[mode], t1 - t0, t2 - t1,
+               (t2 > t1) ? (t1 - t0) / (t2 - t1) : 0.0,
+               same ? (mode < 2 ? "identical" : "reads back exactly") : "MISMATCH");
+    }
+
+    remove(file_a);
+    remove(file_b);
+    free(x);
+}
+static void tools_generate_sample_file(void)      /* Generate a file with simple test data, 5 samples already put in */
+{
+    const char *filename = "samples_auto.txt";
+
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        printf("\nError: Could not open '%s' for writing.\n", filename);
         return;
     }
 
-    double C = C_uF * 1e-6;  /* uF -> F */
-    double fc = 1.0 / (2.0 * M_PI * R * C);
+    /* put in 5 samples */
+    fprintf(fp, "1.0\n");
+    fprintf(fp, "2.0\n");
+    fprintf(fp, "3.0\n");
+    fprintf(fp, "4.0\n");
+    fprintf(fp, "5.0\n");
 
-    printf("Cutoff frequency fc = %.3f Hz\n", fc);
+    fclose(fp);
+
+    printf("\n[Tools] Wrote 5 samples to '%s'.\n", filename);
+    printf("Values: 1.0, 2.0, 3.0, 4.0, 5.0\n");
+    printf("You can now use 'Tools -> Auto-test' to analyse this file.\n");
 }
-static void cc_voltage_divider(void)  /* Two-resistor voltage divider */
+static void tools_save_stats_silent(SignalContext *ctx, const char *filename, double started)
 {
-    printf("\n[Voltage divider]\n");
+    /* Same report as Signal Analyzer -> Save, plus a record in the results log */
+    int ok = sa_ctx_save_stats(ctx, filename) == SA_OK;
+    printf("Saving results to '%s'... %s.\n", filename, ok ? "done" : "failed");
+    if (ok && sa_ctx_log_run(ctx, "auto-test", started) != SA_OK) {
+        printf("Warning: could not append to the results log '%s'.\n", SA_RUN_LOG);
+    }
+}
+/* Report, results-log record and cache entry of an auto-test run.  In       *
+ * pipelined mode these are written by a second thread while the plot is    *
+ * drawn; the job only holds copies, never the context.                     */
+typedef struct {
+    SaStatsRecord rec;
+    double        sum, sum_sq;
+    const char   *source;
+    const char   *report;
+    double        started;
+    struct stat   sb;           /* the source before it was read */
+    uint64_t      hash;         /* XXH64 from the reader thread */
+    int           saved, logged;
+} ToolsSaveJob;
+
+static void *tools_save_worker(void *arg)
+{
+    ToolsSaveJob *job = (ToolsSaveJob *)arg;
 
-    double Vin = uc_get_double("Enter Vin (V): ");
-    double R1  = uc_get_double("Enter R1 (ohms): ");
-    double R2  = uc_get_double("Enter R2 (ohms): ");
+    job->saved  = sa_stats_save(&job->rec, job->source, job->report, SA_SAVE_TEXT) == SA_OK;
+    job->logged = job->saved && sa_runlog_stats(&job->rec, "auto-test", job->source, job->started) == SA_OK;
+    sa_cache_store(job->source, &job->sb, &job->hash, &job->rec, SA_CACHE_HAS_DIST,
+                   job->sum, job->sum_sq, 0);
+    return NULL;
+}
+static void tools_auto_test_pipelined(const char *filename, const char *report,
+                                      const struct stat *sb, double started)
+{
+    SignalPipeTiming tm;
+    ToolsSaveJob job;
+    pthread_t writer;
 
-    if (R1 <= 0.0 || R2 <= 0.0) {
-        printf("R1 and R2 must be > 0.\n");
+    /* 1. Load: reader thread fills two buffers while this thread parses */
+    printf("\n[Tools] Pipelined mode: reading, parsing and saving overlap.\n");
+    if (!sa_load_report(sa_ctx_load_pipelined(&g_sa_ctx, filename, &tm), filename)) {
+        printf("[Tools] Auto-Test aborted (could not load samples).\n");
         return;
     }
+    printf("[Tools] %.1f MB: read %.3f s and parse %.3f s overlapped in %.3f s.\n",
+           (double)tm.bytes / 1e6, tm.read_s, tm.parse_s, tm.wall_s);
 
-    double Vout = Vin * (R2 / (R1 + R2));
+    /* 2. Statistics */
+    printf("\n[Tools] Calculating statistics...\n");
+    sa_calculate_stats();
 
-    printf("Vout = %.4f V\n", Vout);
-    /* Simultaneously output the ratio of Vout to Vout/Vin. */
-    printf("Divider ratio = Vout/Vin = %.4f\n", (Vin != 0.0) ? (Vout / Vin) : 0.0);
+    /* 3. + 4. Save on a writer thread while the plot is drawn */
+    memset(&job, 0, sizeof(job));
+    int have_job = sa_stats_snapshot(&g_sa_ctx, &job.rec) == SA_OK;
+    int threaded = 0;
+    if (have_job) {
+        job.sum     = g_sa_ctx.sig.sum;
+        job.sum_sq  = g_sa_ctx.sig.sum_sq;
+        job.source  = filename;
+        job.report  = report;
+        job.started = started;
+        job.sb      = *sb;
+        job.hash    = tm.hash;
+        threaded = pthread_create(&writer, NULL, tools_save_worker, &job) == 0;
+    }
+
+    printf("\n[Tools] Drawing ASCII plot...\n");
+    sa_plot_graph();
+
+    printf("\n[Tools] Saving results...\n");
+    if (threaded) {
+        pthread_join(writer, NULL);
+    } else if (have_job) {
+        tools_save_worker(&job);
+    }
+    printf("Saving results to '%s'... %s.\n", report, job.saved ? "done" : "failed");
+    if (job.saved && !job.logged) {
+        printf("Warning: could not append to the results log '%s'.\n", SA_RUN_LOG);
+    }
+
+    printf("\n[Tools] Auto-Test complete.\n");
 }
-static void cc_led_resistor(void)  /* Calculate THE LED Current-Limiting Resistor */
+int tools_auto_test(const char *filename, int pipelined)
 {
-    printf("\n[LED current-limit resistor]\n");
+    const char *report = "signal_stats.txt";
+    SaCacheEntry e;
+    struct stat sb;
 
-    double Vs = uc_get_double("Enter supply voltage Vs (V): ");
-    double Vf = uc_get_double("Enter LED forward voltage Vf (V): ");
-    double If_mA = uc_get_double("Enter desired LED current If (mA): ");
+    double started = sa_wall_now();
 
-    double If = If_mA / 1000.0;  /* mA -> A */
+    printf("\n[Tools] Running Auto-Test on '%s'...\n", filename);
 
-    if (If <= 0.0) {
-        printf("Current must be > 0.\n");
-        return;
+    /* 0. Unchanged since the last run: report the cached results without re-reading */
+    if (sa_cache_probe(filename, 1, &e)) {
+        SignalStats st;
+        SignalPercentiles pct;
+        sa_cache_fill(&e, &st, &pct);
+
+        printf("\n[Tools] '%s' is unchanged since it was last analysed: using cached results.\n", filename);
+        sa_print_stats(&st, &pct);
+        printf("\n[Tools] Samples not reloaded, ASCII plot skipped.\n");
+
+        printf("\n[Tools] Saving results...\n");
+        int ok = sa_stats_save(&e.stats, filename, report, SA_SAVE_TEXT) == SA_OK;
+        printf("Saving results to '%s'... %s.\n", report, ok ? "done" : "failed");
+        if (ok && sa_runlog_stats(&e.stats, "auto-test", filename, started) != SA_OK) {
+            printf("Warning: could not append to the results log '%s'.\n", SA_RUN_LOG);
+        }
+        printf("\n[Tools] Auto-Test complete.\n");
+        return 1;
     }
 
-    double Vr = Vs - Vf;
-    if (Vr <= 0.0) {
-        printf("Vs must be greater than Vf.\n");
-        return;
+    int have_stat = (stat(filename, &sb) == 0);
+    if (pipelined && have_stat) {
+        tools_auto_test_pipelined(filename, report, &sb, started);
+        return g_sa_ctx.sig.count > 0;
+    }
+
+    /* 1. Load sample file */
+    if (!sa_load_from_file_generic(filename)) {
+        printf("[Tools] Auto-Test aborted (could not load samples).\n");
+        return 0;
     }
 
-    double R = Vr / If;
+    /* 2. Compute the statistics result and then print it */
+    printf("\n[Tools] Calculating statistics...\n");
+    sa_calculate_stats();
 
-    printf("Required series resistor R = %.2f ohms\n", R);
+    /* 3. Print ASCII Graph */
+    printf("\n[Tools] Drawing ASCII plot...\n");
+    sa_plot_graph();
+
+    /* 4. Save the results and inform the user that the save was successful. */
+    printf("\n[Tools] Saving results...\n");
+    tools_save_stats_silent(&g_sa_ctx, report, started);
+
+    /* 5. Remember the results for the next run */
+    SaStatsRecord rec;
+    if (have_stat && sa_stats_snapshot(&g_sa_ctx, &rec) == SA_OK) {
+        sa_cache_store(filename, &sb, NULL, &rec, SA_CACHE_HAS_DIST,
+                       g_sa_ctx.sig.sum, g_sa_ctx.sig.sum_sq, 0);
+    }
+
+    printf("\n[Tools] Auto-Test complete.\n");
+    return 1;
 }
-static void cc_ohms_law(void) /* Simple Ohms Law calculator :) */
+static void tools_run_auto_test(void)     /* Auto Test: pipelined for large captures */
 {
-    printf("\n[Ohm's law]\n");
-    printf("1. Solve V (given I and R)\n");
-    printf("2. Solve I (given V and R)\n");
-    printf("3. Solve R (given V and I)\n");
-
-    int mode = uc_get_choice();
+    const char *filename = "samples_auto.txt";
+    struct stat sb;
 
-    if (mode == 1) {
-        double I = uc_get_double("Enter current I (A): ");
-        double R = uc_get_double("Enter resistance R (ohms): ");
-        double V = I * R;
-        printf("V = %.4f V\n", V);
-    } else if (mode == 2) {
-        double V = uc_get_double("Enter voltage V (V): ");
-        double R = uc_get_double("Enter resistance R (ohms): ");
-        if (R == 0.0) {
-            printf("R must not be 0.\n");
-            return;
-        }
-        double I = V / R;
-        printf("I = %.6f A\n", I);
-    } else if (mode == 3) {
-        double V = uc_get_double("Enter voltage V (V): ");
-        double I = uc_get_double("Enter current I (A): ");
-        if (I == 0.0) {
-            printf("I must not be 0.\n");
-            return;
+    int large = (stat(filename, &sb) == 0 && sb.st_size >= TOOLS_PIPELINE_MIN);
+    tools_auto_test(filename, large);
+}
+int tools_file_stats(int nfiles, char *const files[])
+{
+    int all_ok = 1;
+
+    for (int i = 0; i < nfiles; i++) {
+        SignalStats st;
+        SignalPercentiles pct;
+        int hit = 0;
+        double t0 = sa_live_now();
+        int status = sa_file_stats_cached(files[i], &st, &pct, &hit);
+        double ms = (sa_live_now() - t0) * 1e3;
+
+        if (status != SA_OK) {
+            printf("\n[Stats] '%s': %s.\n", files[i],
+                   status == SA_ERR_EMPTY ? "no samples found" :
+                   status == SA_ERR_MEMORY ? "out of memory" : "could not be read");
+            all_ok = 0;
+            continue;
         }
-        double R = V / I;
-        printf("R = %.2f ohms\n", R);
-    } else {
-        printf("Invalid mode.\n");
+        printf("\n[Stats] '%s': %s in %.3f ms\n", files[i],
+               hit ? "from the result cache" : "analysed and cached", ms);
+        sa_print_stats(&st, &pct);
     }
+    return all_ok;
 }
-static void cc_cap_charging(void) /* Cap Charging: V(t) = Vs * (1 − e^(−t/RC)) */
+static void tools_cached_stats(void)   /* Menu front-end for tools_file_stats() */
 {
-    printf("\n[Capacitor charging curve]\n");
+    char path[512];
 
-    double Vs   = uc_get_double("Enter supply voltage Vs (V): ");
-    double R    = uc_get_double("Enter R (ohms): ");
-    double C_uF = uc_get_double("Enter C (microfarads, uF): ");
-    double t    = uc_get_double("Enter time t (seconds): ");
+    printf("\nCapture file [samples.txt]: ");
+    if (!fgets(path, sizeof(path), stdin)) {
+        return;
+    }
+    path[strcspn(path, "\r\n")] = '\0';
 
-    if (R <= 0.0 || C_uF <= 0.0 || t < 0.0) {
-        printf("R, C must be > 0 and t >= 0.\n");
+    char *files[1] = { path[0] ? path : "samples.txt" };
+    tools_file_stats(1, files);
+}
+/* ======================================== *
+ * 7. Tools: Batch analysis (worker pool)   *
+ * ======================================== */
+
+/* Analyses every capture matching a directory or glob pattern.             *
+ * Files are split into one contiguous slice per worker thread; a worker    *
+ * takes files from the front of its own slice and, once that is empty,     *
+ * steals the back half of the fullest other slice, so a few huge files do  *
+ * not leave the other cores idle.  Each worker reuses one read buffer and  *
+ * one parse buffer for all of its files and never stores the samples:      *
+ * statistics are accumulated while parsing.  Results land in a per-file    *
+ * slot and are written as a single table once all workers have finished.  */
+
+#define TOOLS_BATCH_CHUNK        (1 << 20)   /* bytes per read() */
+#define TOOLS_BATCH_MAX_THREADS  64
+#define TOOLS_BATCH_CACHE_MIN    (256 << 10) /* smallest file worth a result-cache entry */
+
+typedef struct {
+    SaRunningStats stats;
+    long long      rejected;     /* tokens that were not numbers */
+    long long      bytes;
+    double         started;      /* Unix time the file was opened */
+    double         elapsed;      /* seconds spent on it */
+    int            ok;
+    int            cached;       /* 1 = taken from the result cache, not read */
+} BatchResult;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int             begin;       /* next file index the owner will take */
+    int             end;         /* one past the last index in this slice */
+} BatchDeque;
+
+typedef struct {
+    char       **files;
+    BatchResult *results;
+    BatchDeque  *deques;
+    int          nthreads;
+} BatchPool;
+
+typedef struct {
+    BatchPool *pool;
+    int        id;
+    int        steals;
+} BatchWorker;
+
+/* Stream one file through the chunk parser into running statistics */
+static void tools_batch_analyze_file(const char *path, BatchResult *res,
+                                     char *chunk, double *values)
+{
+    double t0 = sa_live_now();
+    res->started = sa_wall_now();
+
+    /* Small files parse faster than a cache entry can be checked and written */
+    struct stat sb;
+    SaCacheEntry e;
+    int use_cache = (stat(path, &sb) == 0 && sb.st_size >= TOOLS_BATCH_CACHE_MIN);
+    if (use_cache && sa_cache_probe(path, 0, &e)) {
+        res->stats.count  = e.stats.count;
+        res->stats.sum    = e.sum;
+        res->stats.sum_sq = e.sum_sq;
+        res->stats.min    = e.stats.min;
+        res->stats.max    = e.stats.max;
+        res->rejected     = e.rejected;
+        res->bytes        = (long long)e.size;
+        res->ok = res->cached = 1;
+        res->elapsed = sa_live_now() - t0;
         return;
     }
 
-    double C  = C_uF * 1e-6;   /* uF -> F */
-    double tau = R * C;        /* time constant RC */
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        if (fd >= 0) close(fd);
+        res->ok = 0;
+        return;
+    }
 
-    double Vt = Vs * (1.0 - exp(-t / tau));
+    /* Hash while parsing so the result can be cached without a second pass */
+    SaHash64 h;
+    sa_hash64_init(&h);
+    size_t carry = 0;
+    for (;;) {
+        ssize_t got = read(fd, chunk + carry, TOOLS_BATCH_CHUNK - carry);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
 
-    printf("Time constant tau = R*C = %.6f s\n", tau);
-    printf("V(t) = %.4f V at t = %.4f s\n", Vt, t);
-}
+        int final = (got <= 0);
+        size_t len = carry + (got > 0 ? (size_t)got : 0);
+        size_t used = 0;
+        if (got > 0) {
+            res->bytes += got;
+            sa_hash64_update(&h, chunk + carry, (size_t)got);
+        }
 
-/* ================================== *
- * 4. Resistor Colour Decoder Module  *
- * ================================== */
-void menu_resistor_colour_decoder(void)       /* Submenu */
+        size_t n = sa_parse_number_chunk(chunk, len, final, values, &used, &res->rejected);
+        for (size_t i = 0; i < n; i++) {
+            sa_running_push(&res->stats, values[i]);
+        }
+
+        if (final) {
+            res->ok = (got == 0);
+            break;
+        }
+
+        carry = len - used;
+        if (carry >= TOOLS_BATCH_CHUNK) {
+            res->rejected++;
+            carry = 0;
+        }
+        memmove(chunk, chunk + used, carry);
+    }
+
+    close(fd);
+    res->elapsed = sa_live_now() - t0;
+
+    if (res->ok && use_cache) {
+        const SaRunningStats *st = &res->stats;
+        double n = (st->count > 0) ? (double)st->count : 1.0;
+        uint64_t hash = sa_hash64_final(&h);
+        SaStatsRecord rec;
+
+        memset(&rec, 0, sizeof(rec));
+        memcpy(rec.magic, "ETKS", 4);
+        rec.version = 1;
+        rec.count = st->count;
+        rec.min   = st->min;
+        rec.max   = st->max;
+        rec.mean  = st->sum / n;
+        rec.rms   = sqrt(st->sum_sq / n);
+        sa_cache_store(path, &sb, &hash, &rec, 0, st->sum, st->sum_sq, res->rejected);
+    }
+}
+/* Take the next file index for worker `id`: own slice first, then steal */
+static int tools_batch_next(BatchPool *pool, int id, int *steals)
 {
-    int running = 1;
+    BatchDeque *own = &pool->deques[id];
 
-    while (running) {
-        printf("\n[Resistor Colour Decoder]\n");
-        printf("1. Decode 4-band resistor\n");
-        printf("2. Decode 5-band resistor\n");
-        printf("3. Back to Main Menu\n");
-        printf("---------------------------\n");
+    pthread_mutex_lock(&own->lock);
+    if (own->begin < own->end) {
+        int idx = own->begin++;
+        pthread_mutex_unlock(&own->lock);
+        return idx;
+    }
+    pthread_mutex_unlock(&own->lock);
 
-        int choice = uc_get_choice();
+    for (;;) {
+        /* Pick the victim with the most remaining work */
+        int victim = -1, best = 0;
+        for (int v = 0; v < pool->nthreads; v++) {
+            if (v == id) continue;
+            pthread_mutex_lock(&pool->deques[v].lock);
+            int left = pool->deques[v].end - pool->deques[v].begin;
+            pthread_mutex_unlock(&pool->deques[v].lock);
+            if (left > best) {
+                best = left;
+                victim = v;
+            }
+        }
+        if (victim < 0) {
+            return -1;   /* nothing left anywhere */
+        }
 
-        switch (choice) {
-            case 1:
-                resistor_decode_4band();
-                break;
-            case 2:
-                resistor_decode_5band();
-                break;
-            case 3:
-                running = 0;
-                break;
-            default:
-                printf("Unknown option.\n");
-                break;
+        BatchDeque *vd = &pool->deques[victim];
+        pthread_mutex_lock(&vd->lock);
+        int left = vd->end - vd->begin;
+        if (left <= 0) {
+            pthread_mutex_unlock(&vd->lock);
+            continue;    /* victim drained meanwhile, look again */
         }
+        int take = (left + 1) / 2;           /* back half, at least one file */
+        int start = vd->end - take;
+        vd->end = start;
+        pthread_mutex_unlock(&vd->lock);
+
+        /* Keep the first stolen file, queue the rest in our own slice */
+        pthread_mutex_lock(&own->lock);
+        own->begin = start + 1;
+        own->end   = start + take;
+        pthread_mutex_unlock(&own->lock);
+
+        (*steals)++;
+        return start;
     }
 }
+static void *tools_batch_worker(void *arg)
+{
+    BatchWorker *w = (BatchWorker *)arg;
+    BatchPool *pool = w->pool;
 
-/* ===================================== *
- * 4. Resistor Colour Decoder Functions  *
- * ===================================== */
-static void resistor_decode_4band(void)       /* 4 band resistor */
+    /* Per-thread buffers, reused for every file this worker analyses */
+    char   *chunk  = malloc(TOOLS_BATCH_CHUNK + 1);
+    double *values = malloc((TOOLS_BATCH_CHUNK / 2 + 1) * sizeof(double));
+
+    int idx;
+    while ((idx = tools_batch_next(pool, w->id, &w->steals)) >= 0) {
+        if (chunk && values) {
+            tools_batch_analyze_file(pool->files[idx], &pool->results[idx], chunk, values);
+        }
+    }
+
+    free(chunk);
+    free(values);
+    return NULL;
+}
+int tools_batch_analyze(const char *pattern, const char *out_file)
 {
-    char b1[32], b2[32], b3[32], b4[32];
+    char dir_pattern[1024];
+    struct stat sb;
+    glob_t g;
+
+    /* A directory means "every regular file in it" */
+    if (stat(pattern, &sb) == 0 && S_ISDIR(sb.st_mode)) {
+        snprintf(dir_pattern, sizeof(dir_pattern), "%s/*", pattern);
+        pattern = dir_pattern;
+    }
 
-    printf("\n[4-band resistor colour decoder]\n");
-    printf("Supported colours:\n");
-    printf("  black, brown, red, orange, yellow, green, blue,\n");
-    printf("  violet, grey, white, gold, silver (tolerance only)\n\n");
+    if (glob(pattern, 0, NULL, &g) != 0 || g.gl_pathc == 0) {
+        printf("\n[Batch] No files match '%s'.\n", pattern);
+        globfree(&g);
+        return 0;
+    }
 
-    /* Read 4 band colours */
-    printf("Enter band 1 colour (first digit): ");
-    if (!fgets(b1, sizeof(b1), stdin)) return;
-    printf("Enter band 2 colour (second digit): ");
-    if (!fgets(b2, sizeof(b2), stdin)) return;
-    printf("Enter band 3 colour (multiplier): ");
-    if (!fgets(b3, sizeof(b3), stdin)) return;
-    printf("Enter band 4 colour (tolerance): ");
-    if (!fgets(b4, sizeof(b4), stdin)) return;
+    /* Keep regular files only */
+    int nfiles = 0;
+    char **files = malloc(g.gl_pathc * sizeof(char *));
+    if (!files) {
+        globfree(&g);
+        return 0;
+    }
+    for (size_t i = 0; i < g.gl_pathc; i++) {
+        if (stat(g.gl_pathv[i], &sb) == 0 && S_ISREG(sb.st_mode)) {
+            files[nfiles++] = g.gl_pathv[i];
+        }
+    }
+    if (nfiles == 0) {
+        printf("\n[Batch] No regular files match '%s'.\n", pattern);
+        free(files);
+        globfree(&g);
+        return 0;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = (cores > 0) ? (int)cores : 1;
+    if (nthreads > TOOLS_BATCH_MAX_THREADS) nthreads = TOOLS_BATCH_MAX_THREADS;
+    if (nthreads > nfiles) nthreads = nfiles;
+
+    BatchResult *results = calloc((size_t)nfiles, sizeof(BatchResult));
+    BatchDeque  deques[TOOLS_BATCH_MAX_THREADS];
+    BatchWorker workers[TOOLS_BATCH_MAX_THREADS];
+    pthread_t   tids[TOOLS_BATCH_MAX_THREADS];
+    BatchPool   pool = { files, results, deques, nthreads };
+
+    if (!results) {
+        free(files);
+        globfree(&g);
+        return 0;
+    }
+
+    /* Initial even split: worker t owns files [t*n/T, (t+1)*n/T) */
+    for (int t = 0; t < nthreads; t++) {
+        pthread_mutex_init(&deques[t].lock, NULL);
+        deques[t].begin = (int)((long long)t * nfiles / nthreads);
+        deques[t].end   = (int)((long long)(t + 1) * nfiles / nthreads);
+    }
+
+    printf("\n[Batch] Analysing %d files with %d worker thread(s)...\n", nfiles, nthreads);
+    double start = sa_live_now();
+
+    int started = 1;                     /* the calling thread is worker 0 */
+    int created[TOOLS_BATCH_MAX_THREADS] = { 0 };
+    for (int t = 0; t < nthreads; t++) {
+        workers[t].pool = &pool;
+        workers[t].id = t;
+        workers[t].steals = 0;
+        if (t > 0 && pthread_create(&tids[t], NULL, tools_batch_worker, &workers[t]) == 0) {
+            created[t] = 1;
+            started++;
+        }
+    }
+    /* Slices of threads that failed to start are simply stolen by the others */
+    tools_batch_worker(&workers[0]);
+    for (int t = 1; t < nthreads; t++) {
+        if (created[t]) pthread_join(tids[t], NULL);
+    }
 
-    /* Remove line breaks and convert to lowercase / 去掉换行并转小写 */
-    b1[strcspn(b1, "\r\n")] = '\0';
-    b2[strcspn(b2, "\r\n")] = '\0';
-    b3[strcspn(b3, "\r\n")] = '\0';
-    b4[strcspn(b4, "\r\n")] = '\0';
+    double elapsed = sa_live_now() - start;
 
-    str_to_lower(b1);
-    str_to_lower(b2);
-    str_to_lower(b3);
-    str_to_lower(b4);
+    /* Consolidated table */
+    FILE *fp = fopen(out_file, "w");
+    if (!fp) {
+        printf("\nError: Could not open '%s' for writing.\n", out_file);
+    }
 
-    int d1 = resistor_digit_from_color(b1);
-    int d2 = resistor_digit_from_color(b2);
-    double mult = 0.0;
-    double tol  = 0.0;
+    long long total_samples = 0, total_bytes = 0;
+    int failed = 0, steals = 0, cached = 0;
+    for (int t = 0; t < nthreads; t++) steals += workers[t].steals;
 
-    if (d1 < 0 || d2 < 0) {
-        printf("Error: invalid colour in first or second band.\n");
-        return;
+    if (fp) {
+        fprintf(fp, "# Batch analysis of '%s': %d files, %d threads, %.3f s\n",
+                pattern, nfiles, started, elapsed);
+        fprintf(fp, "# %-38s %12s %14s %14s %14s %14s %s\n",
+                "file", "count", "min", "max", "mean", "rms", "status");
     }
-    if (resistor_multiplier_from_color(b3, &mult) != 0) {
-        printf("Error: invalid multiplier colour.\n");
-        return;
+    for (int i = 0; i < nfiles; i++) {
+        const BatchResult *r = &results[i];
+        const SaRunningStats *st = &r->stats;
+        const char *status = !r->ok ? "read-error" : (st->count == 0 ? "no-samples" : "ok");
+        double mean = (st->count > 0) ? st->sum / (double)st->count : 0.0;
+        double rms  = (st->count > 0) ? sqrt(st->sum_sq / (double)st->count) : 0.0;
+
+        if (!r->ok || st->count == 0) failed++;
+        total_samples += st->count;
+        if (r->cached) cached++;
+        else total_bytes += r->bytes;
+
+        if (fp) {
+            fprintf(fp, "%-40s %12lld %14.6f %14.6f %14.6f %14.6f %s\n",
+                    files[i], st->count, st->min, st->max, mean, rms, status);
+        }
     }
-    if (resistor_tolerance_from_color(b4, &tol) != 0) {
-        printf("Error: invalid tolerance colour.\n");
-        return;
+    if (fp) {
+        fclose(fp);
     }
 
-    int base = d1 * 10 + d2;       /* The first two digits */
-    double R = base * mult;        /* OHM */
-
-    double display_value = R;
-    const char *unit = "Ω";
+    /* One results-log record per file, appended in a single batch */
+    int logged = sa_runlog_begin();
+    for (int i = 0; logged && i < nfiles; i++) {
+        const BatchResult *r = &results[i];
+        const SaRunningStats *st = &r->stats;
+        double n = (st->count > 0) ? (double)st->count : 1.0;
+
+        sa_runlog_head(r->started, r->elapsed, "batch", files[i]);
+        if (st->count > 0) {
+            sa_out_json_basic(&g_sa_runlog.ob, st->count, st->min, st->max,
+                              st->sum / n, sqrt(st->sum_sq / n));
+        } else {
+            sa_out_str(&g_sa_runlog.ob, "\"count\":0");
+        }
+        sa_out_str(&g_sa_runlog.ob, ",\"bytes\":");
+        sa_out_int(&g_sa_runlog.ob, r->bytes);
+        sa_out_str(&g_sa_runlog.ob, ",\"rejected\":");
+        sa_out_int(&g_sa_runlog.ob, r->rejected);
+        sa_out_str(&g_sa_runlog.ob, r->cached ? ",\"cached\":true" : ",\"cached\":false");
+        sa_runlog_tail(!r->ok ? "read-error" : (st->count == 0 ? "no-samples" : "ok"));
+    }
+    if (logged && !sa_runlog_end()) logged = 0;
 
-    if (R >= 1e6) {
-        display_value = R / 1e6;
-        unit = "MΩ";
-    } else if (R >= 1e3) {
-        display_value = R / 1e3;
-        unit = "kΩ";
+    printf("[Batch] %d files (%d from the result cache, %d without samples or unreadable), "
+           "%lld samples, %.1f MB read in %.3f s",
+           nfiles, cached, failed, total_samples, (double)total_bytes / 1e6, elapsed);
+    if (elapsed > 0.0) {
+        printf(" (%.1f MB/s)", (double)total_bytes / 1e6 / elapsed);
+    }
+    printf(", %d work steals.\n", steals);
+    if (fp) {
+        printf("[Batch] Results table written to '%s'.\n", out_file);
+    }
+    if (!logged) {
+        printf("[Batch] Warning: could not append to the results log '%s'.\n", SA_RUN_LOG);
     }
 
-    printf("\nResult (4-band):\n");
-    printf("  Nominal resistance: %.3f %s\n", display_value, unit);
-    printf("  Tolerance: ±%.2f %%\n", tol);
+    for (int t = 0; t < nthreads; t++) {
+        pthread_mutex_destroy(&deques[t].lock);
+    }
+    free(results);
+    free(files);
+    globfree(&g);
+    return fp != NULL;
 }
-static void resistor_decode_5band(void)       /* 5 band resistor */
+static void tools_batch_analysis(void)   /* Menu front-end for tools_batch_analyze() */
 {
-    char b1[32], b2[32], b3[32], b4[32], b5[32];
+    char pattern[512];
 
-    printf("\n[5-band resistor colour decoder]\n");
-    printf("Supported colours (digits & multiplier):\n");
-    printf("  black, brown, red, orange, yellow, green, blue,\n");
-    printf("  violet, grey, white, gold, silver (mult/tolerance)\n\n");
+    printf("\n[Batch analysis]\n");
+    printf("Enter a directory or glob pattern (e.g. captures/*.txt): ");
+    if (!fgets(pattern, sizeof(pattern), stdin)) {
+        printf("\nInput error. Cancelling.\n");
+        return;
+    }
+    pattern[strcspn(pattern, "\r\n")] = '\0';
 
-    /* Read 5 band colours */
-    printf("Enter band 1 colour (first digit): ");
-    if (!fgets(b1, sizeof(b1), stdin)) return;
-    printf("Enter band 2 colour (second digit): ");
-    if (!fgets(b2, sizeof(b2), stdin)) return;
-    printf("Enter band 3 colour (third digit): ");
-    if (!fgets(b3, sizeof(b3), stdin)) return;
-    printf("Enter band 4 colour (multiplier): ");
-    if (!fgets(b4, sizeof(b4), stdin)) return;
-    printf("Enter band 5 colour (tolerance): ");
-    if (!fgets(b5, sizeof(b5), stdin)) return;
+    if (pattern[0] == '\0') {
+        printf("No pattern given.\n");
+        return;
+    }
 
-    /* Remove line breaks and convert to lowercase / 去掉换行并转小写 */
-    b1[strcspn(b1, "\r\n")] = '\0';
-    b2[strcspn(b2, "\r\n")] = '\0';
-    b3[strcspn(b3, "\r\n")] = '\0';
-    b4[strcspn(b4, "\r\n")] = '\0';
-    b5[strcspn(b5, "\r\n")] = '\0';
+    tools_batch_analyze(pattern, "batch_results.txt");
+}
+
+/* ========================================== *
+ * 7. Tools: Server mode (Unix domain socket) *
+ * ========================================== */
+
+/* `--serve [socket] [workers]` keeps the toolkit resident so other local   *
+ * programs can use it without paying process start-up for every request.   *
+ * One request per line, one response line per request, in order:           *
+ *   PING                                    OK pong                        *
+ *   ANALYZE <file>                          OK count=.. min=.. ... cached=1 *
+ *   CONVERT <name> <value>                  OK value=.. unit=..            *
+ *   RESISTOR <4 or 5 colours>               OK ohms=.. tolerance=..        *
+ *   CIRCUIT rc <R> <C_uF>                   OK fc=..                       *
+ *   CIRCUIT divider <Vin> <R1> <R2>         OK vout=.. ratio=..            *
+ *   CIRCUIT led <Vs> <Vf> <If_mA>           OK ohms=..                     *
+ *   CIRCUIT ohm v|i|r <a> <b>               OK v=.. / i=.. / r=..          *
+ *   CIRCUIT cap <Vs> <R> <C_uF> <t>         OK tau=.. v=..                 *
+ *   EVAL <expr>[; name=value ...]           OK value=..                    *
+ *   STATS                                   OK requests=.. mean_us=.. ...  *
+ *   QUIT                                    closes the connection          *
+ * Failures answer "ERR <reason>".  Numbers may carry SI prefixes (4.7k) and *
+ * are answered in shortest round-trip form.  CONVERT names are the ones in *
+ * etk_convert() (dbm-mw, c-k, adc-temp, ...).                              *
+ * A fixed pool of workers is started up front.  Each owns its read buffer, *
+ * its response buffer and a SignalContext whose sample array is kept       *
+ * between ANALYZE requests, so a warm worker does not allocate.  Analyses   *
+ * go through the result cache; only real analyses (cache misses) go to the *
+ * run log.  ANALYZE reads regular files only (no FIFOs or devices), at     *
+ * most SRV_MAX_FILE bytes.  The acceptor queues connections for idle       *
+ * workers; a client may keep its connection and pipeline requests - every  *
+ * complete line from one read() is answered with a single write().  A      *
+ * worker serves one connection at a time, so at most `workers` clients    *
+ * are connected at once and the rest wait in the queue; a connection      *
+ * silent for SRV_IDLE_TIMEOUT_S seconds gets "ERR idle timeout" and is     *
+ * closed.                                                                  *
+ * SIGINT / SIGTERM stop the server and remove the socket.                  */
+
+#define SRV_DEFAULT_SOCKET  "elec_toolkit.sock"
+#define SRV_MAX_WORKERS     64
+#define SRV_MIN_WORKERS     4
+#define SRV_QUEUE           128          /* accepted connections waiting for a worker */
+#define SRV_IN_SIZE         (64 << 10)   /* read buffer; also the longest request line */
+#define SRV_MAX_ARGS        8
+#define SRV_IDLE_TIMEOUT_S  30           /* a silent client gives its worker back */
+#define SRV_MAX_FILE        (1LL << 30)  /* ANALYZE reads at most this many bytes */
+
+enum { SRV_REPLIED, SRV_FAILED, SRV_QUIT };
+
+typedef struct SrvServer SrvServer;
+
+typedef struct {
+    SrvServer         *srv;
+    pthread_t          thread;
+    atomic_int         fd;               /* connection being served, -1 when idle */
+    char              *in;
+    SaOutBuf           out;
+    SignalContext      ctx;              /* keeps its sample array between analyses */
+    atomic_ullong      requests;         /* written by the owner only */
+    atomic_ullong      errors;
+    atomic_ullong      busy_ns;
+    atomic_ullong      max_ns;
+} SrvWorker;
+
+struct SrvServer {
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;
+    int             queue[SRV_QUEUE];
+    int             head, count;
+    int             stopping;
+    double          started;
+    atomic_ullong   connections;
+    SrvWorker      *workers;
+    int             nworkers;
+};
+
+static volatile sig_atomic_t g_srv_stop;
+
+static void srv_on_signal(int sig)
+{
+    (void)sig;
+    g_srv_stop = 1;
+}
+
+/* ---- Request parsing ---- */
+static char *srv_token(char **p)
+{
+    char *s = *p;
+    while (*s == ' ' || *s == '\t') s++;
+    if (*s == '\0') {
+        *p = s;
+        return NULL;
+    }
+    char *t = s;
+    while (*s && *s != ' ' && *s != '\t') s++;
+    if (*s) *s++ = '\0';
+    *p = s;
+    return t;
+}
+static char *srv_trim(char *s)
+{
+    while (*s == ' ' || *s == '\t') s++;
+    size_t n = strlen(s);
+    while (n > 0 && (s[n - 1] == ' ' || s[n - 1] == '\t')) s[--n] = '\0';
+    return s;
+}
+/* Split the arguments; returns the count, or max + 1 if there are more */
+static int srv_split(char *args, char *argv[], int max)
+{
+    int n = 0;
+    char *t;
+    while ((t = srv_token(&args)) != NULL) {
+        if (n == max) return max + 1;
+        argv[n++] = t;
+    }
+    return n;
+}
+/* A plain number, or a constant expression with SI prefixes (4.7k, 1/3) */
+static int srv_number(const char *s, double *v)
+{
+    char *end;
+    char err[64];
+    EcProgram prog;
+
+    errno = 0;
+    *v = strtod(s, &end);
+    if (end != s && *end == '\0' && errno == 0) {
+        return 1;
+    }
+    if (!ec_compile(s, NULL, 0, &prog, err, sizeof(err)) || prog.nvars > 0) {
+        return 0;
+    }
+    *v = ec_eval(&prog, NULL);
+    return 1;
+}
+static int srv_numbers(char *const argv[], int n, double *v)
+{
+    for (int i = 0; i < n; i++) {
+        if (!srv_number(argv[i], &v[i])) return 0;
+    }
+    return 1;
+}
 
-    str_to_lower(b1);
-    str_to_lower(b2);
-    str_to_lower(b3);
-    str_to_lower(b4);
-    str_to_lower(b5);
+/* ---- Responses ---- */
+static int srv_fail(SaOutBuf *ob, const char *msg)
+{
+    sa_out_str(ob, "ERR ");
+    sa_out_str(ob, msg);
+    sa_out_char(ob, '\n');
+    return SRV_FAILED;
+}
+static void srv_num(SaOutBuf *ob, const char *key, double v)
+{
+    sa_out_char(ob, ' ');
+    sa_out_str(ob, key);
+    sa_out_char(ob, '=');
+    sa_out_shortest(ob, v);
+}
+static void srv_int(SaOutBuf *ob, const char *key, long long v)
+{
+    sa_out_char(ob, ' ');
+    sa_out_str(ob, key);
+    sa_out_char(ob, '=');
+    sa_out_int(ob, v);
+}
 
-    int d1 = resistor_digit_from_color(b1);
-    int d2 = resistor_digit_from_color(b2);
-    int d3 = resistor_digit_from_color(b3);
-    double mult = 0.0;
-    double tol  = 0.0;
+/* ---- Commands ---- */
+static int srv_cmd_analyze(SrvWorker *w, char *args)
+{
+    SaOutBuf *ob = &w->out;
+    const char *path = srv_trim(args);
+    SaCacheEntry e;
 
-    if (d1 < 0 || d2 < 0 || d3 < 0) {
-        printf("Error: invalid colour in first, second or third band.\n");
-        return;
+    if (*path == '\0') {
+        return srv_fail(ob, "usage: ANALYZE <file>");
     }
-    if (resistor_multiplier_from_color(b4, &mult) != 0) {
-        printf("Error: invalid multiplier colour.\n");
-        return;
+    /* Regular files only: a FIFO or /dev/zero would hold the worker forever.  *
+     * O_NONBLOCK keeps open() itself from waiting for a FIFO writer.          */
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+    struct stat sb;
+    if (fd < 0) {
+        return srv_fail(ob, "could not be read");
     }
-    if (resistor_tolerance_from_color(b5, &tol) != 0) {
-        printf("Error: invalid tolerance colour.\n");
-        return;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+        close(fd);
+        return srv_fail(ob, "not a regular file");
+    }
+    if (sb.st_size > SRV_MAX_FILE) {
+        close(fd);
+        return srv_fail(ob, "file too large");
     }
 
-    int base = d1 * 100 + d2 * 10 + d3;    /* 5-band: Three digits */
-    double R = base * mult;                /* OHM */
+    double started = sa_wall_now();
+    int hit = sa_cache_probe(path, 1, &e);
+    if (!hit) {
+        int status = sa_cache_analyze(&w->ctx, path, fd, SRV_MAX_FILE, &e);
+        if (status != SA_OK) {
+            close(fd);
+            return srv_fail(ob, status == SA_ERR_EMPTY ? "no samples found" :
+                                status == SA_ERR_MEMORY ? "out of memory" :
+                                status == SA_ERR_FORMAT ? "file too large" : "could not be read");
+        }
+        sa_runlog_stats(&e.stats, "serve", path, started);
+    }
+    close(fd);
+
+    const SaStatsRecord *r = &e.stats;
+    sa_out_str(ob, "OK");
+    srv_int(ob, "count", r->count);
+    srv_num(ob, "min", r->min);
+    srv_num(ob, "max", r->max);
+    srv_num(ob, "mean", r->mean);
+    srv_num(ob, "rms", r->rms);
+    srv_num(ob, "p50", r->p50);
+    srv_num(ob, "p95", r->p95);
+    srv_num(ob, "p99", r->p99);
+    srv_num(ob, "p999", r->p999);
+    srv_int(ob, "exact", r->exact);
+    srv_int(ob, "cached", hit);
+    sa_out_char(ob, '\n');
+    return SRV_REPLIED;
+}
+static int srv_cmd_convert(SrvWorker *w, char *args)
+{
+    SaOutBuf *ob = &w->out;
+    char *argv[SRV_MAX_ARGS];
+    const char *unit = "";
+    double x, y;
 
-    double display_value = R;
-    const char *unit = "Ω";
+    if (srv_split(args, argv, SRV_MAX_ARGS) != 2 || !srv_number(argv[1], &x)) {
+        return srv_fail(ob, "usage: CONVERT <name> <value>");
+    }
+    int rc = etk_convert(argv[0], x, &y, &unit);
+    if (rc == ETK_ERR_ARG)   return srv_fail(ob, "unknown conversion");
+    if (rc == ETK_ERR_RANGE) return srv_fail(ob, "value out of range");
+
+    sa_out_str(ob, "OK");
+    srv_num(ob, "value", y);
+    sa_out_str(ob, " unit=");
+    sa_out_str(ob, unit);
+    sa_out_char(ob, '\n');
+    return SRV_REPLIED;
+}
+static int srv_cmd_resistor(SrvWorker *w, char *args)
+{
+    SaOutBuf *ob = &w->out;
+    char *bands[SRV_MAX_ARGS];
+    double ohms = 0.0, tol = 0.0;
 
-    if (R >= 1e6) {
-        display_value = R / 1e6;
-        unit = "MΩ";
-    } else if (R >= 1e3) {
-        display_value = R / 1e3;
-        unit = "kΩ";
+    int n = srv_split(args, bands, SRV_MAX_ARGS);
+    if (n != 4 && n != 5) {
+        return srv_fail(ob, "usage: RESISTOR <4 or 5 colours>");
     }
+    int bad = etk_resistor_decode((const char *const *)bands, n, &ohms, &tol);
+    if (bad != 0) {
+        char msg[48];
+        snprintf(msg, sizeof(msg), "invalid colour in band %d", bad);
+        return srv_fail(ob, msg);
+    }
+    sa_out_str(ob, "OK");
+    srv_num(ob, "ohms", ohms);
+    srv_num(ob, "tolerance", tol);
+    sa_out_char(ob, '\n');
+    return SRV_REPLIED;
+}
+static int srv_cmd_circuit(SrvWorker *w, char *args)
+{
+    SaOutBuf *ob = &w->out;
+    char *argv[SRV_MAX_ARGS];
+    double v[SRV_MAX_ARGS];
 
-    printf("\nResult (5-band):\n");
-    printf("  Nominal resistance: %.3f %s\n", display_value, unit);
-    printf("  Tolerance: ±%.2f %%\n", tol);
+    int n = srv_split(args, argv, SRV_MAX_ARGS);
+    if (n < 1) {
+        return srv_fail(ob, "usage: CIRCUIT rc|divider|led|ohm|cap <values>");
+    }
+    const char *f = argv[0];
+
+    if (strcasecmp(f, "rc") == 0) {
+        if (n != 3 || !srv_numbers(argv + 1, 2, v)) return srv_fail(ob, "usage: CIRCUIT rc <R> <C_uF>");
+        if (v[0] <= 0.0 || v[1] <= 0.0) return srv_fail(ob, "R and C must be > 0");
+        sa_out_str(ob, "OK");
+        srv_num(ob, "fc", etk_rc_cutoff_hz(v[0], v[1]));
+    } else if (strcasecmp(f, "divider") == 0) {
+        if (n != 4 || !srv_numbers(argv + 1, 3, v)) return srv_fail(ob, "usage: CIRCUIT divider <Vin> <R1> <R2>");
+        if (v[1] <= 0.0 || v[2] <= 0.0) return srv_fail(ob, "R1 and R2 must be > 0");
+        double vout = etk_divider_vout(v[0], v[1], v[2]);
+        sa_out_str(ob, "OK");
+        srv_num(ob, "vout", vout);
+        srv_num(ob, "ratio", (v[0] != 0.0) ? (vout / v[0]) : 0.0);
+    } else if (strcasecmp(f, "led") == 0) {
+        if (n != 4 || !srv_numbers(argv + 1, 3, v)) return srv_fail(ob, "usage: CIRCUIT led <Vs> <Vf> <If_mA>");
+        if (v[2] <= 0.0) return srv_fail(ob, "current must be > 0");
+        if (v[0] - v[1] <= 0.0) return srv_fail(ob, "Vs must be greater than Vf");
+        sa_out_str(ob, "OK");
+        srv_num(ob, "ohms", etk_led_resistor_ohms(v[0], v[1], v[2]));
+    } else if (strcasecmp(f, "ohm") == 0) {
+        if (n != 4 || !srv_numbers(argv + 2, 2, v)) return srv_fail(ob, "usage: CIRCUIT ohm v|i|r <a> <b>");
+        char solve = (char)tolower((unsigned char)argv[1][0]);
+        if (argv[1][1] != '\0' || (solve != 'v' && solve != 'i' && solve != 'r')) {
+            return srv_fail(ob, "usage: CIRCUIT ohm v|i|r <a> <b>");
+        }
+        if (solve != 'v' && v[1] == 0.0) {
+            return srv_fail(ob, solve == 'i' ? "R must not be 0" : "I must not be 0");
+        }
+        sa_out_str(ob, "OK");
+        if (solve == 'v')      srv_num(ob, "v", v[0] * v[1]);   /* I R */
+        else if (solve == 'i') srv_num(ob, "i", v[0] / v[1]);   /* V R */
+        else                   srv_num(ob, "r", v[0] / v[1]);   /* V I */
+    } else if (strcasecmp(f, "cap") == 0) {
+        if (n != 5 || !srv_numbers(argv + 1, 4, v)) return srv_fail(ob, "usage: CIRCUIT cap <Vs> <R> <C_uF> <t>");
+        if (v[1] <= 0.0 || v[2] <= 0.0 || v[3] < 0.0) return srv_fail(ob, "R, C must be > 0 and t >= 0");
+        sa_out_str(ob, "OK");
+        srv_num(ob, "tau", etk_time_constant(v[1], v[2]));
+        srv_num(ob, "v", etk_cap_voltage(v[0], v[1], v[2], v[3]));
+    } else {
+        return srv_fail(ob, "unknown circuit formula");
+    }
+    sa_out_char(ob, '\n');
+    return SRV_REPLIED;
 }
-static void str_to_lower(char *s)    /* converts a C-string to lowercase in-place */
-{         
-    while (*s) {
-        *s = (char)tolower((unsigned char)*s);
-        s++;
+static int srv_cmd_eval(SrvWorker *w, char *args)
+{
+    SaOutBuf *ob = &w->out;
+    EcBinding bind[EC_MAX_VARS];
+    EcProgram prog;
+    char err[96];
+    int nbind = 0;
+
+    char *expr = args;
+    char *next = strchr(args, ';');
+    if (next) *next++ = '\0';
+    while (next) {                        /* name=value bindings */
+        char *item = next;
+        next = strchr(item, ';');
+        if (next) *next++ = '\0';
+        char *eq = strchr(item, '=');
+        if (!eq) return srv_fail(ob, "binding must be name=value");
+        *eq = '\0';
+        if (nbind == EC_MAX_VARS) return srv_fail(ob, "too many bindings");
+        bind[nbind].name = srv_trim(item);
+        if (!srv_number(srv_trim(eq + 1), &bind[nbind].value)) {
+            return srv_fail(ob, "invalid binding value");
+        }
+        nbind++;
+    }
+    expr = srv_trim(expr);
+    if (*expr == '\0') {
+        return srv_fail(ob, "usage: EVAL <expr>[; name=value ...]");
+    }
+    if (!ec_compile(expr, bind, nbind, &prog, err, sizeof(err))) {
+        return srv_fail(ob, err);
     }
+    if (prog.nvars > 0) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "unbound variable %s", prog.var_names[0]);
+        return srv_fail(ob, msg);
+    }
+    sa_out_str(ob, "OK");
+    srv_num(ob, "value", ec_eval(&prog, NULL));
+    sa_out_char(ob, '\n');
+    return SRV_REPLIED;
 }
-static int resistor_digit_from_color(const char *s) /* Maps a colour name to its corresponding digit 0–9 */
-{
-    if      (strcmp(s, "black")  == 0) return 0;
-    else if (strcmp(s, "brown")  == 0) return 1;
-    else if (strcmp(s, "red")    == 0) return 2;
-    else if (strcmp(s, "orange") == 0) return 3;
-    else if (strcmp(s, "yellow") == 0) return 4;
-    else if (strcmp(s, "green")  == 0) return 5;
-    else if (strcmp(s, "blue")   == 0) return 6;
-    else if (strcmp(s, "violet") == 0) return 7;
-    else if (strcmp(s, "grey")   == 0 || strcmp(s, "gray") == 0) return 8;
-    else if (strcmp(s, "white")  == 0) return 9;
-    return -1; /* invalid */
-}
-static int resistor_multiplier_from_color(const char *s, double *mult)  /* Maps a colour name to its multiplier (×10^n) as a double */
-{
-    if      (strcmp(s, "black")  == 0) *mult = 1.0;
-    else if (strcmp(s, "brown")  == 0) *mult = 10.0;
-    else if (strcmp(s, "red")    == 0) *mult = 100.0;
-    else if (strcmp(s, "orange") == 0) *mult = 1e3;
-    else if (strcmp(s, "yellow") == 0) *mult = 1e4;
-    else if (strcmp(s, "green")  == 0) *mult = 1e5;
-    else if (strcmp(s, "blue")   == 0) *mult = 1e6;
-    else if (strcmp(s, "violet") == 0) *mult = 1e7;
-    else if (strcmp(s, "grey")   == 0 || strcmp(s, "gray") == 0) *mult = 1e8;
-    else if (strcmp(s, "white")  == 0) *mult = 1e9;
-    else if (strcmp(s, "gold")   == 0) *mult = 0.1;
-    else if (strcmp(s, "silver") == 0) *mult = 0.01;
-    else return -1;
-    return 0;
+static void srv_totals(SrvServer *srv, unsigned long long *req, unsigned long long *err,
+                       unsigned long long *busy_ns, unsigned long long *max_ns)
+{
+    *req = *err = *busy_ns = *max_ns = 0;
+    for (int i = 0; i < srv->nworkers; i++) {
+        SrvWorker *w = &srv->workers[i];
+        unsigned long long m = atomic_load_explicit(&w->max_ns, memory_order_relaxed);
+        *req     += atomic_load_explicit(&w->requests, memory_order_relaxed);
+        *err     += atomic_load_explicit(&w->errors, memory_order_relaxed);
+        *busy_ns += atomic_load_explicit(&w->busy_ns, memory_order_relaxed);
+        if (m > *max_ns) *max_ns = m;
+    }
 }
-static int resistor_tolerance_from_color(const char *s, double *tol)  /* Maps a colour name to its tolerance percentage */
-{
-    /* Percentage */
-    if      (strcmp(s, "brown")  == 0) *tol = 1.0;
-    else if (strcmp(s, "red")    == 0) *tol = 2.0;
-    else if (strcmp(s, "green")  == 0) *tol = 0.5;
-    else if (strcmp(s, "blue")   == 0) *tol = 0.25;
-    else if (strcmp(s, "violet") == 0) *tol = 0.10;
-    else if (strcmp(s, "grey")   == 0 || strcmp(s, "gray") == 0) *tol = 0.05;
-    else if (strcmp(s, "gold")   == 0) *tol = 5.0;
-    else if (strcmp(s, "silver") == 0) *tol = 10.0;
-    else return -1;
-    return 0;
+static int srv_cmd_stats(SrvWorker *w)
+{
+    SaOutBuf *ob = &w->out;
+    unsigned long long req, err, busy_ns, max_ns;
+
+    srv_totals(w->srv, &req, &err, &busy_ns, &max_ns);
+    sa_out_str(ob, "OK");
+    srv_int(ob, "workers", w->srv->nworkers);
+    srv_int(ob, "connections", (long long)atomic_load(&w->srv->connections));
+    srv_int(ob, "requests", (long long)req);
+    srv_int(ob, "errors", (long long)err);
+    sa_out_str(ob, " mean_us=");
+    sa_out_fixed(ob, req ? (double)busy_ns / (double)req * 1e-3 : 0.0, 2);
+    sa_out_str(ob, " max_us=");
+    sa_out_fixed(ob, (double)max_ns * 1e-3, 2);
+    sa_out_str(ob, " uptime_s=");
+    sa_out_fixed(ob, sa_live_now() - w->srv->started, 3);
+    sa_out_char(ob, '\n');
+    return SRV_REPLIED;
 }
 
-/* ================================= *
- * 6. Engineering Calculator Module  *
- * ================================= */
-void menu_engineering_calculator(void)
+static int srv_handle(SrvWorker *w, char *line)
 {
-    printf("\n[Engineering Calculator]\n");
-    printf("This feature slot is reserved for a future DLC.\n"); 
-    printf("For general arithmetic and scientific functions,\n");
-    printf("please use a normal calculator.\n");
-    printf("This project focuses on signal and circuit tools.\n");
-    printf("\nTip: An Easter egg is hidden inside funcs.c.\n");
-    printf("A tiny cat is waiting for you to discover it. Go Say Hi!\n");
+    char *args = line;
+    char *cmd = srv_token(&args);
+
+    if (!cmd)                            return srv_fail(&w->out, "empty request");
+    if (strcasecmp(cmd, "PING") == 0)    { sa_out_str(&w->out, "OK pong\n"); return SRV_REPLIED; }
+    if (strcasecmp(cmd, "ANALYZE") == 0)  return srv_cmd_analyze(w, args);
+    if (strcasecmp(cmd, "CONVERT") == 0)  return srv_cmd_convert(w, args);
+    if (strcasecmp(cmd, "RESISTOR") == 0) return srv_cmd_resistor(w, args);
+    if (strcasecmp(cmd, "CIRCUIT") == 0)  return srv_cmd_circuit(w, args);
+    if (strcasecmp(cmd, "EVAL") == 0)     return srv_cmd_eval(w, args);
+    if (strcasecmp(cmd, "STATS") == 0)    return srv_cmd_stats(w);
+    if (strcasecmp(cmd, "QUIT") == 0)     return SRV_QUIT;
+    return srv_fail(&w->out, "unknown command");
 }
-/* ======================================================================= *
- *   This feature has been delayed......again.                             *
- *   Release date: TBD (just like GTA 6 before 2026).                      *
- *                                                                         *
- *              ▄██████▄      ╔═╗┬ ┬┌─┐┬┌─                                 *
- *             ███    ███     ║═╬└┬┘├─┤├┴┐  (Coming Soon™)                 *   
- *             ███    ███     ╚═╝ ┴ ┴ ┴┴ ┴                                 *
- *             ███    ███                                                  * 
- *             ▀██████▀                                                    *
- *                                                                         *
- *   Please enjoy other fully implemented modules while waiting :)         *
- *                                                                         *
- *     /\_/\     Oh my god meow! you found me!                             *
- *    ( o.o )    It's the companion we shipped pre-DLC.                    *
- *     > ^ <     And littele kitten believes in your math skills.          * 
- *                                                                         *
- *   If all else fails, you can always team up with our other legendary    *
- *   companion the Casio FX-991EX, to tackle the challenges!               *
- *                                                                         *
- * ======================================================================= */
 
-
-/* ============================================================ *
- * 7. Tools (Auto Tests & File Operations for Signal Analyzer)  *
- * ============================================================ */
-void menu_tools(void)
+/* ---- Connections and workers ---- */
+static void srv_serve_connection(SrvWorker *w, int fd)
 {
-    int running = 1;
-
-    while (running) {
-        printf("\n------ Tools (Auto Tests & Files for Signal Analyzer) ------\n");
-        printf("1. Generate sample file for Signal Analyzer\n");
-        printf("2. Auto-test Signal Analyzer (load + stats + graph)\n");
-        printf("3. Back to Main Menu\n");
-        printf("----------------------------------------\n");
-
-        int choice = uc_get_choice();
+    size_t have = 0;
+    int quit = 0;
+
+    w->out.fd = fd;
+    w->out.len = 0;
+    w->out.error = 0;
+
+    /* The worker is tied up while the client holds the connection, so one  *
+     * that stops talking (or stops reading its answers) is dropped.         */
+    struct timeval idle = { SRV_IDLE_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &idle, sizeof(idle));
+
+    while (!quit && !w->out.error) {
+        ssize_t got = read(fd, w->in + have, SRV_IN_SIZE - have);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            srv_fail(&w->out, "idle timeout");
+            sa_out_flush(&w->out);
+            break;
+        }
+        if (got <= 0) break;
+
+        char *line = w->in;
+        char *end = w->in + have + got;
+        char *nl;
+        while (!quit && (nl = memchr(line, '\n', (size_t)(end - line))) != NULL) {
+            *nl = '\0';
+            if (nl > line && nl[-1] == '\r') nl[-1] = '\0';
+
+            double t0 = sa_live_now();
+            int rc = srv_handle(w, line);
+            unsigned long long ns = (unsigned long long)((sa_live_now() - t0) * 1e9);
+
+            quit = (rc == SRV_QUIT);
+            atomic_store_explicit(&w->requests, atomic_load_explicit(&w->requests, memory_order_relaxed) + 1,
+                                  memory_order_relaxed);
+            atomic_store_explicit(&w->busy_ns, atomic_load_explicit(&w->busy_ns, memory_order_relaxed) + ns,
+                                  memory_order_relaxed);
+            if (ns > atomic_load_explicit(&w->max_ns, memory_order_relaxed)) {
+                atomic_store_explicit(&w->max_ns, ns, memory_order_relaxed);
+            }
+            if (rc == SRV_FAILED) {
+                atomic_store_explicit(&w->errors, atomic_load_explicit(&w->errors, memory_order_relaxed) + 1,
+                                      memory_order_relaxed);
+            }
+            line = nl + 1;
+        }
+        sa_out_flush(&w->out);            /* one write for everything answered */
 
-        switch (choice) {
-            case 1:
-                tools_generate_sample_file();
-                break;
-            case 2:
-                tools_run_auto_test();
-                break;
-            case 3:
-                running = 0;
-                break;
-            default:
-                printf("Unknown option.\n");
-                break;
+        have = (size_t)(end - line);
+        if (have == SRV_IN_SIZE) {
+            srv_fail(&w->out, "request line too long");
+            sa_out_flush(&w->out);
+            break;
         }
+        memmove(w->in, line, have);
     }
 }
-static void tools_generate_sample_file(void)      /* Generate a file with simple test data, 5 samples already put in */
+static void *srv_worker(void *arg)
 {
-    const char *filename = "samples_auto.txt";
+    SrvWorker *w = arg;
+    SrvServer *srv = w->srv;
 
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        printf("\nError: Could not open '%s' for writing.\n", filename);
-        return;
+    for (;;) {
+        pthread_mutex_lock(&srv->lock);
+        while (srv->count == 0 && !srv->stopping) {
+            pthread_cond_wait(&srv->ready, &srv->lock);
+        }
+        if (srv->count == 0) {            /* stopping and nothing queued */
+            pthread_mutex_unlock(&srv->lock);
+            break;
+        }
+        int fd = srv->queue[srv->head];
+        srv->head = (srv->head + 1) % SRV_QUEUE;
+        srv->count--;
+        int stopping = srv->stopping;     /* written under the lock by tools_serve() */
+        atomic_store(&w->fd, fd);
+        pthread_mutex_unlock(&srv->lock);
+
+        if (!stopping) {
+            srv_serve_connection(w, fd);
+        }
+        atomic_store(&w->fd, -1);
+        close(fd);
     }
+    return NULL;
+}
 
-    /* put in 5 samples */
-    fprintf(fp, "1.0\n");
-    fprintf(fp, "2.0\n");
-    fprintf(fp, "3.0\n");
-    fprintf(fp, "4.0\n");
-    fprintf(fp, "5.0\n");
+/* Bind the listening socket; a stale socket file (no server) is replaced */
+static int srv_listen(const char *path)
+{
+    struct sockaddr_un addr;
 
-    fclose(fp);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("\n[Serve] Socket path '%s' is too long.\n", path);
+        return -1;
+    }
+    memcpy(addr.sun_path, path, strlen(path) + 1);
 
-    printf("\n[Tools] Wrote 5 samples to '%s'.\n", filename);
-    printf("Values: 1.0, 2.0, 3.0, 4.0, 5.0\n");
-    printf("You can now use 'Tools -> Auto-test' to analyse this file.\n");
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        printf("\n[Serve] socket(): %s.\n", strerror(errno));
+        return -1;
+    }
+    struct stat sb;
+    if (lstat(path, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            printf("\n[Serve] Another server is already listening on '%s'.\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        printf("\n[Serve] Could not listen on '%s': %s.\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
-static void tools_save_stats_silent(const char *filename)
+
+int tools_serve(const char *socket_path, int nworkers)
 {
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        printf("Error: could not open '%s' for writing.\n", filename);
-        return;
+    SrvServer srv;
+
+    if (!socket_path || !*socket_path) socket_path = SRV_DEFAULT_SOCKET;
+    if (nworkers <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        nworkers = (cores > SRV_MIN_WORKERS) ? (int)cores : SRV_MIN_WORKERS;
+    }
+    if (nworkers > SRV_MAX_WORKERS) nworkers = SRV_MAX_WORKERS;
+
+    memset(&srv, 0, sizeof(srv));
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.ready, NULL);
+    srv.started = sa_live_now();
+    srv.workers = calloc((size_t)nworkers, sizeof(SrvWorker));
+    if (!srv.workers) {
+        printf("\n[Serve] Out of memory.\n");
+        return 0;
     }
 
-    fprintf(fp, "Count: %d\n", g_last_signal.count);
-    fprintf(fp, "Min: %f\n",  g_last_signal.min);
-    fprintf(fp, "Max: %f\n",  g_last_signal.max);
-    fprintf(fp, "Mean: %f\n", g_last_signal.mean);
-    fprintf(fp, "RMS: %f\n",  g_last_signal.rms);
+    int listen_fd = srv_listen(socket_path);
+    if (listen_fd < 0) {
+        free(srv.workers);
+        return 0;
+    }
 
-    fclose(fp);
-    printf("Saving results to '%s'... done.\n", filename);
-}
-static void tools_run_auto_test(void)     /* Auto Test */
-{
-    const char *filename = "samples_auto.txt";
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = srv_on_signal;        /* no SA_RESTART: poll() returns EINTR */
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);             /* a client that hangs up is just closed */
+    g_srv_stop = 0;
+
+    /* Workers get their buffers before the first request arrives */
+    for (int i = 0; i < nworkers; i++) {
+        SrvWorker *w = &srv.workers[i];
+        w->srv = &srv;
+        atomic_init(&w->fd, -1);
+        w->in = malloc(SRV_IN_SIZE);
+        w->out.fd = -1;
+        sa_ctx_init(&w->ctx);
+        if (!w->in || !sa_out_need(&w->out, 1) ||
+            pthread_create(&w->thread, NULL, srv_worker, w) != 0) {
+            free(w->in);
+            sa_out_release(&w->out);
+            sa_ctx_free(&w->ctx);
+            break;
+        }
+        srv.nworkers++;
+    }
 
-    printf("\n[Tools] Running Auto-Test on '%s'...\n", filename);
+    if (srv.nworkers > 0) {
+        printf("\n[Serve] Listening on '%s' with %d workers (Ctrl+C to stop).\n",
+               socket_path, srv.nworkers);
+        fflush(stdout);
+    } else {
+        printf("\n[Serve] Could not start any worker.\n");
+        g_srv_stop = 1;
+    }
 
-    /* 1. Load sample file */
-    if (!sa_load_from_file_generic(filename)) {
-        printf("[Tools] Auto-Test aborted (could not load samples).\n");
-        return;
+    while (!g_srv_stop) {
+        struct pollfd pfd = { listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 500) <= 0) {
+            continue;                     /* timeout or a signal: re-check the flag */
+        }
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        pthread_mutex_lock(&srv.lock);
+        if (srv.count == SRV_QUEUE) {
+            pthread_mutex_unlock(&srv.lock);
+            static const char busy[] = "ERR server busy\n";
+            ssize_t w = write(fd, busy, sizeof(busy) - 1);
+            (void)w;
+            close(fd);
+            continue;
+        }
+        srv.queue[(srv.head + srv.count) % SRV_QUEUE] = fd;
+        srv.count++;
+        atomic_fetch_add(&srv.connections, 1);
+        pthread_cond_signal(&srv.ready);
+        pthread_mutex_unlock(&srv.lock);
     }
 
-    /* 2. Compute the statistics result and then print it */
-    printf("\n[Tools] Calculating statistics...\n");
-    sa_calculate_stats();
+    /* Stop: no new connections, wake the idle workers, end the open ones */
+    close(listen_fd);
+    unlink(socket_path);
+    pthread_mutex_lock(&srv.lock);
+    srv.stopping = 1;
+    pthread_cond_broadcast(&srv.ready);
+    for (int i = 0; i < srv.nworkers; i++) {
+        int fd = atomic_load(&srv.workers[i].fd);
+        if (fd >= 0) shutdown(fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&srv.lock);
 
-    /* 3. Print ASCII Graph */
-    printf("\n[Tools] Drawing ASCII plot...\n");
-    sa_plot_graph();
+    unsigned long long req, err, busy_ns, max_ns;
+    for (int i = 0; i < srv.nworkers; i++) {
+        pthread_join(srv.workers[i].thread, NULL);
+    }
+    srv_totals(&srv, &req, &err, &busy_ns, &max_ns);
+    for (int i = 0; i < srv.nworkers; i++) {
+        free(srv.workers[i].in);
+        sa_out_release(&srv.workers[i].out);
+        sa_ctx_free(&srv.workers[i].ctx);
+    }
+    sa_runlog_sync();
 
-    /* 4. Save the results and inform the user that the save was successful. */
-    printf("\n[Tools] Saving results...\n");
-    tools_save_stats_silent("signal_stats.txt");
+    printf("\n[Serve] Stopped: %llu connections, %llu requests (%llu errors), "
+           "mean %.2f us, max %.2f us per request.\n",
+           (unsigned long long)atomic_load(&srv.connections), req, err,
+           req ? (double)busy_ns / (double)req * 1e-3 : 0.0, (double)max_ns * 1e-3);
 
-    printf("\n[Tools] Auto-Test complete.\n");
-}
\ No newline at end of file
+    free(srv.workers);
+    pthread_cond_destroy(&srv.ready);
+    pthread_mutex_destroy(&srv.lock);
+    return 1;
+}
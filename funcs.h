@@ -4,7 +4,7 @@
 
 /* This header exposes:                                        *
  *   - The shared SignalStats structure used across modules    *
- *   - External access to the global g_last_signal instance    *
+ *   - The SignalContext analysis API (reentrant, no globals)  *
  *   - Menu entry-point functions for all application modules  *
  *   - Sub-functions for the Signal Analyzer                   */
 /* All implementations are provided in funcs.c and are invoked from main.c based on user selection from the main menu. */
@@ -12,22 +12,340 @@
 #ifndef FUNCS_H
 #define FUNCS_H
 
-#define MAX_SAMPLES 128  /* Maximum number of samples stored/processed */
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_SAMPLES 128  /* Maximum number of samples entered by hand / kept from a live stream */
 
 
 /* --------- Shared signal data structure --------- */
 /* Used by:  Signal Analyzer / Tools (Auto-test module) / Any other module that needs to access recent analysis results */
 typedef struct {
-    double samples[MAX_SAMPLES];       /* Raw sample array */
+    double *samples;                   /* Raw sample array (heap, grows as samples are appended) */
+    int    capacity;                   /* Allocated length of samples[] */
     int    count;                      /* Number of valid samples */
     double mean;                       /* Arithmetic mean */
     double rms;                        /* Root-mean-square */
     double min;                        /* Minimum value */
     double max;                        /* Maximum value */
+
+    /* Cached sufficient statistics, kept current by sa_signal_append() */
+    double sum;                        /* Sum of the samples */
+    double sum_sq;                     /* Sum of the squared samples */
+    int    dirty;                      /* 1 = samples edited in place, cache needs a rescan */
+    unsigned long generation;          /* Incremented on every change to the samples */
 } SignalStats;
 
-/* Global variable holding the MOST RECENT signal-analysis result */
-extern SignalStats g_last_signal;  /* Defined in funcs.c, declared here for cross-module use */
+/* --------- Signal analysis context --------- */
+/* Everything one analysis owns.  The sa_ctx_* functions only touch the context  *
+ * they are given, so separate contexts can be used on different threads.        *
+ * A zero-initialised context (or sa_ctx_init) is a valid empty one.             */
+typedef struct {
+    SignalStats sig;                   /* Samples and cached statistics */
+    char        source[256];           /* Where the samples came from (file name, "manual entry", ...) */
+    double     *scratch;               /* Reusable work buffer for derived series */
+    size_t      scratch_cap;           /* Length of scratch[] in doubles */
+} SignalContext;
+
+/* Where the time went in sa_ctx_load_pipelined() (timing may be NULL) */
+typedef struct {
+    double             wall_s;         /* Whole load */
+    double             read_s;         /* Reader thread blocked in read() */
+    double             parse_s;        /* Calling thread parsing and storing samples */
+    long long          bytes;
+    unsigned long long hash;           /* XXH64 of the file contents */
+} SignalPipeTiming;
+
+/* Status codes returned by the sa_ctx_* functions */
+enum {
+    SA_OK         =  0,
+    SA_ERR_OPEN   = -1,                /* File could not be opened */
+    SA_ERR_EMPTY  = -2,                /* No samples (none loaded / none found in file) */
+    SA_ERR_MEMORY = -3,                /* Allocation failed */
+    SA_ERR_FORMAT = -4                 /* File is not in the expected format */
+};
+
+/* --------- Distribution of the samples (sa_ctx_percentiles) --------- */
+typedef struct {
+    double p50;                        /* Median */
+    double p95;
+    double p99;
+    double p999;                       /* 99.9th percentile */
+    int    exact;                      /* 1 = exact order statistics, 0 = histogram-sketch estimate */
+} SignalPercentiles;
+
+SignalContext *sa_default_context(void);                         /* The context used by the menus */
+void    sa_ctx_init(SignalContext *ctx);
+void    sa_ctx_free(SignalContext *ctx);                          /* Release samples and scratch memory */
+double *sa_ctx_scratch(SignalContext *ctx, size_t n);             /* Work buffer of at least n doubles */
+int     sa_ctx_load_file(SignalContext *ctx, const char *filename);
+int     sa_ctx_load_pipelined(SignalContext *ctx, const char *filename,
+                              SignalPipeTiming *timing);   /* Reader thread overlaps I/O and parsing */
+int     sa_ctx_calculate(SignalContext *ctx);                     /* Update mean/rms/min/max */
+int     sa_ctx_plot(SignalContext *ctx);                          /* ASCII bar graph and histogram to stdout */
+int     sa_ctx_save_stats(SignalContext *ctx, const char *filename);
+int     sa_ctx_percentiles(SignalContext *ctx, SignalPercentiles *pct);
+int     sa_ctx_histogram(SignalContext *ctx, long long *bins, int nbins);  /* nbins equal bins over [min, max] */
+
+/* --------- Structured stats output and results log --------- */
+enum { SA_SAVE_TEXT = 0, SA_SAVE_JSON = 1, SA_SAVE_CSV = 2, SA_SAVE_BINARY = 3 };
+
+#define SA_RUN_LOG "signal_runs.jsonl"  /* Append-only, one JSON object per analysis run */
+
+int     sa_ctx_save_stats_as(SignalContext *ctx, const char *filename, int format);  /* SA_SAVE_* */
+int     sa_ctx_log_run(SignalContext *ctx, const char *mode, double started);       /* started: Unix time, 0 = now */
+int     sa_runlog_sync(void);                                     /* Write and fsync pending log records */
+
+/* Statistics of a file through the on-disk result cache (.etk_cache/):  *
+ * unchanged files (size, mtime, content hash) are not read again.       *
+ * st->samples stays NULL; pct may be NULL.                              */
+int     sa_file_stats_cached(const char *filename, SignalStats *st, SignalPercentiles *pct,
+                             int *from_cache);
+
+/* --------- Multi-channel capture (structure of arrays) --------- */
+#define SA_MAX_CHANNELS 64
+
+typedef struct {
+    double mean, rms, min, max;
+} SignalChannelStats;
+
+/* Channel c occupies data[c * stride .. c * stride + frames).  Each channel   *
+ * starts on a 64-byte boundary; stride is padded to whole cache lines.        */
+typedef struct {
+    int     channels;                  /* 1..SA_MAX_CHANNELS */
+    int     frames;                    /* Samples per channel */
+    int     capacity;                  /* Frames that fit before the buffer grows */
+    size_t  stride;                    /* Doubles from one channel's start to the next */
+    double *data;                      /* Aligned block holding all channels */
+    SignalChannelStats stats[SA_MAX_CHANNELS];   /* Filled by sa_ch_calculate() */
+    long long bad_rows;                /* Lines skipped for having the wrong number of values */
+    char    source[256];
+} SignalChannels;
+
+void    sa_ch_init(SignalChannels *mc);
+void    sa_ch_free(SignalChannels *mc);
+/* channels 0 = detect.  *mc is replaced only on success; SA_ERR_FORMAT for more than SA_MAX_CHANNELS */
+int     sa_ch_load_file(SignalChannels *mc, const char *filename, int channels);
+const double *sa_ch_data(const SignalChannels *mc, int channel);
+int     sa_ch_calculate(SignalChannels *mc);                     /* Per-channel stats, parallel when large */
+int     sa_ch_save_stats(SignalChannels *mc, const char *filename);
+int     sa_ch_to_context(const SignalChannels *mc, int channel, SignalContext *ctx);
+
+/* --------- Reduced-precision sample storage --------- */
+enum { SA_STORE_F32 = 1, SA_STORE_I32 = 2, SA_STORE_I16 = 3 };
+
+/* Integer formats hold ADC codes: value = code * scale + offset.  Values   *
+ * outside the code range are clipped (and counted).                       */
+typedef struct {
+    int       format;                  /* SA_STORE_* */
+    int       count;
+    int       capacity;
+    double    scale;                   /* Value of one code (1 for float32) */
+    double    offset;                  /* Value of code 0 (0 for float32) */
+    void     *data;                    /* 64-byte aligned float / int32_t / int16_t array */
+    long long clipped;
+    char      source[256];
+} SignalCompact;
+
+void    sa_compact_init(SignalCompact *pk, int format, double scale, double offset);
+void    sa_compact_free(SignalCompact *pk);
+size_t  sa_compact_bytes(const SignalCompact *pk);
+int     sa_compact_load_file(SignalCompact *pk, const char *filename);
+int     sa_compact_from_context(SignalCompact *pk, const SignalContext *ctx);
+int     sa_compact_to_context(const SignalCompact *pk, SignalContext *ctx);
+double  sa_compact_value(const SignalCompact *pk, int i);
+int     sa_compact_stats(const SignalCompact *pk, SignalChannelStats *st);   /* Widening SIMD pass */
+
+/* Compressed captures (.etkz): lossless delta + zigzag + bit-packed blocks */
+int     sa_codec_write(const SignalCompact *pk, const char *filename, size_t *bytes_out);
+int     sa_codec_read(SignalCompact *pk, const char *filename);               /* Parallel decode */
+int     sa_codec_stats(const char *filename, SignalChannelStats *st, long long *count);  /* No decode buffer */
+
+/* --------- Spectrogram (short-time Fourier transform) --------- */
+#define SA_STFT_ROWS 32                /* Heat map grid: time slices */
+#define SA_STFT_COLS 64                /*                frequency columns */
+
+typedef struct {
+    int       window;                  /* Frame length (power of two) */
+    int       hop;                     /* Samples between frame starts */
+    int       bins;                    /* window / 2 + 1, 0 Hz to Nyquist */
+    long long frames;
+    double    sample_rate;             /* Hz, 0 = not given */
+    int       rows, cols;              /* Used part of cells[] */
+    float     peak_db;
+    float     cells[SA_STFT_ROWS * SA_STFT_COLS];  /* Max-pooled dB, row-major */
+} SignalSpectrogram;
+
+/* Hann-windowed STFT of the samples, frames computed in parallel.  The full   *
+ * frames x bins dB matrix is streamed to filename (NULL = heat map only).     *
+ * SA_ERR_FORMAT for a bad window / hop, SA_ERR_EMPTY with fewer than window  *
+ * samples.                                                                    */
+int     sa_ctx_stft(SignalContext *ctx, int window, int hop, double sample_rate,
+                    const char *filename, SignalSpectrogram *spec);
+
+/* --------- Event detection --------- */
+enum { SA_EVT_RISE = 0, SA_EVT_FALL = 1, SA_EVT_GLITCH = 2, SA_EVT_DROPOUT = 3, SA_EVT_KINDS = 4 };
+
+typedef struct {
+    double    lo, hi;                  /* Schmitt trigger thresholds, lo < hi */
+    double    glitch_width;            /* Pulses narrower than this (samples) are glitches; 0 = off */
+    double    dropout_level;           /* |x| <= level counts as no signal */
+    long long dropout_min;             /* Samples of no signal that make a dropout; 0 = off */
+} SignalEventConfig;
+
+/* Times and durations are in samples (fractional: interpolated crossings) */
+typedef struct {
+    int       kind;                    /* SA_EVT_* */
+    int       polarity;                /* 1 = high-going, -1 = low-going */
+    long long start, end;              /* Samples [start, end) the event covers */
+    double    time;                    /* Threshold crossing (edges, glitches) or start (dropouts) */
+    double    duration;                /* Rise / fall time, glitch width, dropout length; NaN if unknown */
+    double    min, max, mean;          /* Over [start, end) */
+} SignalEvent;
+
+typedef struct {
+    SignalEvent *events;               /* Kept events in time order */
+    size_t       count, cap;
+    long long    total[SA_EVT_KINDS];  /* Every event found, kept or not */
+    long long    dropped;              /* Found but not kept (storage limit) */
+    long long    samples;              /* Samples scanned */
+    long long    dropout_samples;
+    long long    trans_n[2];           /* Rise [0] / fall [1] time summary */
+    double       trans_min[2], trans_max[2], trans_sum[2];
+} SignalEventList;
+
+int     sa_ctx_events(SignalContext *ctx, const SignalEventConfig *cfg, SignalEventList *out);
+int     sa_events_save(const SignalEventList *ev, double sample_rate, const char *filename);  /* CSV */
+void    sa_events_free(SignalEventList *ev);
+
+/* --------- Cross-correlation of two captures --------- */
+typedef struct {
+    int       max_lag;
+    double   *r;                       /* 2 max_lag + 1 correlation coefficients, r[max_lag + lag] */
+    int       peak_lag;                /* Lag of the largest |r| */
+    double    peak_r;                  /* r there (negative: B is inverted) */
+    double    delay;                   /* Peak lag refined between samples: B[n + delay] ~ A[n] */
+    int       segment;                 /* Coherence segment length */
+    int       bins;                    /* segment / 2 + 1 */
+    long long segments;                /* Segments averaged */
+    double   *coherence;               /* bins values in 0..1; NULL if the overlap is shorter than a segment */
+    double    mean_coherence;          /* Over bins 1 .. bins-2 */
+} SignalXcorr;
+
+/* FFT block correlation (memory independent of the capture length) and  *
+ * Welch coherence of A and B aligned at the peak lag.                    *
+ * SA_ERR_FORMAT for a bad lag / segment.                                 */
+int     sa_ctx_xcorr(SignalContext *a, SignalContext *b, int max_lag, int segment, SignalXcorr *out);
+int     sa_xcorr_save(const SignalXcorr *xc, double sample_rate, const char *xcorr_file,
+                      const char *coh_file);                         /* CSV; coh_file may be NULL */
+void    sa_xcorr_free(SignalXcorr *xc);
+
+/* --------- Circuit Calculator: Monte Carlo tolerance analysis --------- */
+enum { CC_MC_DIVIDER = 0, CC_MC_RC = 1, CC_MC_LED = 2 };
+enum { CC_DIST_UNIFORM = 0, CC_DIST_GAUSS = 1 };      /* Gaussian: tolerance = 3 sigma */
+
+#define CC_MC_BINS 4096                /* Histogram bins over the worst-case range */
+
+typedef struct {
+    double nominal;
+    double tol_pct;                    /* +/- percent */
+} CcPart;
+
+typedef struct {
+    int       circuit;                 /* CC_MC_* */
+    int       dist;                    /* CC_DIST_* */
+    CcPart    part[3];                 /* Divider: R1, R2; RC: R, C (uF); LED: Vs, Vf, R */
+    double    vin;                     /* Divider input voltage */
+    long long trials;
+    double    spec_pct;                /* Accepted: within +/- spec_pct of the nominal output */
+    uint64_t  seed;
+} CcMonteCarloConfig;
+
+typedef struct {
+    long long trials, in_spec;
+    double    nominal;
+    double    wc_min, wc_max;          /* All parts at their tolerance limits */
+    double    mean, stddev, min, max;
+    double    p_low, p50, p_high;      /* 0.135%, 50%, 99.865% (the +/-3 sigma points) */
+    double    hist_min, hist_max;
+    long long hist[CC_MC_BINS];
+} CcMonteCarloResult;
+
+int     cc_monte_carlo(const CcMonteCarloConfig *cfg, CcMonteCarloResult *res);  /* 1 on success */
+
+/* --------- Circuit Calculator: transient simulation of a ladder network --------- */
+enum { CC_SRC_STEP = 0, CC_SRC_PULSE = 1, CC_SRC_SAMPLED = 2 };
+
+#define CC_TR_MAX_SECTIONS 10000
+#define CC_TR_MAX_OUTPUT   100000000   /* Output samples per run */
+
+typedef struct {
+    double R;                          /* Series resistance from the previous node, ohms */
+    double L;                          /* Series inductance, henries (0 = none) */
+    double C;                          /* Shunt capacitance to ground, farads (0 = none) */
+    double G;                          /* Shunt conductance to ground, siemens (0 = none) */
+} CcLadderSection;
+
+typedef struct {
+    const CcLadderSection *section;    /* section[0] is driven by the source */
+    int    nsections;
+    int    probe;                      /* Node voltage recorded, 1..nsections */
+    int    source;                     /* CC_SRC_* */
+    double v1, v2;                     /* Level before / after the step; pulse low / high */
+    double delay, width, period;       /* Seconds; step uses delay only; period 0 = single pulse */
+    const SignalContext *input;        /* CC_SRC_SAMPLED: one sample per 1/sample_rate, linear between */
+    double sample_rate;                /* Output (and sampled input) rate, Hz */
+    double duration;                   /* Seconds simulated */
+    double reltol;                     /* Local error per step (0 = 1e-4) */
+} CcTransientConfig;
+
+typedef struct {
+    long long steps, rejected, factorizations;
+    double    h_min, h_max;            /* Smallest / largest step accepted, s */
+} CcTransientStats;
+
+/* Probe waveform into out (not cfg->input) and, if filename is set, one value  *
+ * per line into that file.  SA_ERR_FORMAT for invalid settings or a circuit    *
+ * without a solution (an inductor ending in an open node).                    */
+int     cc_transient(const CcTransientConfig *cfg, SignalContext *out, const char *filename,
+                     CcTransientStats *st);
+
+/* --------- Circuit Calculator: frequency response (Bode) sweep --------- */
+#define CC_BODE_MAX_SECTIONS 16
+#define CC_BODE_MIN_POINTS   2
+#define CC_BODE_MAX_POINTS   100000000
+#define CC_BODE_COLS         64        /* Columns of the ASCII Bode plot */
+
+enum { CC_BODE_BINARY = 0, CC_BODE_CSV = 1 };
+
+/* (b0 + b1 s + b2 s^2) / (a0 + a1 s + a2 s^2), s = j 2 pi f */
+typedef struct {
+    double b[3];
+    double a[3];
+} CcBodeSection;
+
+typedef struct {
+    int           nsections;
+    CcBodeSection sec[CC_BODE_MAX_SECTIONS];   /* Multiplied together */
+    char          name[64];
+} CcAnalogFilter;
+
+typedef struct {
+    long long points;
+    double    f_start, f_stop;
+    double    peak_db, peak_hz;
+    double    f_low_3db, f_high_3db;   /* 3 dB below the peak on either side (0 = not in the sweep) */
+    double    col_hz[CC_BODE_COLS];    /* Sweep points sampled for the plot */
+    double    col_db[CC_BODE_COLS];
+    double    col_phase[CC_BODE_COLS]; /* Degrees */
+} CcBodeResult;
+
+int     cc_filter_rc(CcAnalogFilter *flt, double R, double C_uF, int highpass);          /* 1 on success */
+int     cc_filter_butterworth(CcAnalogFilter *flt, int highpass, int order, double fc);  /* order 1-32 */
+int     cc_filter_rlc_bandpass(CcAnalogFilter *flt, double R, double L, double C_uF);    /* Output across R */
+/* Log-spaced sweep, saved as CC_BODE_BINARY (header + float32 dB/degree pairs) or CSV */
+int     cc_bode_sweep(const CcAnalogFilter *flt, double f_start, double f_stop, long long points,
+                      const char *filename, int format, CcBodeResult *res);
 
 /* -------------------- All the main functions for Menu ------------------- */
 /* These functions correspond to the 8 main menu items */
@@ -39,12 +357,39 @@ void menu_unit_converter(void);           /* 5. Unit Converter */
 void menu_engineering_calculator(void);   /* 6. Engineering Calculator */
 void menu_tools(void);                    /* 7. Tools (Auto tests & File I/O) */
 
+/* ------------------------- Signal sample store helpers ------------------------ */
+/* Keep count/sum/sum_sq/min/max in step with samples[] so statistics are O(1).    */
+int  sa_signal_reserve(SignalStats *sig, int capacity);/* Pre-allocate; 0 on allocation failure */
+void sa_signal_free(SignalStats *sig);                 /* Release the sample array */
+void sa_signal_clear(SignalStats *sig);                /* Empty the store (keeps the allocation) */
+int  sa_signal_append(SignalStats *sig, double x);     /* Add one sample; 0 on allocation failure */
+void sa_signal_mark_dirty(SignalStats *sig);           /* Call after editing samples[] in place */
+void sa_signal_refresh(SignalStats *sig);              /* Update mean/rms/min/max (rescans only if dirty) */
+
 /* -------------------------- Signal Analyzer Submenu ------------------------- */
-/* These functions implement the internal options of theSignal Analyzer module. */
+/* These functions implement the internal options of theSignal Analyzer module. *
+ * They operate on the default context.                                        */
 void sa_enter_samples(void);              /* Manual entry of sample data */
 void sa_load_from_file(void);             /* Load samples from samples.txt */
 void sa_calculate_stats(void);            /* Compute mean, RMS, min, max */
 void sa_plot_graph(void);                 /* Print ASCII bar graph */
 void sa_save_stats_to_file(void);         /* Save results to signal_stats.txt */
+void sa_rolling_stats(void);              /* Sliding-window mean/RMS/min/max, saved to signal_rolling.txt */
+void sa_live_stream(void);                /* Live statistics from a FIFO / file (menu prompt) */
+void sa_filter_samples(void);             /* RC / Butterworth biquad / FIR filtering of samples or a file */
+void sa_resample_samples(void);           /* Polyphase L/M resampling of samples or a file */
+void sa_multichannel_menu(void);          /* Interleaved multi-channel files: per-channel stats / plot / save */
+void sa_compact_menu(void);               /* float32 / int32 / int16 storage with widening statistics */
+void sa_codec_menu(void);                 /* Compress / decompress captures, stats while decoding */
+void sa_spectrogram(void);                /* STFT heat map, matrix saved to signal_stft.bin */
+void sa_detect_events(void);              /* Edges, glitches and dropouts, saved to signal_events.csv */
+void sa_cross_correlate(void);            /* Delay and coherence between the samples and a second capture */
+int  sa_live_stream_from(SignalContext *ctx, const char *path, double interval_s);  /* path "-" = stdin; returns 1 on success */
+
+/* ------------------------------- Tools ------------------------------------ */
+int  tools_batch_analyze(const char *pattern, const char *out_file);  /* Directory or glob; returns 1 on success */
+int  tools_auto_test(const char *filename, int pipelined);          /* Load, stats, plot, save; 1 on success */
+int  tools_file_stats(int nfiles, char *const files[]);              /* Cached statistics per file; 1 if all succeeded */
+int  tools_serve(const char *socket_path, int nworkers);             /* Unix-socket request server; 1 after a clean stop */
 
 #endif /* FUNCS_H */
@@ -27,6 +27,10 @@
  *     - Tools (Auto Tests & File Operations for Signal Analyzer):
  *       generates sample data and runs an automated test pipeline
  *       for the signal-analysis functions and save the data.
+ *
+ *     The I/O-free computation cores (statistics, conversions, circuit
+ *     formulas, resistor decoding) live in electoolkit.c; "make lib" also
+ *     builds them as libelectoolkit.a / libelectoolkit.so.
  */
 
 /* This file contains the main() function and the top-level menu handling code. *
@@ -49,9 +53,41 @@ static int  is_integer(const char *s);    /* Check if string is an integer */
 
 /*                        Program entry point.                           *
  * Runs an infinite loop that repeatedly shows the main menu and         *
- * processes the user’s selection until the user chooses the Exit option */
-int main(void)
+ * processes the user’s selection until the user chooses the Exit option *
+ * Command-line modes (no menu):                                         *
+ *     ./main.out --live [path]   live statistics from stdin or a FIFO   *
+ *     ./main.out --batch <dir|glob> [out]   batch statistics table      *
+ *     ./main.out --stats <file>...   statistics through the result cache *
+ *     ./main.out --autotest <file> [--sequential]   pipelined auto-test *
+ *     ./main.out --serve [socket] [workers]   Unix-socket request server */
+int main(int argc, char *argv[])
 {
+    if (argc > 1) {
+        if (strcmp(argv[1], "--live") == 0) {
+            const char *path = (argc > 2) ? argv[2] : "-";
+            return sa_live_stream_from(sa_default_context(), path, 1.0) ? 0 : 1;
+        }
+        if (strcmp(argv[1], "--batch") == 0 && argc > 2) {
+            const char *out = (argc > 3) ? argv[3] : "batch_results.txt";
+            return tools_batch_analyze(argv[2], out) ? 0 : 1;
+        }
+        if (strcmp(argv[1], "--stats") == 0 && argc > 2) {
+            return tools_file_stats(argc - 2, argv + 2) ? 0 : 1;
+        }
+        if (strcmp(argv[1], "--autotest") == 0 && argc > 2) {
+            int pipelined = !(argc > 3 && strcmp(argv[3], "--sequential") == 0);
+            return tools_auto_test(argv[2], pipelined) ? 0 : 1;
+        }
+        if (strcmp(argv[1], "--serve") == 0) {
+            const char *path = (argc > 2) ? argv[2] : NULL;     /* default elec_toolkit.sock */
+            int workers = (argc > 3) ? atoi(argv[3]) : 0;      /* 0 = one per core, at least 4 */
+            return tools_serve(path, workers) ? 0 : 1;
+        }
+        printf("Usage: %s [--live [fifo_or_file] | --batch <dir|glob> [results_file] | --stats <file>...\n"
+               "          | --autotest <file> [--sequential] | --serve [socket] [workers]]\n", argv[0]);
+        return 1;
+    }
+
     /* Run forever until the user selects "Exit" in the main menu */
     for(;;) {
         main_menu();